@@ -0,0 +1,179 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+/*  Sends a file of the specified size over the specified transport a number
+    of times and reports the throughput and the CPU time used. In 'read' mode
+    the file is read into a message buffer before it's sent, in 'sendfile'
+    mode the message refers to the file (see nn_filemsg) and, with TCP and IPC,
+    it's sent straight from the page cache. */
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+
+#include "../src/utils/attr.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/thread.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+static const char *bind_to;
+static size_t size;
+static int count;
+
+static void receiver (NN_UNUSED void *arg)
+{
+    int rc;
+    int s;
+    int opt;
+    int i;
+    void *buf;
+
+    s = nn_socket (AF_SP, NN_PULL);
+    assert (s != -1);
+    opt = -1;
+    rc = nn_setsockopt (s, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, sizeof (opt));
+    assert (rc == 0);
+    rc = nn_bind (s, bind_to);
+    assert (rc >= 0);
+
+    /*  The sender announces itself by an empty message. */
+    rc = nn_recv (s, &buf, NN_MSG, 0);
+    assert (rc == 0);
+    nn_freemsg (buf);
+
+    for (i = 0; i != count; ++i) {
+        rc = nn_recv (s, &buf, NN_MSG, 0);
+        assert (rc == (int) size);
+        nn_freemsg (buf);
+    }
+
+    rc = nn_close (s);
+    assert (rc == 0);
+}
+
+static uint64_t cpu_time (void)
+{
+    int rc;
+    struct rusage ru;
+
+    rc = getrusage (RUSAGE_SELF, &ru);
+    assert (rc == 0);
+    return (uint64_t) (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+        ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+int main (int argc, char *argv [])
+{
+    int rc;
+    int s;
+    int fd;
+    int i;
+    int sendfile;
+    size_t pos;
+    ssize_t nbytes;
+    char *block;
+    void *msg;
+    char name [] = "/tmp/file_thr-XXXXXX";
+    struct nn_thread thread;
+    struct nn_stopwatch stopwatch;
+    uint64_t elapsed;
+    uint64_t cpu;
+    double mbs;
+
+    if (argc != 5 || (strcmp (argv [4], "read") != 0 &&
+          strcmp (argv [4], "sendfile") != 0)) {
+        printf ("usage: file_thr <bind-to> <file-size-MB> <count> "
+            "<read|sendfile>\n");
+        return 1;
+    }
+    bind_to = argv [1];
+    size = (size_t) atoi (argv [2]) * 1024 * 1024;
+    count = atoi (argv [3]);
+    sendfile = strcmp (argv [4], "sendfile") == 0;
+
+    /*  Create the file and make sure it's in the page cache. */
+    fd = mkstemp (name);
+    assert (fd >= 0);
+    rc = unlink (name);
+    assert (rc == 0);
+    block = malloc (1024 * 1024);
+    assert (block);
+    memset (block, 'x', 1024 * 1024);
+    for (pos = 0; pos < size; pos += 1024 * 1024) {
+        nbytes = write (fd, block, 1024 * 1024);
+        assert (nbytes == 1024 * 1024);
+    }
+    free (block);
+
+    nn_thread_init (&thread, receiver, NULL);
+
+    s = nn_socket (AF_SP, NN_PUSH);
+    assert (s != -1);
+    rc = nn_connect (s, bind_to);
+    assert (rc >= 0);
+    rc = nn_send (s, "", 0, 0);
+    assert (rc == 0);
+
+    nn_stopwatch_init (&stopwatch);
+    cpu = cpu_time ();
+    for (i = 0; i != count; ++i) {
+        if (sendfile) {
+            msg = nn_filemsg (fd, 0, size);
+            assert (msg);
+        }
+        else {
+            msg = nn_allocmsg (size, 0);
+            assert (msg);
+            for (pos = 0; pos < size; pos += nbytes) {
+                nbytes = pread (fd, (char*) msg + pos, size - pos, pos);
+                assert (nbytes > 0);
+            }
+        }
+        rc = nn_send (s, &msg, NN_MSG, 0);
+        assert (rc == (int) size);
+    }
+    nn_thread_term (&thread);
+    elapsed = nn_stopwatch_term (&stopwatch);
+    cpu = cpu_time () - cpu;
+
+    rc = nn_close (s);
+    assert (rc == 0);
+    close (fd);
+
+    mbs = (double) size * count / elapsed;
+    printf ("mode: %s\n", argv [4]);
+    printf ("message size: %d [B]\n", (int) size);
+    printf ("message count: %d\n", count);
+    printf ("throughput: %.3f [MB/s]\n", mbs);
+    printf ("CPU time: %.3f [s]\n", (double) cpu / 1000000);
+
+    return 0;
+}
@@ -0,0 +1,794 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+/*  Benchmark driver. Runs each of the scalability protocols over each of
+    the transports within a single process, sweeping message sizes, number
+    of connections and number of threads, and prints one line of results per
+    combination, either as CSV or as JSON.
+
+    The first 8 bytes of each message carry the time it was sent at, so that
+    the receiving side can compute the latency. It's one-way latency for
+    pair, pipeline, pubsub and bus, and round-trip latency for reqrep and
+    survey. */
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/pipeline.h"
+#include "../src/pubsub.h"
+#include "../src/reqrep.h"
+#include "../src/survey.h"
+#include "../src/bus.h"
+
+#include "../src/utils/attr.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/thread.c"
+#include "../src/utils/sleep.c"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined NN_HAVE_WINDOWS
+#include "../src/utils/win.h"
+#else
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+/*  Maximum number of items in each of the lists passed on command line. */
+#define BENCH_MAXLIST 32
+
+/*  How long to wait for a peer before declaring the rest of the messages
+    lost, in milliseconds. */
+#define BENCH_TIMEOUT 5000
+
+struct bench;
+
+struct bench_proto {
+    const char *name;
+    int central;
+    int peer;
+    int roundtrip;
+    int maxconns;
+    void (*run) (struct bench *self);
+};
+
+/*  Results collected by a single thread. */
+struct bench_samples {
+    uint64_t *lat;
+    size_t count;
+    size_t capacity;
+    uint64_t last;
+};
+
+struct bench_worker {
+    struct bench *bench;
+    struct nn_thread thread;
+    int *socks;
+    int nsocks;
+    struct bench_samples samples;
+};
+
+struct bench {
+    const struct bench_proto *proto;
+    const char *transport;
+    char addr [128];
+    size_t size;
+    int conns;
+    int threads;
+    int count;
+
+    int central;
+    int peers [1024];
+    struct bench_worker workers [BENCH_MAXLIST];
+    struct bench_samples samples;
+    uint64_t start;
+};
+
+static void bench_fanin (struct bench *self);
+static void bench_fanout (struct bench *self);
+static void bench_reqrep (struct bench *self);
+static void bench_survey (struct bench *self);
+
+static const struct bench_proto bench_protos [] = {
+    {"pair", NN_PAIR, NN_PAIR, 0, 1, bench_fanin},
+    {"pipeline", NN_PULL, NN_PUSH, 0, 0, bench_fanin},
+    {"reqrep", NN_REP, NN_REQ, 1, 0, bench_reqrep},
+    {"pubsub", NN_PUB, NN_SUB, 0, 0, bench_fanout},
+    {"bus", NN_BUS, NN_BUS, 0, 0, bench_fanout},
+    {"survey", NN_SURVEYOR, NN_RESPONDENT, 1, 0, bench_survey}
+};
+
+#define BENCH_NPROTOS ((int) (sizeof (bench_protos) / sizeof (bench_protos [0])))
+
+static int bench_json;
+static int bench_port = 5555;
+static int bench_run_id;
+
+static uint64_t bench_now (void)
+{
+#if defined NN_HAVE_WINDOWS
+    LARGE_INTEGER tps;
+    LARGE_INTEGER time;
+
+    QueryPerformanceFrequency (&tps);
+    QueryPerformanceCounter (&time);
+    return (uint64_t) (time.QuadPart / tps.QuadPart * 1000000000 +
+        time.QuadPart % tps.QuadPart * 1000000000 / tps.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/*  CPU time consumed by the whole process, in nanoseconds. */
+static uint64_t bench_cpu (void)
+{
+#if defined NN_HAVE_WINDOWS
+    FILETIME creation, exit, kernel, user;
+    ULARGE_INTEGER k, u;
+
+    GetProcessTimes (GetCurrentProcess (), &creation, &exit, &kernel, &user);
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) * 100;
+#else
+    struct rusage ru;
+
+    getrusage (RUSAGE_SELF, &ru);
+    return ((uint64_t) ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000 +
+        ((uint64_t) ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000;
+#endif
+}
+
+static void bench_samples_init (struct bench_samples *self, size_t capacity)
+{
+    self->lat = malloc ((capacity ? capacity : 1) * sizeof (uint64_t));
+    alloc_assert (self->lat);
+    self->count = 0;
+    self->capacity = capacity;
+    self->last = 0;
+}
+
+static void bench_samples_term (struct bench_samples *self)
+{
+    free (self->lat);
+}
+
+/*  Records the latency of a message stamped by bench_stamp. */
+static void bench_record (struct bench_samples *self, void *msg)
+{
+    uint64_t sent;
+    uint64_t now;
+
+    memcpy (&sent, msg, sizeof (sent));
+    now = bench_now ();
+    if (self->count < self->capacity)
+        self->lat [self->count++] = now - sent;
+    self->last = now;
+}
+
+static void bench_stamp (void *msg)
+{
+    uint64_t now;
+
+    now = bench_now ();
+    memcpy (msg, &now, sizeof (now));
+}
+
+static void *bench_msg (struct bench *self)
+{
+    void *msg;
+
+    msg = nn_allocmsg (self->size, 0);
+    alloc_assert (msg);
+    memset (msg, 111, self->size);
+    bench_stamp (msg);
+    return msg;
+}
+
+/*  Sends a freshly stamped message. Returns 0 on success, -1 on failure. */
+static int bench_send (struct bench *self, int s)
+{
+    int rc;
+    void *msg;
+
+    msg = bench_msg (self);
+    rc = nn_send (s, &msg, NN_MSG, 0);
+    if (rc < 0) {
+        nn_freemsg (msg);
+        return -1;
+    }
+    return 0;
+}
+
+static void bench_setopt (int s, int level, int option, int val)
+{
+    int rc;
+
+    rc = nn_setsockopt (s, level, option, &val, sizeof (val));
+    errno_assert (rc == 0);
+}
+
+static int bench_socket (int protocol)
+{
+    int s;
+
+    s = nn_socket (AF_SP, protocol);
+    errno_assert (s >= 0);
+    bench_setopt (s, NN_SOL_SOCKET, NN_RCVTIMEO, BENCH_TIMEOUT);
+    bench_setopt (s, NN_SOL_SOCKET, NN_SNDTIMEO, BENCH_TIMEOUT);
+    bench_setopt (s, NN_SOL_SOCKET, NN_RCVMAXSIZE, -1);
+    if (protocol == NN_SUB) {
+        nn_assert (nn_setsockopt (s, NN_SUB, NN_SUB_SUBSCRIBE, "", 0) == 0);
+    }
+    if (protocol == NN_PUB || protocol == NN_BUS) {
+
+        /*  Make the publisher wait for slow subscribers instead of dropping
+            the messages. */
+        bench_setopt (s, NN_SOL_SOCKET, NN_SNDQUEUE_MSGS, 1024);
+        bench_setopt (s, NN_SOL_SOCKET, NN_SNDQUEUE_POLICY, NN_SNDQUEUE_BLOCK);
+    }
+    if (protocol == NN_SURVEYOR)
+        bench_setopt (s, NN_SURVEYOR, NN_SURVEYOR_DEADLINE, BENCH_TIMEOUT);
+    return s;
+}
+
+/*  Creates the central socket and the peers. Returns -1 if the transport
+    is not available. */
+static int bench_setup (struct bench *self)
+{
+    int rc;
+    int i;
+
+    ++bench_run_id;
+    if (strcmp (self->transport, "inproc") == 0)
+        sprintf (self->addr, "inproc://nn_bench_%d", bench_run_id);
+    else if (strcmp (self->transport, "ipc") == 0)
+        sprintf (self->addr, "ipc://nn_bench_%d.ipc", bench_run_id);
+    else if (strcmp (self->transport, "shm") == 0)
+        sprintf (self->addr, "shm://nn_bench_%d.shm", bench_run_id);
+    else
+        sprintf (self->addr, "%s://127.0.0.1:%d", self->transport,
+            bench_port++);
+
+    self->central = bench_socket (self->proto->central);
+    rc = nn_bind (self->central, self->addr);
+    if (rc < 0) {
+        fprintf (stderr, "nn_bench: cannot bind to %s: %s\n", self->addr,
+            nn_strerror (nn_errno ()));
+        nn_close (self->central);
+        return -1;
+    }
+    for (i = 0; i != self->conns; ++i) {
+        self->peers [i] = bench_socket (self->proto->peer);
+        rc = nn_connect (self->peers [i], self->addr);
+        errno_assert (rc >= 0);
+    }
+
+    /*  Give the connections (and subscriptions) time to get established. */
+    nn_sleep (200);
+    return 0;
+}
+
+static void bench_teardown (struct bench *self)
+{
+    int i;
+
+    for (i = 0; i != self->conns; ++i)
+        nn_close (self->peers [i]);
+    nn_close (self->central);
+}
+
+/*  Distributes the peers among the worker threads and starts them. Each
+    worker expects 'perpeer' messages for each of its sockets. */
+static void bench_start (struct bench *self, nn_thread_routine *routine,
+    size_t perpeer)
+{
+    int i;
+    int j;
+    struct bench_worker *worker;
+
+    for (i = 0; i != self->threads; ++i) {
+        worker = &self->workers [i];
+        worker->bench = self;
+        worker->socks = malloc (self->conns * sizeof (int));
+        alloc_assert (worker->socks);
+        worker->nsocks = 0;
+        for (j = i; j < self->conns; j += self->threads)
+            worker->socks [worker->nsocks++] = self->peers [j];
+        bench_samples_init (&worker->samples, worker->nsocks * perpeer);
+    }
+    for (i = 0; i != self->threads; ++i)
+        nn_thread_init (&self->workers [i].thread, routine,
+            &self->workers [i]);
+}
+
+/*  Waits for the workers and merges their samples into the main ones. */
+static void bench_join (struct bench *self)
+{
+    int i;
+    struct bench_worker *worker;
+    struct bench_samples *samples;
+
+    for (i = 0; i != self->threads; ++i) {
+        worker = &self->workers [i];
+        nn_thread_term (&worker->thread);
+        samples = &worker->samples;
+        if (samples->count > 0) {
+            nn_assert (self->samples.count + samples->count <=
+                self->samples.capacity);
+            memcpy (self->samples.lat + self->samples.count, samples->lat,
+                samples->count * sizeof (uint64_t));
+            self->samples.count += samples->count;
+        }
+        if (samples->last > self->samples.last)
+            self->samples.last = samples->last;
+        bench_samples_term (samples);
+        free (worker->socks);
+    }
+}
+
+/*  Receives from all the sockets until 'perpeer' messages are received from
+    each or until the peers go silent. If 'echo' is set, each message is
+    sent back. */
+static void bench_recvall (struct bench_worker *self, size_t perpeer, int echo)
+{
+    int rc;
+    int i;
+    int n;
+    void *msg;
+    size_t *received;
+    int *index;
+    struct nn_pollfd *pfd;
+
+    received = calloc (self->nsocks, sizeof (size_t));
+    alloc_assert (received);
+    index = malloc (self->nsocks * sizeof (int));
+    alloc_assert (index);
+    pfd = malloc (self->nsocks * sizeof (struct nn_pollfd));
+    alloc_assert (pfd);
+
+    while (1) {
+
+        /*  Poll only on the sockets that still expect some messages. */
+        n = 0;
+        for (i = 0; i != self->nsocks; ++i) {
+            if (received [i] >= perpeer)
+                continue;
+            index [n] = i;
+            pfd [n].fd = self->socks [i];
+            pfd [n].events = NN_POLLIN;
+            pfd [n].revents = 0;
+            ++n;
+        }
+        if (n == 0)
+            break;
+        rc = nn_poll (pfd, n, BENCH_TIMEOUT);
+        if (rc <= 0)
+            break;
+        for (i = 0; i != n; ++i) {
+            if (!(pfd [i].revents & NN_POLLIN))
+                continue;
+            rc = nn_recv (pfd [i].fd, &msg, NN_MSG, NN_DONTWAIT);
+            if (rc < 0)
+                continue;
+            ++received [index [i]];
+            if (echo) {
+                self->samples.last = bench_now ();
+                rc = nn_send (pfd [i].fd, &msg, NN_MSG, 0);
+                if (rc < 0)
+                    nn_freemsg (msg);
+            }
+            else {
+                bench_record (&self->samples, msg);
+                nn_freemsg (msg);
+            }
+        }
+    }
+
+    free (index);
+    free (pfd);
+    free (received);
+}
+
+/*  pair, pipeline: peers send, the central socket receives. */
+
+static void bench_fanin_sender (void *arg)
+{
+    int i;
+    int j;
+    struct bench_worker *self;
+
+    self = (struct bench_worker*) arg;
+    for (i = 0; i != self->bench->count; ++i)
+        for (j = 0; j != self->nsocks; ++j)
+            if (bench_send (self->bench, self->socks [j]) < 0)
+                return;
+}
+
+static void bench_fanin (struct bench *self)
+{
+    int rc;
+    size_t i;
+    size_t total;
+    void *msg;
+
+    total = (size_t) self->conns * self->count;
+    bench_start (self, bench_fanin_sender, 0);
+    for (i = 0; i != total; ++i) {
+        rc = nn_recv (self->central, &msg, NN_MSG, 0);
+        if (rc < 0)
+            break;
+        bench_record (&self->samples, msg);
+        nn_freemsg (msg);
+    }
+    bench_join (self);
+}
+
+/*  pubsub, bus: the central socket sends, every peer receives. */
+
+static void bench_fanout_receiver (void *arg)
+{
+    struct bench_worker *self;
+
+    self = (struct bench_worker*) arg;
+    bench_recvall (self, self->bench->count, 0);
+}
+
+static void bench_fanout (struct bench *self)
+{
+    int i;
+
+    bench_start (self, bench_fanout_receiver, self->count);
+    for (i = 0; i != self->count; ++i)
+        if (bench_send (self, self->central) < 0)
+            break;
+    bench_join (self);
+}
+
+/*  reqrep: peers send requests, the central socket echoes them back. */
+
+static void bench_reqrep_client (void *arg)
+{
+    int rc;
+    int i;
+    int j;
+    void *msg;
+    struct bench_worker *self;
+
+    self = (struct bench_worker*) arg;
+    for (i = 0; i != self->bench->count; ++i) {
+        for (j = 0; j != self->nsocks; ++j)
+            if (bench_send (self->bench, self->socks [j]) < 0)
+                return;
+        for (j = 0; j != self->nsocks; ++j) {
+            rc = nn_recv (self->socks [j], &msg, NN_MSG, 0);
+            if (rc < 0)
+                return;
+            bench_record (&self->samples, msg);
+            nn_freemsg (msg);
+        }
+    }
+}
+
+static void bench_reqrep (struct bench *self)
+{
+    struct bench_worker server;
+
+    server.bench = self;
+    server.socks = &self->central;
+    server.nsocks = 1;
+    bench_samples_init (&server.samples, 0);
+    bench_start (self, bench_reqrep_client, self->count);
+    bench_recvall (&server, (size_t) self->conns * self->count, 1);
+    bench_join (self);
+    bench_samples_term (&server.samples);
+}
+
+/*  survey: the central socket sends surveys, peers echo them back. */
+
+static void bench_survey_respondent (void *arg)
+{
+    struct bench_worker *self;
+
+    self = (struct bench_worker*) arg;
+    bench_recvall (self, self->bench->count, 1);
+}
+
+static void bench_survey (struct bench *self)
+{
+    int rc;
+    int i;
+    int j;
+    void *msg;
+
+    bench_start (self, bench_survey_respondent, 0);
+    for (i = 0; i != self->count; ++i) {
+        if (bench_send (self, self->central) < 0)
+            break;
+        for (j = 0; j != self->conns; ++j) {
+            rc = nn_recv (self->central, &msg, NN_MSG, 0);
+            if (rc < 0)
+                break;
+            bench_record (&self->samples, msg);
+            nn_freemsg (msg);
+        }
+    }
+    bench_join (self);
+}
+
+static int bench_cmp (const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/*  Returns the given percentile of the samples, in microseconds. */
+static double bench_percentile (struct bench_samples *self, double p)
+{
+    size_t i;
+
+    if (self->count == 0)
+        return 0.0;
+    i = (size_t) (p / 100.0 * (double) self->count);
+    if (i >= self->count)
+        i = self->count - 1;
+    return (double) self->lat [i] / 1000.0;
+}
+
+static void bench_header (void)
+{
+    if (bench_json)
+        return;
+    printf ("protocol,transport,size,conns,threads,messages,lost,latency,"
+        "seconds,msgs_per_sec,mbytes_per_sec,p50_us,p99_us,p999_us,max_us,"
+        "cpu_us_per_msg\n");
+}
+
+static void bench_report (struct bench *self, uint64_t cpu)
+{
+    size_t expected;
+    double seconds;
+    double rate;
+    double mbps;
+    double cpumsg;
+    const char *kind;
+    const char *fmt;
+
+    expected = (size_t) self->conns * self->count;
+    qsort (self->samples.lat, self->samples.count, sizeof (uint64_t),
+        bench_cmp);
+    seconds = self->samples.last > self->start ?
+        (double) (self->samples.last - self->start) / 1e9 : 0.0;
+    rate = seconds > 0 ? (double) self->samples.count / seconds : 0.0;
+    mbps = rate * (double) self->size / 1e6;
+    cpumsg = self->samples.count > 0 ?
+        (double) cpu / 1000.0 / (double) self->samples.count : 0.0;
+    kind = self->proto->roundtrip ? "roundtrip" : "oneway";
+
+    if (bench_json)
+        fmt = "{\"protocol\":\"%s\",\"transport\":\"%s\",\"size\":%d,"
+            "\"conns\":%d,\"threads\":%d,\"messages\":%d,\"lost\":%d,"
+            "\"latency\":\"%s\",\"seconds\":%.6f,\"msgs_per_sec\":%.1f,"
+            "\"mbytes_per_sec\":%.3f,\"p50_us\":%.3f,\"p99_us\":%.3f,"
+            "\"p999_us\":%.3f,\"max_us\":%.3f,\"cpu_us_per_msg\":%.3f}\n";
+    else
+        fmt = "%s,%s,%d,%d,%d,%d,%d,%s,%.6f,%.1f,%.3f,%.3f,%.3f,%.3f,%.3f,"
+            "%.3f\n";
+    printf (fmt, self->proto->name, self->transport, (int) self->size,
+        self->conns, self->threads, (int) self->samples.count,
+        (int) (expected - self->samples.count), kind, seconds, rate, mbps,
+        bench_percentile (&self->samples, 50.0),
+        bench_percentile (&self->samples, 99.0),
+        bench_percentile (&self->samples, 99.9),
+        bench_percentile (&self->samples, 100.0), cpumsg);
+    fflush (stdout);
+}
+
+static void bench_run (const struct bench_proto *proto, const char *transport,
+    size_t size, int conns, int threads, int count)
+{
+    struct bench self;
+    uint64_t cpu;
+
+    /*  Skip the combinations that make no sense. */
+    if (proto->maxconns > 0 && conns > proto->maxconns)
+        return;
+    if (threads > conns)
+        return;
+
+    memset (&self, 0, sizeof (self));
+    self.proto = proto;
+    self.transport = transport;
+    self.size = size;
+    self.conns = conns;
+    self.threads = threads;
+    self.count = count;
+    if (bench_setup (&self) < 0)
+        return;
+
+    bench_samples_init (&self.samples, (size_t) conns * count);
+    cpu = bench_cpu ();
+    self.start = bench_now ();
+    proto->run (&self);
+    cpu = bench_cpu () - cpu;
+    bench_report (&self, cpu);
+    bench_samples_term (&self.samples);
+    bench_teardown (&self);
+}
+
+/*  Splits comma-separated list in place. Returns number of items. */
+static int bench_split (char *list, char **items)
+{
+    int n;
+    char *p;
+
+    n = 0;
+    p = list;
+    while (p && *p && n < BENCH_MAXLIST) {
+        items [n++] = p;
+        p = strchr (p, ',');
+        if (p)
+            *p++ = 0;
+    }
+    return n;
+}
+
+static void bench_usage (void)
+{
+    fprintf (stderr,
+        "usage: nn_bench [options]\n"
+        "  -p <list>  protocols: pair,pipeline,reqrep,pubsub,bus,survey "
+            "(all)\n"
+        "  -t <list>  transports: inproc,ipc,tcp,ws,shm,udp "
+            "(inproc,ipc,tcp)\n"
+        "  -s <list>  message sizes in bytes, at least 8 (64,1024,65536)\n"
+        "  -c <list>  numbers of connections (1)\n"
+        "  -T <list>  numbers of threads driving the connections (1)\n"
+        "  -n <num>   messages per connection (10000)\n"
+        "  -P <port>  first TCP/UDP port to use (5555)\n"
+        "  -j         print results as JSON lines instead of CSV\n");
+}
+
+int main (int argc, char *argv [])
+{
+    int i;
+    int p;
+    int t;
+    int s;
+    int c;
+    int th;
+    int count;
+    int nprotos, ntransports, nsizes, nconns, nthreads;
+    char *protos [BENCH_MAXLIST];
+    char *transports [BENCH_MAXLIST];
+    char *sizes [BENCH_MAXLIST];
+    char *conns [BENCH_MAXLIST];
+    char *threads [BENCH_MAXLIST];
+    char defprotos [] = "pair,pipeline,reqrep,pubsub,bus,survey";
+    char deftransports [] = "inproc,ipc,tcp";
+    char defsizes [] = "64,1024,65536";
+    char defconns [] = "1";
+    char defthreads [] = "1";
+    const struct bench_proto *proto;
+
+    nprotos = bench_split (defprotos, protos);
+    ntransports = bench_split (deftransports, transports);
+    nsizes = bench_split (defsizes, sizes);
+    nconns = bench_split (defconns, conns);
+    nthreads = bench_split (defthreads, threads);
+    count = 10000;
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp (argv [i], "-j") == 0) {
+            bench_json = 1;
+            continue;
+        }
+        if (argv [i][0] != '-' || i + 1 >= argc) {
+            bench_usage ();
+            return 1;
+        }
+        switch (argv [i][1]) {
+        case 'p':
+            nprotos = bench_split (argv [++i], protos);
+            break;
+        case 't':
+            ntransports = bench_split (argv [++i], transports);
+            break;
+        case 's':
+            nsizes = bench_split (argv [++i], sizes);
+            break;
+        case 'c':
+            nconns = bench_split (argv [++i], conns);
+            break;
+        case 'T':
+            nthreads = bench_split (argv [++i], threads);
+            break;
+        case 'n':
+            count = atoi (argv [++i]);
+            break;
+        case 'P':
+            bench_port = atoi (argv [++i]);
+            break;
+        default:
+            bench_usage ();
+            return 1;
+        }
+    }
+
+    /*  Validate the arguments. */
+    if (count <= 0) {
+        bench_usage ();
+        return 1;
+    }
+    for (s = 0; s != nsizes; ++s) {
+        if (atoi (sizes [s]) < (int) sizeof (uint64_t)) {
+            bench_usage ();
+            return 1;
+        }
+    }
+    for (c = 0; c != nconns; ++c) {
+        if (atoi (conns [c]) < 1 || atoi (conns [c]) > 1024) {
+            bench_usage ();
+            return 1;
+        }
+    }
+    for (th = 0; th != nthreads; ++th) {
+        if (atoi (threads [th]) < 1 || atoi (threads [th]) > BENCH_MAXLIST) {
+            bench_usage ();
+            return 1;
+        }
+    }
+
+    bench_header ();
+    for (p = 0; p != nprotos; ++p) {
+        proto = NULL;
+        for (i = 0; i != BENCH_NPROTOS; ++i)
+            if (strcmp (bench_protos [i].name, protos [p]) == 0)
+                proto = &bench_protos [i];
+        if (!proto) {
+            fprintf (stderr, "nn_bench: unknown protocol %s\n", protos [p]);
+            return 1;
+        }
+        for (t = 0; t != ntransports; ++t)
+            for (s = 0; s != nsizes; ++s)
+                for (c = 0; c != nconns; ++c)
+                    for (th = 0; th != nthreads; ++th)
+                        bench_run (proto, transports [t],
+                            (size_t) atoi (sizes [s]), atoi (conns [c]),
+                            atoi (threads [th]), count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,208 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+/*  Distributes tasks from a PUSH socket to a set of PULL workers, one of
+    which is slower than the others, and reports how long the tasks took to
+    complete, from being sent to being done, and how busy each worker was.
+    Run it with credit of 0 and then with a small credit to see the effect
+    of NN_PULL_CREDIT on work distribution. */
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+
+#include "../src/utils/attr.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/thread.c"
+#include "../src/utils/sleep.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define DONE_ADDRESS "inproc://pipeline_skew"
+#define MAX_WORKERS 64
+
+struct worker {
+    struct nn_thread thread;
+    int duration;
+    int tasks;
+    uint64_t busy;
+};
+
+static const char *bind_to;
+static int task_count;
+static int credit;
+static struct nn_stopwatch epoch;
+static uint64_t *latencies;
+
+static void worker (void *arg)
+{
+    int rc;
+    int s;
+    int done;
+    struct worker *self;
+    uint64_t task [2];
+    uint64_t start;
+
+    self = (struct worker*) arg;
+
+    s = nn_socket (AF_SP, NN_PULL);
+    assert (s != -1);
+    rc = nn_setsockopt (s, NN_PULL, NN_PULL_CREDIT, &credit, sizeof (credit));
+    assert (rc == 0);
+    rc = nn_connect (s, bind_to);
+    assert (rc >= 0);
+    done = nn_socket (AF_SP, NN_PUSH);
+    assert (done != -1);
+    rc = nn_connect (done, DONE_ADDRESS);
+    assert (rc >= 0);
+
+    while (1) {
+        rc = nn_recv (s, task, sizeof (task), 0);
+        if (rc < 0 && (nn_errno () == ETERM || nn_errno () == EBADF))
+            break;
+        assert (rc == sizeof (task));
+
+        /*  The task itself. */
+        start = nn_stopwatch_term (&epoch);
+        nn_sleep (self->duration);
+        self->busy += nn_stopwatch_term (&epoch) - start;
+        ++self->tasks;
+
+        latencies [task [0]] = nn_stopwatch_term (&epoch) - task [1];
+        rc = nn_send (done, task, sizeof (task), 0);
+        assert (rc == sizeof (task));
+    }
+
+    nn_close (done);
+    nn_close (s);
+}
+
+static int compare (const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*) a;
+    uint64_t y = *(const uint64_t*) b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+int main (int argc, char *argv [])
+{
+    int rc;
+    int s;
+    int done;
+    int i;
+    int nworkers;
+    int duration;
+    int skew;
+    uint64_t task [2];
+    uint64_t elapsed;
+    uint64_t total;
+    struct worker workers [MAX_WORKERS];
+
+    if (argc != 7) {
+        printf ("usage: pipeline_skew <bind-to> <worker-count> <task-count> "
+            "<task-duration-ms> <slow-factor> <credit>\n");
+        return 1;
+    }
+
+    bind_to = argv [1];
+    nworkers = atoi (argv [2]);
+    task_count = atoi (argv [3]);
+    duration = atoi (argv [4]);
+    skew = atoi (argv [5]);
+    credit = atoi (argv [6]);
+    assert (nworkers > 0 && nworkers <= MAX_WORKERS);
+    assert (task_count > 0);
+
+    latencies = malloc (task_count * sizeof (uint64_t));
+    assert (latencies);
+
+    s = nn_socket (AF_SP, NN_PUSH);
+    assert (s != -1);
+    rc = nn_bind (s, bind_to);
+    assert (rc >= 0);
+    done = nn_socket (AF_SP, NN_PULL);
+    assert (done != -1);
+    rc = nn_bind (done, DONE_ADDRESS);
+    assert (rc >= 0);
+
+    /*  Worker 0 is the slow one. */
+    nn_stopwatch_init (&epoch);
+    for (i = 0; i != nworkers; ++i) {
+        workers [i].duration = i == 0 ? duration * skew : duration;
+        workers [i].tasks = 0;
+        workers [i].busy = 0;
+        nn_thread_init (&workers [i].thread, worker, &workers [i]);
+    }
+
+    /*  Wait a bit till all the workers are connected. */
+    nn_sleep (100);
+
+    total = nn_stopwatch_term (&epoch);
+    for (i = 0; i != task_count; ++i) {
+        task [0] = i;
+        task [1] = nn_stopwatch_term (&epoch);
+        rc = nn_send (s, task, sizeof (task), 0);
+        assert (rc == sizeof (task));
+    }
+    for (i = 0; i != task_count; ++i) {
+        rc = nn_recv (done, task, sizeof (task), 0);
+        assert (rc == sizeof (task));
+    }
+    total = nn_stopwatch_term (&epoch) - total;
+
+    nn_term ();
+    for (i = 0; i != nworkers; ++i)
+        nn_thread_term (&workers [i].thread);
+
+    qsort (latencies, task_count, sizeof (uint64_t), compare);
+    elapsed = 0;
+    for (i = 0; i != task_count; ++i)
+        elapsed += latencies [i];
+
+    printf ("credit: %d\n", credit);
+    printf ("total time: %.3f [ms]\n", (double) total / 1000);
+    printf ("task latency avg: %.3f [ms]\n",
+        (double) elapsed / task_count / 1000);
+    printf ("task latency p50: %.3f [ms]\n",
+        (double) latencies [task_count / 2] / 1000);
+    printf ("task latency p99: %.3f [ms]\n",
+        (double) latencies [(task_count - 1) * 99 / 100] / 1000);
+    printf ("task latency max: %.3f [ms]\n",
+        (double) latencies [task_count - 1] / 1000);
+    for (i = 0; i != nworkers; ++i)
+        printf ("worker %d: %d tasks, %.1f%% utilization\n", i,
+            workers [i].tasks, (double) workers [i].busy * 100 / total);
+
+    free (latencies);
+    nn_close (done);
+    nn_close (s);
+
+    return 0;
+}
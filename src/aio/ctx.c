@@ -34,10 +34,12 @@ void nn_ctx_init (struct nn_ctx *self, struct nn_pool *pool,
     nn_queue_init (&self->events);
     nn_queue_init (&self->eventsto);
     self->onleave = onleave;
+    nn_recorder_init (&self->recorder);
 }
 
 void nn_ctx_term (struct nn_ctx *self)
 {
+    nn_recorder_term (&self->recorder);
     nn_queue_term (&self->eventsto);
     nn_queue_term (&self->events);
     nn_mutex_term (&self->sync);
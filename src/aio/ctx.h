@@ -29,6 +29,7 @@
 #include "worker.h"
 #include "pool.h"
 #include "fsm.h"
+#include "recorder.h"
 
 /*  AIO context for objects using AIO subsystem. */
 
@@ -40,6 +41,9 @@ struct nn_ctx {
     struct nn_queue events;
     struct nn_queue eventsto;
     nn_ctx_onleave onleave;
+
+    /*  Recent history of the state machines living in the context. */
+    struct nn_recorder recorder;
 };
 
 void nn_ctx_init (struct nn_ctx *self, struct nn_pool *pool,
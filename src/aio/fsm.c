@@ -80,8 +80,11 @@ void nn_fsm_event_process (struct nn_fsm_event *self)
 void nn_fsm_feed (struct nn_fsm *self, int src, int type, void *srcptr)
 {
     if (nn_slow (self->state != NN_FSM_STATE_STOPPING)) {
+        nn_recorder_event (&self->ctx->recorder, self, self->fn, src, type);
         self->fn (self, src, type, srcptr);
     } else {
+        nn_recorder_event (&self->ctx->recorder, self, self->shutdown_fn,
+            src, type);
         self->shutdown_fn (self, src, type, srcptr);
     }
 }
@@ -121,6 +124,8 @@ void nn_fsm_term (struct nn_fsm *self)
 void nn_fsm_start (struct nn_fsm *self)
 {
     nn_assert (nn_fsm_isidle (self));
+    nn_recorder_event (&self->ctx->recorder, self, self->fn,
+        NN_FSM_ACTION, NN_FSM_START);
     self->fn (self, NN_FSM_ACTION, NN_FSM_START, NULL);
     self->state = NN_FSM_STATE_ACTIVE;
 }
@@ -138,6 +143,8 @@ void nn_fsm_stop (struct nn_fsm *self)
         return;
 
     self->state = NN_FSM_STATE_STOPPING;
+    nn_recorder_event (&self->ctx->recorder, self, self->shutdown_fn,
+        NN_FSM_ACTION, NN_FSM_STOP);
     self->shutdown_fn (self, NN_FSM_ACTION, NN_FSM_STOP, NULL);
 }
 
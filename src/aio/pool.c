@@ -22,6 +22,8 @@
 
 #include "pool.h"
 
+#include "../utils/err.h"
+
 /*  TODO: The dummy implementation of a thread pool. As for now there's only
     one worker thread created. */
 
@@ -39,3 +41,12 @@ struct nn_worker *nn_pool_choose_worker (struct nn_pool *self)
 {
     return &self->worker;
 }
+
+int nn_pool_getstats (struct nn_pool *self, int i,
+    struct nn_worker_stats *stats)
+{
+    if (i != 0)
+        return -EINVAL;
+    nn_worker_getstats (&self->worker, stats);
+    return 0;
+}
@@ -35,5 +35,10 @@ int nn_pool_init (struct nn_pool *self);
 void nn_pool_term (struct nn_pool *self);
 struct nn_worker *nn_pool_choose_worker (struct nn_pool *self);
 
+/*  Copies the counters of the i-th worker thread into 'stats'. Returns
+    -EINVAL if there's no such worker. */
+int nn_pool_getstats (struct nn_pool *self, int i,
+    struct nn_worker_stats *stats);
+
 #endif
 
@@ -0,0 +1,125 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "recorder.h"
+
+#include "../utils/clock.h"
+#include "../utils/fast.h"
+
+#include <string.h>
+
+#if defined NN_HAVE_WINDOWS
+#include "../utils/win.h"
+#define nn_recorder_wbarrier() MemoryBarrier ()
+#define nn_recorder_rbarrier() MemoryBarrier ()
+#elif defined __ATOMIC_RELEASE
+/*  On strongly ordered CPUs these don't cost anything but a compiler
+    barrier, which matters as the writer is on the hot path. */
+#define nn_recorder_wbarrier() __atomic_thread_fence (__ATOMIC_RELEASE)
+#define nn_recorder_rbarrier() __atomic_thread_fence (__ATOMIC_ACQUIRE)
+#elif defined NN_HAVE_GCC_ATOMIC_BUILTINS
+#define nn_recorder_wbarrier() __sync_synchronize ()
+#define nn_recorder_rbarrier() __sync_synchronize ()
+#else
+#define nn_recorder_wbarrier()
+#define nn_recorder_rbarrier()
+#endif
+
+static void nn_recorder_put (struct nn_recorder *self, int kind,
+    struct nn_fsm *fsm, nn_fsm_fn fn, int src, int type);
+
+void nn_recorder_init (struct nn_recorder *self)
+{
+    memset (self, 0, sizeof (*self));
+}
+
+void nn_recorder_term (struct nn_recorder *self)
+{
+    /*  Nothing to do. The entries may still be read right before the context
+        is deallocated. */
+    (void) self;
+}
+
+void nn_recorder_event (struct nn_recorder *self, struct nn_fsm *fsm,
+    nn_fsm_fn fn, int src, int type)
+{
+    nn_recorder_put (self, NN_RECORDER_EVENT, fsm, fn, src, type);
+}
+
+void nn_recorder_error (struct nn_recorder *self, int eid, int errnum)
+{
+    nn_recorder_put (self, NN_RECORDER_ERROR, NULL, NULL, eid, errnum);
+}
+
+int nn_recorder_read (struct nn_recorder *self,
+    struct nn_recorder_entry *entries)
+{
+    uint64_t pos;
+    uint64_t i;
+    uint64_t seq;
+    struct nn_recorder_entry *entry;
+    int count;
+
+    pos = self->pos;
+    nn_recorder_rbarrier ();
+
+    count = 0;
+    i = pos > NN_RECORDER_SIZE ? pos - NN_RECORDER_SIZE : 0;
+    for (; i != pos; ++i) {
+        entry = &self->entries [i % NN_RECORDER_SIZE];
+        seq = entry->seq;
+        nn_recorder_rbarrier ();
+        if (nn_slow (seq != i + 1))
+            continue;
+        memcpy (&entries [count], entry, sizeof (*entry));
+        nn_recorder_rbarrier ();
+
+        /*  The writer has overtaken us while copying the entry. */
+        if (nn_slow (entry->seq != seq))
+            continue;
+        ++count;
+    }
+
+    return count;
+}
+
+static void nn_recorder_put (struct nn_recorder *self, int kind,
+    struct nn_fsm *fsm, nn_fsm_fn fn, int src, int type)
+{
+    uint64_t pos;
+    struct nn_recorder_entry *entry;
+
+    pos = self->pos;
+    entry = &self->entries [pos % NN_RECORDER_SIZE];
+
+    entry->seq = 0;
+    nn_recorder_wbarrier ();
+    entry->time = nn_clock_us ();
+    entry->fsm = fsm;
+    entry->fn = fn;
+    entry->kind = kind;
+    entry->src = src;
+    entry->type = type;
+    nn_recorder_wbarrier ();
+    entry->seq = pos + 1;
+    self->pos = pos + 1;
+}
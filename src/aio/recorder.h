@@ -0,0 +1,83 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_RECORDER_INCLUDED
+#define NN_RECORDER_INCLUDED
+
+#include "fsm.h"
+
+#include <stdint.h>
+
+/*  Flight recorder. Fixed-size ring of the most recent events processed
+    by the state machines of a context (i.e. of a socket) and of the errors
+    reported by its endpoints. It is always on.
+
+    Records are written only from within the context, so there's a single
+    writer at a time. Readers don't lock the context, so the history can be
+    retrieved even if the context is stuck. Each entry carries a sequence
+    number that the writer invalidates before overwriting the entry; readers
+    drop entries that changed while they were being copied. */
+
+#ifndef NN_RECORDER_SIZE
+#define NN_RECORDER_SIZE 128
+#endif
+
+/*  Event was fed to a state machine. 'src' and 'type' are those of the
+    event. */
+#define NN_RECORDER_EVENT 1
+
+/*  Error state of an endpoint has changed. 'src' is the endpoint ID, 'type'
+    the error number or zero if the error has cleared. */
+#define NN_RECORDER_ERROR 2
+
+struct nn_recorder_entry {
+    volatile uint64_t seq;
+    uint64_t time;
+    struct nn_fsm *fsm;
+    nn_fsm_fn fn;
+    int kind;
+    int src;
+    int type;
+};
+
+struct nn_recorder {
+    volatile uint64_t pos;
+    struct nn_recorder_entry entries [NN_RECORDER_SIZE];
+};
+
+void nn_recorder_init (struct nn_recorder *self);
+void nn_recorder_term (struct nn_recorder *self);
+
+/*  Record an event about to be processed by the handler 'fn' of 'fsm'. */
+void nn_recorder_event (struct nn_recorder *self, struct nn_fsm *fsm,
+    nn_fsm_fn fn, int src, int type);
+
+/*  Record a change in the error state of endpoint 'eid'. */
+void nn_recorder_error (struct nn_recorder *self, int eid, int errnum);
+
+/*  Copy up to NN_RECORDER_SIZE of the most recent entries, oldest first,
+    into 'entries'. Returns the number of entries copied. Can be called from
+    any thread without entering the context. */
+int nn_recorder_read (struct nn_recorder *self,
+    struct nn_recorder_entry *entries);
+
+#endif
@@ -74,6 +74,11 @@ int nn_timer_isidle (struct nn_timer *self)
 }
 
 void nn_timer_start (struct nn_timer *self, int timeout)
+{
+    nn_timer_start_us (self, (int64_t) timeout * 1000);
+}
+
+void nn_timer_start_us (struct nn_timer *self, int64_t timeout)
 {
     /*  Negative timeout make no sense. */
     nn_assert (timeout >= 0);
@@ -37,7 +37,9 @@ struct nn_timer {
     struct nn_worker_timer wtimer;
     struct nn_fsm_event done;
     struct nn_worker *worker;
-    int timeout;
+
+    /*  Timeout to start the worker timer with, in microseconds. */
+    int64_t timeout;
 };
 
 void nn_timer_init (struct nn_timer *self, int src, struct nn_fsm *owner);
@@ -45,6 +47,9 @@ void nn_timer_term (struct nn_timer *self);
 
 int nn_timer_isidle (struct nn_timer *self);
 void nn_timer_start (struct nn_timer *self, int timeout);
+
+/*  Same as nn_timer_start, but the timeout is in microseconds. */
+void nn_timer_start_us (struct nn_timer *self, int64_t timeout);
 void nn_timer_stop (struct nn_timer *self);
 
 #endif
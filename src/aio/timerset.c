@@ -37,7 +37,7 @@ void nn_timerset_term (struct nn_timerset *self)
     nn_list_term (&self->timeouts);
 }
 
-int nn_timerset_add (struct nn_timerset *self, int timeout,
+int nn_timerset_add (struct nn_timerset *self, int64_t timeout,
     struct nn_timerset_hndl *hndl)
 {
     struct nn_list_item *it;
@@ -45,7 +45,7 @@ int nn_timerset_add (struct nn_timerset *self, int timeout,
     int first;
 
     /*  Compute the instant when the timeout will be due. */
-    hndl->timeout = nn_clock_ms()  + timeout;
+    hndl->timeout = nn_clock_us () + timeout;
 
     /*  Insert it into the ordered list of timeouts. */
     for (it = nn_list_begin (&self->timeouts);
@@ -80,14 +80,25 @@ int nn_timerset_rm (struct nn_timerset *self, struct nn_timerset_hndl *hndl)
 
 int nn_timerset_timeout (struct nn_timerset *self)
 {
-    int timeout;
+    int64_t timeout;
 
     if (nn_fast (nn_list_empty (&self->timeouts)))
         return -1;
 
-    timeout = (int) (nn_cont (nn_list_begin (&self->timeouts),
-        struct nn_timerset_hndl, list)->timeout - nn_clock_ms());
-    return timeout < 0 ? 0 : timeout;
+    /*  Round up. Waking up before the timeout is due would mean spinning
+        until it is. */
+    timeout = (int64_t) (nn_cont (nn_list_begin (&self->timeouts),
+        struct nn_timerset_hndl, list)->timeout - nn_clock_us ());
+    return timeout < 0 ? 0 : (int) ((timeout + 999) / 1000);
+}
+
+int64_t nn_timerset_due (struct nn_timerset *self)
+{
+    if (nn_fast (nn_list_empty (&self->timeouts)))
+        return -1;
+
+    return (int64_t) nn_cont (nn_list_begin (&self->timeouts),
+        struct nn_timerset_hndl, list)->timeout;
 }
 
 int nn_timerset_event (struct nn_timerset *self, struct nn_timerset_hndl **hndl)
@@ -101,7 +112,7 @@ int nn_timerset_event (struct nn_timerset *self, struct nn_timerset_hndl **hndl)
     /*  If no timeout have expired yet, there's no event to return. */
     first = nn_cont (nn_list_begin (&self->timeouts),
         struct nn_timerset_hndl, list);
-    if (first->timeout > nn_clock_ms())
+    if (first->timeout > nn_clock_us ())
         return -EAGAIN;
 
     /*  Return the first timeout and remove it from the list of active
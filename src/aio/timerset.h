@@ -28,7 +28,7 @@
 #include "../utils/list.h"
 
 /*  This class stores a list of timeouts and reports the next one to expire
-    along with the time till it happens. */
+    along with the time till it happens. Timeouts are kept in microseconds. */
 
 struct nn_timerset_hndl {
     struct nn_list_item list;
@@ -41,10 +41,18 @@ struct nn_timerset {
 
 void nn_timerset_init (struct nn_timerset *self);
 void nn_timerset_term (struct nn_timerset *self);
-int nn_timerset_add (struct nn_timerset *self, int timeout,
+int nn_timerset_add (struct nn_timerset *self, int64_t timeout,
     struct nn_timerset_hndl *hndl);
 int nn_timerset_rm (struct nn_timerset *self, struct nn_timerset_hndl *hndl);
+
+/*  Returns time till the first timeout expires in milliseconds, rounded up,
+    or -1 if there's no timeout. */
 int nn_timerset_timeout (struct nn_timerset *self);
+
+/*  Returns the instant the first timeout expires at, as returned by
+    nn_clock_us, or -1 if there's no timeout. */
+int64_t nn_timerset_due (struct nn_timerset *self);
+
 int nn_timerset_event (struct nn_timerset *self, struct nn_timerset_hndl **hndl);
 
 void nn_timerset_hndl_init (struct nn_timerset_hndl *self);
@@ -39,7 +39,7 @@
 #define NN_USOCK_SHUTDOWN 8
 
 /*  Maximum number of iovecs that can be passed to nn_usock_send function. */
-#define NN_USOCK_MAX_IOVCNT 3
+#define NN_USOCK_MAX_IOVCNT 11
 
 /*  Size of the buffer used for batch-reads of inbound data. To keep the
     performance optimal make sure that this value is larger than network MTU. */
@@ -87,6 +87,22 @@ void nn_usock_connect (struct nn_usock *self, const struct sockaddr *addr,
 
 void nn_usock_send (struct nn_usock *self, const struct nn_iovec *iov,
     int iovcnt);
+
+#if !defined NN_HAVE_WINDOWS && defined NN_HAVE_MSG_CONTROL
+/*  Same as nn_usock_send, but also passes file descriptor 'fd' to the peer.
+    Works only with AF_UNIX sockets. The descriptor is duplicated by the OS,
+    so the caller is free to close it once NN_USOCK_SENT is raised. */
+void nn_usock_send_fd (struct nn_usock *self, const struct nn_iovec *iov,
+    int iovcnt, int fd);
+#endif
+
+#if !defined NN_HAVE_WINDOWS && defined NN_HAVE_SENDFILE
+/*  Sends 'len' bytes of file 'fd' starting at 'offset' without copying them
+    to the user space. The file must stay open until NN_USOCK_SENT is raised.
+    If the file can't be read to the end, the connection fails. */
+void nn_usock_sendfile (struct nn_usock *self, int fd, uint64_t offset,
+    size_t len);
+#endif
 void nn_usock_recv (struct nn_usock *self, void *buf, size_t len, int *fd);
 
 int nn_usock_geterrno (struct nn_usock *self);
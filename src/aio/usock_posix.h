@@ -70,6 +70,21 @@ struct nn_usock {
 
         /*  List of buffers being sent at the moment. Referenced from 'hdr'. */
         struct iovec iov [NN_USOCK_MAX_IOVCNT];
+
+        /*  File range being sent at the moment, if 'file' isn't -1. In that
+            case 'hdr' is not used. */
+        int file;
+        uint64_t fileoff;
+        size_t filelen;
+
+#if defined NN_HAVE_MSG_CONTROL
+        /*  Ancillary data carrying a file descriptor passed via SCM_RIGHTS.
+            Referenced from 'hdr' until the first byte is sent. */
+        union {
+            struct cmsghdr align;
+            unsigned char buf [CMSG_SPACE (sizeof (int))];
+        } ctrl;
+#endif
     } out;
 
     /*  Asynchronous tasks for the worker. */
@@ -22,6 +22,54 @@
 
 #include "worker.h"
 
+#include "../utils/clock.h"
+
+#include <string.h>
+
+/*  Atomic accesses to the statistics. The counters have a single writer, so
+    there's no need for read-modify-write operations nor for ordering. */
+static uint64_t nn_worker_stat_load (uint64_t *stat)
+{
+#if defined NN_HAVE_GCC_ATOMIC_LOADSTORE64
+    return __atomic_load_n (stat, __ATOMIC_RELAXED);
+#elif defined NN_HAVE_WINDOWS
+    return (uint64_t) InterlockedCompareExchange64 ((volatile LONGLONG*) stat,
+        0, 0);
+#else
+    return *(volatile uint64_t*) stat;
+#endif
+}
+
+static void nn_worker_stat_store (uint64_t *stat, uint64_t val)
+{
+#if defined NN_HAVE_GCC_ATOMIC_LOADSTORE64
+    __atomic_store_n (stat, val, __ATOMIC_RELAXED);
+#elif defined NN_HAVE_WINDOWS
+    InterlockedExchange64 ((volatile LONGLONG*) stat, (LONGLONG) val);
+#else
+    *(volatile uint64_t*) stat = val;
+#endif
+}
+
+/*  Called by the worker thread only. */
+static void nn_worker_stat_add (uint64_t *stat, uint64_t n)
+{
+    nn_worker_stat_store (stat, *stat + n);
+}
+
+/*  Called by the worker thread after each event handler. 'last' is the time
+    when the handler was invoked. It's updated to the current time, which is
+    when the next handler, if any, is invoked. */
+static void nn_worker_handled (struct nn_worker *self, uint64_t *last)
+{
+    uint64_t now;
+
+    now = nn_clock_us ();
+    if (now - *last > self->stats.maxhandler)
+        nn_worker_stat_store (&self->stats.maxhandler, now - *last);
+    *last = now;
+}
+
 #if defined NN_HAVE_WINDOWS
 #include "worker_win.inc"
 #else
@@ -43,3 +91,15 @@ int nn_worker_timer_isactive (struct nn_worker_timer *self)
 {
     return nn_timerset_hndl_isactive (&self->hndl);
 }
+
+void nn_worker_getstats (struct nn_worker *self,
+    struct nn_worker_stats *stats)
+{
+    stats->loops = nn_worker_stat_load (&self->stats.loops);
+    stats->events = nn_worker_stat_load (&self->stats.events);
+    stats->tasks = nn_worker_stat_load (&self->stats.tasks);
+    stats->timers = nn_worker_stat_load (&self->stats.timers);
+    stats->busy = nn_worker_stat_load (&self->stats.busy);
+    stats->wait = nn_worker_stat_load (&self->stats.wait);
+    stats->maxhandler = nn_worker_stat_load (&self->stats.maxhandler);
+}
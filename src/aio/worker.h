@@ -27,6 +27,33 @@
 #include "fsm.h"
 #include "timerset.h"
 
+#include <stdint.h>
+
+/*  Counters describing how busy the worker thread is. They are only ever
+    modified by the worker thread itself. Other threads read them using
+    relaxed atomic loads, so the values they see may be slightly out of date
+    and not consistent with each other. Where 64-bit atomic accesses are not
+    available, other than on Windows, a value read on a 32-bit platform may
+    be torn. Times are in microseconds. */
+struct nn_worker_stats {
+
+    /*  Number of times the worker thread woke up. */
+    uint64_t loops;
+
+    /*  Number of events returned by the poller, tasks executed and timers
+        fired. */
+    uint64_t events;
+    uint64_t tasks;
+    uint64_t timers;
+
+    /*  Time spent processing the events and waiting for them. */
+    uint64_t busy;
+    uint64_t wait;
+
+    /*  The longest time spent in a single event handler. */
+    uint64_t maxhandler;
+};
+
 #if defined NN_HAVE_WINDOWS
 #include "worker_win.h"
 #else
@@ -60,7 +87,12 @@ void nn_worker_term (struct nn_worker *self);
 void nn_worker_execute (struct nn_worker *self, struct nn_worker_task *task);
 void nn_worker_cancel (struct nn_worker *self, struct nn_worker_task *task);
 
-void nn_worker_add_timer (struct nn_worker *self, int timeout,
+/*  Copies the worker's counters into 'stats'. */
+void nn_worker_getstats (struct nn_worker *self,
+    struct nn_worker_stats *stats);
+
+/*  Timeout is in microseconds. */
+void nn_worker_add_timer (struct nn_worker *self, int64_t timeout,
     struct nn_worker_timer *timer);
 void nn_worker_rm_timer (struct nn_worker *self,
     struct nn_worker_timer *timer);
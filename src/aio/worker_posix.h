@@ -56,6 +56,17 @@ struct nn_worker {
     struct nn_poller poller;
     struct nn_poller_hndl efd_hndl;
     struct nn_timerset timerset;
+    struct nn_worker_stats stats;
+#if defined NN_USE_TIMERFD
+
+    /*  The timerfd the first timeout is armed on, so that timeouts have
+        microsecond rather than millisecond resolution. 'tfd_due' is the
+        instant it is armed for, -1 if it's disarmed. If timerfd is not
+        available at run time 'tfd' is -1 and poller's timeout is used. */
+    int tfd;
+    struct nn_poller_hndl tfd_hndl;
+    int64_t tfd_due;
+#endif
     struct nn_thread thread;
 };
 
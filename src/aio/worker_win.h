@@ -65,6 +65,7 @@ int nn_worker_op_isidle (struct nn_worker_op *self);
 struct nn_worker {
     HANDLE cp;
     struct nn_timerset timerset;
+    struct nn_worker_stats stats;
     struct nn_thread thread;
 };
 
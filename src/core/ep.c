@@ -26,6 +26,7 @@
 
 #include "ep.h"
 #include "sock.h"
+#include "snapshot.h"
 
 #include "../utils/err.h"
 #include "../utils/cont.h"
@@ -57,6 +58,8 @@ int nn_ep_init (struct nn_ep *self, int src, struct nn_sock *sock, int eid,
 
     self->sock = sock;
     self->eid = eid;
+    self->bind = bind;
+    self->transport = transport;
     self->last_errno = 0;
     nn_list_item_init (&self->item);
     memcpy (&self->options, &sock->ep_template, sizeof(struct nn_ep_options));
@@ -211,6 +214,7 @@ void nn_ep_set_error(struct nn_ep *self, int errnum)
     if (self->last_errno == 0)
         nn_sock_stat_increment (self->sock, NN_STAT_CURRENT_EP_ERRORS, 1);
     self->last_errno = errnum;
+    nn_recorder_error (&nn_ep_getctx (self)->recorder, self->eid, errnum);
     nn_sock_report_error (self->sock, self, errnum);
 }
 
@@ -221,6 +225,7 @@ void nn_ep_clear_error (struct nn_ep *self)
         return;
     nn_sock_stat_increment (self->sock, NN_STAT_CURRENT_EP_ERRORS, -1);
     self->last_errno = 0;
+    nn_recorder_error (&nn_ep_getctx (self)->recorder, self->eid, 0);
     nn_sock_report_error (self->sock, self, 0);
 }
 
@@ -229,6 +234,40 @@ void nn_ep_stat_increment (struct nn_ep *self, int name, int increment)
     nn_sock_stat_increment (self->sock, name, increment);
 }
 
+void nn_ep_snapshot (struct nn_ep *self, struct nn_snapshot *snap)
+{
+    char addr [NN_SOCKADDR_MAX + 16];
+    size_t sz;
+
+    /*  Reassemble the address in the form it was passed to nn_bind()
+        or nn_connect(). */
+    sz = strlen (self->transport->name);
+    nn_assert (sz + 3 + strlen (self->addr) < sizeof (addr));
+    memcpy (addr, self->transport->name, sz);
+    memcpy (addr + sz, "://", 3);
+    strcpy (addr + sz + 3, self->addr);
+
+    nn_snapshot_begin (snap, NULL, '{');
+    nn_snapshot_int (snap, "id", self->eid);
+    nn_snapshot_str (snap, "address", addr);
+    nn_snapshot_bool (snap, "bind", self->bind);
+    switch (self->state) {
+    case NN_EP_STATE_IDLE:
+        nn_snapshot_str (snap, "state", "idle");
+        break;
+    case NN_EP_STATE_ACTIVE:
+        nn_snapshot_str (snap, "state", "active");
+        break;
+    default:
+        nn_snapshot_str (snap, "state", "stopping");
+        break;
+    }
+    nn_snapshot_int (snap, "last_errno", self->last_errno);
+    nn_snapshot_str (snap, "last_error",
+        self->last_errno ? nn_strerror (self->last_errno) : NULL);
+    nn_snapshot_end (snap, '}');
+}
+
 int nn_ep_ispeer_ep (struct nn_ep *self, struct nn_ep *other)
 {
     return nn_ep_ispeer (self, other->sock->socktype->protocol);
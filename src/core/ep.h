@@ -30,6 +30,8 @@
 
 #include "../utils/list.h"
 
+struct nn_snapshot;
+
 /*  Events generated by the nn_ep object. */
 #define NN_EP_STOPPED 1
 
@@ -39,6 +41,8 @@ struct nn_ep {
     struct nn_sock *sock;
     struct nn_ep_options options;
     int eid;
+    int bind;
+    const struct nn_transport *transport;
     struct nn_list_item item;
     char addr [NN_SOCKADDR_MAX + 1];
     int protocol;
@@ -71,4 +75,7 @@ void nn_ep_set_error(struct nn_ep *self, int errnum);
 void nn_ep_clear_error(struct nn_ep *self);
 void nn_ep_stat_increment(struct nn_ep *self, int name, int increment);
 
+/*  Write the state of the endpoint to the snapshot (see nn_get_snapshot). */
+void nn_ep_snapshot (struct nn_ep *self, struct nn_snapshot *snap);
+
 #endif
@@ -29,6 +29,7 @@
 #include "global.h"
 #include "sock.h"
 #include "ep.h"
+#include "snapshot.h"
 
 #include "../aio/pool.h"
 #include "../aio/timer.h"
@@ -42,6 +43,7 @@
 #include "../utils/cont.h"
 #include "../utils/random.h"
 #include "../utils/chunk.h"
+#include "../utils/region.h"
 #include "../utils/msg.h"
 #include "../utils/attr.h"
 
@@ -132,14 +134,26 @@ const struct nn_socktype *nn_socktypes[] = {
 
 extern struct nn_transport nn_inproc;
 extern struct nn_transport nn_ipc;
+#if defined NN_HAVE_SHM
+extern struct nn_transport nn_shm;
+#endif
 extern struct nn_transport nn_tcp;
 extern struct nn_transport nn_ws;
+#if !defined NN_HAVE_WINDOWS
+extern struct nn_transport nn_udp;
+#endif
 
 const struct nn_transport *nn_transports[] = {
     &nn_inproc,
     &nn_ipc,
+#if defined NN_HAVE_SHM
+    &nn_shm,
+#endif
     &nn_tcp,
     &nn_ws,
+#if !defined NN_HAVE_WINDOWS
+    &nn_udp,
+#endif
     NULL,
 };
 
@@ -167,6 +181,7 @@ struct nn_global {
     int state;
 
     int print_errors;
+    int print_flight_record;
 
     int inited;
     nn_mutex_t lock;
@@ -195,6 +210,10 @@ static int nn_global_hold_socket (struct nn_sock **sockp, int s);
 static int nn_global_hold_socket_locked (struct nn_sock **sockp, int s);
 static void nn_global_rele_socket(struct nn_sock *);
 
+/*  Introspection. */
+static int nn_global_copy_snapshot (struct nn_snapshot *snap, void *buf,
+    size_t len);
+
 int nn_errno (void)
 {
     return nn_err_errno ();
@@ -248,6 +267,10 @@ static void nn_global_init (void)
     /*  any non-empty string is true */
     self.print_errors = envvar && *envvar;
 
+    /*  Print the flight record of each socket to the stderr on close  */
+    envvar = getenv("NN_PRINT_FLIGHT_RECORD");
+    self.print_flight_record = envvar && *envvar;
+
     /*  Allocate the stack of unused file descriptors. */
     self.unused = (uint16_t*) (self.socks + NN_MAX_SOCKETS);
     alloc_assert (self.unused);
@@ -361,6 +384,42 @@ void *nn_allocmsg (size_t size, int type)
     return NULL;
 }
 
+void *nn_filemsg (int fd, uint64_t offset, size_t size)
+{
+    int rc;
+    void *result;
+
+    rc = nn_chunk_alloc_file (fd, offset, size, &result);
+    if (rc == 0)
+        return result;
+    errno = -rc;
+    return NULL;
+}
+
+int nn_register_region (void *addr, size_t size, size_t blocksize)
+{
+    int rc;
+
+    rc = nn_region_register (addr, size, blocksize);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+    return rc;
+}
+
+int nn_unregister_region (int type)
+{
+    int rc;
+
+    rc = nn_region_unregister (type);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+    return 0;
+}
+
 void *nn_reallocmsg (void *msg, size_t size)
 {
     int rc;
@@ -378,6 +437,16 @@ int nn_freemsg (void *msg)
     return 0;
 }
 
+int nn_refmsg (void *msg)
+{
+    if (nn_slow (!nn_chunk_check (msg))) {
+        errno = EFAULT;
+        return -1;
+    }
+    nn_chunk_addref (msg, 1);
+    return 0;
+}
+
 struct nn_cmsghdr *nn_cmsg_nxthdr_ (const struct nn_msghdr *mhdr,
     const struct nn_cmsghdr *cmsg)
 {
@@ -723,6 +792,8 @@ int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
     int nnmsg;
     struct nn_cmsghdr *cmsg;
     struct nn_sock *sock;
+    int fd;
+    uint64_t offset;
 
     rc = nn_global_hold_socket (&sock, s);
     if (nn_slow (rc < 0)) {
@@ -750,6 +821,41 @@ int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
         nn_msg_init_chunk (&msg, chunk);
         nnmsg = 1;
     }
+    else if (msghdr->msg_iovlen > 1 &&
+          msghdr->msg_iov [0].iov_len == NN_MSG) {
+
+        /*  Gather the chunks into a single message without copying them. */
+        if (nn_slow (msghdr->msg_iovlen > NN_MSG_MAXPARTS + 1)) {
+            rc = -EMSGSIZE;
+            goto fail;
+        }
+        sz = 0;
+        for (i = 0; i != msghdr->msg_iovlen; ++i) {
+            iov = &msghdr->msg_iov [i];
+            if (nn_slow (iov->iov_len != NN_MSG)) {
+               rc = -EINVAL;
+               goto fail;
+            }
+            if (nn_slow (*(void**) iov->iov_base == NULL)) {
+                rc = -EFAULT;
+                goto fail;
+            }
+            sz += nn_chunk_size (*(void**) iov->iov_base);
+        }
+
+        /*  A chunk referring to a file can't be the body itself, so it takes
+            up one of the parts. */
+        if (nn_slow (msghdr->msg_iovlen > NN_MSG_MAXPARTS &&
+              nn_chunk_file (*(void**) msghdr->msg_iov [0].iov_base,
+              &fd, &offset))) {
+            rc = -EMSGSIZE;
+            goto fail;
+        }
+        nn_msg_init_chunk (&msg, *(void**) msghdr->msg_iov [0].iov_base);
+        for (i = 1; i != msghdr->msg_iovlen; ++i)
+            nn_msg_addpart (&msg, *(void**) msghdr->msg_iov [i].iov_base);
+        nnmsg = 1;
+    }
     else {
 
         /*  Compute the total size of the message. */
@@ -791,14 +897,13 @@ int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
         /*  TODO: SP_HDR should not be copied here! */
         if (msghdr->msg_controllen == NN_MSG) {
             chunk = *((void**) msghdr->msg_control);
-            nn_chunkref_term (&msg.hdrs);
-            nn_chunkref_init_chunk (&msg.hdrs, chunk);
+            nn_msg_sethdrs (&msg, chunk);
         }
         else {
-            nn_chunkref_term (&msg.hdrs);
-            nn_chunkref_init (&msg.hdrs, msghdr->msg_controllen);
-            memcpy (nn_chunkref_data (&msg.hdrs),
-                msghdr->msg_control, msghdr->msg_controllen);
+            rc = nn_chunk_alloc (msghdr->msg_controllen, 0, &chunk);
+            errnum_assert (rc == 0, -rc);
+            memcpy (chunk, msghdr->msg_control, msghdr->msg_controllen);
+            nn_msg_sethdrs (&msg, chunk);
         }
 
         /* Search for SP_HDR property. */
@@ -821,6 +926,9 @@ int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
             }
             cmsg = NN_CMSG_NXTHDR (msghdr, cmsg);
         }
+
+        /*  From now on, the deadline doesn't depend on when it's looked at. */
+        nn_msg_armdeadline (&msg);
     }
 
     /*  Send it further down the stack. */
@@ -829,8 +937,11 @@ int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
 
         /*  If we are dealing with user-supplied buffer, detach it from
             the message object. */
-        if (nnmsg)
+        if (nnmsg) {
             nn_chunkref_init (&msg.body, 0);
+            if (msg.parts)
+                msg.parts->nchunks = 0;
+        }
 
         nn_msg_term (&msg);
         goto fail;
@@ -867,6 +978,9 @@ int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags)
     size_t sptotalsz;
     struct nn_cmsghdr *chdr;
     struct nn_sock *sock;
+    void *deadline;
+    int left;
+    size_t pos;
 
     rc = nn_global_hold_socket (&sock, s);
     if (nn_slow (rc < 0)) {
@@ -923,7 +1037,7 @@ int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags)
 
         spsz = nn_chunkref_size (&msg.sphdr);
         sptotalsz = NN_CMSG_SPACE (spsz+sizeof (size_t));
-        ctrlsz = sptotalsz + nn_chunkref_size (&msg.hdrs);
+        ctrlsz = sptotalsz + nn_msg_hdrssize (&msg);
 
         if (msghdr->msg_controllen == NN_MSG) {
 
@@ -959,11 +1073,25 @@ int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags)
 
             /*  Fill in as many remaining properties as possible.
                 Truncate the trailing properties if necessary. */
-            hdrssz = nn_chunkref_size (&msg.hdrs);
+            hdrssz = nn_msg_hdrssize (&msg);
             if (hdrssz > ctrlsz - sptotalsz)
                 hdrssz = ctrlsz - sptotalsz;
-            memcpy (((char*) ctrl) + sptotalsz,
-                nn_chunkref_data (&msg.hdrs), hdrssz);
+            if (hdrssz > 0)
+                memcpy (((char*) ctrl) + sptotalsz, msg.hdrs, hdrssz);
+
+            /*  The user gets the time remaining till the deadline, so that
+                the message can be passed on with the deadline intact. The
+                headers may be shared with other copies of the message, so
+                only the copy handed to the user is changed. */
+            deadline = nn_msg_getcmsg (&msg, NN_SOL_SOCKET, NN_DEADLINE,
+                sizeof (int));
+            if (nn_slow (deadline != NULL)) {
+                left = nn_msg_timeleft (&msg);
+                pos = ((char*) deadline) - ((char*) msg.hdrs);
+                if (pos + sizeof (left) <= hdrssz)
+                    memcpy (((char*) ctrl) + sptotalsz + pos, &left,
+                        sizeof (left));
+            }
         }
     }
 
@@ -1030,6 +1158,18 @@ uint64_t nn_get_statistic (int s, int statistic)
     case NN_STAT_BYTES_RECEIVED:
         val = sock->statistics.bytes_received;
         break;
+    case NN_STAT_DROPPED_MESSAGES:
+        val = sock->statistics.dropped_messages;
+        break;
+    case NN_STAT_HEDGED_REQUESTS:
+        val = sock->statistics.hedged_requests;
+        break;
+    case NN_STAT_EXPIRED_MESSAGES:
+        val = sock->statistics.expired_messages;
+        break;
+    case NN_STAT_QUEUED_BYTES:
+        val = sock->statistics.queued_bytes;
+        break;
     case NN_STAT_CURRENT_CONNECTIONS:
         val = sock->statistics.current_connections;
         break;
@@ -1052,6 +1192,153 @@ uint64_t nn_get_statistic (int s, int statistic)
     return val;
 }
 
+uint64_t nn_get_worker_statistic (int worker, int statistic)
+{
+    int rc;
+    struct nn_worker_stats stats;
+
+    nn_do_once (&once, nn_lib_init);
+
+    /*  Worker threads exist only while there's at least one socket open. */
+    nn_mutex_lock (&self.lock);
+    if (nn_slow (self.socks == NULL))
+        rc = -EINVAL;
+    else
+        rc = nn_pool_getstats (&self.pool, worker, &stats);
+    nn_mutex_unlock (&self.lock);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return (uint64_t)-1;
+    }
+
+    switch (statistic) {
+    case NN_STAT_WORKER_LOOPS:
+        return stats.loops;
+    case NN_STAT_WORKER_EVENTS:
+        return stats.events;
+    case NN_STAT_WORKER_TASKS:
+        return stats.tasks;
+    case NN_STAT_WORKER_TIMERS:
+        return stats.timers;
+    case NN_STAT_WORKER_BUSY_TIME:
+        return stats.busy;
+    case NN_STAT_WORKER_WAIT_TIME:
+        return stats.wait;
+    case NN_STAT_WORKER_MAX_HANDLER_TIME:
+        return stats.maxhandler;
+    }
+
+    errno = EINVAL;
+    return (uint64_t)-1;
+}
+
+int nn_get_snapshot (void *buf, size_t len)
+{
+    int rc;
+    int i;
+    int nsocks;
+    int *fds;
+    struct nn_sock **socks;
+    struct nn_snapshot snap;
+
+    nn_do_once (&once, nn_lib_init);
+
+    /*  Hold all the sockets first so that the global lock isn't kept while
+        waiting for the individual sockets' contexts. */
+    socks = NULL;
+    fds = NULL;
+    nsocks = 0;
+    nn_mutex_lock (&self.lock);
+    if (self.socks != NULL && self.nsocks > 0) {
+        socks = nn_alloc (sizeof (struct nn_sock*) * self.nsocks,
+            "snapshot");
+        alloc_assert (socks);
+        fds = nn_alloc (sizeof (int) * self.nsocks, "snapshot");
+        alloc_assert (fds);
+        for (i = 0; i != NN_MAX_SOCKETS && (size_t) nsocks != self.nsocks; ++i) {
+            if (self.socks [i] == NULL || nn_sock_hold (self.socks [i]) != 0)
+                continue;
+            socks [nsocks] = self.socks [i];
+            fds [nsocks] = i;
+            ++nsocks;
+        }
+    }
+    nn_mutex_unlock (&self.lock);
+
+    nn_snapshot_init (&snap);
+    nn_snapshot_begin (&snap, NULL, '{');
+    nn_snapshot_begin (&snap, "sockets", '[');
+    for (i = 0; i != nsocks; ++i) {
+        nn_snapshot_begin (&snap, NULL, '{');
+        nn_snapshot_int (&snap, "fd", fds [i]);
+        nn_sock_snapshot (socks [i], &snap);
+        nn_snapshot_end (&snap, '}');
+        nn_global_rele_socket (socks [i]);
+    }
+    nn_snapshot_end (&snap, ']');
+    nn_snapshot_end (&snap, '}');
+    if (socks) {
+        nn_free (fds);
+        nn_free (socks);
+    }
+
+    rc = nn_global_copy_snapshot (&snap, buf, len);
+    nn_snapshot_term (&snap);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+    return rc;
+}
+
+int nn_get_flight_record (int s, void *buf, size_t len)
+{
+    int rc;
+    struct nn_sock *sock;
+    struct nn_snapshot snap;
+
+    rc = nn_global_hold_socket (&sock, s);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+
+    /*  The record is read without entering the socket's context so that
+        it can be retrieved even if the socket is stuck. */
+    nn_snapshot_init (&snap);
+    nn_snapshot_begin (&snap, NULL, '{');
+    nn_snapshot_int (&snap, "fd", s);
+    nn_sock_record (sock, &snap);
+    nn_snapshot_end (&snap, '}');
+    nn_global_rele_socket (sock);
+
+    rc = nn_global_copy_snapshot (&snap, buf, len);
+    nn_snapshot_term (&snap);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+    return rc;
+}
+
+int nn_get_memory_stat (int i, struct nn_memory_stat *buf, int buflen)
+{
+    int rc;
+    struct nn_memory_stat stat;
+
+    if (nn_slow (buflen < 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+    rc = nn_alloc_stat (i, &stat.name, &stat.bytes, &stat.blocks);
+    if (rc < 0)
+        return 0;
+    if (buflen > (int) sizeof (stat))
+        buflen = (int) sizeof (stat);
+    memcpy (buf, &stat, buflen);
+    return buflen;
+}
+
 static int nn_global_create_ep (struct nn_sock *sock, const char *addr,
     int bind)
 {
@@ -1118,6 +1405,41 @@ int nn_global_print_errors ()
     return self.print_errors;
 }
 
+int nn_global_print_flight_record (void)
+{
+    return self.print_flight_record;
+}
+
+/*  Hands the document over, zero-terminated, either in a freshly allocated
+    message chunk or in the user-supplied buffer. Returns the length of the
+    whole document. */
+static int nn_global_copy_snapshot (struct nn_snapshot *snap, void *buf,
+    size_t len)
+{
+    int rc;
+    void *chunk;
+
+    if (len == NN_MSG) {
+        if (nn_slow (buf == NULL))
+            return -EFAULT;
+        rc = nn_chunk_alloc (snap->len + 1, 0, &chunk);
+        if (nn_slow (rc < 0))
+            return rc;
+        memcpy (chunk, snap->buf, snap->len + 1);
+        *(void**) buf = chunk;
+    }
+    else if (len > 0) {
+        if (nn_slow (buf == NULL))
+            return -EFAULT;
+        if (len > snap->len + 1)
+            len = snap->len + 1;
+        memcpy (buf, snap->buf, len);
+        ((char*) buf) [len - 1] = 0;
+    }
+
+    return (int) snap->len;
+}
+
 /*  Get the socket structure for a socket id.  This must be called under
     the global lock (self.lock.)  The socket itself will not be freed
     while the hold is active. */
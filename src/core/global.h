@@ -31,4 +31,7 @@ const struct nn_transport *nn_global_transport (int id);
 struct nn_pool *nn_global_getpool ();
 int nn_global_print_errors();
 
+/*  Returns 1 if flight records should be printed when sockets are closed. */
+int nn_global_print_flight_record (void);
+
 #endif
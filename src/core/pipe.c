@@ -26,9 +26,11 @@
 
 #include "sock.h"
 #include "ep.h"
+#include "snapshot.h"
 
 #include "../utils/err.h"
 #include "../utils/fast.h"
+#include "../utils/probe.h"
 
 /*  Internal pipe states. */
 #define NN_PIPEBASE_STATE_IDLE 1
@@ -59,6 +61,16 @@ void nn_pipebase_init (struct nn_pipebase *self,
     self->outstate = NN_PIPEBASE_OUTSTATE_DEACTIVATED;
     self->sock = ep->sock;
     memcpy (&self->options, &ep->options, sizeof (struct nn_ep_options));
+    self->maxsz = 0;
+    self->gather = 0;
+    self->sendfile = 0;
+    nn_list_item_init (&self->item);
+    self->eid = ep->eid;
+    self->messages_sent = 0;
+    self->messages_received = 0;
+    self->bytes_sent = 0;
+    self->bytes_received = 0;
+    self->messages_dropped = 0;
     nn_fsm_event_init (&self->in);
     nn_fsm_event_init (&self->out);
 }
@@ -69,9 +81,27 @@ void nn_pipebase_term (struct nn_pipebase *self)
 
     nn_fsm_event_term (&self->out);
     nn_fsm_event_term (&self->in);
+    nn_list_item_term (&self->item);
     nn_fsm_term (&self->fsm);
 }
 
+void nn_pipebase_setmaxsz (struct nn_pipebase *self, size_t maxsz)
+{
+    nn_assert_state (self, NN_PIPEBASE_STATE_IDLE);
+    self->maxsz = maxsz;
+}
+
+void nn_pipebase_setgather (struct nn_pipebase *self)
+{
+    self->gather = 1;
+}
+
+void nn_pipebase_setsendfile (struct nn_pipebase *self)
+{
+    nn_assert (self->gather);
+    self->sendfile = 1;
+}
+
 int nn_pipebase_start (struct nn_pipebase *self)
 {
     int rc;
@@ -182,6 +212,27 @@ int nn_pipe_send (struct nn_pipe *self, struct nn_msg *msg)
     pipebase = (struct nn_pipebase*) self;
     nn_assert (pipebase->outstate == NN_PIPEBASE_OUTSTATE_IDLE);
     pipebase->outstate = NN_PIPEBASE_OUTSTATE_SENDING;
+
+    /*  Message that refers to a file that was truncated or can't be read
+        is dropped, whether the transport reads the file into memory or
+        sends it straight from the file. */
+    if (nn_slow (msg->parts != NULL)) {
+        if (!pipebase->gather || (msg->parts->files && !pipebase->sendfile))
+            rc = nn_msg_flatten (msg);
+        else
+            rc = nn_msg_checkfiles (msg);
+        if (nn_slow (rc < 0)) {
+            nn_msg_term (msg);
+            ++pipebase->messages_dropped;
+            nn_sock_stat_increment (pipebase->sock,
+                NN_STAT_DROPPED_MESSAGES, 1);
+            pipebase->outstate = NN_PIPEBASE_OUTSTATE_IDLE;
+            return 0;
+        }
+    }
+    NN_PROBE2 (pipe__send, self, nn_msg_bodysize (msg));
+    ++pipebase->messages_sent;
+    pipebase->bytes_sent += nn_msg_bodysize (msg);
     rc = pipebase->vfptr->send (pipebase, msg);
     errnum_assert (rc >= 0, -rc);
     if (nn_fast (pipebase->outstate == NN_PIPEBASE_OUTSTATE_SENT)) {
@@ -203,6 +254,9 @@ int nn_pipe_recv (struct nn_pipe *self, struct nn_msg *msg)
     pipebase->instate = NN_PIPEBASE_INSTATE_RECEIVING;
     rc = pipebase->vfptr->recv (pipebase, msg);
     errnum_assert (rc >= 0, -rc);
+    NN_PROBE2 (pipe__recv, self, nn_msg_bodysize (msg));
+    ++pipebase->messages_received;
+    pipebase->bytes_received += nn_msg_bodysize (msg);
 
     if (nn_fast (pipebase->instate == NN_PIPEBASE_INSTATE_RECEIVED)) {
         pipebase->instate = NN_PIPEBASE_INSTATE_IDLE;
@@ -213,6 +267,21 @@ int nn_pipe_recv (struct nn_pipe *self, struct nn_msg *msg)
     return rc | NN_PIPEBASE_RELEASE;
 }
 
+int nn_pipe_expired (struct nn_pipe *self, struct nn_msg *msg)
+{
+    if (nn_fast (nn_msg_timeleft (msg) != 0))
+        return 0;
+    nn_msg_term (msg);
+    nn_sock_stat_increment (((struct nn_pipebase*) self)->sock,
+        NN_STAT_EXPIRED_MESSAGES, 1);
+    return 1;
+}
+
+void nn_pipe_dropped (struct nn_pipe *self)
+{
+    ++((struct nn_pipebase*) self)->messages_dropped;
+}
+
 void nn_pipe_getopt (struct nn_pipe *self, int level, int option,
     void *optval, size_t *optvallen)
 {
@@ -222,3 +291,37 @@ void nn_pipe_getopt (struct nn_pipe *self, int level, int option,
     pipebase = (struct nn_pipebase*) self;
     nn_pipebase_getopt (pipebase, level, option, optval, optvallen);
 }
+
+void nn_pipebase_snapshot (struct nn_pipebase *self, struct nn_snapshot *snap)
+{
+    nn_snapshot_begin (snap, NULL, '{');
+    nn_snapshot_int (snap, "endpoint", self->eid);
+    switch (self->instate) {
+    case NN_PIPEBASE_INSTATE_IDLE:
+        nn_snapshot_str (snap, "in", "ready");
+        break;
+    case NN_PIPEBASE_INSTATE_ASYNC:
+        nn_snapshot_str (snap, "in", "waiting");
+        break;
+    default:
+        nn_snapshot_str (snap, "in", "inactive");
+        break;
+    }
+    switch (self->outstate) {
+    case NN_PIPEBASE_OUTSTATE_IDLE:
+        nn_snapshot_str (snap, "out", "ready");
+        break;
+    case NN_PIPEBASE_OUTSTATE_ASYNC:
+        nn_snapshot_str (snap, "out", "busy");
+        break;
+    default:
+        nn_snapshot_str (snap, "out", "inactive");
+        break;
+    }
+    nn_snapshot_uint (snap, "messages_sent", self->messages_sent);
+    nn_snapshot_uint (snap, "messages_received", self->messages_received);
+    nn_snapshot_uint (snap, "bytes_sent", self->bytes_sent);
+    nn_snapshot_uint (snap, "bytes_received", self->bytes_received);
+    nn_snapshot_uint (snap, "messages_dropped", self->messages_dropped);
+    nn_snapshot_end (snap, '}');
+}
@@ -0,0 +1,201 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "snapshot.h"
+
+#include "../utils/alloc.h"
+#include "../utils/err.h"
+#include "../utils/fast.h"
+
+#include <string.h>
+
+static void nn_snapshot_write (struct nn_snapshot *self, const char *data,
+    size_t len);
+static void nn_snapshot_quoted (struct nn_snapshot *self, const char *str);
+static void nn_snapshot_key (struct nn_snapshot *self, const char *key);
+static void nn_snapshot_number (struct nn_snapshot *self, const char *key,
+    int negative, unsigned long long val);
+
+void nn_snapshot_init (struct nn_snapshot *self)
+{
+    self->cap = 4096;
+    self->buf = nn_alloc (self->cap, "snapshot");
+    alloc_assert (self->buf);
+    self->len = 0;
+    self->items [0] = 0;
+    self->depth = 0;
+}
+
+void nn_snapshot_term (struct nn_snapshot *self)
+{
+    nn_free (self->buf);
+}
+
+void nn_snapshot_begin (struct nn_snapshot *self, const char *key, char open)
+{
+    nn_assert (self->depth + 1 <
+        (int) (sizeof (self->items) / sizeof (self->items [0])));
+    nn_snapshot_key (self, key);
+    nn_snapshot_write (self, &open, 1);
+    ++self->depth;
+    self->items [self->depth] = 0;
+}
+
+void nn_snapshot_end (struct nn_snapshot *self, char close)
+{
+    nn_assert (self->depth > 0);
+    --self->depth;
+    nn_snapshot_write (self, &close, 1);
+}
+
+void nn_snapshot_int (struct nn_snapshot *self, const char *key, long long val)
+{
+    if (val < 0)
+        nn_snapshot_number (self, key, 1, 0ULL - (unsigned long long) val);
+    else
+        nn_snapshot_number (self, key, 0, (unsigned long long) val);
+}
+
+void nn_snapshot_uint (struct nn_snapshot *self, const char *key,
+    unsigned long long val)
+{
+    nn_snapshot_number (self, key, 0, val);
+}
+
+void nn_snapshot_hex (struct nn_snapshot *self, const char *key,
+    unsigned long long val)
+{
+    static const char hex [] = "0123456789abcdef";
+    char digits [21];
+    size_t pos;
+
+    /*  Written as a string as JSON doesn't have hexadecimal numbers. */
+    pos = sizeof (digits);
+    digits [--pos] = '"';
+    do {
+        digits [--pos] = hex [val & 0xf];
+        val >>= 4;
+    } while (val);
+    digits [--pos] = 'x';
+    digits [--pos] = '0';
+    digits [--pos] = '"';
+
+    nn_snapshot_key (self, key);
+    nn_snapshot_write (self, digits + pos, sizeof (digits) - pos);
+}
+
+void nn_snapshot_bool (struct nn_snapshot *self, const char *key, int val)
+{
+    nn_snapshot_key (self, key);
+    if (val)
+        nn_snapshot_write (self, "true", 4);
+    else
+        nn_snapshot_write (self, "false", 5);
+}
+
+void nn_snapshot_str (struct nn_snapshot *self, const char *key,
+    const char *val)
+{
+    nn_snapshot_key (self, key);
+    if (!val) {
+        nn_snapshot_write (self, "null", 4);
+        return;
+    }
+    nn_snapshot_quoted (self, val);
+}
+
+static void nn_snapshot_key (struct nn_snapshot *self, const char *key)
+{
+    if (self->items [self->depth]++ > 0)
+        nn_snapshot_write (self, ",", 1);
+    if (key) {
+        nn_snapshot_quoted (self, key);
+        nn_snapshot_write (self, ":", 1);
+    }
+}
+
+static void nn_snapshot_number (struct nn_snapshot *self, const char *key,
+    int negative, unsigned long long val)
+{
+    char digits [24];
+    size_t pos;
+
+    pos = sizeof (digits);
+    do {
+        digits [--pos] = (char) ('0' + val % 10);
+        val /= 10;
+    } while (val);
+    if (negative)
+        digits [--pos] = '-';
+
+    nn_snapshot_key (self, key);
+    nn_snapshot_write (self, digits + pos, sizeof (digits) - pos);
+}
+
+static void nn_snapshot_quoted (struct nn_snapshot *self, const char *str)
+{
+    static const char hex [] = "0123456789abcdef";
+    char esc [6];
+    const char *run;
+
+    nn_snapshot_write (self, "\"", 1);
+
+    /*  Copy runs of plain characters in one go, escape the rest. */
+    run = str;
+    for (; *str; ++str) {
+        if ((unsigned char) *str >= 0x20 && *str != '"' && *str != '\\')
+            continue;
+        nn_snapshot_write (self, run, str - run);
+        esc [0] = '\\';
+        if (*str == '"' || *str == '\\') {
+            esc [1] = *str;
+            nn_snapshot_write (self, esc, 2);
+        }
+        else {
+            esc [1] = 'u';
+            esc [2] = '0';
+            esc [3] = '0';
+            esc [4] = hex [(*str >> 4) & 0xf];
+            esc [5] = hex [*str & 0xf];
+            nn_snapshot_write (self, esc, 6);
+        }
+        run = str + 1;
+    }
+    nn_snapshot_write (self, run, str - run);
+
+    nn_snapshot_write (self, "\"", 1);
+}
+
+static void nn_snapshot_write (struct nn_snapshot *self, const char *data,
+    size_t len)
+{
+    /*  Always keep a spare byte for the terminating zero. */
+    if (nn_slow (self->len + len + 1 > self->cap)) {
+        while (self->len + len + 1 > self->cap)
+            self->cap *= 2;
+        self->buf = nn_realloc (self->buf, self->cap);
+        alloc_assert (self->buf);
+    }
+    memcpy (self->buf + self->len, data, len);
+    self->len += len;
+    self->buf [self->len] = 0;
+}
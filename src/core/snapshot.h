@@ -0,0 +1,62 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_SNAPSHOT_INCLUDED
+#define NN_SNAPSHOT_INCLUDED
+
+#include <stddef.h>
+
+/*  Growable text buffer the introspection snapshot (see nn_get_snapshot)
+    is written to. The document is JSON; the objects taking part in it
+    (sockets, endpoints, pipes) each write their own part of it. */
+
+struct nn_snapshot {
+    char *buf;
+    size_t len;
+    size_t cap;
+
+    /*  Number of values written at the current nesting level; used to
+        decide whether a separating comma is needed. */
+    int items [8];
+    int depth;
+};
+
+void nn_snapshot_init (struct nn_snapshot *self);
+void nn_snapshot_term (struct nn_snapshot *self);
+
+/*  Open or close a JSON object or array. If 'key' is not NULL the value
+    is written as a member of the enclosing object. */
+void nn_snapshot_begin (struct nn_snapshot *self, const char *key, char open);
+void nn_snapshot_end (struct nn_snapshot *self, char close);
+
+/*  Write a single member of the current object. A NULL string is written
+    as JSON null. */
+void nn_snapshot_int (struct nn_snapshot *self, const char *key, long long val);
+void nn_snapshot_uint (struct nn_snapshot *self, const char *key,
+    unsigned long long val);
+void nn_snapshot_hex (struct nn_snapshot *self, const char *key,
+    unsigned long long val);
+void nn_snapshot_bool (struct nn_snapshot *self, const char *key, int val);
+void nn_snapshot_str (struct nn_snapshot *self, const char *key,
+    const char *val);
+
+#endif
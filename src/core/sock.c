@@ -29,6 +29,7 @@
 #include "sock.h"
 #include "global.h"
 #include "ep.h"
+#include "snapshot.h"
 
 #include "../utils/err.h"
 #include "../utils/cont.h"
@@ -36,6 +37,7 @@
 #include "../utils/fast.h"
 #include "../utils/alloc.h"
 #include "../utils/msg.h"
+#include "../utils/probe.h"
 
 #include <limits.h>
 
@@ -62,6 +64,10 @@
 static struct nn_optset *nn_sock_optset (struct nn_sock *self, int id);
 static int nn_sock_setopt_inner (struct nn_sock *self, int level,
     int option, const void *optval, size_t optvallen);
+static int nn_sock_send_inner (struct nn_sock *self, struct nn_msg *msg,
+    int flags);
+static int nn_sock_recv_inner (struct nn_sock *self, struct nn_msg *msg,
+    int flags);
 static void nn_sock_onleave (struct nn_ctx *self);
 static void nn_sock_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
@@ -121,6 +127,7 @@ int nn_sock_init (struct nn_sock *self, const struct nn_socktype *socktype,
     self->flags = 0;
     nn_list_init (&self->eps);
     nn_list_init (&self->sdeps);
+    nn_list_init (&self->pipes);
     self->eid = 1;
 
     /*  Default values for NN_SOL_SOCKET options. */
@@ -132,6 +139,13 @@ int nn_sock_init (struct nn_sock *self, const struct nn_socktype *socktype,
     self->reconnect_ivl = 100;
     self->reconnect_ivl_max = 0;
     self->maxttl = 8;
+    self->sndqueue_msgs = 0;
+    self->sndqueue_bytes = 0;
+    self->sndqueue_policy = NN_SNDQUEUE_DROP_NEWEST;
+    self->rcvfragsize = -1;
+    self->rcvmore = 0;
+    self->sndmaxsz = 0;
+    self->sndlimited = 0;
     self->ep_template.sndprio = 8;
     self->ep_template.rcvprio = 8;
     self->ep_template.ipv4only = 1;
@@ -224,6 +238,9 @@ int nn_sock_term (struct nn_sock *self)
     /*  At this point, we can be reasonably certain that no other thread
         has any references to the socket. */
 
+    if (nn_global_print_flight_record ())
+        nn_sock_print_record (self);
+
     /*  Close the event FDs entirely. */
     if (!(self->socktype->flags & NN_SOCKTYPE_FLAG_NORECV)) {
         nn_efd_term (&self->rcvfd);
@@ -236,6 +253,7 @@ int nn_sock_term (struct nn_sock *self)
     nn_fsm_term (&self->fsm);
     nn_sem_term (&self->termsem);
     nn_sem_term (&self->relesem);
+    nn_list_term (&self->pipes);
     nn_list_term (&self->sdeps);
     nn_list_term (&self->eps);
     nn_ctx_term (&self->ctx);
@@ -371,6 +389,28 @@ static int nn_sock_setopt_inner (struct nn_sock *self, int level,
             return -EINVAL;
         self->maxttl = val;
         return 0;
+    case NN_SNDQUEUE_MSGS:
+        if (val < 0)
+            return -EINVAL;
+        self->sndqueue_msgs = val;
+        return 0;
+    case NN_SNDQUEUE_BYTES:
+        if (val < 0)
+            return -EINVAL;
+        self->sndqueue_bytes = val;
+        return 0;
+    case NN_SNDQUEUE_POLICY:
+        if (val < NN_SNDQUEUE_DROP_NEWEST || val > NN_SNDQUEUE_BLOCK)
+            return -EINVAL;
+        self->sndqueue_policy = val;
+        return 0;
+    case NN_RCVFRAGSIZE:
+        if (val == 0 || val < -1)
+            return -EINVAL;
+        if (!(self->socktype->flags & NN_SOCKTYPE_FLAG_FRAGMENTS))
+            return -ENOTSUP;
+        self->rcvfragsize = val;
+        return 0;
     case NN_LINGER:
 	/*  Ignored, retained for compatibility. */
         return 0;
@@ -461,6 +501,21 @@ int nn_sock_getopt_inner (struct nn_sock *self, int level,
     case NN_MAXTTL:
         intval = self->maxttl;
         break;
+    case NN_SNDQUEUE_MSGS:
+        intval = self->sndqueue_msgs;
+        break;
+    case NN_SNDQUEUE_BYTES:
+        intval = self->sndqueue_bytes;
+        break;
+    case NN_SNDQUEUE_POLICY:
+        intval = self->sndqueue_policy;
+        break;
+    case NN_RCVFRAGSIZE:
+        intval = self->rcvfragsize;
+        break;
+    case NN_RCVMORE:
+        intval = self->rcvmore;
+        break;
     case NN_SNDFD:
         if (self->socktype->flags & NN_SOCKTYPE_FLAG_NOSEND)
             return -ENOPROTOOPT;
@@ -566,11 +621,23 @@ int nn_sock_rm_ep (struct nn_sock *self, int eid)
 }
 
 int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
+{
+    int rc;
+
+    NN_PROBE3 (sock__send__entry, self, nn_msg_bodysize (msg), flags);
+    rc = nn_sock_send_inner (self, msg, flags);
+    NN_PROBE2 (sock__send__return, self, rc);
+    return rc;
+}
+
+static int nn_sock_send_inner (struct nn_sock *self, struct nn_msg *msg,
+    int flags)
 {
     int rc;
     uint64_t deadline;
     uint64_t now;
     int timeout;
+    int left;
 
     /*  Some sockets types cannot be used for sending messages. */
     if (nn_slow (self->socktype->flags & NN_SOCKTYPE_FLAG_NOSEND))
@@ -578,14 +645,32 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
 
     nn_ctx_enter (&self->ctx);
 
-    /*  Compute the deadline for SNDTIMEO timer. */
-    if (self->sndtimeo < 0) {
+    /*  Refuse messages that some of the pipes wouldn't be able to carry. */
+    if (nn_slow (self->sndlimited > 0 && nn_chunkref_size (&msg->sphdr) +
+          nn_msg_bodysize (msg) > self->sndmaxsz)) {
+        nn_ctx_leave (&self->ctx);
+        return -EMSGSIZE;
+    }
+
+    /*  Don't even try to send a message that has passed its deadline. */
+    left = nn_msg_timeleft (msg);
+    if (nn_slow (left == 0)) {
+        nn_ctx_leave (&self->ctx);
+        nn_sock_stat_increment (self, NN_STAT_EXPIRED_MESSAGES, 1);
+        return -ETIMEDOUT;
+    }
+
+    /*  Compute the deadline for SNDTIMEO timer. If the message has
+        a deadline of its own, don't wait past it. */
+    if (self->sndtimeo < 0 && left < 0) {
         deadline = -1;
         timeout = -1;
     }
     else {
-        deadline = nn_clock_ms() + self->sndtimeo;
         timeout = self->sndtimeo;
+        if (left >= 0 && (timeout < 0 || left < timeout))
+            timeout = left;
+        deadline = nn_clock_ms() + timeout;
     }
 
     while (1) {
@@ -616,8 +701,11 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
         }
         nn_assert (rc < 0);
 
-        /*  Any unexpected error is forwarded to the caller. */
+        /*  Any unexpected error is forwarded to the caller. A fragmented
+            message cut short by a disconnection is over as well. */
         if (nn_slow (rc != -EAGAIN)) {
+            if (rc == -ECONNRESET)
+                self->rcvmore = 0;
             nn_ctx_leave (&self->ctx);
             return rc;
         }
@@ -633,8 +721,11 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
             for sending. */
         nn_ctx_leave (&self->ctx);
         rc = nn_efd_wait (&self->sndfd, timeout);
-        if (nn_slow (rc == -ETIMEDOUT))
+        if (nn_slow (rc == -ETIMEDOUT)) {
+            if (nn_msg_timeleft (msg) == 0)
+                nn_sock_stat_increment (self, NN_STAT_EXPIRED_MESSAGES, 1);
             return -ETIMEDOUT;
+        }
         if (nn_slow (rc == -EINTR))
             return -EINTR;
         if (nn_slow (rc == -EBADF))
@@ -650,7 +741,7 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
 
         /*  If needed, re-compute the timeout to reflect the time that have
             already elapsed. */
-        if (self->sndtimeo >= 0) {
+        if (timeout >= 0) {
             now = nn_clock_ms();
             timeout = (int) (now > deadline ? 0 : deadline - now);
         }
@@ -658,6 +749,18 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
 }
 
 int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
+{
+    int rc;
+
+    NN_PROBE2 (sock__recv__entry, self, flags);
+    rc = nn_sock_recv_inner (self, msg, flags);
+    NN_PROBE3 (sock__recv__return, self, rc,
+        rc == 0 ? nn_msg_bodysize (msg) : 0);
+    return rc;
+}
+
+static int nn_sock_recv_inner (struct nn_sock *self, struct nn_msg *msg,
+    int flags)
 {
     int rc;
     uint64_t deadline;
@@ -703,13 +806,17 @@ int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
         /*  Try to receive the message in a non-blocking way. */
         rc = self->sockbase->vfptr->recv (self->sockbase, msg);
         if (nn_fast (rc == 0)) {
+            self->rcvmore = nn_msg_more (msg);
             nn_ctx_leave (&self->ctx);
             return 0;
         }
         nn_assert (rc < 0);
 
-        /*  Any unexpected error is forwarded to the caller. */
+        /*  Any unexpected error is forwarded to the caller. A fragmented
+            message cut short by a disconnection is over as well. */
         if (nn_slow (rc != -EAGAIN)) {
+            if (rc == -ECONNRESET)
+                self->rcvmore = 0;
             nn_ctx_leave (&self->ctx);
             return rc;
         }
@@ -752,10 +859,22 @@ int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
 int nn_sock_add (struct nn_sock *self, struct nn_pipe *pipe)
 {
     int rc;
+    size_t maxsz;
 
     rc = self->sockbase->vfptr->add (self->sockbase, pipe);
     if (nn_slow (rc >= 0)) {
         nn_sock_stat_increment (self, NN_STAT_CURRENT_CONNECTIONS, 1);
+        nn_list_insert (&self->pipes, &((struct nn_pipebase*) pipe)->item,
+            nn_list_end (&self->pipes));
+
+        /*  The limit only ever shrinks while there are limited pipes.
+            That's conservative, but cheap. */
+        maxsz = ((struct nn_pipebase*) pipe)->maxsz;
+        if (nn_slow (maxsz > 0)) {
+            if (self->sndlimited == 0 || maxsz < self->sndmaxsz)
+                self->sndmaxsz = maxsz;
+            ++self->sndlimited;
+        }
     }
     return rc;
 }
@@ -764,6 +883,9 @@ void nn_sock_rm (struct nn_sock *self, struct nn_pipe *pipe)
 {
     self->sockbase->vfptr->rm (self->sockbase, pipe);
     nn_sock_stat_increment (self, NN_STAT_CURRENT_CONNECTIONS, -1);
+    nn_list_erase (&self->pipes, &((struct nn_pipebase*) pipe)->item);
+    if (nn_slow (((struct nn_pipebase*) pipe)->maxsz > 0))
+        --self->sndlimited;
 }
 
 static void nn_sock_onleave (struct nn_ctx *self)
@@ -1077,6 +1199,23 @@ void nn_sock_stat_increment (struct nn_sock *self, int name, int64_t increment)
             nn_assert (increment >= 0);
             self->statistics.bytes_received += increment;
             break;
+        case NN_STAT_DROPPED_MESSAGES:
+            nn_assert (increment > 0);
+            self->statistics.dropped_messages += increment;
+            break;
+        case NN_STAT_HEDGED_REQUESTS:
+            nn_assert (increment > 0);
+            self->statistics.hedged_requests += increment;
+            break;
+        case NN_STAT_EXPIRED_MESSAGES:
+            nn_assert (increment > 0);
+            self->statistics.expired_messages += increment;
+            break;
+        case NN_STAT_QUEUED_BYTES:
+            nn_assert (increment > 0 ||
+                self->statistics.queued_bytes >= (uint64_t) -increment);
+            self->statistics.queued_bytes += increment;
+            break;
 
         case NN_STAT_CURRENT_CONNECTIONS:
             nn_assert (increment > 0 ||
@@ -1126,3 +1265,141 @@ void nn_sock_rele (struct nn_sock *self)
         nn_sem_post (&self->relesem);
     }
 }
+
+void nn_sock_snapshot (struct nn_sock *self, struct nn_snapshot *snap)
+{
+    struct nn_symbol_properties sym;
+    const char *type;
+    struct nn_list_item *it;
+    int i;
+
+    /*  Find the name of the socket type in the symbol table. */
+    type = NULL;
+    for (i = 0; nn_symbol_info (i, &sym, sizeof (sym)) > 0; ++i) {
+        if (sym.ns == NN_NS_PROTOCOL &&
+              sym.value == self->socktype->protocol) {
+            type = sym.name + 3;
+            break;
+        }
+    }
+
+    nn_ctx_enter (&self->ctx);
+
+    nn_snapshot_str (snap, "name", self->socket_name);
+    nn_snapshot_str (snap, "type", type);
+    nn_snapshot_bool (snap, "raw", self->socktype->domain == AF_SP_RAW);
+    nn_snapshot_bool (snap, "readable", self->flags & NN_SOCK_FLAG_IN);
+    nn_snapshot_bool (snap, "writable", self->flags & NN_SOCK_FLAG_OUT);
+    nn_snapshot_uint (snap, "messages_sent", self->statistics.messages_sent);
+    nn_snapshot_uint (snap, "messages_received",
+        self->statistics.messages_received);
+    nn_snapshot_uint (snap, "bytes_sent", self->statistics.bytes_sent);
+    nn_snapshot_uint (snap, "bytes_received",
+        self->statistics.bytes_received);
+    nn_snapshot_uint (snap, "queued_bytes", self->statistics.queued_bytes);
+    nn_snapshot_uint (snap, "dropped_messages",
+        self->statistics.dropped_messages);
+    nn_snapshot_int (snap, "current_connections",
+        self->statistics.current_connections);
+    nn_snapshot_int (snap, "current_ep_errors",
+        self->statistics.current_ep_errors);
+
+    /*  Endpoints that are being shut down are listed as well. */
+    nn_snapshot_begin (snap, "endpoints", '[');
+    for (it = nn_list_begin (&self->eps); it != nn_list_end (&self->eps);
+          it = nn_list_next (&self->eps, it))
+        nn_ep_snapshot (nn_cont (it, struct nn_ep, item), snap);
+    for (it = nn_list_begin (&self->sdeps); it != nn_list_end (&self->sdeps);
+          it = nn_list_next (&self->sdeps, it))
+        nn_ep_snapshot (nn_cont (it, struct nn_ep, item), snap);
+    nn_snapshot_end (snap, ']');
+
+    nn_snapshot_begin (snap, "pipes", '[');
+    for (it = nn_list_begin (&self->pipes); it != nn_list_end (&self->pipes);
+          it = nn_list_next (&self->pipes, it))
+        nn_pipebase_snapshot (nn_cont (it, struct nn_pipebase, item), snap);
+    nn_snapshot_end (snap, ']');
+
+    nn_ctx_leave (&self->ctx);
+}
+
+void nn_sock_record (struct nn_sock *self, struct nn_snapshot *snap)
+{
+    struct nn_recorder_entry entries [NN_RECORDER_SIZE];
+    struct nn_recorder_entry *entry;
+    int count;
+    int i;
+
+    count = nn_recorder_read (&self->ctx.recorder, entries);
+
+    nn_snapshot_str (snap, "name", self->socket_name);
+    nn_snapshot_begin (snap, "entries", '[');
+    for (i = 0; i != count; ++i) {
+        entry = &entries [i];
+        nn_snapshot_begin (snap, NULL, '{');
+        nn_snapshot_uint (snap, "time", entry->time);
+        switch (entry->kind) {
+        case NN_RECORDER_EVENT:
+            nn_snapshot_str (snap, "kind", "event");
+            nn_snapshot_hex (snap, "fsm", (uintptr_t) entry->fsm);
+            nn_snapshot_hex (snap, "handler", (uintptr_t) entry->fn);
+            nn_snapshot_int (snap, "src", entry->src);
+            nn_snapshot_int (snap, "type", entry->type);
+            break;
+        case NN_RECORDER_ERROR:
+            nn_snapshot_str (snap, "kind", "error");
+            nn_snapshot_int (snap, "endpoint", entry->src);
+            nn_snapshot_int (snap, "errno", entry->type);
+            nn_snapshot_str (snap, "error",
+                entry->type ? nn_strerror (entry->type) : NULL);
+            break;
+        default:
+            nn_assert (0);
+        }
+        nn_snapshot_end (snap, '}');
+    }
+    nn_snapshot_end (snap, ']');
+}
+
+void nn_sock_print_record (struct nn_sock *self)
+{
+    struct nn_recorder_entry entries [NN_RECORDER_SIZE];
+    struct nn_recorder_entry *entry;
+    unsigned long long delta;
+    int count;
+    int i;
+
+    count = nn_recorder_read (&self->ctx.recorder, entries);
+
+    /*  Time elapsed since the previous entry is printed so that stalls
+        stand out. */
+    fprintf (stderr, "nanomsg: socket.%s: Flight record (%d entries)\n",
+        self->socket_name, count);
+    for (i = 0; i != count; ++i) {
+        entry = &entries [i];
+        delta = i ? entry->time - entries [i - 1].time : 0;
+        switch (entry->kind) {
+        case NN_RECORDER_EVENT:
+            fprintf (stderr, "nanomsg: socket.%s: %llu.%06llu +%lluus "
+                "fsm 0x%llx handler 0x%llx src %d type %d\n",
+                self->socket_name,
+                (unsigned long long) (entry->time / 1000000),
+                (unsigned long long) (entry->time % 1000000), delta,
+                (unsigned long long) (uintptr_t) entry->fsm,
+                (unsigned long long) (uintptr_t) entry->fn,
+                entry->src, entry->type);
+            break;
+        case NN_RECORDER_ERROR:
+            fprintf (stderr, "nanomsg: socket.%s: %llu.%06llu +%lluus "
+                "endpoint %d error: %s\n",
+                self->socket_name,
+                (unsigned long long) (entry->time / 1000000),
+                (unsigned long long) (entry->time % 1000000), delta,
+                entry->src,
+                entry->type ? nn_strerror (entry->type) : "cleared");
+            break;
+        default:
+            nn_assert (0);
+        }
+    }
+}
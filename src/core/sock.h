@@ -35,9 +35,10 @@
 #include "../utils/list.h"
 
 struct nn_pipe;
+struct nn_snapshot;
 
 /*  The maximum implemented transport ID. */
-#define NN_MAX_TRANSPORT 4
+#define NN_MAX_TRANSPORT 6
 
 struct nn_sock
 {
@@ -65,6 +66,9 @@ struct nn_sock
     /*  List of all endpoint being in the process of shutting down. */
     struct nn_list sdeps;
 
+    /*  List of all pipes attached to the socket. */
+    struct nn_list pipes;
+
     /*  Next endpoint ID to assign to a new endpoint. */
     int eid;
 
@@ -80,6 +84,20 @@ struct nn_sock
     int reconnect_ivl;
     int reconnect_ivl_max;
     int maxttl;
+    int sndqueue_msgs;
+    int sndqueue_bytes;
+    int sndqueue_policy;
+    int rcvfragsize;
+
+    /*  1 if the last message received is a fragment followed by further
+        fragments of the same message. */
+    int rcvmore;
+
+    /*  Smallest message size limit among the pipes that have one and
+        the number of such pipes. If there are any, larger messages are
+        refused straight away. */
+    size_t sndmaxsz;
+    int sndlimited;
 
     /*  Endpoint-specific options.  */
     struct nn_ep_options ep_template;
@@ -114,6 +132,12 @@ struct nn_sock
         uint64_t bytes_sent;
         /*  Bytes recevied (sum length of data in messages received)  */
         uint64_t bytes_received;
+        /*  Messages discarded by the per-pipe send queues  */
+        uint64_t dropped_messages;
+        /*  Duplicate requests sent to a second peer  */
+        uint64_t hedged_requests;
+        /*  Messages dropped because they have passed their deadline  */
+        uint64_t expired_messages;
 
         /*****  Level-style values *****/
 
@@ -125,6 +149,8 @@ struct nn_sock
         int current_snd_priority;
         /*  Number of endpoints having last_errno set to non-zero value  */
         int current_ep_errors;
+        /*  Bytes in messages currently queued inside the socket  */
+        uint64_t queued_bytes;
 
     } statistics;
 
@@ -198,5 +224,19 @@ void nn_sock_stat_increment(struct nn_sock *self, int name, int64_t increment);
 int nn_sock_hold (struct nn_sock *self);
 void nn_sock_rele (struct nn_sock *self);
 
+/*  Write the state of the socket, its endpoints and pipes to the snapshot
+    (see nn_get_snapshot). The members are added to the object the caller
+    has opened. */
+void nn_sock_snapshot (struct nn_sock *self, struct nn_snapshot *snap);
+
+/*  Write the flight record of the socket (see nn_get_flight_record) to
+    the snapshot, or print it to stderr. Neither enters the socket's
+    context. */
+void nn_sock_record (struct nn_sock *self, struct nn_snapshot *snap);
+void nn_sock_print_record (struct nn_sock *self);
+
+/*  Write the state of the pipe to the snapshot. Implemented in pipe.c. */
+void nn_pipebase_snapshot (struct nn_pipebase *self, struct nn_snapshot *snap);
+
 #endif
 
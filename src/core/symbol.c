@@ -27,7 +27,9 @@
 
 #include "../inproc.h"
 #include "../ipc.h"
+#include "../shm.h"
 #include "../tcp.h"
+#include "../udp.h"
 
 #include "../pair.h"
 #include "../pubsub.h"
@@ -70,6 +72,7 @@ static const struct nn_symbol_properties sym_value_names [] = {
     NN_SYM(NN_UNIT_BOOLEAN, OPTION_UNIT, NONE, NONE),
     NN_SYM(NN_UNIT_COUNTER, OPTION_UNIT, NONE, NONE),
     NN_SYM(NN_UNIT_MESSAGES, OPTION_UNIT, NONE, NONE),
+    NN_SYM(NN_UNIT_MICROSECONDS, OPTION_UNIT, NONE, NONE),
 
     NN_SYM(NN_VERSION_CURRENT, VERSION, NONE, NONE),
     NN_SYM(NN_VERSION_REVISION, VERSION, NONE, NONE),
@@ -80,8 +83,10 @@ static const struct nn_symbol_properties sym_value_names [] = {
 
     NN_SYM(NN_INPROC, TRANSPORT, NONE, NONE),
     NN_SYM(NN_IPC, TRANSPORT, NONE, NONE),
+    NN_SYM(NN_SHM, TRANSPORT, NONE, NONE),
     NN_SYM(NN_TCP, TRANSPORT, NONE, NONE),
     NN_SYM(NN_WS, TRANSPORT, NONE, NONE),
+    NN_SYM(NN_UDP, TRANSPORT, NONE, NONE),
 
     NN_SYM(NN_PAIR, PROTOCOL, NONE, NONE),
     NN_SYM(NN_PUB, PROTOCOL, NONE, NONE),
@@ -115,13 +120,38 @@ static const struct nn_symbol_properties sym_value_names [] = {
     NN_SYM(NN_IPV4ONLY, SOCKET_OPTION, INT, BOOLEAN),
     NN_SYM(NN_SOCKET_NAME, SOCKET_OPTION, STR, NONE),
     NN_SYM(NN_MAXTTL, SOCKET_OPTION, INT, NONE),
+    NN_SYM(NN_SNDQUEUE_MSGS, SOCKET_OPTION, INT, MESSAGES),
+    NN_SYM(NN_SNDQUEUE_BYTES, SOCKET_OPTION, INT, BYTES),
+    NN_SYM(NN_SNDQUEUE_POLICY, SOCKET_OPTION, INT, NONE),
+    NN_SYM(NN_RCVFRAGSIZE, SOCKET_OPTION, INT, BYTES),
+    NN_SYM(NN_RCVMORE, SOCKET_OPTION, INT, BOOLEAN),
 
     NN_SYM(NN_SUB_SUBSCRIBE, TRANSPORT_OPTION, STR, NONE),
     NN_SYM(NN_SUB_UNSUBSCRIBE, TRANSPORT_OPTION, STR, NONE),
+    NN_SYM(NN_PUB_CONFLATE, TRANSPORT_OPTION, INT, MESSAGES),
+    NN_SYM(NN_PUB_CONFLATE_KEYLEN, TRANSPORT_OPTION, INT, BYTES),
+    NN_SYM(NN_PUB_SPILL_FILE, TRANSPORT_OPTION, STR, NONE),
+    NN_SYM(NN_PUB_SPILL_SIZE, TRANSPORT_OPTION, INT, BYTES),
     NN_SYM(NN_REQ_RESEND_IVL, TRANSPORT_OPTION, INT, MILLISECONDS),
+    NN_SYM(NN_REQ_RESEND_IVL_US, TRANSPORT_OPTION, INT, MICROSECONDS),
+    NN_SYM(NN_REQ_HEDGE_IVL, TRANSPORT_OPTION, INT, MILLISECONDS),
+    NN_SYM(NN_REQ_HEDGE_PERCENTILE, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_REQ_HEDGE_RATIO, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_REP_CONTEXTS, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_PULL_CREDIT, TRANSPORT_OPTION, INT, MESSAGES),
+    NN_SYM(NN_PUSH_SPILL_FILE, TRANSPORT_OPTION, STR, NONE),
+    NN_SYM(NN_PUSH_SPILL_SIZE, TRANSPORT_OPTION, INT, BYTES),
     NN_SYM(NN_SURVEYOR_DEADLINE, TRANSPORT_OPTION, INT, MILLISECONDS),
+    NN_SYM(NN_SURVEYOR_DEADLINE_US, TRANSPORT_OPTION, INT, MICROSECONDS),
     NN_SYM(NN_TCP_NODELAY, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_TCP_HEARTBEAT_IVL, TRANSPORT_OPTION, INT, MILLISECONDS),
+    NN_SYM(NN_TCP_HEARTBEAT_MISSES, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_TCP_USER_TIMEOUT, TRANSPORT_OPTION, INT, MILLISECONDS),
+    NN_SYM(NN_TCP_CONNECT_DELAY, TRANSPORT_OPTION, INT, MILLISECONDS),
     NN_SYM(NN_WS_MSG_TYPE, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_UDP_MTU, TRANSPORT_OPTION, INT, BYTES),
+    NN_SYM(NN_UDP_MULTICAST_TTL, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_UDP_MULTICAST_LOOP, TRANSPORT_OPTION, INT, BOOLEAN),
 
     NN_SYM(NN_DONTWAIT, FLAG, NONE, NONE),
     NN_SYM(NN_WS_MSG_TYPE_TEXT, FLAG, NONE, NONE),
@@ -174,10 +204,21 @@ static const struct nn_symbol_properties sym_value_names [] = {
     NN_SYM(NN_STAT_MESSAGES_RECEIVED, STATISTIC, INT, MESSAGES),
     NN_SYM(NN_STAT_BYTES_SENT, STATISTIC, INT, BYTES),
     NN_SYM(NN_STAT_BYTES_RECEIVED, STATISTIC, INT, BYTES),
+    NN_SYM(NN_STAT_DROPPED_MESSAGES, STATISTIC, INT, MESSAGES),
+    NN_SYM(NN_STAT_QUEUED_BYTES, STATISTIC, INT, BYTES),
+    NN_SYM(NN_STAT_HEDGED_REQUESTS, STATISTIC, INT, MESSAGES),
+    NN_SYM(NN_STAT_EXPIRED_MESSAGES, STATISTIC, INT, MESSAGES),
     NN_SYM(NN_STAT_CURRENT_CONNECTIONS, STATISTIC, INT, NONE),
     NN_SYM(NN_STAT_INPROGRESS_CONNECTIONS, STATISTIC, INT, NONE),
     NN_SYM(NN_STAT_CURRENT_SND_PRIORITY, STATISTIC, INT, PRIORITY),
-    NN_SYM(NN_STAT_CURRENT_EP_ERRORS, STATISTIC, INT, NONE)
+    NN_SYM(NN_STAT_CURRENT_EP_ERRORS, STATISTIC, INT, NONE),
+    NN_SYM(NN_STAT_WORKER_LOOPS, STATISTIC, INT, COUNTER),
+    NN_SYM(NN_STAT_WORKER_EVENTS, STATISTIC, INT, COUNTER),
+    NN_SYM(NN_STAT_WORKER_TASKS, STATISTIC, INT, COUNTER),
+    NN_SYM(NN_STAT_WORKER_TIMERS, STATISTIC, INT, COUNTER),
+    NN_SYM(NN_STAT_WORKER_BUSY_TIME, STATISTIC, INT, MICROSECONDS),
+    NN_SYM(NN_STAT_WORKER_WAIT_TIME, STATISTIC, INT, MICROSECONDS),
+    NN_SYM(NN_STAT_WORKER_MAX_HANDLER_TIME, STATISTIC, INT, MICROSECONDS)
 };
 
 const int SYM_VALUE_NAMES_LEN = (sizeof (sym_value_names) /
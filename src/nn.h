@@ -216,6 +216,7 @@ NN_EXPORT const char *nn_symbol (int i, int *value);
 #define NN_UNIT_BOOLEAN 4
 #define NN_UNIT_MESSAGES 5
 #define NN_UNIT_COUNTER 6
+#define NN_UNIT_MICROSECONDS 7
 
 /*  Structure that is returned from nn_symbol  */
 struct nn_symbol_properties {
@@ -257,6 +258,10 @@ NN_EXPORT void nn_term (void);
 NN_EXPORT void *nn_allocmsg (size_t size, int type);
 NN_EXPORT void *nn_reallocmsg (void *msg, size_t size);
 NN_EXPORT int nn_freemsg (void *msg);
+NN_EXPORT int nn_refmsg (void *msg);
+NN_EXPORT void *nn_filemsg (int fd, uint64_t offset, size_t size);
+NN_EXPORT int nn_register_region (void *addr, size_t size, size_t blocksize);
+NN_EXPORT int nn_unregister_region (int type);
 
 /******************************************************************************/
 /*  Socket definition.                                                        */
@@ -335,6 +340,16 @@ NN_EXPORT  struct nn_cmsghdr *nn_cmsg_nxthdr_ (
 #define NN_SOCKET_NAME 15
 #define NN_RCVMAXSIZE 16
 #define NN_MAXTTL 17
+#define NN_SNDQUEUE_MSGS 18
+#define NN_SNDQUEUE_BYTES 19
+#define NN_SNDQUEUE_POLICY 20
+#define NN_RCVFRAGSIZE 21
+#define NN_RCVMORE 22
+
+/*  Values of NN_SNDQUEUE_POLICY option.                                      */
+#define NN_SNDQUEUE_DROP_NEWEST 1
+#define NN_SNDQUEUE_DROP_OLDEST 2
+#define NN_SNDQUEUE_BLOCK 3
 
 /*  Send/recv options.                                                        */
 #define NN_DONTWAIT 1
@@ -343,6 +358,11 @@ NN_EXPORT  struct nn_cmsghdr *nn_cmsg_nxthdr_ (
 #define PROTO_SP 1
 #define SP_HDR 1
 
+/*  Ancillary property (level NN_SOL_SOCKET) limiting the time, in
+    milliseconds, the message may take to get delivered. The data is an int.
+    Messages that pass their deadline are dropped. */
+#define NN_DEADLINE 23
+
 NN_EXPORT int nn_socket (int domain, int protocol);
 NN_EXPORT int nn_close (int s);
 NN_EXPORT int nn_setsockopt (int s, int level, int option, const void *optval,
@@ -400,11 +420,56 @@ NN_EXPORT int nn_device (int s1, int s2);
 #define NN_STAT_MESSAGES_RECEIVED       302
 #define NN_STAT_BYTES_SENT              303
 #define NN_STAT_BYTES_RECEIVED          304
+#define NN_STAT_DROPPED_MESSAGES        305
+#define NN_STAT_QUEUED_BYTES            306
+#define NN_STAT_HEDGED_REQUESTS         307
+#define NN_STAT_EXPIRED_MESSAGES        308
 /*  Protocol statistics  */
 #define	NN_STAT_CURRENT_SND_PRIORITY    401
 
 NN_EXPORT uint64_t nn_get_statistic (int s, int stat);
 
+/*  Worker thread statistics  */
+#define NN_STAT_WORKER_LOOPS            501
+#define NN_STAT_WORKER_EVENTS           502
+#define NN_STAT_WORKER_TASKS            503
+#define NN_STAT_WORKER_TIMERS           504
+#define NN_STAT_WORKER_BUSY_TIME        505
+#define NN_STAT_WORKER_WAIT_TIME        506
+#define NN_STAT_WORKER_MAX_HANDLER_TIME 507
+
+NN_EXPORT uint64_t nn_get_worker_statistic (int worker, int stat);
+
+/*  JSON document describing all the open sockets, their endpoints and pipes.
+    Returns the full length of the document; if 'len' is NN_MSG, 'buf' points
+    to a pointer that receives a message chunk holding it. */
+NN_EXPORT int nn_get_snapshot (void *buf, size_t len);
+
+/*  JSON document listing the most recent state machine events and endpoint
+    errors of the socket, oldest first. Buffer handling is the same as with
+    nn_get_snapshot. */
+NN_EXPORT int nn_get_flight_record (int s, void *buf, size_t len);
+
+/*  Memory used by the library, accounted per allocation name such as
+    "message chunk" or "hash map". */
+struct nn_memory_stat {
+
+    /*  The allocation name  */
+    const char *name;
+
+    /*  Bytes currently allocated  */
+    uint64_t bytes;
+
+    /*  Number of blocks currently allocated  */
+    uint64_t blocks;
+};
+
+/*  Fills in nn_memory_stat structure for i-th allocation name and returns    */
+/*  its length. If the index is out-of-range, returns 0. Negative 'buflen'    */
+/*  fails with EINVAL.                                                        */
+NN_EXPORT int nn_get_memory_stat (int i, struct nn_memory_stat *buf,
+    int buflen);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,6 +33,10 @@ extern "C" {
 #define NN_PUSH (NN_PROTO_PIPELINE * 16 + 0)
 #define NN_PULL (NN_PROTO_PIPELINE * 16 + 1)
 
+#define NN_PULL_CREDIT 1
+#define NN_PUSH_SPILL_FILE 2
+#define NN_PUSH_SPILL_SIZE 3
+
 #ifdef __cplusplus
 }
 #endif
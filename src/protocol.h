@@ -70,6 +70,15 @@ int nn_pipe_send (struct nn_pipe *self, struct nn_msg *msg);
     the call. It will be initialised when the call succeeds. */
 int nn_pipe_recv (struct nn_pipe *self, struct nn_msg *msg);
 
+/*  If the message has passed its deadline (see NN_DEADLINE) it is
+    deallocated, accounted for in the statistics of the socket the pipe
+    belongs to, and 1 is returned. Otherwise, returns 0. */
+int nn_pipe_expired (struct nn_pipe *self, struct nn_msg *msg);
+
+/*  Accounts for a message that was meant for the pipe but was discarded
+    before reaching it, e.g. because the pipe's send queue was full. */
+void nn_pipe_dropped (struct nn_pipe *self);
+
 /*  Get option for pipe. Mostly useful for endpoint-specific options  */
 void nn_pipe_getopt (struct nn_pipe *self, int level, int option,
     void *optval, size_t *optvallen);
@@ -153,7 +162,7 @@ int nn_sockbase_getopt (struct nn_sockbase *self, int option,
 
 /*  Add some statistics for socket  */
 void nn_sockbase_stat_increment (struct nn_sockbase *self, int name,
-    int increment);
+    int64_t increment);
 
 /******************************************************************************/
 /*  The socktype class.                                                       */
@@ -167,6 +176,10 @@ void nn_sockbase_stat_increment (struct nn_sockbase *self, int name,
 /*  Specifies that the socket type can be never used to send messages. */
 #define NN_SOCKTYPE_FLAG_NOSEND 2
 
+/*  Specifies that the socket type is able to deliver large messages in
+    fragments (see NN_RCVFRAGSIZE option). */
+#define NN_SOCKTYPE_FLAG_FRAGMENTS 4
+
 struct nn_socktype {
 
     /*  Domain and protocol IDs as specified in nn_socket() function. */
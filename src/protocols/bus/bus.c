@@ -91,9 +91,9 @@ static int nn_bus_send (struct nn_sockbase *self, struct nn_msg *msg)
 
     /*  Send the message. */
     rc = nn_xbus_send (&bus->xbus.sockbase, msg);
-    errnum_assert (rc == 0, -rc);
+    errnum_assert (rc == 0 || rc == -EAGAIN, -rc);
 
-    return 0;
+    return rc;
 }
 
 static int nn_bus_recv (struct nn_sockbase *self, struct nn_msg *msg)
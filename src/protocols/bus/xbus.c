@@ -40,6 +40,8 @@
     neccessary for the pointer to fit in 64-bit ID. */
 CT_ASSERT (sizeof (uint64_t) >= sizeof (struct nn_pipe*));
 
+/*  Private functions. */
+
 /*  Implementation of nn_sockbase's virtual functions. */
 static void nn_xbus_destroy (struct nn_sockbase *self);
 static const struct nn_sockbase_vfptr nn_xbus_sockbase_vfptr = {
@@ -114,6 +116,7 @@ void nn_xbus_rm (struct nn_sockbase *self, struct nn_pipe *pipe)
 
     nn_fq_rm (&xbus->inpipes, &data->initem);
     nn_dist_rm (&xbus->outpipes, &data->outitem);
+    nn_dist_stats (&xbus->outpipes, &xbus->sockbase);
 
     nn_free (data);
 }
@@ -138,18 +141,32 @@ void nn_xbus_out (struct nn_sockbase *self, struct nn_pipe *pipe)
     data = nn_pipe_getdata (pipe);
 
     nn_dist_out (&xbus->outpipes, &data->outitem);
+    nn_dist_stats (&xbus->outpipes, &xbus->sockbase);
 }
 
 int nn_xbus_events (struct nn_sockbase *self)
 {
-    return (nn_fq_can_recv (&nn_cont (self, struct nn_xbus,
-        sockbase)->inpipes) ? NN_SOCKBASE_EVENT_IN : 0) | NN_SOCKBASE_EVENT_OUT;
+    struct nn_xbus *xbus;
+
+    xbus = nn_cont (self, struct nn_xbus, sockbase);
+
+    return (nn_fq_can_recv (&xbus->inpipes) ? NN_SOCKBASE_EVENT_IN : 0) |
+        (nn_dist_can_send (&xbus->outpipes) ? NN_SOCKBASE_EVENT_OUT : 0);
 }
 
 int nn_xbus_send (struct nn_sockbase *self, struct nn_msg *msg)
 {
+    int rc;
     size_t hdrsz;
     struct nn_pipe *exclude;
+    struct nn_xbus *xbus;
+
+    xbus = nn_cont (self, struct nn_xbus, sockbase);
+
+    /*  Check before the header is stripped, so that the message is intact
+        if the user has to retry. */
+    if (nn_slow (!nn_dist_can_send (&xbus->outpipes)))
+        return -EAGAIN;
 
     hdrsz = nn_chunkref_size (&msg->sphdr);
     if (hdrsz == 0)
@@ -162,8 +179,9 @@ int nn_xbus_send (struct nn_sockbase *self, struct nn_msg *msg)
     else
         return -EINVAL;
 
-    return nn_dist_send (&nn_cont (self, struct nn_xbus, sockbase)->outpipes,
-        msg, exclude);
+    rc = nn_dist_send (&xbus->outpipes, msg, exclude);
+    nn_dist_stats (&xbus->outpipes, &xbus->sockbase);
+    return rc;
 }
 
 int nn_xbus_recv (struct nn_sockbase *self, struct nn_msg *msg)
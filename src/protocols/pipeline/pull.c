@@ -29,7 +29,7 @@
 struct nn_socktype nn_pull_socktype = {
     AF_SP,
     NN_PULL,
-    NN_SOCKTYPE_FLAG_NOSEND,
+    NN_SOCKTYPE_FLAG_NOSEND | NN_SOCKTYPE_FLAG_FRAGMENTS,
     nn_xpull_create,
     nn_xpull_ispeer,
 };
@@ -33,20 +33,50 @@
 #include "../../utils/fast.h"
 #include "../../utils/alloc.h"
 #include "../../utils/attr.h"
+#include "../../utils/list.h"
+#include "../../utils/wire.h"
+
+/*  In credit mode PULL socket tells each peer how many messages it may have
+    in flight towards this socket. The grant is a 32-bit count of messages
+    the peer is allowed to send over the lifetime of the pipe. Being
+    cumulative, it doesn't matter how many messages were in flight when the
+    grant was sent. Peers that don't understand credits never read it. */
+#define NN_XPULL_GRANTSZ 4
 
 struct nn_xpull_data {
     struct nn_fq_data fq;
+
+    /*  The item in nn_xpull's list of all pipes. */
+    struct nn_list_item item;
+
+    /*  Number of messages the peer may have in flight, 0 if the credit mode
+        is off for this pipe. */
+    int window;
+
+    /*  Total number of messages granted to the peer so far. */
+    uint32_t granted;
+
+    /*  1 if the grant can be sent to the pipe immediately. */
+    int writable;
 };
 
 struct nn_xpull {
     struct nn_sockbase sockbase;
     struct nn_fq fq;
+
+    /*  All the pipes attached to the socket. */
+    struct nn_list pipes;
+
+    /*  Value of NN_PULL_CREDIT option. It applies to the pipes created
+        after it was set. */
+    int credit;
 };
 
 /*  Private functions. */
 static void nn_xpull_init (struct nn_xpull *self,
     const struct nn_sockbase_vfptr *vfptr, void *hint);
 static void nn_xpull_term (struct nn_xpull *self);
+static void nn_xpull_grant (struct nn_xpull_data *data);
 
 /*  Implementation of nn_sockbase's virtual functions. */
 static void nn_xpull_destroy (struct nn_sockbase *self);
@@ -56,6 +86,10 @@ static void nn_xpull_in (struct nn_sockbase *self, struct nn_pipe *pipe);
 static void nn_xpull_out (struct nn_sockbase *self, struct nn_pipe *pipe);
 static int nn_xpull_events (struct nn_sockbase *self);
 static int nn_xpull_recv (struct nn_sockbase *self, struct nn_msg *msg);
+static int nn_xpull_setopt (struct nn_sockbase *self, int level, int option,
+        const void *optval, size_t optvallen);
+static int nn_xpull_getopt (struct nn_sockbase *self, int level, int option,
+        void *optval, size_t *optvallen);
 static const struct nn_sockbase_vfptr nn_xpull_sockbase_vfptr = {
     NULL,
     nn_xpull_destroy,
@@ -66,8 +100,8 @@ static const struct nn_sockbase_vfptr nn_xpull_sockbase_vfptr = {
     nn_xpull_events,
     NULL,
     nn_xpull_recv,
-    NULL,
-    NULL
+    nn_xpull_setopt,
+    nn_xpull_getopt
 };
 
 static void nn_xpull_init (struct nn_xpull *self,
@@ -75,10 +109,13 @@ static void nn_xpull_init (struct nn_xpull *self,
 {
     nn_sockbase_init (&self->sockbase, vfptr, hint);
     nn_fq_init (&self->fq);
+    nn_list_init (&self->pipes);
+    self->credit = 0;
 }
 
 static void nn_xpull_term (struct nn_xpull *self)
 {
+    nn_list_term (&self->pipes);
     nn_fq_term (&self->fq);
     nn_sockbase_term (&self->sockbase);
 }
@@ -111,6 +148,11 @@ static int nn_xpull_add (struct nn_sockbase *self, struct nn_pipe *pipe)
     alloc_assert (data);
     nn_pipe_setdata (pipe, data);
     nn_fq_add (&xpull->fq, &data->fq, pipe, rcvprio);
+    nn_list_item_init (&data->item);
+    nn_list_insert (&xpull->pipes, &data->item, nn_list_end (&xpull->pipes));
+    data->window = xpull->credit;
+    data->granted = 0;
+    data->writable = 0;
 
     return 0;
 }
@@ -123,6 +165,8 @@ static void nn_xpull_rm (struct nn_sockbase *self, struct nn_pipe *pipe)
     xpull = nn_cont (self, struct nn_xpull, sockbase);
     data = nn_pipe_getdata (pipe);
     nn_fq_rm (&xpull->fq, &data->fq);
+    nn_list_erase (&xpull->pipes, &data->item);
+    nn_list_item_term (&data->item);
     nn_free (data);
 }
 
@@ -138,10 +182,15 @@ static void nn_xpull_in (NN_UNUSED struct nn_sockbase *self,
 }
 
 static void nn_xpull_out (NN_UNUSED struct nn_sockbase *self,
-                          NN_UNUSED struct nn_pipe *pipe)
+                          struct nn_pipe *pipe)
 {
-    /*  We are not going to send any messages, so there's no point is
-        maintaining a list of pipes ready for sending. */
+    struct nn_xpull_data *data;
+
+    /*  The only messages sent are credit grants. The initial one goes out
+        as soon as the pipe becomes writable. */
+    data = nn_pipe_getdata (pipe);
+    data->writable = 1;
+    nn_xpull_grant (data);
 }
 
 static int nn_xpull_events (struct nn_sockbase *self)
@@ -153,14 +202,102 @@ static int nn_xpull_events (struct nn_sockbase *self)
 static int nn_xpull_recv (struct nn_sockbase *self, struct nn_msg *msg)
 {
     int rc;
+    struct nn_xpull *xpull;
+    struct nn_pipe *pipe;
+    struct nn_list_item *it;
+
+    xpull = nn_cont (self, struct nn_xpull, sockbase);
+
+    rc = nn_fq_recv (&xpull->fq, msg, &pipe);
+    if (nn_fast (rc >= 0))
+        nn_xpull_grant (nn_pipe_getdata (pipe));
 
-    rc = nn_fq_recv (&nn_cont (self, struct nn_xpull, sockbase)->fq,
-         msg, NULL);
+    /*  Messages dropped because of their deadline consume credit as well.
+        They may have come from any pipe, so check all of them. */
+    if (nn_slow (xpull->fq.dropped)) {
+        xpull->fq.dropped = 0;
+        for (it = nn_list_begin (&xpull->pipes);
+              it != nn_list_end (&xpull->pipes);
+              it = nn_list_next (&xpull->pipes, it))
+            nn_xpull_grant (nn_cont (it, struct nn_xpull_data, item));
+    }
 
     /*  Discard NN_PIPEBASE_PARSED flag. */
     return rc < 0 ? rc : 0;
 }
 
+static void nn_xpull_grant (struct nn_xpull_data *data)
+{
+    int rc;
+    struct nn_msg msg;
+
+    if (nn_fast (!data->window))
+        return;
+
+    /*  Top the credit up once half of it is consumed. Granting after each
+        message would double the number of messages on the wire. */
+    if ((int32_t) (data->granted - data->fq.received) * 2 > data->window)
+        return;
+
+    /*  If the pipe is busy, the grant will be sent on the next 'out' event.
+        It will be computed afresh at that point. */
+    if (!data->writable)
+        return;
+
+    data->granted = data->fq.received + data->window;
+    nn_msg_init (&msg, NN_XPULL_GRANTSZ);
+    nn_putl (nn_chunkref_data (&msg.body), data->granted);
+    rc = nn_pipe_send (data->fq.priodata.pipe, &msg);
+    errnum_assert (rc >= 0, -rc);
+    if (rc & NN_PIPE_RELEASE)
+        data->writable = 0;
+}
+
+static int nn_xpull_setopt (struct nn_sockbase *self, int level, int option,
+        const void *optval, size_t optvallen)
+{
+    struct nn_xpull *xpull;
+    int val;
+
+    xpull = nn_cont (self, struct nn_xpull, sockbase);
+
+    if (level != NN_PULL)
+        return -ENOPROTOOPT;
+
+    if (option == NN_PULL_CREDIT) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        val = *(int*) optval;
+        if (nn_slow (val < 0))
+            return -EINVAL;
+        xpull->credit = val;
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
+static int nn_xpull_getopt (struct nn_sockbase *self, int level, int option,
+        void *optval, size_t *optvallen)
+{
+    struct nn_xpull *xpull;
+
+    xpull = nn_cont (self, struct nn_xpull, sockbase);
+
+    if (level != NN_PULL)
+        return -ENOPROTOOPT;
+
+    if (option == NN_PULL_CREDIT) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = xpull->credit;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
 int nn_xpull_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_xpull *self;
@@ -181,7 +318,7 @@ int nn_xpull_ispeer (int socktype)
 struct nn_socktype nn_xpull_socktype = {
     AF_SP_RAW,
     NN_PULL,
-    NN_SOCKTYPE_FLAG_NOSEND,
+    NN_SOCKTYPE_FLAG_NOSEND | NN_SOCKTYPE_FLAG_FRAGMENTS,
     nn_xpull_create,
     nn_xpull_ispeer,
 };
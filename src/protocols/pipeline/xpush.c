@@ -27,26 +27,50 @@
 #include "../../pipeline.h"
 
 #include "../utils/lb.h"
+#include "../utils/spill.h"
 
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 #include "../../utils/fast.h"
 #include "../../utils/alloc.h"
 #include "../../utils/attr.h"
+#include "../../utils/wire.h"
+
+#include <stdint.h>
+#include <string.h>
 
 struct nn_xpush_data {
     struct nn_lb_data lb;
+
+    /*  1 if the peer is a PULL socket in credit mode, i.e. if it has sent
+        us a grant. Until then, the pipe is limited by its buffers only. */
+    int credit;
+
+    /*  Number of messages sent to the pipe so far and the number of
+        messages the peer allows us to send, as of the last grant. */
+    uint32_t sent;
+    uint32_t allowed;
 };
 
 struct nn_xpush {
     struct nn_sockbase sockbase;
     struct nn_lb lb;
+
+    /*  Messages that were sent while no pipe was able to accept them, if
+        NN_PUSH_SPILL_FILE is set. 'spillsize' is the size of the spill files
+        created from now on. */
+    struct nn_spill spill;
+    int spillsize;
 };
 
 /*  Private functions. */
 static void nn_xpush_init (struct nn_xpush *self,
     const struct nn_sockbase_vfptr *vfptr, void *hint);
 static void nn_xpush_term (struct nn_xpush *self);
+static void nn_xpush_credit (struct nn_xpush *self,
+    struct nn_xpush_data *data);
+static int nn_xpush_send_lb (struct nn_xpush *self, struct nn_msg *msg);
+static void nn_xpush_drain (struct nn_xpush *self);
 
 /*  Implementation of nn_sockbase's virtual functions. */
 static void nn_xpush_destroy (struct nn_sockbase *self);
@@ -56,6 +80,10 @@ static void nn_xpush_in (struct nn_sockbase *self, struct nn_pipe *pipe);
 static void nn_xpush_out (struct nn_sockbase *self, struct nn_pipe *pipe);
 static int nn_xpush_events (struct nn_sockbase *self);
 static int nn_xpush_send (struct nn_sockbase *self, struct nn_msg *msg);
+static int nn_xpush_setopt (struct nn_sockbase *self, int level, int option,
+        const void *optval, size_t optvallen);
+static int nn_xpush_getopt (struct nn_sockbase *self, int level, int option,
+        void *optval, size_t *optvallen);
 static const struct nn_sockbase_vfptr nn_xpush_sockbase_vfptr = {
     NULL,
     nn_xpush_destroy,
@@ -66,8 +94,8 @@ static const struct nn_sockbase_vfptr nn_xpush_sockbase_vfptr = {
     nn_xpush_events,
     nn_xpush_send,
     NULL,
-    NULL,
-    NULL
+    nn_xpush_setopt,
+    nn_xpush_getopt
 };
 
 static void nn_xpush_init (struct nn_xpush *self,
@@ -75,10 +103,13 @@ static void nn_xpush_init (struct nn_xpush *self,
 {
     nn_sockbase_init (&self->sockbase, vfptr, hint);
     nn_lb_init (&self->lb);
+    nn_spill_init (&self->spill);
+    self->spillsize = NN_SPILL_DEFSIZE;
 }
 
 static void nn_xpush_term (struct nn_xpush *self)
 {
+    nn_spill_term (&self->spill);
     nn_lb_term (&self->lb);
     nn_sockbase_term (&self->sockbase);
 }
@@ -111,6 +142,9 @@ static int nn_xpush_add (struct nn_sockbase *self, struct nn_pipe *pipe)
     alloc_assert (data);
     nn_pipe_setdata (pipe, data);
     nn_lb_add (&xpush->lb, &data->lb, pipe, sndprio);
+    data->credit = 0;
+    data->sent = 0;
+    data->allowed = 0;
 
     return 0;
 }
@@ -129,11 +163,34 @@ static void nn_xpush_rm (struct nn_sockbase *self, struct nn_pipe *pipe)
         nn_lb_get_priority (&xpush->lb));
 }
 
-static void nn_xpush_in (NN_UNUSED struct nn_sockbase *self,
-    NN_UNUSED struct nn_pipe *pipe)
+static void nn_xpush_in (struct nn_sockbase *self, struct nn_pipe *pipe)
 {
-    /*  We are not going to receive any messages, so there's no need to store
-        the list of inbound pipes. */
+    int rc;
+    struct nn_xpush *xpush;
+    struct nn_xpush_data *data;
+    struct nn_msg msg;
+
+    xpush = nn_cont (self, struct nn_xpush, sockbase);
+    data = nn_pipe_getdata (pipe);
+
+    /*  The only messages PULL sockets send are credit grants. Process all
+        of them that are available. Anything malformed is ignored. */
+    while (1) {
+        rc = nn_pipe_recv (pipe, &msg);
+        errnum_assert (rc >= 0, -rc);
+        if (nn_fast (nn_chunkref_size (&msg.body) == 4)) {
+            data->credit = 1;
+            data->allowed = nn_getl (nn_chunkref_data (&msg.body));
+        }
+        nn_msg_term (&msg);
+        if (rc & NN_PIPE_RELEASE)
+            break;
+    }
+
+    nn_xpush_credit (xpush, data);
+    nn_xpush_drain (xpush);
+    nn_sockbase_stat_increment (self, NN_STAT_CURRENT_SND_PRIORITY,
+        nn_lb_get_priority (&xpush->lb));
 }
 
 static void nn_xpush_out (struct nn_sockbase *self, struct nn_pipe *pipe)
@@ -144,20 +201,149 @@ static void nn_xpush_out (struct nn_sockbase *self, struct nn_pipe *pipe)
     xpush = nn_cont (self, struct nn_xpush, sockbase);
     data = nn_pipe_getdata (pipe);
     nn_lb_out (&xpush->lb, &data->lb);
+    nn_xpush_drain (xpush);
     nn_sockbase_stat_increment (self, NN_STAT_CURRENT_SND_PRIORITY,
         nn_lb_get_priority (&xpush->lb));
 }
 
 static int nn_xpush_events (struct nn_sockbase *self)
 {
-    return nn_lb_can_send (&nn_cont (self, struct nn_xpush, sockbase)->lb) ?
+    struct nn_xpush *xpush;
+
+    xpush = nn_cont (self, struct nn_xpush, sockbase);
+
+    return nn_lb_can_send (&xpush->lb) || nn_spill_can_put (&xpush->spill) ?
         NN_SOCKBASE_EVENT_OUT : 0;
 }
 
 static int nn_xpush_send (struct nn_sockbase *self, struct nn_msg *msg)
 {
-    return nn_lb_send (&nn_cont (self, struct nn_xpush, sockbase)->lb,
-        msg, NULL);
+    struct nn_xpush *xpush;
+
+    xpush = nn_cont (self, struct nn_xpush, sockbase);
+
+    /*  Once there are messages in the spill, newer messages have to queue
+        up behind them to keep the ordering. */
+    if (nn_slow (nn_spill_active (&xpush->spill))) {
+        nn_xpush_drain (xpush);
+        if (!nn_spill_empty (&xpush->spill) || !nn_lb_can_send (&xpush->lb))
+            return nn_spill_put (&xpush->spill, msg);
+    }
+
+    return nn_xpush_send_lb (xpush, msg);
+}
+
+static int nn_xpush_setopt (struct nn_sockbase *self, int level, int option,
+        const void *optval, size_t optvallen)
+{
+    struct nn_xpush *xpush;
+    int dropped;
+    int val;
+
+    xpush = nn_cont (self, struct nn_xpush, sockbase);
+
+    if (level != NN_PUSH)
+        return -ENOPROTOOPT;
+
+    switch (option) {
+    case NN_PUSH_SPILL_FILE:
+        dropped = nn_spill_close (&xpush->spill);
+        if (dropped > 0)
+            nn_sockbase_stat_increment (self, NN_STAT_DROPPED_MESSAGES,
+                dropped);
+        if (optvallen == 0)
+            return 0;
+        return nn_spill_open (&xpush->spill, optval, optvallen,
+            xpush->spillsize);
+    case NN_PUSH_SPILL_SIZE:
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        val = *(int*) optval;
+        if (nn_slow (val < NN_SPILL_MINSIZE))
+            return -EINVAL;
+        xpush->spillsize = val;
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
+static int nn_xpush_getopt (struct nn_sockbase *self, int level, int option,
+        void *optval, size_t *optvallen)
+{
+    struct nn_xpush *xpush;
+    const char *path;
+
+    xpush = nn_cont (self, struct nn_xpush, sockbase);
+
+    if (level != NN_PUSH)
+        return -ENOPROTOOPT;
+
+    switch (option) {
+    case NN_PUSH_SPILL_FILE:
+        path = nn_spill_path (&xpush->spill);
+        strncpy (optval, path, *optvallen);
+        *optvallen = strlen (path);
+        return 0;
+    case NN_PUSH_SPILL_SIZE:
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = xpush->spillsize;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
+static int nn_xpush_send_lb (struct nn_xpush *self, struct nn_msg *msg)
+{
+    int rc;
+    struct nn_pipe *pipe;
+    struct nn_xpush_data *data;
+
+    rc = nn_lb_send (&self->lb, msg, &pipe);
+    if (nn_slow (rc < 0))
+        return rc;
+
+    data = nn_pipe_getdata (pipe);
+    ++data->sent;
+    if (data->credit)
+        nn_xpush_credit (self, data);
+
+    return rc;
+}
+
+static void nn_xpush_drain (struct nn_xpush *self)
+{
+    int rc;
+    struct nn_msg msg;
+
+    if (nn_fast (!nn_spill_active (&self->spill)))
+        return;
+
+    /*  A peer may have become available. Messages that didn't fit into
+        the spill before are worth trying again. */
+    nn_spill_retry (&self->spill);
+
+    while (nn_lb_can_send (&self->lb)) {
+        rc = nn_spill_get (&self->spill, &msg);
+        if (rc == -EAGAIN)
+            break;
+        rc = nn_xpush_send_lb (self, &msg);
+        errnum_assert (rc == 0, -rc);
+    }
+}
+
+static void nn_xpush_credit (struct nn_xpush *self,
+    struct nn_xpush_data *data)
+{
+    /*  Pipes without credit are skipped by the load balancer, so that the
+        work goes to the peers that are able to process it. */
+    if (!data->credit || (int32_t) (data->allowed - data->sent) > 0)
+        nn_lb_unhold (&self->lb, &data->lb);
+    else
+        nn_lb_hold (&self->lb, &data->lb);
 }
 
 int nn_xpush_create (void *hint, struct nn_sockbase **sockbase)
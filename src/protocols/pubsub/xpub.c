@@ -27,6 +27,7 @@
 #include "../../pubsub.h"
 
 #include "../utils/dist.h"
+#include "../utils/spill.h"
 
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
@@ -35,6 +36,7 @@
 #include "../../utils/attr.h"
 
 #include <stddef.h>
+#include <string.h>
 
 struct nn_xpub_data {
     struct nn_dist_data item;
@@ -47,12 +49,20 @@ struct nn_xpub {
 
     /*  Distributor. */
     struct nn_dist outpipes;
+
+    /*  Messages that were published while no subscriber was able to accept
+        them, if NN_PUB_SPILL_FILE is set. 'spillsize' is the size of
+        the spill files created from now on. */
+    struct nn_spill spill;
+    int spillsize;
 };
 
 /*  Private functions. */
 static void nn_xpub_init (struct nn_xpub *self,
     const struct nn_sockbase_vfptr *vfptr, void *hint);
 static void nn_xpub_term (struct nn_xpub *self);
+static int nn_xpub_writable (struct nn_xpub *self);
+static void nn_xpub_drain (struct nn_xpub *self);
 
 /*  Implementation of nn_sockbase's virtual functions. */
 static void nn_xpub_destroy (struct nn_sockbase *self);
@@ -62,6 +72,10 @@ static void nn_xpub_in (struct nn_sockbase *self, struct nn_pipe *pipe);
 static void nn_xpub_out (struct nn_sockbase *self, struct nn_pipe *pipe);
 static int nn_xpub_events (struct nn_sockbase *self);
 static int nn_xpub_send (struct nn_sockbase *self, struct nn_msg *msg);
+static int nn_xpub_setopt (struct nn_sockbase *self, int level, int option,
+        const void *optval, size_t optvallen);
+static int nn_xpub_getopt (struct nn_sockbase *self, int level, int option,
+        void *optval, size_t *optvallen);
 static const struct nn_sockbase_vfptr nn_xpub_sockbase_vfptr = {
     NULL,
     nn_xpub_destroy,
@@ -72,8 +86,8 @@ static const struct nn_sockbase_vfptr nn_xpub_sockbase_vfptr = {
     nn_xpub_events,
     nn_xpub_send,
     NULL,
-    NULL,
-    NULL
+    nn_xpub_setopt,
+    nn_xpub_getopt
 };
 
 static void nn_xpub_init (struct nn_xpub *self,
@@ -81,10 +95,13 @@ static void nn_xpub_init (struct nn_xpub *self,
 {
     nn_sockbase_init (&self->sockbase, vfptr, hint);
     nn_dist_init (&self->outpipes);
+    nn_spill_init (&self->spill);
+    self->spillsize = NN_SPILL_DEFSIZE;
 }
 
 static void nn_xpub_term (struct nn_xpub *self)
 {
+    nn_spill_term (&self->spill);
     nn_dist_term (&self->outpipes);
     nn_sockbase_term (&self->sockbase);
 }
@@ -123,6 +140,7 @@ static void nn_xpub_rm (struct nn_sockbase *self, struct nn_pipe *pipe)
     data = nn_pipe_getdata (pipe);
 
     nn_dist_rm (&xpub->outpipes, &data->item);
+    nn_dist_stats (&xpub->outpipes, &xpub->sockbase);
 
     nn_free (data);
 }
@@ -143,17 +161,159 @@ static void nn_xpub_out (struct nn_sockbase *self, struct nn_pipe *pipe)
     data = nn_pipe_getdata (pipe);
 
     nn_dist_out (&xpub->outpipes, &data->item);
+    nn_xpub_drain (xpub);
+    nn_dist_stats (&xpub->outpipes, &xpub->sockbase);
 }
 
-static int nn_xpub_events (NN_UNUSED struct nn_sockbase *self)
+static int nn_xpub_events (struct nn_sockbase *self)
 {
-    return NN_SOCKBASE_EVENT_OUT;
+    struct nn_xpub *xpub;
+
+    xpub = nn_cont (self, struct nn_xpub, sockbase);
+
+    if (nn_slow (nn_spill_active (&xpub->spill)))
+        return nn_xpub_writable (xpub) || nn_spill_can_put (&xpub->spill) ?
+            NN_SOCKBASE_EVENT_OUT : 0;
+    return nn_dist_can_send (&xpub->outpipes) ? NN_SOCKBASE_EVENT_OUT : 0;
 }
 
 static int nn_xpub_send (struct nn_sockbase *self, struct nn_msg *msg)
 {
-    return nn_dist_send (&nn_cont (self, struct nn_xpub, sockbase)->outpipes,
-        msg, NULL);
+    int rc;
+    struct nn_xpub *xpub;
+
+    xpub = nn_cont (self, struct nn_xpub, sockbase);
+
+    /*  With the spill enabled, messages that no subscriber is able to accept
+        are stored in the spill rather than dropped. Once there are messages
+        in the spill, newer messages have to queue up behind them. */
+    if (nn_slow (nn_spill_active (&xpub->spill))) {
+        nn_xpub_drain (xpub);
+        if (!nn_spill_empty (&xpub->spill) || !nn_xpub_writable (xpub)) {
+            rc = nn_spill_put (&xpub->spill, msg);
+            nn_dist_stats (&xpub->outpipes, &xpub->sockbase);
+            return rc;
+        }
+    }
+
+    rc = nn_dist_send (&xpub->outpipes, msg, NULL);
+    nn_dist_stats (&xpub->outpipes, &xpub->sockbase);
+    return rc;
+}
+
+static int nn_xpub_setopt (struct nn_sockbase *self, int level, int option,
+        const void *optval, size_t optvallen)
+{
+    struct nn_xpub *xpub;
+    int val;
+
+    xpub = nn_cont (self, struct nn_xpub, sockbase);
+
+    if (level != NN_PUB)
+        return -ENOPROTOOPT;
+
+    if (option == NN_PUB_SPILL_FILE) {
+        val = nn_spill_close (&xpub->spill);
+        if (val > 0)
+            nn_sockbase_stat_increment (self, NN_STAT_DROPPED_MESSAGES, val);
+        if (optvallen == 0)
+            return 0;
+        return nn_spill_open (&xpub->spill, optval, optvallen,
+            xpub->spillsize);
+    }
+
+    if (nn_slow (optvallen != sizeof (int)))
+        return -EINVAL;
+    val = *(int*) optval;
+
+    switch (option) {
+    case NN_PUB_CONFLATE:
+        if (nn_slow (val < 0))
+            return -EINVAL;
+        nn_dist_conflate (&xpub->outpipes, val, xpub->outpipes.lvckeylen);
+        nn_dist_stats (&xpub->outpipes, &xpub->sockbase);
+        return 0;
+    case NN_PUB_CONFLATE_KEYLEN:
+        if (nn_slow (val < 0))
+            return -EINVAL;
+        nn_dist_conflate (&xpub->outpipes, xpub->outpipes.lvcmax, val);
+        return 0;
+    case NN_PUB_SPILL_SIZE:
+        if (nn_slow (val < NN_SPILL_MINSIZE))
+            return -EINVAL;
+        xpub->spillsize = val;
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
+static int nn_xpub_getopt (struct nn_sockbase *self, int level, int option,
+        void *optval, size_t *optvallen)
+{
+    struct nn_xpub *xpub;
+    const char *path;
+
+    xpub = nn_cont (self, struct nn_xpub, sockbase);
+
+    if (level != NN_PUB)
+        return -ENOPROTOOPT;
+
+    if (option == NN_PUB_SPILL_FILE) {
+        path = nn_spill_path (&xpub->spill);
+        strncpy (optval, path, *optvallen);
+        *optvallen = strlen (path);
+        return 0;
+    }
+
+    if (nn_slow (*optvallen < sizeof (int)))
+        return -EINVAL;
+
+    switch (option) {
+    case NN_PUB_CONFLATE:
+        *(int*) optval = xpub->outpipes.lvcmax;
+        break;
+    case NN_PUB_CONFLATE_KEYLEN:
+        *(int*) optval = xpub->outpipes.lvckeylen;
+        break;
+    case NN_PUB_SPILL_SIZE:
+        *(int*) optval = xpub->spillsize;
+        break;
+    default:
+        return -ENOPROTOOPT;
+    }
+    *optvallen = sizeof (int);
+
+    return 0;
+}
+
+/*  Returns 1 if a message sent now would reach at least one subscriber. */
+static int nn_xpub_writable (struct nn_xpub *self)
+{
+    return self->outpipes.count > 0 && nn_dist_can_send (&self->outpipes);
+}
+
+static void nn_xpub_drain (struct nn_xpub *self)
+{
+    int rc;
+    struct nn_msg msg;
+
+    if (nn_fast (!nn_spill_active (&self->spill)))
+        return;
+
+    /*  A subscriber may have become available. Messages that didn't fit into
+        the spill before are worth trying again. */
+    nn_spill_retry (&self->spill);
+
+    /*  Stop as soon as no subscriber can accept more data, so that
+        the messages are not dropped or queued per subscriber. */
+    while (nn_xpub_writable (self)) {
+        rc = nn_spill_get (&self->spill, &msg);
+        if (rc == -EAGAIN)
+            break;
+        rc = nn_dist_send (&self->outpipes, &msg, NULL);
+        errnum_assert (rc == 0, -rc);
+    }
 }
 
 int nn_xpub_create (void *hint, struct nn_sockbase **sockbase)
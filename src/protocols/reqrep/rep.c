@@ -37,6 +37,12 @@
 
 #define NN_REP_INPROGRESS 1
 
+/*  Handles consist of the generation in the upper 16 bits and the index of
+    the context in the lower 16 bits. */
+#define NN_REP_MAXCTXS 0xffff
+
+static void nn_rep_setctxs (struct nn_rep *self, int nctxs);
+
 static const struct nn_sockbase_vfptr nn_rep_sockbase_vfptr = {
     NULL,
     nn_rep_destroy,
@@ -47,8 +53,8 @@ static const struct nn_sockbase_vfptr nn_rep_sockbase_vfptr = {
     nn_rep_events,
     nn_rep_send,
     nn_rep_recv,
-    NULL,
-    NULL
+    nn_rep_setopt,
+    nn_rep_getopt
 };
 
 void nn_rep_init (struct nn_rep *self,
@@ -56,15 +62,64 @@ void nn_rep_init (struct nn_rep *self,
 {
     nn_xrep_init (&self->xrep, vfptr, hint);
     self->flags = 0;
+    self->ctxs = NULL;
+    self->nctxs = 0;
+    self->inuse = 0;
+    self->unused = -1;
+    self->last = 0;
+    self->generation = 1;
 }
 
 void nn_rep_term (struct nn_rep *self)
 {
     if (self->flags & NN_REP_INPROGRESS)
         nn_chunkref_term (&self->backtrace);
+    nn_rep_setctxs (self, 0);
     nn_xrep_term (&self->xrep);
 }
 
+/*  Replaces the set of contexts by 'nctxs' new ones. Requests being
+    processed are cancelled. */
+static void nn_rep_setctxs (struct nn_rep *self, int nctxs)
+{
+    int i;
+
+    for (i = 0; i != self->nctxs; ++i)
+        if (self->ctxs [i].handle)
+            nn_chunkref_term (&self->ctxs [i].backtrace);
+    nn_free (self->ctxs);
+    self->ctxs = NULL;
+    self->nctxs = 0;
+    self->inuse = 0;
+    self->unused = -1;
+    self->last = 0;
+
+    if (nctxs == 0)
+        return;
+    self->ctxs = nn_alloc (nctxs * sizeof (struct nn_rep_ctx),
+        "REP contexts");
+    alloc_assert (self->ctxs);
+    for (i = 0; i != nctxs; ++i) {
+        self->ctxs [i].handle = 0;
+        self->ctxs [i].next = i + 1 < nctxs ? i + 1 : -1;
+    }
+    self->nctxs = nctxs;
+    self->unused = 0;
+}
+
+static struct nn_rep_ctx *nn_rep_findctx (struct nn_rep *self,
+    uint32_t handle)
+{
+    struct nn_rep_ctx *ctx;
+
+    if (nn_slow ((int) (handle & 0xffff) >= self->nctxs))
+        return NULL;
+    ctx = &self->ctxs [handle & 0xffff];
+    if (nn_slow (handle == 0 || ctx->handle != handle))
+        return NULL;
+    return ctx;
+}
+
 void nn_rep_destroy (struct nn_sockbase *self)
 {
     struct nn_rep *rep;
@@ -82,6 +137,15 @@ int nn_rep_events (struct nn_sockbase *self)
 
     rep = nn_cont (self, struct nn_rep, xrep.sockbase);
     events = nn_xrep_events (&rep->xrep.sockbase);
+    if (rep->nctxs) {
+
+        /*  No new request can be received while all contexts are in use. */
+        if (rep->inuse == rep->nctxs)
+            events &= ~NN_SOCKBASE_EVENT_IN;
+        if (rep->inuse == 0)
+            events &= ~NN_SOCKBASE_EVENT_OUT;
+        return events;
+    }
     if (!(rep->flags & NN_REP_INPROGRESS))
         events &= ~NN_SOCKBASE_EVENT_OUT;
     return events;
@@ -91,18 +155,47 @@ int nn_rep_send (struct nn_sockbase *self, struct nn_msg *msg)
 {
     int rc;
     struct nn_rep *rep;
+    struct nn_rep_ctx *ctx;
+    uint8_t *handle;
 
     rep = nn_cont (self, struct nn_rep, xrep.sockbase);
 
-    /*  If no request was received, there's nowhere to send the reply to. */
-    if (nn_slow (!(rep->flags & NN_REP_INPROGRESS)))
-        return -EFSM;
+    if (rep->nctxs) {
+
+        /*  Find the request the reply belongs to. If the user hasn't
+            specified one, reply to the request received last. */
+        handle = nn_msg_getcmsg (msg, NN_REP, NN_REP_CONTEXT,
+            sizeof (uint32_t));
+        ctx = nn_rep_findctx (rep, handle ? nn_getl (handle) : rep->last);
+        if (nn_slow (!ctx))
+            return -EFSM;
+
+        /*  Move the stored backtrace into the message header and release
+            the context. */
+        nn_assert (nn_chunkref_size (&msg->sphdr) == 0);
+        nn_chunkref_term (&msg->sphdr);
+        nn_chunkref_mv (&msg->sphdr, &ctx->backtrace);
+        nn_msg_rmcmsg (msg, NN_REP, NN_REP_CONTEXT);
+        if (ctx->handle == rep->last)
+            rep->last = 0;
+        ctx->handle = 0;
+        ctx->next = rep->unused;
+        rep->unused = (int) (ctx - rep->ctxs);
+        --rep->inuse;
+    }
+    else {
+
+        /*  If no request was received, there's nowhere to send the reply
+            to. */
+        if (nn_slow (!(rep->flags & NN_REP_INPROGRESS)))
+            return -EFSM;
 
-    /*  Move the stored backtrace into the message header. */
-    nn_assert (nn_chunkref_size (&msg->sphdr) == 0);
-    nn_chunkref_term (&msg->sphdr);
-    nn_chunkref_mv (&msg->sphdr, &rep->backtrace);
-    rep->flags &= ~NN_REP_INPROGRESS;
+        /*  Move the stored backtrace into the message header. */
+        nn_assert (nn_chunkref_size (&msg->sphdr) == 0);
+        nn_chunkref_term (&msg->sphdr);
+        nn_chunkref_mv (&msg->sphdr, &rep->backtrace);
+        rep->flags &= ~NN_REP_INPROGRESS;
+    }
 
     /*  Send the reply. If it cannot be sent because of pushback,
         drop it silently. */
@@ -112,6 +205,42 @@ int nn_rep_send (struct nn_sockbase *self, struct nn_msg *msg)
     return 0;
 }
 
+static int nn_rep_recv_ctx (struct nn_rep *self, struct nn_msg *msg)
+{
+    int rc;
+    struct nn_rep_ctx *ctx;
+    uint8_t handle [sizeof (uint32_t)];
+
+    /*  All the contexts are in use. Wait till some reply is sent. */
+    if (nn_slow (self->unused < 0))
+        return -EAGAIN;
+
+    /*  Receive the request. */
+    rc = nn_xrep_recv (&self->xrep.sockbase, msg);
+    if (nn_slow (rc == -EAGAIN))
+        return -EAGAIN;
+    errnum_assert (rc == 0, -rc);
+
+    /*  Store the backtrace in an unused context. */
+    ctx = &self->ctxs [self->unused];
+    self->unused = ctx->next;
+    ++self->inuse;
+    nn_chunkref_mv (&ctx->backtrace, &msg->sphdr);
+    nn_chunkref_init (&msg->sphdr, 0);
+
+    /*  Hand the handle of the context to the user. */
+    ++self->generation;
+    if (nn_slow (self->generation == 0))
+        self->generation = 1;
+    ctx->handle = ((uint32_t) self->generation << 16) |
+        (uint32_t) (ctx - self->ctxs);
+    self->last = ctx->handle;
+    nn_putl (handle, ctx->handle);
+    nn_msg_setcmsg (msg, NN_REP, NN_REP_CONTEXT, handle, sizeof (handle));
+
+    return 0;
+}
+
 int nn_rep_recv (struct nn_sockbase *self, struct nn_msg *msg)
 {
     int rc;
@@ -119,6 +248,9 @@ int nn_rep_recv (struct nn_sockbase *self, struct nn_msg *msg)
 
     rep = nn_cont (self, struct nn_rep, xrep.sockbase);
 
+    if (rep->nctxs)
+        return nn_rep_recv_ctx (rep, msg);
+
     /*  If a request is already being processed, cancel it. */
     if (nn_slow (rep->flags & NN_REP_INPROGRESS)) {
         nn_chunkref_term (&rep->backtrace);
@@ -139,6 +271,57 @@ int nn_rep_recv (struct nn_sockbase *self, struct nn_msg *msg)
     return 0;
 }
 
+int nn_rep_setopt (struct nn_sockbase *self, int level, int option,
+        const void *optval, size_t optvallen)
+{
+    int val;
+    struct nn_rep *rep;
+
+    rep = nn_cont (self, struct nn_rep, xrep.sockbase);
+
+    if (level != NN_REP)
+        return -ENOPROTOOPT;
+
+    if (option == NN_REP_CONTEXTS) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        val = *(int*) optval;
+        if (nn_slow (val < 0 || val > NN_REP_MAXCTXS))
+            return -EINVAL;
+
+        /*  Switching the mode cancels all the requests in progress. */
+        if (rep->flags & NN_REP_INPROGRESS) {
+            nn_chunkref_term (&rep->backtrace);
+            rep->flags &= ~NN_REP_INPROGRESS;
+        }
+        nn_rep_setctxs (rep, val);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
+int nn_rep_getopt (struct nn_sockbase *self, int level, int option,
+        void *optval, size_t *optvallen)
+{
+    struct nn_rep *rep;
+
+    rep = nn_cont (self, struct nn_rep, xrep.sockbase);
+
+    if (level != NN_REP)
+        return -ENOPROTOOPT;
+
+    if (option == NN_REP_CONTEXTS) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = rep->nctxs;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
 static int nn_rep_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_rep *self;
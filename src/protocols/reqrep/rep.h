@@ -26,10 +26,36 @@
 #include "../../protocol.h"
 #include "xrep.h"
 
+/*  Request being processed when NN_REP_CONTEXTS is set. */
+struct nn_rep_ctx {
+
+    /*  Handle passed to the user along with the request. Zero if the
+        context is not in use. */
+    uint32_t handle;
+
+    /*  Index of the next unused context, if this one is unused. */
+    int next;
+
+    struct nn_chunkref backtrace;
+};
+
 struct nn_rep {
     struct nn_xrep xrep;
     uint32_t flags;
     struct nn_chunkref backtrace;
+
+    /*  Contexts for requests being processed concurrently. If 'nctxs' is
+        zero, only a single request is processed at a time, using the
+        'backtrace' above. */
+    struct nn_rep_ctx *ctxs;
+    int nctxs;
+    int inuse;
+    int unused;
+
+    /*  Handle of the request received last and generation counter to make
+        the handles of a re-used context distinct. */
+    uint32_t last;
+    uint16_t generation;
 };
 
 /*  Some users may want to extend the REP protocol similar to how REP extends XREP.
@@ -43,5 +69,9 @@ void nn_rep_destroy (struct nn_sockbase *self);
 int nn_rep_events (struct nn_sockbase *self);
 int nn_rep_send (struct nn_sockbase *self, struct nn_msg *msg);
 int nn_rep_recv (struct nn_sockbase *self, struct nn_msg *msg);
+int nn_rep_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen);
+int nn_rep_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen);
 
 #endif
@@ -36,12 +36,22 @@
 #include "../../utils/random.h"
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
+#include "../../utils/clock.h"
 
 #include <stddef.h>
 #include <string.h>
+#include <limits.h>
 
-/*  Default re-send interval is 1 minute. */
-#define NN_REQ_DEFAULT_RESEND_IVL 60000
+/*  Default re-send interval is 1 minute, in microseconds. */
+#define NN_REQ_DEFAULT_RESEND_IVL 60000000
+
+/*  By default, at most 10% of requests can be hedged, with a burst of at
+    most 10 hedged requests in a row. */
+#define NN_REQ_DEFAULT_HEDGE_RATIO 10
+#define NN_REQ_HEDGE_BURST 10
+
+/*  Number of reply times needed before the percentile can be used. */
+#define NN_REQ_HEDGE_MINSAMPLES 16
 
 #define NN_REQ_STATE_IDLE 1
 #define NN_REQ_STATE_PASSIVE 2
@@ -52,6 +62,7 @@
 #define NN_REQ_STATE_STOPPING_TIMER 7
 #define NN_REQ_STATE_DONE 8
 #define NN_REQ_STATE_STOPPING 9
+#define NN_REQ_STATE_HEDGING 10
 
 #define NN_REQ_ACTION_START 1
 #define NN_REQ_ACTION_IN 2
@@ -89,13 +100,22 @@ void nn_req_init (struct nn_req *self,
     nn_random_generate (&self->lastid, sizeof (self->lastid));
 
     self->task.sent_to = NULL;
+    self->task.hedged_to = NULL;
 
     nn_msg_init (&self->task.request, 0);
     nn_msg_init (&self->task.reply, 0);
     nn_timer_init (&self->task.timer, NN_REQ_SRC_RESEND_TIMER, &self->fsm);
     self->resend_ivl = NN_REQ_DEFAULT_RESEND_IVL;
+    self->hedge_ivl = 0;
+    self->hedge_percentile = 0;
+    self->hedge_ratio = NN_REQ_DEFAULT_HEDGE_RATIO;
+    self->hedge_budget = 0;
+    self->rttpos = 0;
+    self->nrtts = 0;
 
     nn_task_init (&self->task, self->lastid);
+    self->task.sent_at = 0;
+    self->task.hedge = 0;
 
     /*  Start the state machine. */
     nn_fsm_start (&self->fsm);
@@ -143,6 +163,7 @@ void nn_req_in (struct nn_sockbase *self, struct nn_pipe *pipe)
     int rc;
     struct nn_req *req;
     uint32_t reqid;
+    struct nn_msg reply;
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
@@ -152,44 +173,57 @@ void nn_req_in (struct nn_sockbase *self, struct nn_pipe *pipe)
     while (1) {
 
         /*  Get new reply. */
-        rc = nn_xreq_recv (&req->xreq.sockbase, &req->task.reply);
+        rc = nn_xreq_recv (&req->xreq.sockbase, &reply);
         if (nn_slow (rc == -EAGAIN))
             return;
         errnum_assert (rc == 0, -rc);
 
-        /*  No request was sent. Getting a reply doesn't make sense. */
-        if (nn_slow (!nn_req_inprogress (req))) {
-            nn_msg_term (&req->task.reply);
+        /*  No request is waiting for a reply. Either no request was sent or
+            the reply was already received. The latter happens when both
+            the request and its hedged copy are answered. */
+        if (nn_slow (req->state != NN_REQ_STATE_ACTIVE &&
+              req->state != NN_REQ_STATE_HEDGING)) {
+            nn_msg_term (&reply);
             continue;
         }
 
         /*  Ignore malformed replies. */
-        if (nn_slow (nn_chunkref_size (&req->task.reply.sphdr) !=
-              sizeof (uint32_t))) {
-            nn_msg_term (&req->task.reply);
+        if (nn_slow (nn_chunkref_size (&reply.sphdr) != sizeof (uint32_t))) {
+            nn_msg_term (&reply);
             continue;
         }
 
         /*  Ignore replies with incorrect request IDs. */
-        reqid = nn_getl (nn_chunkref_data (&req->task.reply.sphdr));
+        reqid = nn_getl (nn_chunkref_data (&reply.sphdr));
         if (nn_slow (!(reqid & 0x80000000))) {
-            nn_msg_term (&req->task.reply);
+            nn_msg_term (&reply);
             continue;
         }
         if (nn_slow (reqid != (req->task.id | 0x80000000))) {
-            nn_msg_term (&req->task.reply);
+            nn_msg_term (&reply);
             continue;
         }
 
         /*  Trim the request ID. */
-        nn_chunkref_term (&req->task.reply.sphdr);
-        nn_chunkref_init (&req->task.reply.sphdr, 0);
+        nn_chunkref_term (&reply.sphdr);
+        nn_chunkref_init (&reply.sphdr, 0);
+
+        /*  Store the reply. There may be a reply to a cancelled request
+            that was never retrieved by the user. */
+        nn_msg_term (&req->task.reply);
+        nn_msg_mv (&req->task.reply, &reply);
 
         /*  TODO: Deallocate the request here? */
 
+        /*  Remember how long it took to get the reply. */
+        req->rtts [req->rttpos] =
+            (uint32_t) ((nn_clock_us () - req->task.sent_at) / 1000);
+        req->rttpos = (req->rttpos + 1) % NN_REQ_HEDGE_SAMPLES;
+        if (req->nrtts < NN_REQ_HEDGE_SAMPLES)
+            ++req->nrtts;
+
         /*  Notify the state machine. */
-        if (req->state == NN_REQ_STATE_ACTIVE)
-            nn_fsm_action (&req->fsm, NN_REQ_ACTION_IN);
+        nn_fsm_action (&req->fsm, NN_REQ_ACTION_IN);
 
         return;
     }
@@ -242,6 +276,11 @@ int nn_req_csend (struct nn_sockbase *self, struct nn_msg *msg)
     nn_chunkref_init (&msg->sphdr, 4);
     nn_putl (nn_chunkref_data (&msg->sphdr), req->task.id | 0x80000000);
 
+    /*  Each request allows for a fraction of a hedged request. */
+    req->hedge_budget += req->hedge_ratio;
+    if (req->hedge_budget > NN_REQ_HEDGE_BURST * 100)
+        req->hedge_budget = NN_REQ_HEDGE_BURST * 100;
+
     /*  Store the message so that it can be re-sent if there's no reply. */
     nn_msg_term (&req->task.request);
     nn_msg_mv (&req->task.request, msg);
@@ -286,11 +325,40 @@ int nn_req_setopt (struct nn_sockbase *self, int level, int option,
     if (level != NN_REQ)
         return -ENOPROTOOPT;
 
-    if (option == NN_REQ_RESEND_IVL) {
+    switch (option) {
+    case NN_REQ_RESEND_IVL:
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        req->resend_ivl = (int64_t) *(int*) optval * 1000;
+        return 0;
+    case NN_REQ_RESEND_IVL_US:
         if (nn_slow (optvallen != sizeof (int)))
             return -EINVAL;
+        if (nn_slow (*(int*) optval < 0))
+            return -EINVAL;
         req->resend_ivl = *(int*) optval;
         return 0;
+    case NN_REQ_HEDGE_IVL:
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        if (nn_slow (*(int*) optval < 0))
+            return -EINVAL;
+        req->hedge_ivl = *(int*) optval;
+        return 0;
+    case NN_REQ_HEDGE_PERCENTILE:
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        if (nn_slow (*(int*) optval < 0 || *(int*) optval > 99))
+            return -EINVAL;
+        req->hedge_percentile = *(int*) optval;
+        return 0;
+    case NN_REQ_HEDGE_RATIO:
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        if (nn_slow (*(int*) optval < 0 || *(int*) optval > 100))
+            return -EINVAL;
+        req->hedge_ratio = *(int*) optval;
+        return 0;
     }
 
     return -ENOPROTOOPT;
@@ -306,15 +374,31 @@ int nn_req_getopt (struct nn_sockbase *self, int level, int option,
     if (level != NN_REQ)
         return -ENOPROTOOPT;
 
-    if (option == NN_REQ_RESEND_IVL) {
-        if (nn_slow (*optvallen < sizeof (int)))
-            return -EINVAL;
-        *(int*) optval = req->resend_ivl;
-        *optvallen = sizeof (int);
-        return 0;
+    if (nn_slow (*optvallen < sizeof (int)))
+        return -EINVAL;
+
+    switch (option) {
+    case NN_REQ_RESEND_IVL:
+        *(int*) optval = (int) (req->resend_ivl / 1000);
+        break;
+    case NN_REQ_RESEND_IVL_US:
+        *(int*) optval = req->resend_ivl > INT_MAX ?
+            INT_MAX : (int) req->resend_ivl;
+        break;
+    case NN_REQ_HEDGE_IVL:
+        *(int*) optval = req->hedge_ivl;
+        break;
+    case NN_REQ_HEDGE_PERCENTILE:
+        *(int*) optval = req->hedge_percentile;
+        break;
+    case NN_REQ_HEDGE_RATIO:
+        *(int*) optval = req->hedge_ratio;
+        break;
+    default:
+        return -ENOPROTOOPT;
     }
-
-    return -ENOPROTOOPT;
+    *optvallen = sizeof (int);
+    return 0;
 }
 
 void nn_req_shutdown (struct nn_fsm *self, int src, int type,
@@ -441,6 +525,15 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
                 return;
 
             case NN_REQ_ACTION_PIPE_RM:
+
+                /*  Pipe the request was sent to is gone, but the hedged
+                    copy is still in flight. Keep waiting for its reply. */
+                if (req->task.hedged_to) {
+                    req->task.sent_to = req->task.hedged_to;
+                    req->task.hedged_to = NULL;
+                    return;
+                }
+
                 /*  Pipe that we sent request to is removed  */
                 nn_timer_stop (&req->task.timer);
                 req->task.sent_to = NULL;
@@ -456,6 +549,13 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_TIMER_TIMEOUT:
                 nn_timer_stop (&req->task.timer);
+
+                /*  Reply is late. Send a hedged copy of the request. */
+                if (req->task.hedge) {
+                    req->state = NN_REQ_STATE_HEDGING;
+                    return;
+                }
+
                 req->task.sent_to = NULL;
                 req->state = NN_REQ_STATE_TIMED_OUT;
                 return;
@@ -497,6 +597,53 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
             nn_fsm_bad_source (req->state, src, type);
         }
 
+/******************************************************************************/
+/*  HEDGING state.                                                            */
+/*  Reply didn't arrive within the hedging delay. Stopping the timer.         */
+/*  Afterwards, we'll send a copy of the request to a different peer.         */
+/******************************************************************************/
+    case NN_REQ_STATE_HEDGING:
+        switch (src) {
+
+        case NN_REQ_SRC_RESEND_TIMER:
+            switch (type) {
+            case NN_TIMER_STOPPED:
+                nn_req_action_hedge (req);
+                return;
+            default:
+                nn_fsm_bad_action (req->state, src, type);
+            }
+
+        case NN_FSM_ACTION:
+            switch (type) {
+            case NN_REQ_ACTION_IN:
+
+                /*  Reply arrived in the meantime. No need to hedge. */
+                req->task.sent_to = NULL;
+                req->state = NN_REQ_STATE_STOPPING_TIMER;
+                return;
+
+            case NN_REQ_ACTION_SENT:
+                req->task.sent_to = NULL;
+                req->state = NN_REQ_STATE_CANCELLING;
+                return;
+
+            case NN_REQ_ACTION_PIPE_RM:
+
+                /*  Pipe the request was sent to is gone. Re-send the
+                    request immediately instead of hedging it. */
+                req->task.sent_to = NULL;
+                req->state = NN_REQ_STATE_TIMED_OUT;
+                return;
+
+            default:
+                nn_fsm_bad_action (req->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (req->state, src, type);
+        }
+
 /******************************************************************************/
 /*  CANCELLING state.                                                         */
 /*  Request was canceled. Waiting till the timer is stopped. Note that        */
@@ -603,6 +750,7 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
 void nn_req_action_send (struct nn_req *self, int allow_delay)
 {
     int rc;
+    int delay;
     struct nn_msg msg;
     struct nn_pipe *to;
 
@@ -621,11 +769,22 @@ void nn_req_action_send (struct nn_req *self, int allow_delay)
 
     /*  Request was successfully sent. Set up the re-send timer
         in case the request gets lost somewhere further out
-        in the topology. */
+        in the topology. If the request is to be hedged, the timer
+        fires first after the hedging delay. */
     if (nn_fast (rc == 0)) {
-        nn_timer_start (&self->task.timer, self->resend_ivl);
         nn_assert (to);
         self->task.sent_to = to;
+        self->task.hedged_to = NULL;
+        self->task.sent_at = nn_clock_us ();
+        delay = nn_req_hedge_delay (self);
+        if (delay > 0 && (int64_t) delay * 1000 < self->resend_ivl) {
+            self->task.hedge = 1;
+            nn_timer_start (&self->task.timer, delay);
+        }
+        else {
+            self->task.hedge = 0;
+            nn_timer_start_us (&self->task.timer, self->resend_ivl);
+        }
         self->state = NN_REQ_STATE_ACTIVE;
         return;
     }
@@ -634,6 +793,71 @@ void nn_req_action_send (struct nn_req *self, int allow_delay)
     errnum_assert (0, -rc);
 }
 
+void nn_req_action_hedge (struct nn_req *self)
+{
+    int rc;
+    int64_t elapsed;
+    struct nn_msg msg;
+    struct nn_pipe *to;
+
+    self->task.hedge = 0;
+
+    /*  Send a copy of the request to a different peer, unless too many
+        requests were hedged recently. The first reply to arrive wins, the
+        other one is dropped. */
+    if (self->hedge_budget >= 100) {
+        nn_msg_cp (&msg, &self->task.request);
+        rc = nn_xreq_send_except (&self->xreq.sockbase, &msg,
+            self->task.sent_to, &to);
+        if (rc == 0) {
+            self->task.hedged_to = to;
+            self->hedge_budget -= 100;
+            nn_sockbase_stat_increment (&self->xreq.sockbase,
+                NN_STAT_HEDGED_REQUESTS, 1);
+        }
+        else {
+            errnum_assert (rc == -EAGAIN, -rc);
+            nn_msg_term (&msg);
+        }
+    }
+
+    /*  Wait for the rest of the re-send interval. */
+    elapsed = (int64_t) (nn_clock_us () - self->task.sent_at);
+    nn_timer_start_us (&self->task.timer,
+        elapsed < self->resend_ivl ? self->resend_ivl - elapsed : 0);
+    self->state = NN_REQ_STATE_ACTIVE;
+}
+
+int nn_req_hedge_delay (struct nn_req *self)
+{
+    int i;
+    int j;
+    int n;
+    uint32_t rtt;
+    uint32_t rtts [NN_REQ_HEDGE_SAMPLES];
+
+    /*  Hedging is switched off altogether. */
+    if (self->hedge_ratio == 0)
+        return 0;
+
+    /*  Until enough replies are seen, fall back to the fixed delay. */
+    if (self->hedge_percentile == 0 ||
+          self->nrtts < NN_REQ_HEDGE_MINSAMPLES)
+        return self->hedge_ivl;
+
+    /*  Sort the recent reply times and pick the percentile. The delay is at
+        least 1 millisecond, as zero means no hedging. */
+    n = self->nrtts;
+    for (i = 0; i != n; ++i) {
+        rtt = self->rtts [i];
+        for (j = i; j > 0 && rtts [j - 1] > rtt; --j)
+            rtts [j] = rtts [j - 1];
+        rtts [j] = rtt;
+    }
+    rtt = rtts [n * self->hedge_percentile / 100];
+    return rtt > 0 ? (int) rtt : 1;
+}
+
 static int nn_req_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_req *self;
@@ -652,6 +876,8 @@ void nn_req_rm (struct nn_sockbase *self, struct nn_pipe *pipe) {
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
     nn_xreq_rm (self, pipe);
+    if (nn_slow (pipe == req->task.hedged_to))
+        req->task.hedged_to = NULL;
     if (nn_slow (pipe == req->task.sent_to)) {
         nn_fsm_action (&req->fsm, NN_REQ_ACTION_PIPE_RM);
     }
@@ -30,6 +30,9 @@
 #include "../../protocol.h"
 #include "../../aio/fsm.h"
 
+/*  Number of recent reply times used to compute the hedging delay. */
+#define NN_REQ_HEDGE_SAMPLES 64
+
 struct nn_req {
 
     /*  The base class. Raw REQ socket. */
@@ -42,8 +45,24 @@ struct nn_req {
     /*  Last request ID assigned. */
     uint32_t lastid;
 
-    /*  Protocol-specific socket options. */
-    int resend_ivl;
+    /*  Protocol-specific socket options. Re-send interval is kept in
+        microseconds. */
+    int64_t resend_ivl;
+    int hedge_ivl;
+    int hedge_percentile;
+    int hedge_ratio;
+
+    /*  Hedged requests that can be sent at the moment, in hundredths.
+        Each request adds 'hedge_ratio' to the budget, each hedged copy
+        takes 100 out of it. */
+    int hedge_budget;
+
+    /*  Ring buffer of recent reply times, in milliseconds. 'rttpos' is where
+        the next one goes, 'nrtts' the number of valid entries, which stops
+        growing once the buffer is full. */
+    uint32_t rtts [NN_REQ_HEDGE_SAMPLES];
+    int rttpos;
+    int nrtts;
 
     /*  The request being processed. */
     struct nn_task task;
@@ -60,6 +79,8 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
 void nn_req_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
 void nn_req_action_send (struct nn_req *self, int allow_delay);
+void nn_req_action_hedge (struct nn_req *self);
+int nn_req_hedge_delay (struct nn_req *self);
 
 /*  Implementation of nn_sockbase's virtual functions. */
 void nn_req_stop (struct nn_sockbase *self);
@@ -48,6 +48,17 @@ struct nn_task {
     /*  Pipe the current request has been sent to. This is an optimisation so
         that request can be re-sent immediately if the pipe disappears.  */
     struct nn_pipe *sent_to;
+
+    /*  Pipe the hedged copy of the current request has been sent to, if any.
+        The request is still outstanding while either of the pipes exists. */
+    struct nn_pipe *hedged_to;
+
+    /*  Time when the request was last sent, in microseconds. */
+    uint64_t sent_at;
+
+    /*  If set, the timer is waiting to send a hedged copy of the request
+        rather than to re-send it. */
+    int hedge;
 };
 
 void nn_task_init (struct nn_task *self, uint32_t id);
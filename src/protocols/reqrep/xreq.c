@@ -175,6 +175,20 @@ int nn_xreq_send_to (struct nn_sockbase *self, struct nn_msg *msg,
     return 0;
 }
 
+int nn_xreq_send_except (struct nn_sockbase *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to)
+{
+    int rc;
+
+    rc = nn_lb_send_except (&nn_cont (self, struct nn_xreq, sockbase)->lb,
+        msg, except, to);
+    if (nn_slow (rc == -EAGAIN))
+        return -EAGAIN;
+    errnum_assert (rc >= 0, -rc);
+
+    return 0;
+}
+
 int nn_xreq_recv (struct nn_sockbase *self, struct nn_msg *msg)
 {
     int rc;
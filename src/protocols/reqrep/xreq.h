@@ -47,6 +47,8 @@ int nn_xreq_events (struct nn_sockbase *self);
 int nn_xreq_send (struct nn_sockbase *self, struct nn_msg *msg);
 int nn_xreq_send_to (struct nn_sockbase *self, struct nn_msg *msg,
     struct nn_pipe **to);
+int nn_xreq_send_except (struct nn_sockbase *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to);
 int nn_xreq_recv (struct nn_sockbase *self, struct nn_msg *msg);
 
 int nn_xreq_ispeer (int socktype);
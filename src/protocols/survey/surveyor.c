@@ -38,8 +38,9 @@
 #include "../../utils/attr.h"
 
 #include <string.h>
+#include <limits.h>
 
-#define NN_SURVEYOR_DEFAULT_DEADLINE 1000
+#define NN_SURVEYOR_DEFAULT_DEADLINE 1000000
 
 #define NN_SURVEYOR_STATE_IDLE 1
 #define NN_SURVEYOR_STATE_PASSIVE 2
@@ -73,8 +74,8 @@ struct nn_surveyor {
     /*  When starting the survey, the message is temporarily stored here. */
     struct nn_msg tosend;
 
-    /*  Protocol-specific socket options. */
-    int deadline;
+    /*  Protocol-specific socket options. Deadline is in microseconds. */
+    int64_t deadline;
 
     /*  Flag if surveyor has timed out */
     int timedout;
@@ -195,6 +196,13 @@ static int nn_surveyor_send (struct nn_sockbase *self, struct nn_msg *msg)
 
     surveyor = nn_cont (self, struct nn_surveyor, xsurveyor.sockbase);
 
+    /*  First check whether the survey can be sent at all. This has to be done
+        before the message is consumed, so that it's still there when
+        the user retries. */
+    if (nn_slow (!(nn_xsurveyor_events (&surveyor->xsurveyor.sockbase) &
+          NN_SOCKBASE_EVENT_OUT)))
+        return -EAGAIN;
+
     /*  Generate new survey ID. */
     ++surveyor->surveyid;
     surveyor->surveyid |= 0x80000000;
@@ -213,11 +221,6 @@ static int nn_surveyor_send (struct nn_sockbase *self, struct nn_msg *msg)
     /*  Cancel any ongoing survey, if any. */
     if (nn_slow (nn_surveyor_inprogress (surveyor))) {
 
-        /*  First check whether the survey can be sent at all. */
-        if (!(nn_xsurveyor_events (&surveyor->xsurveyor.sockbase) &
-              NN_SOCKBASE_EVENT_OUT))
-            return -EAGAIN;
-
         /*  Cancel the current survey. */
         nn_fsm_action (&surveyor->fsm, NN_SURVEYOR_ACTION_CANCEL);
 
@@ -285,6 +288,15 @@ static int nn_surveyor_setopt (struct nn_sockbase *self, int level, int option,
     if (option == NN_SURVEYOR_DEADLINE) {
         if (nn_slow (optvallen != sizeof (int)))
             return -EINVAL;
+        surveyor->deadline = (int64_t) *(int*) optval * 1000;
+        return 0;
+    }
+
+    if (option == NN_SURVEYOR_DEADLINE_US) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        if (nn_slow (*(int*) optval < 0))
+            return -EINVAL;
         surveyor->deadline = *(int*) optval;
         return 0;
     }
@@ -305,7 +317,16 @@ static int nn_surveyor_getopt (struct nn_sockbase *self, int level, int option,
     if (option == NN_SURVEYOR_DEADLINE) {
         if (nn_slow (*optvallen < sizeof (int)))
             return -EINVAL;
-        *(int*) optval = surveyor->deadline;
+        *(int*) optval = (int) (surveyor->deadline / 1000);
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_SURVEYOR_DEADLINE_US) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = surveyor->deadline > INT_MAX ?
+            INT_MAX : (int) surveyor->deadline;
         *optvallen = sizeof (int);
         return 0;
     }
@@ -376,7 +397,7 @@ static void nn_surveyor_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_SURVEYOR_ACTION_START:
                 nn_surveyor_resend (surveyor);
-                nn_timer_start (&surveyor->timer, surveyor->deadline);
+                nn_timer_start_us (&surveyor->timer, surveyor->deadline);
                 surveyor->state = NN_SURVEYOR_STATE_ACTIVE;
                 return;
 
@@ -440,7 +461,7 @@ static void nn_surveyor_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_TIMER_STOPPED:
                 nn_surveyor_resend (surveyor);
-                nn_timer_start (&surveyor->timer, surveyor->deadline);
+                nn_timer_start_us (&surveyor->timer, surveyor->deadline);
                 surveyor->state = NN_SURVEYOR_STATE_ACTIVE;
                 return;
             default:
@@ -112,6 +112,7 @@ void nn_xsurveyor_rm (struct nn_sockbase *self, struct nn_pipe *pipe)
 
     nn_fq_rm (&xsurveyor->inpipes, &data->initem);
     nn_dist_rm (&xsurveyor->outpipes, &data->outitem);
+    nn_dist_stats (&xsurveyor->outpipes, &xsurveyor->sockbase);
 
     nn_free (data);
 }
@@ -136,6 +137,7 @@ void nn_xsurveyor_out (struct nn_sockbase *self, struct nn_pipe *pipe)
     data = nn_pipe_getdata (pipe);
 
     nn_dist_out (&xsurveyor->outpipes, &data->outitem);
+    nn_dist_stats (&xsurveyor->outpipes, &xsurveyor->sockbase);
 }
 
 int nn_xsurveyor_events (struct nn_sockbase *self)
@@ -145,7 +147,9 @@ int nn_xsurveyor_events (struct nn_sockbase *self)
 
     xsurveyor = nn_cont (self, struct nn_xsurveyor, sockbase);
 
-    events = NN_SOCKBASE_EVENT_OUT;
+    events = 0;
+    if (nn_dist_can_send (&xsurveyor->outpipes))
+        events |= NN_SOCKBASE_EVENT_OUT;
     if (nn_fq_can_recv (&xsurveyor->inpipes))
         events |= NN_SOCKBASE_EVENT_IN;
     return events;
@@ -153,8 +157,14 @@ int nn_xsurveyor_events (struct nn_sockbase *self)
 
 int nn_xsurveyor_send (struct nn_sockbase *self, struct nn_msg *msg)
 {
-    return nn_dist_send (
-        &nn_cont (self, struct nn_xsurveyor, sockbase)->outpipes, msg, NULL);
+    int rc;
+    struct nn_xsurveyor *xsurveyor;
+
+    xsurveyor = nn_cont (self, struct nn_xsurveyor, sockbase);
+
+    rc = nn_dist_send (&xsurveyor->outpipes, msg, NULL);
+    nn_dist_stats (&xsurveyor->outpipes, &xsurveyor->sockbase);
+    return rc;
 }
 
 int nn_xsurveyor_recv (struct nn_sockbase *self, struct nn_msg *msg)
@@ -20,49 +20,205 @@
     IN THE SOFTWARE.
 */
 
+
 #include "dist.h"
 
+#include "../../nn.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 #include "../../utils/fast.h"
+#include "../../utils/alloc.h"
 #include "../../utils/attr.h"
 
 #include <stddef.h>
+#include <string.h>
+
+/*  Message waiting in the backlog of a pipe that is not writable. */
+struct nn_dist_entry {
+    struct nn_list_item item;
+    struct nn_msg msg;
+};
+
+/*  Private functions. */
+static size_t nn_dist_msgsize (struct nn_msg *msg);
+static void nn_dist_push (struct nn_dist *self, struct nn_dist_data *data,
+    struct nn_dist_entry *entry);
+static struct nn_dist_entry *nn_dist_pop (struct nn_dist *self,
+    struct nn_dist_data *data);
+static int nn_dist_nofit (struct nn_dist_data *data, size_t sz);
+static int nn_dist_atlimit (struct nn_dist_data *data);
+static void nn_dist_queue (struct nn_dist *self,
+    struct nn_dist_data *data, struct nn_msg *msg);
+static void nn_dist_conflate_msg (struct nn_dist *self,
+    struct nn_dist_data *data, struct nn_msg *msg);
+static void nn_dist_drop (struct nn_dist *self, struct nn_dist_data *data);
 
 void nn_dist_init (struct nn_dist *self)
 {
     self->count = 0;
     nn_list_init (&self->pipes);
+    nn_list_init (&self->all);
+    self->lvcmax = 0;
+    self->lvckeylen = 0;
+    self->total = 0;
+    self->full = 0;
+    self->dropped = 0;
+    self->queued = 0;
 }
 
 void nn_dist_term (struct nn_dist *self)
 {
     nn_assert (self->count == 0);
+    nn_assert (self->total == 0);
+    nn_list_term (&self->all);
     nn_list_term (&self->pipes);
 }
 
-void nn_dist_add (NN_UNUSED struct nn_dist *self,
+void nn_dist_add (struct nn_dist *self,
     struct nn_dist_data *data, struct nn_pipe *pipe)
 {
+    size_t sz;
+
     data->pipe = pipe;
     nn_list_item_init (&data->item);
+    nn_list_item_init (&data->all);
+    nn_list_init (&data->backlog);
+    data->backlogcnt = 0;
+    data->backlogsz = 0;
+    data->full = 0;
+    data->dropped = 0;
+
+    sz = sizeof (data->maxmsgs);
+    nn_pipe_getopt (pipe, NN_SOL_SOCKET, NN_SNDQUEUE_MSGS, &data->maxmsgs, &sz);
+    nn_assert (sz == sizeof (data->maxmsgs));
+    sz = sizeof (data->maxbytes);
+    nn_pipe_getopt (pipe, NN_SOL_SOCKET, NN_SNDQUEUE_BYTES,
+        &data->maxbytes, &sz);
+    nn_assert (sz == sizeof (data->maxbytes));
+    sz = sizeof (data->policy);
+    nn_pipe_getopt (pipe, NN_SOL_SOCKET, NN_SNDQUEUE_POLICY,
+        &data->policy, &sz);
+    nn_assert (sz == sizeof (data->policy));
+
+    ++self->total;
+    nn_list_insert (&self->all, &data->all, nn_list_end (&self->all));
 }
 
 void nn_dist_rm (struct nn_dist *self, struct nn_dist_data *data)
 {
+    struct nn_dist_entry *entry;
+
     if (nn_list_item_isinlist (&data->item)) {
         --self->count;
         nn_list_erase (&self->pipes, &data->item);
     }
     nn_list_item_term (&data->item);
+    --self->total;
+    nn_list_erase (&self->all, &data->all);
+    nn_list_item_term (&data->all);
+    if (data->full)
+        --self->full;
+
+    /*  Drop any messages that haven't made it to the pipe. */
+    while (!nn_list_empty (&data->backlog)) {
+        entry = nn_dist_pop (self, data);
+        nn_list_item_term (&entry->item);
+        nn_msg_term (&entry->msg);
+        nn_free (entry);
+        nn_dist_drop (self, data);
+    }
+    nn_list_term (&data->backlog);
 }
 
 void nn_dist_out (struct nn_dist *self, struct nn_dist_data *data)
 {
+    int rc;
+    struct nn_dist_entry *entry;
+
+    /*  Flush the backlog first, skipping the messages that have passed their
+        deadline in the meantime. If the pipe gets blocked again in the process
+        it's not marked as writable and we'll get back here once it becomes
+        writable anew. */
+    rc = 0;
+    while (!nn_list_empty (&data->backlog)) {
+        entry = nn_dist_pop (self, data);
+        if (nn_slow (nn_pipe_expired (data->pipe, &entry->msg))) {
+            nn_list_item_term (&entry->item);
+            nn_free (entry);
+            continue;
+        }
+        rc = nn_pipe_send (data->pipe, &entry->msg);
+        errnum_assert (rc >= 0, -rc);
+        nn_list_item_term (&entry->item);
+        nn_free (entry);
+        if (rc & NN_PIPE_RELEASE)
+            break;
+    }
+
+    /*  If the queue was holding back the sender, there may be room now. */
+    if (data->full && !nn_dist_atlimit (data)) {
+        data->full = 0;
+        --self->full;
+    }
+
+    if (rc & NN_PIPE_RELEASE)
+        return;
+
     ++self->count;
     nn_list_insert (&self->pipes, &data->item, nn_list_end (&self->pipes));
 }
 
+void nn_dist_conflate (struct nn_dist *self, int maxtopics, int keylen)
+{
+    struct nn_list_item *it;
+    struct nn_dist_data *data;
+    struct nn_dist_entry *entry;
+
+    self->lvcmax = maxtopics;
+    self->lvckeylen = keylen;
+    if (maxtopics == 0)
+        return;
+
+    /*  The new bound applies to the messages already waiting as well.
+        Evict the oldest ones from the backlogs that exceed it. */
+    for (it = nn_list_begin (&self->all);
+          it != nn_list_end (&self->all);
+          it = nn_list_next (&self->all, it)) {
+        data = nn_cont (it, struct nn_dist_data, all);
+        while (data->backlogcnt > (uint32_t) maxtopics) {
+            entry = nn_dist_pop (self, data);
+            nn_list_item_term (&entry->item);
+            nn_msg_term (&entry->msg);
+            nn_free (entry);
+            nn_dist_drop (self, data);
+        }
+        if (data->full && !nn_dist_atlimit (data)) {
+            data->full = 0;
+            --self->full;
+        }
+    }
+}
+
+int nn_dist_can_send (struct nn_dist *self)
+{
+    return self->full == 0 ? 1 : 0;
+}
+
+void nn_dist_stats (struct nn_dist *self, struct nn_sockbase *sockbase)
+{
+    if (nn_slow (self->dropped > 0)) {
+        nn_sockbase_stat_increment (sockbase, NN_STAT_DROPPED_MESSAGES,
+            self->dropped);
+        self->dropped = 0;
+    }
+    if (nn_slow (self->queued != 0)) {
+        nn_sockbase_stat_increment (sockbase, NN_STAT_QUEUED_BYTES,
+            self->queued);
+        self->queued = 0;
+    }
+}
+
 int nn_dist_send (struct nn_dist *self, struct nn_msg *msg,
     struct nn_pipe *exclude)
 {
@@ -71,6 +227,26 @@ int nn_dist_send (struct nn_dist *self, struct nn_msg *msg,
     struct nn_dist_data *data;
     struct nn_msg copy;
 
+    /*  Some pipe with NN_SNDQUEUE_BLOCK policy can't accept any more
+        messages. Push back on the user. */
+    if (nn_slow (self->full))
+        return -EAGAIN;
+
+    /*  Pipes that are not writable at the moment get the message stored
+        in their backlog. This has to be done before sending to the writable
+        pipes, as those that get blocked in the process would otherwise get
+        the message twice. */
+    if (self->count < self->total) {
+        for (it = nn_list_begin (&self->all);
+              it != nn_list_end (&self->all);
+              it = nn_list_next (&self->all, it)) {
+            data = nn_cont (it, struct nn_dist_data, all);
+            if (nn_list_item_isinlist (&data->item) || data->pipe == exclude)
+                continue;
+            nn_dist_queue (self, data, msg);
+        }
+    }
+
     /*  TODO: We can optimise for the case when there's only one outbound
         pipe here. No message copying is needed in such case. */
 
@@ -106,3 +282,176 @@ int nn_dist_send (struct nn_dist *self, struct nn_msg *msg,
     return 0;
 }
 
+static size_t nn_dist_msgsize (struct nn_msg *msg)
+{
+    return nn_chunkref_size (&msg->sphdr) + nn_msg_bodysize (msg);
+}
+
+static void nn_dist_push (struct nn_dist *self, struct nn_dist_data *data,
+    struct nn_dist_entry *entry)
+{
+    size_t sz;
+
+    nn_list_insert (&data->backlog, &entry->item,
+        nn_list_end (&data->backlog));
+    ++data->backlogcnt;
+    sz = nn_dist_msgsize (&entry->msg);
+    data->backlogsz += sz;
+    self->queued += (int64_t) sz;
+}
+
+static struct nn_dist_entry *nn_dist_pop (struct nn_dist *self,
+    struct nn_dist_data *data)
+{
+    struct nn_dist_entry *entry;
+    size_t sz;
+
+    entry = nn_cont (nn_list_begin (&data->backlog),
+        struct nn_dist_entry, item);
+    nn_list_erase (&data->backlog, &entry->item);
+    --data->backlogcnt;
+    sz = nn_dist_msgsize (&entry->msg);
+    data->backlogsz -= sz;
+    self->queued -= (int64_t) sz;
+    return entry;
+}
+
+/*  Returns 1 if a message of 'sz' bytes doesn't fit into the pipe's queue.
+    Same as with NN_SNDBUF, a single message is always accepted into an empty
+    queue, whatever its size. */
+static int nn_dist_nofit (struct nn_dist_data *data, size_t sz)
+{
+    if (data->backlogcnt == 0)
+        return 0;
+    if (data->maxmsgs > 0 && data->backlogcnt >= (uint32_t) data->maxmsgs)
+        return 1;
+    if (data->maxbytes > 0 && data->backlogsz + sz > (size_t) data->maxbytes)
+        return 1;
+    return 0;
+}
+
+/*  Returns 1 if the pipe's queue has reached one of its limits. */
+static int nn_dist_atlimit (struct nn_dist_data *data)
+{
+    if (data->maxmsgs > 0 && data->backlogcnt >= (uint32_t) data->maxmsgs)
+        return 1;
+    if (data->maxbytes > 0 && data->backlogsz >= (size_t) data->maxbytes)
+        return 1;
+    return 0;
+}
+
+static void nn_dist_queue (struct nn_dist *self,
+    struct nn_dist_data *data, struct nn_msg *msg)
+{
+    struct nn_dist_entry *entry;
+    size_t sz;
+
+    /*  Last-value cache takes precedence over the send queue. */
+    if (self->lvcmax > 0) {
+        nn_dist_conflate_msg (self, data, msg);
+        return;
+    }
+
+    /*  No send queue. The pipe simply misses the message. */
+    if (data->maxmsgs == 0 && data->maxbytes == 0) {
+        nn_dist_drop (self, data);
+        return;
+    }
+
+    sz = nn_dist_msgsize (msg);
+    switch (data->policy) {
+    case NN_SNDQUEUE_BLOCK:
+
+        /*  Sending is refused while the queue is full, so there's always
+            room for at least one more message. */
+        nn_assert (!data->full);
+        break;
+    case NN_SNDQUEUE_DROP_OLDEST:
+        while (nn_dist_nofit (data, sz)) {
+            entry = nn_dist_pop (self, data);
+            nn_list_item_term (&entry->item);
+            nn_msg_term (&entry->msg);
+            nn_free (entry);
+            nn_dist_drop (self, data);
+        }
+        break;
+    default:
+        nn_assert (data->policy == NN_SNDQUEUE_DROP_NEWEST);
+        if (nn_dist_nofit (data, sz)) {
+            nn_dist_drop (self, data);
+            return;
+        }
+        break;
+    }
+
+    entry = nn_alloc (sizeof (struct nn_dist_entry), "dist backlog");
+    alloc_assert (entry);
+    nn_list_item_init (&entry->item);
+    nn_msg_cp (&entry->msg, msg);
+    nn_dist_push (self, data, entry);
+
+    if (data->policy == NN_SNDQUEUE_BLOCK && nn_dist_atlimit (data)) {
+        data->full = 1;
+        ++self->full;
+    }
+}
+
+static void nn_dist_conflate_msg (struct nn_dist *self,
+    struct nn_dist_data *data, struct nn_msg *msg)
+{
+    struct nn_list_item *it;
+    struct nn_dist_entry *entry;
+    size_t keylen;
+    size_t sz;
+
+    keylen = nn_chunkref_size (&msg->body);
+    if (keylen > (size_t) self->lvckeylen)
+        keylen = (size_t) self->lvckeylen;
+
+    /*  If there's an unsent message with the same topic, replace it.
+        The number of topics is bounded by 'lvcmax' so a linear scan
+        is acceptable here. */
+    for (it = nn_list_begin (&data->backlog);
+          it != nn_list_end (&data->backlog);
+          it = nn_list_next (&data->backlog, it)) {
+        entry = nn_cont (it, struct nn_dist_entry, item);
+        sz = nn_chunkref_size (&entry->msg.body);
+        if (sz > (size_t) self->lvckeylen)
+            sz = (size_t) self->lvckeylen;
+        if (sz == keylen && memcmp (nn_chunkref_data (&entry->msg.body),
+              nn_chunkref_data (&msg->body), keylen) == 0) {
+            sz = nn_dist_msgsize (&entry->msg);
+            data->backlogsz -= sz;
+            self->queued -= (int64_t) sz;
+            nn_msg_term (&entry->msg);
+            nn_msg_cp (&entry->msg, msg);
+            sz = nn_dist_msgsize (&entry->msg);
+            data->backlogsz += sz;
+            self->queued += (int64_t) sz;
+            nn_dist_drop (self, data);
+            return;
+        }
+    }
+
+    /*  New topic. If the cache is full, evict the oldest entry to make
+        room for it. */
+    if (data->backlogcnt >= (uint32_t) self->lvcmax) {
+        entry = nn_dist_pop (self, data);
+        nn_msg_term (&entry->msg);
+        nn_dist_drop (self, data);
+    }
+    else {
+        entry = nn_alloc (sizeof (struct nn_dist_entry), "dist backlog");
+        alloc_assert (entry);
+        nn_list_item_init (&entry->item);
+    }
+    nn_msg_cp (&entry->msg, msg);
+    nn_dist_push (self, data, entry);
+}
+
+static void nn_dist_drop (struct nn_dist *self, struct nn_dist_data *data)
+{
+    ++self->dropped;
+    ++data->dropped;
+    nn_pipe_dropped (data->pipe);
+}
@@ -30,13 +30,65 @@
 /*  Distributor. Sends messages to all the pipes. */
 
 struct nn_dist_data {
+
+    /*  Item in the list of pipes that are ready for sending. */
     struct nn_list_item item;
+
+    /*  Item in the list of all the pipes attached to the distributor. */
+    struct nn_list_item all;
+
     struct nn_pipe *pipe;
+
+    /*  Messages waiting for the pipe to become writable, oldest first.
+        Unless conflation or a send queue is enabled this list is always
+        empty. 'backlogsz' is the total size of the queued messages in
+        bytes. */
+    struct nn_list backlog;
+    uint32_t backlogcnt;
+    size_t backlogsz;
+
+    /*  Send queue limits, as set by NN_SNDQUEUE_* socket options at the time
+        the pipe was attached. Zero means there's no limit. If both limits
+        are zero, the pipe has no send queue. */
+    int maxmsgs;
+    int maxbytes;
+    int policy;
+
+    /*  Set if the pipe uses NN_SNDQUEUE_BLOCK policy and its queue is full. */
+    int full;
+
+    /*  Number of messages the pipe has missed, whether because of the
+        queue limits, conflation or because they were still queued when
+        the pipe was removed. */
+    uint64_t dropped;
 };
 
 struct nn_dist {
     uint32_t count;
     struct nn_list pipes;
+    struct nn_list all;
+
+    /*  Conflation settings. If 'lvcmax' is non-zero, messages sent while
+        a pipe is not writable are kept in the pipe's backlog, keyed by the
+        first 'lvckeylen' bytes of the body. A newer message replaces an older
+        unsent one with the same key, and at most 'lvcmax' distinct keys are
+        kept per pipe. */
+    int lvcmax;
+    int lvckeylen;
+
+    /*  Number of pipes attached to the distributor. */
+    uint32_t total;
+
+    /*  Number of pipes with NN_SNDQUEUE_BLOCK policy that have a full
+        queue. While it's non-zero, no messages can be sent. */
+    uint32_t full;
+
+    /*  Number of messages dropped since the last call to nn_dist_stats. */
+    uint32_t dropped;
+
+    /*  Change of the total size of the backlogs since the last call to
+        nn_dist_stats. */
+    int64_t queued;
 };
 
 void nn_dist_init (struct nn_dist *self);
@@ -44,11 +96,31 @@ void nn_dist_term (struct nn_dist *self);
 void nn_dist_add (struct nn_dist *self, 
     struct nn_dist_data *data, struct nn_pipe *pipe);
 void nn_dist_rm (struct nn_dist *self, struct nn_dist_data *data);
+
+/*  Marks the pipe as writable. If there are any messages in the pipe's backlog
+    they are sent first. */
 void nn_dist_out (struct nn_dist *self, struct nn_dist_data *data);
 
+/*  Sets up the last-value cache for pipes that are not writable. 'maxtopics'
+    of zero disables the conflation. Backlogs longer than 'maxtopics' are
+    trimmed immediately, the oldest messages being counted as dropped. */
+void nn_dist_conflate (struct nn_dist *self, int maxtopics, int keylen);
+
+/*  Returns 1 if a message can be sent at the moment, 0 otherwise. Sending
+    is only ever prevented by a full NN_SNDQUEUE_BLOCK queue. */
+int nn_dist_can_send (struct nn_dist *self);
+
+/*  Adds the number of messages discarded and the change of the size of
+    the pipes' backlogs since the last call to NN_STAT_DROPPED_MESSAGES and
+    NN_STAT_QUEUED_BYTES statistics of the socket. Per-pipe totals are kept
+    in nn_dist_data. */
+void nn_dist_stats (struct nn_dist *self, struct nn_sockbase *sockbase);
+
 /*  Sends the message to all the attached pipes except the one specified
     by 'exclude' parameter. If 'exclude' is NULL, message is sent to all
-    attached pipes. */
+    attached pipes. Pipes that are not writable get the message queued,
+    conflated or dropped, depending on the settings. Returns -EAGAIN if
+    nn_dist_can_send would return 0; the message is left untouched then. */
 int nn_dist_send (struct nn_dist *self, struct nn_msg *msg,
     struct nn_pipe *exclude);
 
@@ -31,6 +31,8 @@ void nn_excl_init (struct nn_excl *self)
     self->pipe = NULL;
     self->inpipe = NULL;
     self->outpipe = NULL;
+    self->more = 0;
+    self->broken = 0;
 }
 
 void nn_excl_term (struct nn_excl *self)
@@ -58,6 +60,12 @@ void nn_excl_rm (struct nn_excl *self, NN_UNUSED struct nn_pipe *pipe)
    self->pipe = NULL;
    self->inpipe = NULL;
    self->outpipe = NULL;
+
+   /*  The rest of the fragmented message is lost. */
+   if (nn_slow (self->more)) {
+       self->more = 0;
+       self->broken = 1;
+   }
 }
 
 void nn_excl_in (struct nn_excl *self, struct nn_pipe *pipe)
@@ -93,15 +101,30 @@ int nn_excl_send (struct nn_excl *self, struct nn_msg *msg)
 int nn_excl_recv (struct nn_excl *self, struct nn_msg *msg)
 {
     int rc;
+    struct nn_pipe *pipe;
 
-    if (nn_slow (!self->inpipe))
-        return -EAGAIN;
+    /*  Report the fragmented message cut short by a disconnection. */
+    if (nn_slow (self->broken)) {
+        self->broken = 0;
+        return -ECONNRESET;
+    }
 
-    rc = nn_pipe_recv (self->inpipe, msg);
-    errnum_assert (rc >= 0, -rc);
+    while (1) {
+        if (nn_slow (!self->inpipe))
+            return -EAGAIN;
 
-    if (rc & NN_PIPE_RELEASE)
-        self->inpipe = NULL;
+        pipe = self->inpipe;
+        rc = nn_pipe_recv (pipe, msg);
+        errnum_assert (rc >= 0, -rc);
+
+        if (rc & NN_PIPE_RELEASE)
+            self->inpipe = NULL;
+
+        /*  Messages that have passed their deadline are silently dropped. */
+        if (nn_fast (!nn_pipe_expired (pipe, msg)))
+            break;
+    }
+    self->more = nn_msg_more (msg);
 
     return rc & ~NN_PIPE_RELEASE;
 }
@@ -113,6 +136,6 @@ int nn_excl_can_send (struct nn_excl *self)
 
 int nn_excl_can_recv (struct nn_excl *self)
 {
-    return self->inpipe ? 1 : 0;
+    return self->inpipe || self->broken ? 1 : 0;
 }
 
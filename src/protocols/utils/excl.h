@@ -42,6 +42,13 @@ struct nn_excl {
     /*  Pipe ready for sending. It's either equal to 'pipe' or NULL. */
     struct nn_pipe *outpipe;
 
+    /*  1 if the last message received was followed by further fragments. */
+    int more;
+
+    /*  Set to 1 when the pipe goes away before the last fragment arrives.
+        The next receive fails with ECONNRESET. */
+    int broken;
+
 };
 
 void nn_excl_init (struct nn_excl *self);
@@ -24,12 +24,20 @@
 
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
+#include "../../utils/fast.h"
 
 #include <stddef.h>
 
+static int nn_fq_recv_locked (struct nn_fq *self, struct nn_msg *msg,
+    struct nn_pipe **pipe);
+
 void nn_fq_init (struct nn_fq *self)
 {
     nn_priolist_init (&self->priolist);
+    self->locked = NULL;
+    self->lockedin = 0;
+    self->broken = 0;
+    self->dropped = 0;
 }
 
 void nn_fq_term (struct nn_fq *self)
@@ -41,40 +49,85 @@ void nn_fq_add (struct nn_fq *self, struct nn_fq_data *data,
     struct nn_pipe *pipe, int priority)
 {
     nn_priolist_add (&self->priolist, &data->priodata, pipe, priority);
+    data->received = 0;
 }
 
 void nn_fq_rm (struct nn_fq *self, struct nn_fq_data *data)
 {
+    /*  The rest of the fragmented message is lost. */
+    if (nn_slow (self->locked == &data->priodata)) {
+        self->locked = NULL;
+        self->lockedin = 0;
+        self->broken = 1;
+    }
     nn_priolist_rm (&self->priolist, &data->priodata);
 }
 
 void nn_fq_in (struct nn_fq *self, struct nn_fq_data *data)
 {
+    if (nn_slow (self->locked == &data->priodata)) {
+        self->lockedin = 1;
+        return;
+    }
     nn_priolist_activate (&self->priolist, &data->priodata);
 }
 
 int nn_fq_can_recv (struct nn_fq *self)
 {
+    if (nn_slow (self->broken))
+        return 1;
+    if (nn_slow (self->locked != NULL))
+        return self->lockedin;
     return nn_priolist_is_active (&self->priolist);
 }
 
 int nn_fq_recv (struct nn_fq *self, struct nn_msg *msg, struct nn_pipe **pipe)
 {
     int rc;
-    struct nn_pipe *p;
-
-    /*  Pipe is NULL only when there are no avialable pipes. */
-    p = nn_priolist_getpipe (&self->priolist);
-    if (nn_slow (!p))
-        return -EAGAIN;
-
-    /*  Receive the messsage. */
-    rc = nn_pipe_recv (p, msg);
-    errnum_assert (rc >= 0, -rc);
+    struct nn_priolist_data *data;
+
+    /*  Report the fragmented message cut short by a disconnection. */
+    if (nn_slow (self->broken)) {
+        self->broken = 0;
+        return -ECONNRESET;
+    }
+
+    /*  Finish the fragmented message first. */
+    if (nn_slow (self->locked != NULL))
+        return nn_fq_recv_locked (self, msg, pipe);
+
+    while (1) {
+
+        /*  Data is NULL only when there are no avialable pipes. */
+        data = nn_priolist_getdata (&self->priolist);
+        if (nn_slow (!data))
+            return -EAGAIN;
+
+        /*  Receive the messsage. */
+        rc = nn_pipe_recv (data->pipe, msg);
+        errnum_assert (rc >= 0, -rc);
+        if (nn_fast (!nn_msg_more (msg)))
+            ++nn_cont (data, struct nn_fq_data, priodata)->received;
+
+        /*  Messages that have passed their deadline are silently dropped. */
+        if (nn_fast (!nn_pipe_expired (data->pipe, msg)))
+            break;
+        self->dropped = 1;
+        nn_priolist_advance (&self->priolist, rc & NN_PIPE_RELEASE);
+    }
 
     /*  Return the pipe data to the user, if required. */
     if (pipe)
-        *pipe = p;
+        *pipe = data->pipe;
+
+    /*  If the message is followed by further fragments, don't read from
+        other pipes until all of them are received. */
+    if (nn_slow (nn_msg_more (msg))) {
+        self->locked = data;
+        self->lockedin = rc & NN_PIPE_RELEASE ? 0 : 1;
+        nn_priolist_advance (&self->priolist, 1);
+        return rc & ~NN_PIPE_RELEASE;
+    }
 
     /*  Move to the next pipe. */
     nn_priolist_advance (&self->priolist, rc & NN_PIPE_RELEASE);
@@ -82,3 +135,33 @@ int nn_fq_recv (struct nn_fq *self, struct nn_msg *msg, struct nn_pipe **pipe)
     return rc & ~NN_PIPE_RELEASE;
 }
 
+static int nn_fq_recv_locked (struct nn_fq *self, struct nn_msg *msg,
+    struct nn_pipe **pipe)
+{
+    int rc;
+    struct nn_priolist_data *data;
+
+    if (!self->lockedin)
+        return -EAGAIN;
+
+    data = self->locked;
+    rc = nn_pipe_recv (data->pipe, msg);
+    errnum_assert (rc >= 0, -rc);
+    if (pipe)
+        *pipe = data->pipe;
+    if (rc & NN_PIPE_RELEASE)
+        self->lockedin = 0;
+
+    /*  Once the last fragment is received, return the pipe to the list. */
+    if (!nn_msg_more (msg)) {
+        ++nn_cont (data, struct nn_fq_data, priodata)->received;
+        self->locked = NULL;
+        if (self->lockedin) {
+            self->lockedin = 0;
+            nn_priolist_activate (&self->priolist, data);
+        }
+    }
+
+    return rc & ~NN_PIPE_RELEASE;
+}
+
@@ -27,15 +27,37 @@
 
 #include "priolist.h"
 
+#include <stdint.h>
+
 /*  Fair-queuer. Retrieves messages from a set of pipes in round-robin
     manner. */
 
 struct nn_fq_data {
     struct nn_priolist_data priodata;
+
+    /*  Number of messages taken from the pipe so far, including those
+        dropped because they've passed their deadline. */
+    uint32_t received;
 };
 
 struct nn_fq {
     struct nn_priolist priolist;
+
+    /*  Pipe in the middle of delivering a fragmented message, if any. It's
+        taken out of the priolist and no other pipe is read from until the
+        last fragment arrives. 'lockedin' is 1 if the pipe has a fragment
+        available. */
+    struct nn_priolist_data *locked;
+    int lockedin;
+
+    /*  Set to 1 when the locked pipe goes away before the last fragment
+        arrives. The next receive fails with ECONNRESET so that the user
+        doesn't take the next message for the rest of the broken one. */
+    int broken;
+
+    /*  Set to 1 when a message is dropped because it has passed its
+        deadline. It's up to the user to reset it. */
+    int dropped;
 };
 
 void nn_fq_init (struct nn_fq *self);
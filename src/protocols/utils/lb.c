@@ -24,6 +24,7 @@
 
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
+#include "../../utils/fast.h"
 
 #include <stddef.h>
 
@@ -41,6 +42,8 @@ void nn_lb_add (struct nn_lb *self, struct nn_lb_data *data,
     struct nn_pipe *pipe, int priority)
 {
     nn_priolist_add (&self->priolist, &data->priodata, pipe, priority);
+    data->writable = 0;
+    data->held = 0;
 }
 
 void nn_lb_rm (struct nn_lb *self, struct nn_lb_data *data)
@@ -50,9 +53,30 @@ void nn_lb_rm (struct nn_lb *self, struct nn_lb_data *data)
 
 void nn_lb_out (struct nn_lb *self, struct nn_lb_data *data)
 {
+    data->writable = 1;
+    if (nn_slow (data->held))
+        return;
     nn_priolist_activate (&self->priolist, &data->priodata);
 }
 
+void nn_lb_hold (struct nn_lb *self, struct nn_lb_data *data)
+{
+    if (data->held)
+        return;
+    data->held = 1;
+    if (data->writable)
+        nn_priolist_deactivate (&self->priolist, &data->priodata);
+}
+
+void nn_lb_unhold (struct nn_lb *self, struct nn_lb_data *data)
+{
+    if (!data->held)
+        return;
+    data->held = 0;
+    if (data->writable)
+        nn_priolist_activate (&self->priolist, &data->priodata);
+}
+
 int nn_lb_can_send (struct nn_lb *self)
 {
     return nn_priolist_is_active (&self->priolist);
@@ -66,23 +90,46 @@ int nn_lb_get_priority (struct nn_lb *self)
 int nn_lb_send (struct nn_lb *self, struct nn_msg *msg, struct nn_pipe **to)
 {
     int rc;
-    struct nn_pipe *pipe;
+    struct nn_priolist_data *data;
 
-    /*  Pipe is NULL only when there are no avialable pipes. */
-    pipe = nn_priolist_getpipe (&self->priolist);
-    if (nn_slow (!pipe))
+    /*  Data is NULL only when there are no avialable pipes. */
+    data = nn_priolist_getdata (&self->priolist);
+    if (nn_slow (!data))
         return -EAGAIN;
 
     /*  Send the messsage. */
-    rc = nn_pipe_send (pipe, msg);
+    rc = nn_pipe_send (data->pipe, msg);
     errnum_assert (rc >= 0, -rc);
 
     /*  Move to the next pipe. */
+    if (rc & NN_PIPE_RELEASE)
+        nn_cont (data, struct nn_lb_data, priodata)->writable = 0;
     nn_priolist_advance (&self->priolist, rc & NN_PIPE_RELEASE);
 
     if (to != NULL)
-        *to = pipe;
+        *to = data->pipe;
 
     return rc & ~NN_PIPE_RELEASE;
 }
 
+int nn_lb_send_except (struct nn_lb *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to)
+{
+    struct nn_pipe *pipe;
+    int priority;
+
+    /*  Skip the excluded pipe if it's the next one in the round-robin. */
+    pipe = nn_priolist_getpipe (&self->priolist);
+    if (nn_slow (!pipe))
+        return -EAGAIN;
+    if (pipe == except) {
+        priority = nn_priolist_get_priority (&self->priolist);
+        nn_priolist_advance (&self->priolist, 0);
+        pipe = nn_priolist_getpipe (&self->priolist);
+        if (pipe == except ||
+              nn_priolist_get_priority (&self->priolist) != priority)
+            return -EAGAIN;
+    }
+
+    return nn_lb_send (self, msg, to);
+}
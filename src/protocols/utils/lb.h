@@ -31,6 +31,13 @@
 
 struct nn_lb_data {
     struct nn_priolist_data priodata;
+
+    /*  1 if the pipe can accept a message at the moment. */
+    int writable;
+
+    /*  1 if the user asked not to send to the pipe, even though it may be
+        writable. See nn_lb_hold. */
+    int held;
 };
 
 struct nn_lb {
@@ -43,8 +50,21 @@ void nn_lb_add (struct nn_lb *self, struct nn_lb_data *data,
     struct nn_pipe *pipe, int priority);
 void nn_lb_rm (struct nn_lb *self, struct nn_lb_data *data);
 void nn_lb_out (struct nn_lb *self, struct nn_lb_data *data);
+
+/*  Stops sending messages to the pipe until nn_lb_unhold is called,
+    irrespective of whether the pipe is writable. Protocols use this to
+    implement their own flow control on top of the one done by pipes. */
+void nn_lb_hold (struct nn_lb *self, struct nn_lb_data *data);
+void nn_lb_unhold (struct nn_lb *self, struct nn_lb_data *data);
+
 int nn_lb_can_send (struct nn_lb *self);
 int nn_lb_get_priority (struct nn_lb *self);
 int nn_lb_send (struct nn_lb *self, struct nn_msg *msg, struct nn_pipe **to);
 
+/*  Same as nn_lb_send, but never sends the message to 'except' pipe. Only
+    the pipes with the highest priority currently available are considered.
+    Returns -EAGAIN if there's no other such pipe. */
+int nn_lb_send_except (struct nn_lb *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to);
+
 #endif
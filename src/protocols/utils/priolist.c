@@ -134,6 +134,13 @@ void nn_priolist_activate (struct nn_priolist *self,
     /*  Current doesn't change otherwise. */
 }
 
+void nn_priolist_deactivate (struct nn_priolist *self,
+    struct nn_priolist_data *data)
+{
+    nn_priolist_rm (self, data);
+    nn_list_item_init (&data->item);
+}
+
 int nn_priolist_is_active (struct nn_priolist *self)
 {
     return self->current == -1 ? 0 : 1;
@@ -146,6 +153,13 @@ struct nn_pipe *nn_priolist_getpipe (struct nn_priolist *self)
     return self->slots [self->current - 1].current->pipe;
 }
 
+struct nn_priolist_data *nn_priolist_getdata (struct nn_priolist *self)
+{
+    if (nn_slow (self->current == -1))
+        return NULL;
+    return self->slots [self->current - 1].current;
+}
+
 void nn_priolist_advance (struct nn_priolist *self, int release)
 {
     struct nn_priolist_slot *slot;
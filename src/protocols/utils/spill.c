@@ -0,0 +1,289 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "spill.h"
+
+#include "../../utils/err.h"
+#include "../../utils/fast.h"
+#include "../../utils/alloc.h"
+#include "../../utils/chunk.h"
+#include "../../utils/chunkref.h"
+#include "../../utils/wire.h"
+
+#include <string.h>
+
+#if !defined NN_HAVE_WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+/*  Each record starts with the sizes of the SP header, the transport-level
+    headers and the body, followed by a reserved word. The data follow in
+    that order and the record is padded to the multiple of 8 bytes. A record
+    whose first word is NN_SPILL_WRAP means that the rest of the file is
+    unused and the next record is at the beginning of the file. */
+#define NN_SPILL_RECHDR 16
+#define NN_SPILL_WRAP 0xffffffff
+
+#define nn_spill_align(sz) (((sz) + 7) & ~((size_t) 7))
+
+void nn_spill_init (struct nn_spill *self)
+{
+    self->fd = -1;
+    self->map = NULL;
+    self->size = 0;
+    self->path = NULL;
+    self->head = 0;
+    self->tail = 0;
+    self->count = 0;
+    self->bytes = 0;
+    self->full = 0;
+}
+
+void nn_spill_term (struct nn_spill *self)
+{
+    nn_spill_close (self);
+}
+
+int nn_spill_open (struct nn_spill *self, const char *path, size_t pathlen,
+    size_t size)
+{
+#if defined NN_HAVE_WINDOWS
+    return -ENOTSUP;
+#else
+    int rc;
+    int fd;
+    int flags;
+    void *map;
+    char *p;
+
+    nn_assert (self->map == NULL);
+    nn_assert (size >= NN_SPILL_MINSIZE);
+    size &= ~((size_t) 7);
+
+    p = nn_alloc (pathlen + 1, "spill path");
+    alloc_assert (p);
+    memcpy (p, path, pathlen);
+    p [pathlen] = 0;
+
+    flags = O_RDWR | O_CREAT | O_TRUNC;
+#ifdef O_CLOEXEC
+    flags |= O_CLOEXEC;
+#endif
+    fd = open (p, flags, 0600);
+    if (nn_slow (fd < 0)) {
+        rc = -errno;
+        nn_free (p);
+        return rc;
+    }
+
+    /*  Allocate the disk space up front. Running out of it while writing
+        to a sparse mapping would kill the process with SIGBUS. */
+#if defined NN_HAVE_POSIX_FALLOCATE
+    rc = posix_fallocate (fd, 0, size);
+    if (nn_slow (rc != 0)) {
+        rc = -rc;
+        goto error;
+    }
+#else
+    if (nn_slow (ftruncate (fd, size) < 0)) {
+        rc = -errno;
+        goto error;
+    }
+#endif
+
+    map = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (nn_slow (map == MAP_FAILED)) {
+        rc = -errno;
+        goto error;
+    }
+#if defined MADV_SEQUENTIAL
+    madvise (map, size, MADV_SEQUENTIAL);
+#endif
+
+    self->fd = fd;
+    self->map = map;
+    self->size = size;
+    self->path = p;
+    return 0;
+
+error:
+    close (fd);
+    unlink (p);
+    nn_free (p);
+    return rc;
+#endif
+}
+
+int nn_spill_close (struct nn_spill *self)
+{
+    int dropped;
+
+    dropped = self->count;
+#if !defined NN_HAVE_WINDOWS
+    if (self->map) {
+        munmap (self->map, self->size);
+        close (self->fd);
+        unlink (self->path);
+        nn_free (self->path);
+    }
+#endif
+    nn_spill_init (self);
+
+    return dropped;
+}
+
+const char *nn_spill_path (struct nn_spill *self)
+{
+    return self->path ? self->path : "";
+}
+
+int nn_spill_active (struct nn_spill *self)
+{
+    return self->map ? 1 : 0;
+}
+
+int nn_spill_empty (struct nn_spill *self)
+{
+    return self->map && self->count == 0 ? 1 : 0;
+}
+
+int nn_spill_can_put (struct nn_spill *self)
+{
+    return self->map && !self->full ? 1 : 0;
+}
+
+int nn_spill_put (struct nn_spill *self, struct nn_msg *msg)
+{
+    size_t sphdrsz;
+    size_t hdrssz;
+    size_t bodysz;
+    size_t recsz;
+    uint8_t *pos;
+    int rc;
+
+    nn_assert (self->map);
+
+    /*  Body parts, including those referring to files, are stored inline. */
+    rc = nn_msg_flatten (msg);
+    if (nn_slow (rc < 0))
+        return rc;
+
+    sphdrsz = nn_chunkref_size (&msg->sphdr);
+    hdrssz = nn_msg_hdrssize (msg);
+    bodysz = nn_chunkref_size (&msg->body);
+    recsz = nn_spill_align (NN_SPILL_RECHDR + sphdrsz + hdrssz + bodysz);
+
+    /*  Find the place for the record. If the spill is empty, start from
+        the beginning of the file to avoid wrapping around needlessly. */
+    if (self->count == 0) {
+        self->head = 0;
+        self->tail = 0;
+    }
+    else if (self->tail == self->head)
+        goto full;
+    if (self->tail >= self->head) {
+        if (self->tail + recsz > self->size) {
+            if (recsz > self->head)
+                goto full;
+            if (self->tail + NN_SPILL_RECHDR <= self->size)
+                nn_putl (self->map + self->tail, NN_SPILL_WRAP);
+            self->tail = 0;
+        }
+    }
+    else if (self->tail + recsz > self->head)
+        goto full;
+
+    pos = self->map + self->tail;
+    nn_putl (pos, (uint32_t) sphdrsz);
+    nn_putl (pos + 4, (uint32_t) hdrssz);
+    nn_putl (pos + 8, (uint32_t) bodysz);
+    nn_putl (pos + 12, 0);
+    pos += NN_SPILL_RECHDR;
+    memcpy (pos, nn_chunkref_data (&msg->sphdr), sphdrsz);
+    pos += sphdrsz;
+    if (hdrssz)
+        memcpy (pos, msg->hdrs, hdrssz);
+    pos += hdrssz;
+    memcpy (pos, nn_chunkref_data (&msg->body), bodysz);
+
+    self->tail += recsz;
+    ++self->count;
+    self->bytes += sphdrsz + bodysz;
+    nn_msg_term (msg);
+
+    return 0;
+
+full:
+    self->full = 1;
+    return -EAGAIN;
+}
+
+int nn_spill_get (struct nn_spill *self, struct nn_msg *msg)
+{
+    int rc;
+    size_t sphdrsz;
+    size_t hdrssz;
+    size_t bodysz;
+    uint8_t *pos;
+    void *hdrs;
+
+    if (nn_slow (self->count == 0))
+        return -EAGAIN;
+
+    if (self->head + NN_SPILL_RECHDR > self->size ||
+          nn_getl (self->map + self->head) == NN_SPILL_WRAP)
+        self->head = 0;
+
+    pos = self->map + self->head;
+    sphdrsz = nn_getl (pos);
+    hdrssz = nn_getl (pos + 4);
+    bodysz = nn_getl (pos + 8);
+    pos += NN_SPILL_RECHDR;
+
+    nn_msg_init (msg, bodysz);
+    nn_chunkref_term (&msg->sphdr);
+    nn_chunkref_init (&msg->sphdr, sphdrsz);
+    memcpy (nn_chunkref_data (&msg->sphdr), pos, sphdrsz);
+    pos += sphdrsz;
+    if (hdrssz) {
+        rc = nn_chunk_alloc (hdrssz, 0, &hdrs);
+        errnum_assert (rc == 0, -rc);
+        memcpy (hdrs, pos, hdrssz);
+        nn_msg_sethdrs (msg, hdrs);
+    }
+    pos += hdrssz;
+    memcpy (nn_chunkref_data (&msg->body), pos, bodysz);
+
+    self->head += nn_spill_align (NN_SPILL_RECHDR + sphdrsz + hdrssz + bodysz);
+    --self->count;
+    self->bytes -= sphdrsz + bodysz;
+    self->full = 0;
+
+    return 0;
+}
+
+void nn_spill_retry (struct nn_spill *self)
+{
+    self->full = 0;
+}
@@ -0,0 +1,104 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_SPILL_INCLUDED
+#define NN_SPILL_INCLUDED
+
+#include "../../utils/msg.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  The smallest and the default size of the spill file. */
+#define NN_SPILL_MINSIZE 4096
+#define NN_SPILL_DEFSIZE (64 * 1024 * 1024)
+
+/*  Spill queue. Holds messages that can't be sent at the moment in a file
+    mapped into memory, so that a socket can absorb a long outage of its
+    peers without growing its heap. The file is used as a ring of
+    length-prefixed records that are written and read strictly in order. */
+
+struct nn_spill {
+
+    /*  The spill file and its mapping, or -1 and NULL if the spill is not
+        in use. 'path' is the name the file was created under. */
+    int fd;
+    uint8_t *map;
+    size_t size;
+    char *path;
+
+    /*  Offsets of the oldest record and of the place where the next record
+        will be written. */
+    size_t head;
+    size_t tail;
+
+    /*  Number of messages in the spill and their total size in bytes. */
+    uint32_t count;
+    size_t bytes;
+
+    /*  Set when a message didn't fit. Cleared once a message is taken out of
+        the spill or nn_spill_retry is called. */
+    int full;
+};
+
+void nn_spill_init (struct nn_spill *self);
+void nn_spill_term (struct nn_spill *self);
+
+/*  Creates the spill file of the specified size, replacing any existing file
+    with the same name. The name is 'pathlen' bytes long and doesn't have to
+    be zero-terminated. The spill must not be in use at the moment. Returns
+    zero or a negative error code. */
+int nn_spill_open (struct nn_spill *self, const char *path, size_t pathlen,
+    size_t size);
+
+/*  Removes the spill file and discards the messages stored in it. Returns
+    number of discarded messages. */
+int nn_spill_close (struct nn_spill *self);
+
+/*  Returns name of the spill file or an empty string if there's none. */
+const char *nn_spill_path (struct nn_spill *self);
+
+/*  Returns 1 if the spill file is open, 0 otherwise. */
+int nn_spill_active (struct nn_spill *self);
+
+/*  Returns 1 if the spill is open and holds no messages. */
+int nn_spill_empty (struct nn_spill *self);
+
+/*  Returns 1 if the spill is able to accept messages at the moment. */
+int nn_spill_can_put (struct nn_spill *self);
+
+/*  Stores the message at the end of the spill. The message is terminated on
+    success. If there's not enough space left -EAGAIN is returned and the
+    message is left untouched. The same happens with other errors, e.g. when
+    the message refers to a file that can't be read any more. */
+int nn_spill_put (struct nn_spill *self, struct nn_msg *msg);
+
+/*  Takes the oldest message out of the spill. Returns -EAGAIN if the spill
+    is empty. */
+int nn_spill_get (struct nn_spill *self, struct nn_msg *msg);
+
+/*  Lets nn_spill_can_put report the spill as available again after a message
+    that didn't fit. Used when the caller's situation has changed, e.g. when
+    a peer has become available. */
+void nn_spill_retry (struct nn_spill *self);
+
+#endif
@@ -35,6 +35,11 @@ extern "C" {
 #define NN_SUB_SUBSCRIBE 1
 #define NN_SUB_UNSUBSCRIBE 2
 
+#define NN_PUB_CONFLATE 1
+#define NN_PUB_CONFLATE_KEYLEN 2
+#define NN_PUB_SPILL_FILE 3
+#define NN_PUB_SPILL_SIZE 4
+
 #ifdef __cplusplus
 }
 #endif
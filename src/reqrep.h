@@ -36,6 +36,16 @@ extern "C" {
 #define NN_REP (NN_PROTO_REQREP * 16 + 1)
 
 #define NN_REQ_RESEND_IVL 1
+#define NN_REQ_HEDGE_IVL 2
+#define NN_REQ_HEDGE_PERCENTILE 3
+#define NN_REQ_HEDGE_RATIO 4
+#define NN_REQ_RESEND_IVL_US 5
+
+#define NN_REP_CONTEXTS 1
+
+/*  Ancillary property (level NN_REP) identifying the request a message
+    belongs to. The data is a uint32_t. */
+#define NN_REP_CONTEXT 2
 
 typedef union nn_req_handle {
     int i;
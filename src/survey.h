@@ -37,6 +37,7 @@ extern "C" {
 #define NN_RESPONDENT (NN_PROTO_SURVEY * 16 + 3)
 
 #define NN_SURVEYOR_DEADLINE 1
+#define NN_SURVEYOR_DEADLINE_US 2
 
 #ifdef __cplusplus
 }
@@ -30,6 +30,10 @@ extern "C" {
 #define NN_TCP -3
 
 #define NN_TCP_NODELAY 1
+#define NN_TCP_HEARTBEAT_IVL 2
+#define NN_TCP_HEARTBEAT_MISSES 3
+#define NN_TCP_USER_TIMEOUT 4
+#define NN_TCP_CONNECT_DELAY 5
 
 #ifdef __cplusplus
 }
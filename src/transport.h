@@ -166,6 +166,20 @@ struct nn_pipebase {
     struct nn_fsm_event in;
     struct nn_fsm_event out;
     struct nn_ep_options options;
+    size_t maxsz;
+    int gather;
+    int sendfile;
+
+    /*  Item in the socket's list of pipes, ID of the endpoint the pipe
+        belongs to and the traffic it has carried or missed. Used by
+        nn_get_snapshot. */
+    struct nn_list_item item;
+    int eid;
+    uint64_t messages_sent;
+    uint64_t messages_received;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint64_t messages_dropped;
 };
 
 /*  Initialise the pipe.  */
@@ -175,6 +189,21 @@ void nn_pipebase_init (struct nn_pipebase *self,
 /*  Terminate the pipe. */
 void nn_pipebase_term (struct nn_pipebase *self);
 
+/*  Call this function before nn_pipebase_start if the pipe can't carry
+    messages larger than 'maxsz' bytes. While the pipe exists, sending
+    a larger message via the socket fails with EMSGSIZE. */
+void nn_pipebase_setmaxsz (struct nn_pipebase *self, size_t maxsz);
+
+/*  Call this function if the pipe is able to send messages whose body consists
+    of several parts (see nn_msg_addpart). Otherwise, such messages are copied
+    into a single buffer before being passed to the pipe. */
+void nn_pipebase_setgather (struct nn_pipebase *self);
+
+/*  Call this function in addition to nn_pipebase_setgather if the pipe is able
+    to send body parts that refer to files (see nn_chunk_alloc_file) straight
+    from the file. Otherwise, the file data is read into memory first. */
+void nn_pipebase_setsendfile (struct nn_pipebase *self);
+
 /*  Call this function once the connection is established. */
 int nn_pipebase_start (struct nn_pipebase *self);
 
@@ -25,6 +25,7 @@
 
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
+#include "../../utils/fast.h"
 #include "../../utils/attr.h"
 
 #include <stddef.h>
@@ -57,6 +58,7 @@ static void nn_sinproc_shutdown (struct nn_fsm *self, int src, int type,
 
 static int nn_sinproc_send (struct nn_pipebase *self, struct nn_msg *msg);
 static int nn_sinproc_recv (struct nn_pipebase *self, struct nn_msg *msg);
+static void nn_sinproc_queued (struct nn_sinproc *self);
 const struct nn_pipebase_vfptr nn_sinproc_pipebase_vfptr = {
     nn_sinproc_send,
     nn_sinproc_recv
@@ -78,6 +80,8 @@ void nn_sinproc_init (struct nn_sinproc *self, int src,
     nn_ep_getopt (ep, NN_SOL_SOCKET, NN_RCVBUF, &rcvbuf, &sz);
     nn_assert (sz == sizeof (rcvbuf));
     nn_msgqueue_init (&self->msgqueue, rcvbuf);
+    self->ep = ep;
+    self->queued = 0;
     nn_msg_init (&self->msg, 0);
     nn_fsm_event_init (&self->event_connect);
     nn_fsm_event_init (&self->event_sent);
@@ -94,6 +98,9 @@ void nn_sinproc_term (struct nn_sinproc *self)
     nn_fsm_event_term (&self->event_sent);
     nn_fsm_event_term (&self->event_connect);
     nn_msg_term (&self->msg);
+    if (self->queued > 0)
+        nn_ep_stat_increment (self->ep, NN_STAT_QUEUED_BYTES,
+            -(int) self->queued);
     nn_msgqueue_term (&self->msgqueue);
     nn_pipebase_term (&self->pipebase);
     nn_fsm_term (&self->fsm);
@@ -138,6 +145,8 @@ static int nn_sinproc_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
     struct nn_sinproc *sinproc;
     struct nn_msg nmsg;
+    uint32_t *deadline;
+    uint32_t at;
 
     sinproc = nn_cont (self, struct nn_sinproc, pipebase);
 
@@ -150,17 +159,33 @@ static int nn_sinproc_send (struct nn_pipebase *self, struct nn_msg *msg)
     nn_assert_state (sinproc, NN_SINPROC_STATE_ACTIVE);
     nn_assert (!(sinproc->flags & NN_SINPROC_FLAG_SENDING));
 
-    nn_msg_init (&nmsg,
-        nn_chunkref_size (&msg->sphdr) +
-        nn_chunkref_size (&msg->body));
-    memcpy (nn_chunkref_data (&nmsg.body),
-        nn_chunkref_data (&msg->sphdr),
-        nn_chunkref_size (&msg->sphdr));
-    memcpy ((char *)nn_chunkref_data (&nmsg.body) +
-        nn_chunkref_size (&msg->sphdr),
-        nn_chunkref_data (&msg->body),
-        nn_chunkref_size (&msg->body));
-    nn_msg_term (msg);
+    /*  The only header passed to the peer is the deadline of the message. */
+    deadline = nn_msg_getcmsg (msg, NN_SOL_SOCKET, NN_DEADLINE, sizeof (at));
+    if (nn_slow (deadline != NULL))
+        at = *deadline;
+
+    /*  Merge the SP header with the body. If the body has enough space in front
+        of it and isn't shared with anyone else, it's done in place. Otherwise,
+        the message has to be copied. */
+    if (nn_fast (nn_msg_prepend (msg, 0) != NULL)) {
+        nn_msg_mv (&nmsg, msg);
+        nn_msg_sethdrs (&nmsg, NULL);
+    }
+    else {
+        nn_msg_init (&nmsg,
+            nn_chunkref_size (&msg->sphdr) +
+            nn_chunkref_size (&msg->body));
+        memcpy (nn_chunkref_data (&nmsg.body),
+            nn_chunkref_data (&msg->sphdr),
+            nn_chunkref_size (&msg->sphdr));
+        memcpy ((char *)nn_chunkref_data (&nmsg.body) +
+            nn_chunkref_size (&msg->sphdr),
+            nn_chunkref_data (&msg->body),
+            nn_chunkref_size (&msg->body));
+        nn_msg_term (msg);
+    }
+    if (nn_slow (deadline != NULL))
+        nn_msg_setcmsg (&nmsg, NN_SOL_SOCKET, NN_DEADLINE, &at, sizeof (at));
 
     /*  Expose the message to the peer. */
     nn_msg_term (&sinproc->msg);
@@ -207,12 +232,24 @@ static int nn_sinproc_recv (struct nn_pipebase *self, struct nn_msg *msg)
         }
     }
 
+    nn_sinproc_queued (sinproc);
+
     if (!nn_msgqueue_empty (&sinproc->msgqueue))
        nn_pipebase_received (&sinproc->pipebase);
 
     return 0;
 }
 
+/*  Propagates change of the msgqueue size to the socket statistics. */
+static void nn_sinproc_queued (struct nn_sinproc *self)
+{
+    if (self->msgqueue.mem == self->queued)
+        return;
+    nn_ep_stat_increment (self->ep, NN_STAT_QUEUED_BYTES,
+        (int) self->msgqueue.mem - (int) self->queued);
+    self->queued = self->msgqueue.mem;
+}
+
 static void nn_sinproc_shutdown_events (struct nn_sinproc *self, int src,
     int type, NN_UNUSED void *srcptr)
 {
@@ -436,6 +473,7 @@ static void nn_sinproc_handler (struct nn_fsm *self, int src, int type,
                 }
                 errnum_assert (rc == 0, -rc);
                 nn_msg_init (&sinproc->peer->msg, 0);
+                nn_sinproc_queued (sinproc);
 
                 /*  Notify the user that there's a message to receive. */
                 if (empty)
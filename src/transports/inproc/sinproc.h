@@ -64,6 +64,11 @@ struct nn_sinproc {
         by the user later on. */
     struct nn_msgqueue msgqueue;
 
+    /*  Endpoint the connection belongs to and the size of msgqueue as last
+        reported to the socket's NN_STAT_QUEUED_BYTES statistic. */
+    struct nn_ep *ep;
+    size_t queued;
+
     /*  This message is the one being sent from this session to the peer
         session. It holds the data only temporarily, until the peer moves
         it to its msgqueue. */
@@ -68,6 +68,9 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_sipc_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
+static void nn_sipc_send_parts (struct nn_sipc *self, struct nn_iovec *iov,
+    int iovcnt);
+static void nn_sipc_recv_fragment (struct nn_sipc *self);
 
 void nn_sipc_init (struct nn_sipc *self, int src,
     struct nn_ep *ep, struct nn_fsm *owner)
@@ -80,10 +83,17 @@ void nn_sipc_init (struct nn_sipc *self, int src,
     self->usock_owner.src = -1;
     self->usock_owner.fsm = NULL;
     nn_pipebase_init (&self->pipebase, &nn_sipc_pipebase_vfptr, ep);
+    nn_pipebase_setgather (&self->pipebase);
+#if defined NN_HAVE_SENDFILE
+    nn_pipebase_setsendfile (&self->pipebase);
+#endif
     self->instate = -1;
     nn_msg_init (&self->inmsg, 0);
+    self->infragsz = 0;
+    self->inleft = 0;
     self->outstate = -1;
     nn_msg_init (&self->outmsg, 0);
+    self->outpart = 0;
     nn_fsm_event_init (&self->done);
 }
 
@@ -125,7 +135,10 @@ void nn_sipc_stop (struct nn_sipc *self)
 static int nn_sipc_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
     struct nn_sipc *sipc;
-    struct nn_iovec iov [3];
+    struct nn_iovec iov [3 + NN_MSG_MAXPARTS];
+    int iovcnt;
+    uint64_t sz;
+    uint8_t *hdr;
 
     sipc = nn_cont (self, struct nn_sipc, pipebase);
 
@@ -136,25 +149,79 @@ static int nn_sipc_send (struct nn_pipebase *self, struct nn_msg *msg)
     nn_msg_term (&sipc->outmsg);
     nn_msg_mv (&sipc->outmsg, msg);
 
-    /*  Serialise the message header. */
-    sipc->outhdr [0] = NN_SIPC_MSG_NORMAL;
-    nn_putll (sipc->outhdr + 1, nn_chunkref_size (&sipc->outmsg.sphdr) +
-        nn_chunkref_size (&sipc->outmsg.body));
+    sz = nn_chunkref_size (&sipc->outmsg.sphdr) +
+        nn_msg_bodysize (&sipc->outmsg);
+
+    /*  If possible, put the headers in front of the body and send it all
+        as a single buffer. */
+    hdr = nn_msg_prepend (&sipc->outmsg, sizeof (sipc->outhdr));
+    if (nn_fast (hdr != NULL)) {
+        hdr [0] = NN_SIPC_MSG_NORMAL;
+        nn_putll (hdr + 1, sz);
+        iov [0].iov_base = nn_chunkref_data (&sipc->outmsg.body);
+        iov [0].iov_len = nn_chunkref_size (&sipc->outmsg.body);
+        iovcnt = 1;
+    }
+    else {
+
+        /*  Serialise the message header. */
+        sipc->outhdr [0] = NN_SIPC_MSG_NORMAL;
+        nn_putll (sipc->outhdr + 1, sz);
+
+        iov [0].iov_base = sipc->outhdr;
+        iov [0].iov_len = sizeof (sipc->outhdr);
+        iov [1].iov_base = nn_chunkref_data (&sipc->outmsg.sphdr);
+        iov [1].iov_len = nn_chunkref_size (&sipc->outmsg.sphdr);
+        iov [2].iov_base = nn_chunkref_data (&sipc->outmsg.body);
+        iov [2].iov_len = nn_chunkref_size (&sipc->outmsg.body);
+        iovcnt = 3;
+    }
 
-    /*  Start async sending. */
-    iov [0].iov_base = sipc->outhdr;
-    iov [0].iov_len = sizeof (sipc->outhdr);
-    iov [1].iov_base = nn_chunkref_data (&sipc->outmsg.sphdr);
-    iov [1].iov_len = nn_chunkref_size (&sipc->outmsg.sphdr);
-    iov [2].iov_base = nn_chunkref_data (&sipc->outmsg.body);
-    iov [2].iov_len = nn_chunkref_size (&sipc->outmsg.body);
-    nn_usock_send (sipc->usock, iov, 3);
+    /*  Append the remaining parts of the body, if any, and start async
+        sending. */
+    sipc->outpart = 0;
+    nn_sipc_send_parts (sipc, iov, iovcnt);
 
     sipc->outstate = NN_SIPC_OUTSTATE_SENDING;
 
     return 0;
 }
 
+/*  Appends body parts of 'outmsg', starting with 'outpart', to the buffers
+    in 'iov' and sends them. A part referring to a file is sent on its own,
+    straight from the file, once the buffers preceding it are sent. */
+static void nn_sipc_send_parts (struct nn_sipc *self, struct nn_iovec *iov,
+    int iovcnt)
+{
+    void *chunk;
+#if defined NN_HAVE_SENDFILE
+    int fd;
+    uint64_t offset;
+#endif
+
+    if (self->outmsg.parts) {
+        while (self->outpart != self->outmsg.parts->nchunks) {
+            chunk = self->outmsg.parts->chunks [self->outpart];
+#if defined NN_HAVE_SENDFILE
+            if (nn_slow (nn_chunk_file (chunk, &fd, &offset))) {
+                if (iovcnt)
+                    break;
+                ++self->outpart;
+                nn_usock_sendfile (self->usock, fd, offset,
+                    nn_chunk_size (chunk));
+                return;
+            }
+#endif
+            iov [iovcnt].iov_base = chunk;
+            iov [iovcnt].iov_len = nn_chunk_size (chunk);
+            ++iovcnt;
+            ++self->outpart;
+        }
+    }
+
+    nn_usock_send (self->usock, iov, iovcnt);
+}
+
 static int nn_sipc_recv (struct nn_pipebase *self, struct nn_msg *msg)
 {
     struct nn_sipc *sipc;
@@ -168,6 +235,12 @@ static int nn_sipc_recv (struct nn_pipebase *self, struct nn_msg *msg)
     nn_msg_mv (msg, &sipc->inmsg);
     nn_msg_init (&sipc->inmsg, 0);
 
+    /*  Continue with the next fragment of a large message. */
+    if (sipc->inleft > 0) {
+        nn_sipc_recv_fragment (sipc);
+        return 0;
+    }
+
     /*  Start receiving new message. */
     sipc->instate = NN_SIPC_INSTATE_HDR;
     nn_usock_recv (sipc->usock, sipc->inhdr, sizeof (sipc->inhdr), NULL);
@@ -211,6 +284,7 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
     uint64_t size;
     int opt;
     size_t opt_sz = sizeof (opt);
+    struct nn_iovec iov [NN_MSG_MAXPARTS];
 
     sipc = nn_cont (self, struct nn_sipc, fsm);
 
@@ -317,8 +391,15 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_USOCK_SENT:
 
-                /*  The message is now fully sent. */
+                /*  Continue with the rest of the message, if any. */
                 nn_assert (sipc->outstate == NN_SIPC_OUTSTATE_SENDING);
+                if (nn_slow (sipc->outmsg.parts &&
+                      sipc->outpart != sipc->outmsg.parts->nchunks)) {
+                    nn_sipc_send_parts (sipc, iov, 0);
+                    return;
+                }
+
+                /*  The message is now fully sent. */
                 sipc->outstate = NN_SIPC_OUTSTATE_IDLE;
                 nn_msg_term (&sipc->outmsg);
                 nn_msg_init (&sipc->outmsg, 0);
@@ -345,6 +426,17 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                         return;
                     }
 
+                    /*  If requested, receive large messages in fragments
+                        rather than allocating memory for the whole message. */
+                    nn_pipebase_getopt (&sipc->pipebase, NN_SOL_SOCKET,
+                        NN_RCVFRAGSIZE, &opt, &opt_sz);
+                    if (opt > 0 && size > (unsigned)opt) {
+                        sipc->infragsz = (size_t) opt;
+                        sipc->inleft = size;
+                        nn_sipc_recv_fragment (sipc);
+                        return;
+                    }
+
                     /*  Allocate memory for the message. */
                     nn_msg_term (&sipc->inmsg);
                     nn_msg_init (&sipc->inmsg, (size_t) size);
@@ -436,3 +528,22 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
         nn_fsm_bad_state (sipc->state, src, type);
     }
 }
+
+/*  Starts receiving next fragment of a large message. All the fragments except
+    for the last one are marked by NN_RCVMORE. */
+static void nn_sipc_recv_fragment (struct nn_sipc *self)
+{
+    size_t sz;
+
+    sz = self->inleft < self->infragsz ? (size_t) self->inleft :
+        self->infragsz;
+    self->inleft -= sz;
+    nn_msg_term (&self->inmsg);
+    nn_msg_init (&self->inmsg, sz);
+    if (self->inleft > 0)
+        nn_msg_setmore (&self->inmsg);
+
+    self->instate = NN_SIPC_INSTATE_BODY;
+    nn_usock_recv (self->usock, nn_chunkref_data (&self->inmsg.body), sz,
+        NULL);
+}
@@ -66,6 +66,11 @@ struct nn_sipc {
     /*  Message being received at the moment. */
     struct nn_msg inmsg;
 
+    /*  If a large message is being received in fragments, the size of
+        a fragment and the number of bytes yet to be received. */
+    size_t infragsz;
+    uint64_t inleft;
+
     /*  State of the outbound state machine. */
     int outstate;
 
@@ -75,6 +80,10 @@ struct nn_sipc {
     /*  Message being sent at the moment. */
     struct nn_msg outmsg;
 
+    /*  Index of the first body part of 'outmsg' that wasn't passed to
+        the socket yet. Parts referring to files are sent separately. */
+    int outpart;
+
     /*  Event raised when the state machine ends. */
     struct nn_fsm_event done;
 };
@@ -0,0 +1,306 @@
+/*
+    Copyright (c) 2012-2013 Martin Sustrik  All rights reserved.
+    Copyright 2016 Garrett D'Amore <garrett@damore.org>
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "ashm.h"
+
+#include "../../utils/err.h"
+#include "../../utils/cont.h"
+#include "../../utils/attr.h"
+
+#define NN_ASHM_STATE_IDLE 1
+#define NN_ASHM_STATE_ACCEPTING 2
+#define NN_ASHM_STATE_ACTIVE 3
+#define NN_ASHM_STATE_STOPPING_SSHM 4
+#define NN_ASHM_STATE_STOPPING_USOCK 5
+#define NN_ASHM_STATE_DONE 6
+#define NN_ASHM_STATE_STOPPING_SSHM_FINAL 7
+#define NN_ASHM_STATE_STOPPING 8
+
+#define NN_ASHM_SRC_USOCK 1
+#define NN_ASHM_SRC_SSHM 2
+#define NN_ASHM_SRC_LISTENER 3
+
+/*  Private functions. */
+static void nn_ashm_handler (struct nn_fsm *self, int src, int type,
+   void *srcptr);
+static void nn_ashm_shutdown (struct nn_fsm *self, int src, int type,
+   void *srcptr);
+
+void nn_ashm_init (struct nn_ashm *self, int src,
+    struct nn_ep *ep, struct nn_fsm *owner)
+{
+    nn_fsm_init (&self->fsm, nn_ashm_handler, nn_ashm_shutdown,
+        src, self, owner);
+    self->state = NN_ASHM_STATE_IDLE;
+    self->ep = ep;
+    nn_usock_init (&self->usock, NN_ASHM_SRC_USOCK, &self->fsm);
+    self->listener = NULL;
+    self->listener_owner.src = -1;
+    self->listener_owner.fsm = NULL;
+    nn_sshm_init (&self->sshm, NN_ASHM_SRC_SSHM, ep, &self->fsm);
+    nn_fsm_event_init (&self->accepted);
+    nn_fsm_event_init (&self->done);
+    nn_list_item_init (&self->item);
+}
+
+void nn_ashm_term (struct nn_ashm *self)
+{
+    nn_assert_state (self, NN_ASHM_STATE_IDLE);
+
+    nn_list_item_term (&self->item);
+    nn_fsm_event_term (&self->done);
+    nn_fsm_event_term (&self->accepted);
+    nn_sshm_term (&self->sshm);
+    nn_usock_term (&self->usock);
+    nn_fsm_term (&self->fsm);
+}
+
+int nn_ashm_isidle (struct nn_ashm *self)
+{
+    return nn_fsm_isidle (&self->fsm);
+}
+
+void nn_ashm_start (struct nn_ashm *self, struct nn_usock *listener)
+{
+    nn_assert_state (self, NN_ASHM_STATE_IDLE);
+
+    /*  Take ownership of the listener socket. */
+    self->listener = listener;
+    self->listener_owner.src = NN_ASHM_SRC_LISTENER;
+    self->listener_owner.fsm = &self->fsm;
+    nn_usock_swap_owner (listener, &self->listener_owner);
+
+    /*  Start the state machine. */
+    nn_fsm_start (&self->fsm);
+}
+
+void nn_ashm_stop (struct nn_ashm *self)
+{
+    nn_fsm_stop (&self->fsm);
+}
+
+static void nn_ashm_shutdown (struct nn_fsm *self, int src, int type,
+    NN_UNUSED void *srcptr)
+{
+    struct nn_ashm *ashm;
+
+    ashm = nn_cont (self, struct nn_ashm, fsm);
+
+    if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
+        if (!nn_sshm_isidle (&ashm->sshm)) {
+            nn_ep_stat_increment (ashm->ep, NN_STAT_DROPPED_CONNECTIONS, 1);
+            nn_sshm_stop (&ashm->sshm);
+        }
+        ashm->state = NN_ASHM_STATE_STOPPING_SSHM_FINAL;
+    }
+    if (nn_slow (ashm->state == NN_ASHM_STATE_STOPPING_SSHM_FINAL)) {
+        if (!nn_sshm_isidle (&ashm->sshm))
+            return;
+        nn_usock_stop (&ashm->usock);
+        ashm->state = NN_ASHM_STATE_STOPPING;
+    }
+    if (nn_slow (ashm->state == NN_ASHM_STATE_STOPPING)) {
+        if (!nn_usock_isidle (&ashm->usock))
+            return;
+       if (ashm->listener) {
+            nn_assert (ashm->listener_owner.fsm);
+            nn_usock_swap_owner (ashm->listener, &ashm->listener_owner);
+            ashm->listener = NULL;
+            ashm->listener_owner.src = -1;
+            ashm->listener_owner.fsm = NULL;
+        }
+        ashm->state = NN_ASHM_STATE_IDLE;
+        nn_fsm_stopped (&ashm->fsm, NN_ASHM_STOPPED);
+        return;
+    }
+
+    nn_fsm_bad_state(ashm->state, src, type);
+}
+
+static void nn_ashm_handler (struct nn_fsm *self, int src, int type,
+    NN_UNUSED void *srcptr)
+{
+    struct nn_ashm *ashm;
+    int val;
+    size_t sz;
+
+    ashm = nn_cont (self, struct nn_ashm, fsm);
+
+    switch (ashm->state) {
+
+/******************************************************************************/
+/*  IDLE state.                                                               */
+/*  The state machine wasn't yet started.                                     */
+/******************************************************************************/
+    case NN_ASHM_STATE_IDLE:
+        switch (src) {
+
+        case NN_FSM_ACTION:
+            switch (type) {
+            case NN_FSM_START:
+                nn_usock_accept (&ashm->usock, ashm->listener);
+                ashm->state = NN_ASHM_STATE_ACCEPTING;
+                return;
+            default:
+                nn_fsm_bad_action (ashm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (ashm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  ACCEPTING state.                                                          */
+/*  Waiting for incoming connection.                                          */
+/******************************************************************************/
+    case NN_ASHM_STATE_ACCEPTING:
+        switch (src) {
+
+        case NN_ASHM_SRC_USOCK:
+            switch (type) {
+            case NN_USOCK_ACCEPTED:
+                nn_ep_clear_error (ashm->ep);
+
+                /*  Set the relevant socket options. */
+                sz = sizeof (val);
+                nn_ep_getopt (ashm->ep, NN_SOL_SOCKET, NN_SNDBUF, &val, &sz);
+                nn_assert (sz == sizeof (val));
+                nn_usock_setsockopt (&ashm->usock, SOL_SOCKET, SO_SNDBUF,
+                    &val, sizeof (val));
+                sz = sizeof (val);
+                nn_ep_getopt (ashm->ep, NN_SOL_SOCKET, NN_RCVBUF, &val, &sz);
+                nn_assert (sz == sizeof (val));
+                nn_usock_setsockopt (&ashm->usock, SOL_SOCKET, SO_RCVBUF,
+                    &val, sizeof (val));
+
+                /*  Return ownership of the listening socket to the parent. */
+                nn_usock_swap_owner (ashm->listener, &ashm->listener_owner);
+                ashm->listener = NULL;
+                ashm->listener_owner.src = -1;
+                ashm->listener_owner.fsm = NULL;
+                nn_fsm_raise (&ashm->fsm, &ashm->accepted, NN_ASHM_ACCEPTED);
+
+                /*  Start the sshm state machine. */
+                nn_usock_activate (&ashm->usock);
+                nn_sshm_start (&ashm->sshm, &ashm->usock, 0);
+                ashm->state = NN_ASHM_STATE_ACTIVE;
+
+                nn_ep_stat_increment (ashm->ep,
+                    NN_STAT_ACCEPTED_CONNECTIONS, 1);
+
+                return;
+
+            default:
+                nn_fsm_bad_action (ashm->state, src, type);
+            }
+
+        case NN_ASHM_SRC_LISTENER:
+            switch (type) {
+            case NN_USOCK_ACCEPT_ERROR:
+                nn_ep_set_error (ashm->ep, nn_usock_geterrno (ashm->listener));
+                nn_ep_stat_increment (ashm->ep, NN_STAT_ACCEPT_ERRORS, 1);
+                nn_usock_accept (&ashm->usock, ashm->listener);
+
+                return;
+
+            default:
+                nn_fsm_bad_action (ashm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (ashm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  ACTIVE state.                                                             */
+/******************************************************************************/
+    case NN_ASHM_STATE_ACTIVE:
+        switch (src) {
+
+        case NN_ASHM_SRC_SSHM:
+            switch (type) {
+            case NN_SSHM_ERROR:
+                nn_sshm_stop (&ashm->sshm);
+                ashm->state = NN_ASHM_STATE_STOPPING_SSHM;
+                nn_ep_stat_increment (ashm->ep, NN_STAT_BROKEN_CONNECTIONS, 1);
+                return;
+            default:
+                nn_fsm_bad_action (ashm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (ashm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  STOPPING_SSHM state.                                                      */
+/******************************************************************************/
+    case NN_ASHM_STATE_STOPPING_SSHM:
+        switch (src) {
+
+        case NN_ASHM_SRC_SSHM:
+            switch (type) {
+            case NN_USOCK_SHUTDOWN:
+                return;
+            case NN_SSHM_STOPPED:
+                nn_usock_stop (&ashm->usock);
+                ashm->state = NN_ASHM_STATE_STOPPING_USOCK;
+                return;
+            default:
+                nn_fsm_bad_action (ashm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (ashm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  STOPPING_USOCK state.                                                      */
+/******************************************************************************/
+    case NN_ASHM_STATE_STOPPING_USOCK:
+        switch (src) {
+
+        case NN_ASHM_SRC_USOCK:
+            switch (type) {
+            case NN_USOCK_SHUTDOWN:
+                return;
+            case NN_USOCK_STOPPED:
+                nn_fsm_raise (&ashm->fsm, &ashm->done, NN_ASHM_ERROR);
+                ashm->state = NN_ASHM_STATE_DONE;
+                return;
+            default:
+                nn_fsm_bad_action (ashm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (ashm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  Invalid state.                                                            */
+/******************************************************************************/
+    default:
+        nn_fsm_bad_state (ashm->state, src, type);
+    }
+}
@@ -0,0 +1,351 @@
+/*
+    Copyright (c) 2012-2013 Martin Sustrik  All rights reserved.
+    Copyright 2016 Franklin "Snaipe" Mathieu <franklinmathieu@gmail.com>
+    Copyright 2016 Garrett D'Amore <garrett@damore.org>
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "bshm.h"
+#include "ashm.h"
+
+#include "../../aio/fsm.h"
+#include "../../aio/usock.h"
+
+#include "../../utils/err.h"
+#include "../../utils/cont.h"
+#include "../../utils/alloc.h"
+#include "../../utils/list.h"
+#include "../../utils/fast.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <fcntl.h>
+
+#define NN_BSHM_BACKLOG 10
+
+#define NN_BSHM_STATE_IDLE 1
+#define NN_BSHM_STATE_ACTIVE 2
+#define NN_BSHM_STATE_STOPPING_ASHM 3
+#define NN_BSHM_STATE_STOPPING_USOCK 4
+#define NN_BSHM_STATE_STOPPING_ASHMS 5
+
+#define NN_BSHM_SRC_USOCK 1
+#define NN_BSHM_SRC_ASHM 2
+
+struct nn_bshm {
+
+    /*  The state machine. */
+    struct nn_fsm fsm;
+    int state;
+
+    struct nn_ep *ep;
+
+    /*  The underlying listening Unix domain socket. */
+    struct nn_usock usock;
+
+    /*  The connection being accepted at the moment. */
+    struct nn_ashm *ashm;
+
+    /*  List of accepted connections. */
+    struct nn_list ashms;
+};
+
+/*  nn_ep virtual interface implementation. */
+static void nn_bshm_stop (void *self);
+static void nn_bshm_destroy (void *self);
+const struct nn_ep_ops nn_bshm_ep_ops = {
+    nn_bshm_stop,
+    nn_bshm_destroy
+};
+
+/*  Private functions. */
+static void nn_bshm_handler (struct nn_fsm *self, int src, int type,
+    void *srcptr);
+static void nn_bshm_shutdown (struct nn_fsm *self, int src, int type,
+    void *srcptr);
+static int nn_bshm_listen (struct nn_bshm *self);
+static void nn_bshm_start_accepting (struct nn_bshm *self);
+
+int nn_bshm_create (struct nn_ep *ep)
+{
+    struct nn_bshm *self;
+    int rc;
+
+    /*  Allocate the new endpoint object. */
+    self = nn_alloc (sizeof (struct nn_bshm), "bshm");
+    alloc_assert (self);
+
+
+    /*  Initialise the structure. */
+    self->ep = ep;
+    nn_ep_tran_setup (ep, &nn_bshm_ep_ops, self);
+    nn_fsm_init_root (&self->fsm, nn_bshm_handler, nn_bshm_shutdown,
+        nn_ep_getctx (ep));
+    self->state = NN_BSHM_STATE_IDLE;
+    self->ashm = NULL;
+    nn_list_init (&self->ashms);
+
+    /*  Start the state machine. */
+    nn_fsm_start (&self->fsm);
+
+    nn_usock_init (&self->usock, NN_BSHM_SRC_USOCK, &self->fsm);
+
+    rc = nn_bshm_listen (self);
+    if (rc != 0) {
+        return rc;
+    }
+
+    return 0;
+}
+
+static void nn_bshm_stop (void *self)
+{
+    struct nn_bshm *bshm = self;
+
+    nn_fsm_stop (&bshm->fsm);
+}
+
+static void nn_bshm_destroy (void *self)
+{
+    struct nn_bshm *bshm = self;
+
+    nn_assert_state (bshm, NN_BSHM_STATE_IDLE);
+    nn_list_term (&bshm->ashms);
+    nn_assert (bshm->ashm == NULL);
+    nn_usock_term (&bshm->usock);
+    nn_fsm_term (&bshm->fsm);
+
+    nn_free (bshm);
+}
+
+static void nn_bshm_shutdown (struct nn_fsm *self, int src, int type,
+    void *srcptr)
+{
+#if defined NN_HAVE_UNIX_SOCKETS
+    const char *addr;
+    int rc;
+#endif
+
+    struct nn_bshm *bshm;
+    struct nn_list_item *it;
+    struct nn_ashm *ashm;
+
+    bshm = nn_cont (self, struct nn_bshm, fsm);
+
+    if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
+        if (bshm->ashm) {
+            nn_ashm_stop (bshm->ashm);
+            bshm->state = NN_BSHM_STATE_STOPPING_ASHM;
+        }
+        else {
+            bshm->state = NN_BSHM_STATE_STOPPING_USOCK;
+        }
+    }
+    if (nn_slow (bshm->state == NN_BSHM_STATE_STOPPING_ASHM)) {
+        if (!nn_ashm_isidle (bshm->ashm))
+            return;
+        nn_ashm_term (bshm->ashm);
+        nn_free (bshm->ashm);
+        bshm->ashm = NULL;
+
+        /* On *nixes, unlink the domain socket file */
+#if defined NN_HAVE_UNIX_SOCKETS
+        addr = nn_ep_getaddr (bshm->ep);
+        rc = unlink(addr);
+        errno_assert (rc == 0 || errno == ENOENT);
+#endif
+
+        nn_usock_stop (&bshm->usock);
+        bshm->state = NN_BSHM_STATE_STOPPING_USOCK;
+    }
+    if (nn_slow (bshm->state == NN_BSHM_STATE_STOPPING_USOCK)) {
+       if (!nn_usock_isidle (&bshm->usock))
+            return;
+        for (it = nn_list_begin (&bshm->ashms);
+              it != nn_list_end (&bshm->ashms);
+              it = nn_list_next (&bshm->ashms, it)) {
+            ashm = nn_cont (it, struct nn_ashm, item);
+            nn_ashm_stop (ashm);
+        }
+        bshm->state = NN_BSHM_STATE_STOPPING_ASHMS;
+        goto ashms_stopping;
+    }
+    if (nn_slow (bshm->state == NN_BSHM_STATE_STOPPING_ASHMS)) {
+        nn_assert (src == NN_BSHM_SRC_ASHM && type == NN_ASHM_STOPPED);
+        ashm = (struct nn_ashm *) srcptr;
+        nn_list_erase (&bshm->ashms, &ashm->item);
+        nn_ashm_term (ashm);
+        nn_free (ashm);
+
+        /*  If there are no more ashm state machines, we can stop the whole
+            bshm object. */
+ashms_stopping:
+        if (nn_list_empty (&bshm->ashms)) {
+            bshm->state = NN_BSHM_STATE_IDLE;
+            nn_fsm_stopped_noevent (&bshm->fsm);
+            nn_ep_stopped (bshm->ep);
+            return;
+        }
+
+        return;
+    }
+
+    nn_fsm_bad_state(bshm->state, src, type);
+}
+
+static void nn_bshm_handler (struct nn_fsm *self, int src, int type,
+    void *srcptr)
+{
+    struct nn_bshm *bshm;
+    struct nn_ashm *ashm;
+
+    bshm = nn_cont (self, struct nn_bshm, fsm);
+
+    switch (bshm->state) {
+
+/******************************************************************************/
+/*  IDLE state.                                                               */
+/******************************************************************************/
+    case NN_BSHM_STATE_IDLE:
+        nn_assert (src == NN_FSM_ACTION);
+        nn_assert (type == NN_FSM_START);
+        bshm->state = NN_BSHM_STATE_ACTIVE;
+        return;
+
+/******************************************************************************/
+/*  ACTIVE state.                                                             */
+/*  The execution is yielded to the ashm state machine in this state.         */
+/******************************************************************************/
+    case NN_BSHM_STATE_ACTIVE:
+        if (src == NN_BSHM_SRC_USOCK) {
+            nn_assert (type == NN_USOCK_SHUTDOWN || type == NN_USOCK_STOPPED);
+            return;
+        }
+
+        /* All other events come from child ashm objects. */
+        nn_assert (src == NN_BSHM_SRC_ASHM);
+        ashm = (struct nn_ashm*) srcptr;
+        switch (type) {
+        case NN_ASHM_ACCEPTED:
+
+            nn_list_insert (&bshm->ashms, &ashm->item,
+                nn_list_end (&bshm->ashms));
+            bshm->ashm = NULL;
+            nn_bshm_start_accepting (bshm);
+            return;
+        case NN_ASHM_ERROR:
+            nn_ashm_stop (ashm);
+            return;
+        case NN_ASHM_STOPPED:
+            nn_list_erase (&bshm->ashms, &ashm->item);
+            nn_ashm_term (ashm);
+            nn_free (ashm);
+            return;
+        default:
+            nn_fsm_bad_action (bshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  Invalid state.                                                            */
+/******************************************************************************/
+    default:
+        nn_fsm_bad_state (bshm->state, src, type);
+    }
+}
+
+static int nn_bshm_listen (struct nn_bshm *self)
+{
+    int rc;
+    struct sockaddr_storage ss;
+    struct sockaddr_un *un;
+    const char *addr;
+#if defined NN_HAVE_UNIX_SOCKETS
+    int fd;
+#endif
+
+    /*  First, create the AF_UNIX address. */
+    addr = nn_ep_getaddr (self->ep);
+    memset (&ss, 0, sizeof (ss));
+    un = (struct sockaddr_un*) &ss;
+    nn_assert (strlen (addr) < sizeof (un->sun_path));
+    ss.ss_family = AF_UNIX;
+    strncpy (un->sun_path, addr, sizeof (un->sun_path));
+
+    /*  Delete the socket file left over by eventual previous runs of
+        the application. We'll check whether the file is still in use by
+        connecting to the endpoint. On Windows plaform, NamedPipe is used
+        which does not have an underlying file. */
+#if defined NN_HAVE_UNIX_SOCKETS
+    fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0) {
+        rc = fcntl (fd, F_SETFL, O_NONBLOCK);
+        errno_assert (rc != -1 || errno == EINVAL);
+        rc = connect (fd, (struct sockaddr*) &ss,
+            sizeof (struct sockaddr_un));
+        if (rc == -1 && errno == ECONNREFUSED) {
+            rc = unlink (addr);
+            errno_assert (rc == 0 || errno == ENOENT);
+        }
+        rc = close (fd);
+        errno_assert (rc == 0);
+    }
+#endif
+
+    /*  Start listening for incoming connections. */
+    rc = nn_usock_start (&self->usock, AF_UNIX, SOCK_STREAM, 0);
+    if (rc < 0) {
+        return rc;
+    }
+
+    rc = nn_usock_bind (&self->usock,
+        (struct sockaddr*) &ss, sizeof (struct sockaddr_un));
+    if (rc < 0) {
+        nn_usock_stop (&self->usock);
+        return rc;
+    }
+
+    rc = nn_usock_listen (&self->usock, NN_BSHM_BACKLOG);
+    if (rc < 0) {
+        nn_usock_stop (&self->usock);
+        return rc;
+    }
+    nn_bshm_start_accepting (self);
+
+    return 0;
+}
+
+/******************************************************************************/
+/*  State machine actions.                                                    */
+/******************************************************************************/
+
+static void nn_bshm_start_accepting (struct nn_bshm *self)
+{
+    nn_assert (self->ashm == NULL);
+
+    /*  Allocate new ashm state machine. */
+    self->ashm = nn_alloc (sizeof (struct nn_ashm), "ashm");
+    alloc_assert (self->ashm);
+    nn_ashm_init (self->ashm, NN_BSHM_SRC_ASHM, self->ep, &self->fsm);
+
+    /*  Start waiting for a new incoming connection. */
+    nn_ashm_start (self->ashm, &self->usock);
+}
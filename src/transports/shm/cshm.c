@@ -0,0 +1,409 @@
+/*
+    Copyright (c) 2012-2013 Martin Sustrik  All rights reserved.
+    Copyright 2016 Garrett D'Amore <garrett@damore.org>
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "cshm.h"
+#include "sshm.h"
+
+#include "../../aio/fsm.h"
+#include "../../aio/usock.h"
+
+#include "../utils/backoff.h"
+
+#include "../../utils/err.h"
+#include "../../utils/cont.h"
+#include "../../utils/alloc.h"
+#include "../../utils/fast.h"
+#include "../../utils/attr.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/un.h>
+
+#define NN_CSHM_STATE_IDLE 1
+#define NN_CSHM_STATE_CONNECTING 2
+#define NN_CSHM_STATE_ACTIVE 3
+#define NN_CSHM_STATE_STOPPING_SSHM 4
+#define NN_CSHM_STATE_STOPPING_USOCK 5
+#define NN_CSHM_STATE_WAITING 6
+#define NN_CSHM_STATE_STOPPING_BACKOFF 7
+#define NN_CSHM_STATE_STOPPING_SSHM_FINAL 8
+#define NN_CSHM_STATE_STOPPING 9
+
+#define NN_CSHM_SRC_USOCK 1
+#define NN_CSHM_SRC_RECONNECT_TIMER 2
+#define NN_CSHM_SRC_SSHM 3
+
+struct nn_cshm {
+
+    /*  The state machine. */
+    struct nn_fsm fsm;
+    int state;
+
+    struct nn_ep *ep;
+
+    /*  The underlying Unix domain socket. */
+    struct nn_usock usock;
+
+    /*  Used to wait before retrying to connect. */
+    struct nn_backoff retry;
+
+    /*  State machine that handles the active part of the connection
+        lifetime. */
+    struct nn_sshm sshm;
+};
+
+/*  nn_ep virtual interface implementation. */
+static void nn_cshm_stop (void *self);
+static void nn_cshm_destroy (void *self);
+const struct nn_ep_ops nn_cshm_ep_ops = {
+    nn_cshm_stop,
+    nn_cshm_destroy
+};
+
+/*  Private functions. */
+static void nn_cshm_handler (struct nn_fsm *self, int src, int type,
+    void *srcptr);
+static void nn_cshm_shutdown (struct nn_fsm *self, int src, int type,
+    void *srcptr);
+static void nn_cshm_start_connecting (struct nn_cshm *self);
+
+int nn_cshm_create (struct nn_ep *ep)
+{
+    struct nn_cshm *self;
+    int reconnect_ivl;
+    int reconnect_ivl_max;
+    size_t sz;
+
+    /*  Allocate the new endpoint object. */
+    self = nn_alloc (sizeof (struct nn_cshm), "cshm");
+    alloc_assert (self);
+
+    /*  Initialise the structure. */
+    self->ep = ep;
+    nn_ep_tran_setup (ep, &nn_cshm_ep_ops, self);
+    nn_fsm_init_root (&self->fsm, nn_cshm_handler, nn_cshm_shutdown,
+        nn_ep_getctx (ep));
+    self->state = NN_CSHM_STATE_IDLE;
+    nn_usock_init (&self->usock, NN_CSHM_SRC_USOCK, &self->fsm);
+    sz = sizeof (reconnect_ivl);
+    nn_ep_getopt (ep, NN_SOL_SOCKET, NN_RECONNECT_IVL, &reconnect_ivl, &sz);
+    nn_assert (sz == sizeof (reconnect_ivl));
+    sz = sizeof (reconnect_ivl_max);
+    nn_ep_getopt (ep, NN_SOL_SOCKET, NN_RECONNECT_IVL_MAX,
+        &reconnect_ivl_max, &sz);
+    nn_assert (sz == sizeof (reconnect_ivl_max));
+    if (reconnect_ivl_max == 0)
+        reconnect_ivl_max = reconnect_ivl;
+    nn_backoff_init (&self->retry, NN_CSHM_SRC_RECONNECT_TIMER,
+        reconnect_ivl, reconnect_ivl_max, &self->fsm);
+    nn_sshm_init (&self->sshm, NN_CSHM_SRC_SSHM, ep, &self->fsm);
+
+    /*  Start the state machine. */
+    nn_fsm_start (&self->fsm);
+
+    return 0;
+}
+
+static void nn_cshm_stop (void *self)
+{
+    struct nn_cshm *cshm = self;
+
+    nn_fsm_stop (&cshm->fsm);
+}
+
+static void nn_cshm_destroy (void *self)
+{
+    struct nn_cshm *cshm = self;
+
+    nn_sshm_term (&cshm->sshm);
+    nn_backoff_term (&cshm->retry);
+    nn_usock_term (&cshm->usock);
+    nn_fsm_term (&cshm->fsm);
+
+    nn_free (cshm);
+}
+
+static void nn_cshm_shutdown (struct nn_fsm *self, int src, int type,
+    NN_UNUSED void *srcptr)
+{
+    struct nn_cshm *cshm;
+
+    cshm = nn_cont (self, struct nn_cshm, fsm);
+
+    if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
+        if (!nn_sshm_isidle (&cshm->sshm)) {
+            nn_ep_stat_increment (cshm->ep, NN_STAT_DROPPED_CONNECTIONS, 1);
+            nn_sshm_stop (&cshm->sshm);
+        }
+        cshm->state = NN_CSHM_STATE_STOPPING_SSHM_FINAL;
+    }
+    if (nn_slow (cshm->state == NN_CSHM_STATE_STOPPING_SSHM_FINAL)) {
+        if (!nn_sshm_isidle (&cshm->sshm))
+            return;
+        nn_backoff_stop (&cshm->retry);
+        nn_usock_stop (&cshm->usock);
+        cshm->state = NN_CSHM_STATE_STOPPING;
+    }
+    if (nn_slow (cshm->state == NN_CSHM_STATE_STOPPING)) {
+        if (!nn_backoff_isidle (&cshm->retry) ||
+              !nn_usock_isidle (&cshm->usock))
+            return;
+        cshm->state = NN_CSHM_STATE_IDLE;
+        nn_fsm_stopped_noevent (&cshm->fsm);
+        nn_ep_stopped (cshm->ep);
+        return;
+    }
+
+    nn_fsm_bad_state(cshm->state, src, type);
+}
+
+static void nn_cshm_handler (struct nn_fsm *self, int src, int type,
+    NN_UNUSED void *srcptr)
+{
+    struct nn_cshm *cshm;
+
+    cshm = nn_cont (self, struct nn_cshm, fsm);
+
+    switch (cshm->state) {
+
+/******************************************************************************/
+/*  IDLE state.                                                               */
+/*  The state machine wasn't yet started.                                     */
+/******************************************************************************/
+    case NN_CSHM_STATE_IDLE:
+        switch (src) {
+
+        case NN_FSM_ACTION:
+            switch (type) {
+            case NN_FSM_START:
+                nn_cshm_start_connecting (cshm);
+                return;
+            default:
+                nn_fsm_bad_action (cshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (cshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  CONNECTING state.                                                         */
+/*  Non-blocking connect is under way.                                        */
+/******************************************************************************/
+    case NN_CSHM_STATE_CONNECTING:
+        switch (src) {
+
+        case NN_CSHM_SRC_USOCK:
+            switch (type) {
+            case NN_USOCK_CONNECTED:
+                nn_sshm_start (&cshm->sshm, &cshm->usock, 1);
+                cshm->state = NN_CSHM_STATE_ACTIVE;
+                nn_ep_stat_increment (cshm->ep,
+                    NN_STAT_INPROGRESS_CONNECTIONS, -1);
+                nn_ep_stat_increment (cshm->ep,
+                    NN_STAT_ESTABLISHED_CONNECTIONS, 1);
+                nn_ep_clear_error (cshm->ep);
+                return;
+            case NN_USOCK_ERROR:
+                nn_ep_set_error (cshm->ep, nn_usock_geterrno (&cshm->usock));
+                nn_usock_stop (&cshm->usock);
+                cshm->state = NN_CSHM_STATE_STOPPING_USOCK;
+                nn_ep_stat_increment (cshm->ep,
+                    NN_STAT_INPROGRESS_CONNECTIONS, -1);
+                nn_ep_stat_increment (cshm->ep, NN_STAT_CONNECT_ERRORS, 1);
+                return;
+            default:
+                nn_fsm_bad_action (cshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (cshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  ACTIVE state.                                                             */
+/*  Connection is established and handled by the sshm state machine.          */
+/******************************************************************************/
+    case NN_CSHM_STATE_ACTIVE:
+        switch (src) {
+
+        case NN_CSHM_SRC_SSHM:
+            switch (type) {
+            case NN_SSHM_ERROR:
+                nn_sshm_stop (&cshm->sshm);
+                cshm->state = NN_CSHM_STATE_STOPPING_SSHM;
+                nn_ep_stat_increment (cshm->ep, NN_STAT_BROKEN_CONNECTIONS, 1);
+                return;
+            default:
+               nn_fsm_bad_action (cshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (cshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  STOPPING_SSHM state.                                                      */
+/*  sshm object was asked to stop but it haven't stopped yet.                 */
+/******************************************************************************/
+    case NN_CSHM_STATE_STOPPING_SSHM:
+        switch (src) {
+
+        case NN_CSHM_SRC_SSHM:
+            switch (type) {
+            case NN_USOCK_SHUTDOWN:
+                return;
+            case NN_SSHM_STOPPED:
+                nn_usock_stop (&cshm->usock);
+                cshm->state = NN_CSHM_STATE_STOPPING_USOCK;
+                return;
+            default:
+                nn_fsm_bad_action (cshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (cshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  STOPPING_USOCK state.                                                     */
+/*  usock object was asked to stop but it haven't stopped yet.                */
+/******************************************************************************/
+    case NN_CSHM_STATE_STOPPING_USOCK:
+        switch (src) {
+
+        case NN_CSHM_SRC_USOCK:
+            switch (type) {
+            case NN_USOCK_SHUTDOWN:
+                return;
+            case NN_USOCK_STOPPED:
+                nn_backoff_start (&cshm->retry);
+                cshm->state = NN_CSHM_STATE_WAITING;
+                return;
+            default:
+                nn_fsm_bad_action (cshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (cshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  WAITING state.                                                            */
+/*  Waiting before re-connection is attempted. This way we won't overload     */
+/*  the system by continuous re-connection attempts.                          */
+/******************************************************************************/
+    case NN_CSHM_STATE_WAITING:
+        switch (src) {
+
+        case NN_CSHM_SRC_RECONNECT_TIMER:
+            switch (type) {
+            case NN_BACKOFF_TIMEOUT:
+                nn_backoff_stop (&cshm->retry);
+                cshm->state = NN_CSHM_STATE_STOPPING_BACKOFF;
+                return;
+            default:
+                nn_fsm_bad_action (cshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (cshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  STOPPING_BACKOFF state.                                                   */
+/*  backoff object was asked to stop, but it haven't stopped yet.             */
+/******************************************************************************/
+    case NN_CSHM_STATE_STOPPING_BACKOFF:
+        switch (src) {
+
+        case NN_CSHM_SRC_RECONNECT_TIMER:
+            switch (type) {
+            case NN_BACKOFF_STOPPED:
+                nn_cshm_start_connecting (cshm);
+                return;
+            default:
+                nn_fsm_bad_action (cshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (cshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  Invalid state.                                                            */
+/******************************************************************************/
+    default:
+        nn_fsm_bad_state (cshm->state, src, type);
+    }
+}
+
+/******************************************************************************/
+/*  State machine actions.                                                    */
+/******************************************************************************/
+
+static void nn_cshm_start_connecting (struct nn_cshm *self)
+{
+    int rc;
+    struct sockaddr_storage ss;
+    struct sockaddr_un *un;
+    const char *addr;
+    int val;
+    size_t sz;
+
+    /*  Try to start the underlying socket. */
+    rc = nn_usock_start (&self->usock, AF_UNIX, SOCK_STREAM, 0);
+    if (nn_slow (rc < 0)) {
+        nn_backoff_start (&self->retry);
+        self->state = NN_CSHM_STATE_WAITING;
+        return;
+    }
+
+    /*  Set the relevant socket options. */
+    sz = sizeof (val);
+    nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_SNDBUF, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    nn_usock_setsockopt (&self->usock, SOL_SOCKET, SO_SNDBUF,
+        &val, sizeof (val));
+    sz = sizeof (val);
+    nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_RCVBUF, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    nn_usock_setsockopt (&self->usock, SOL_SOCKET, SO_RCVBUF,
+        &val, sizeof (val));
+
+    /*  Create the Unix domain socket address from the address string. */
+    addr = nn_ep_getaddr (self->ep);
+    memset (&ss, 0, sizeof (ss));
+    un = (struct sockaddr_un*) &ss;
+    nn_assert (strlen (addr) < sizeof (un->sun_path));
+    ss.ss_family = AF_UNIX;
+    strncpy (un->sun_path, addr, sizeof (un->sun_path));
+
+    /*  Start connecting. */
+    nn_usock_connect (&self->usock, (struct sockaddr*) &ss,
+        sizeof (struct sockaddr_un));
+    self->state  = NN_CSHM_STATE_CONNECTING;
+
+    nn_ep_stat_increment (self->ep, NN_STAT_INPROGRESS_CONNECTIONS, 1);
+}
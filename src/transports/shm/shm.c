@@ -0,0 +1,51 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "bshm.h"
+#include "cshm.h"
+
+#include "../../shm.h"
+
+/*  nn_transport interface. */
+static int nn_shm_bind (struct nn_ep *ep);
+static int nn_shm_connect (struct nn_ep *ep);
+
+struct nn_transport nn_shm = {
+    "shm",
+    NN_SHM,
+    NULL,
+    NULL,
+    nn_shm_bind,
+    nn_shm_connect,
+    NULL,
+};
+
+static int nn_shm_bind (struct nn_ep *ep)
+{
+    return nn_bshm_create (ep);
+}
+
+static int nn_shm_connect (struct nn_ep *ep)
+{
+    return nn_cshm_create (ep);
+}
@@ -0,0 +1,472 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "shmring.h"
+
+#include "../../utils/err.h"
+#include "../../utils/closefd.h"
+#include "../../utils/random.h"
+#include "../../utils/fast.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*  "nnSR" */
+#define NN_SHMRING_MAGIC 0x6e6e5352
+
+/*  Smallest and largest capacity of the ring. */
+#define NN_SHMRING_MINSIZE 4096
+#define NN_SHMRING_MAXSIZE (1 << 30)
+
+/*  Record flags. A message consists of one or more records, the first one
+    marked BEGIN, the last one marked END. PAD record fills the space up to
+    the end of the data area. If there's not even space for a record header
+    at the end of the data area, the space is skipped implicitly. */
+#define NN_SHMRING_REC_BEGIN 1
+#define NN_SHMRING_REC_END 2
+#define NN_SHMRING_REC_PAD 4
+
+/*  Seals that keep the peer from resizing the region once it's mapped.
+    Accessing a mapping beyond the end of a shrunk file raises SIGBUS. */
+#if defined NN_HAVE_MEMFD
+#define NN_SHMRING_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)
+#endif
+
+/*  Records are aligned to this boundary. */
+#define NN_SHMRING_ALIGN(sz) (((sz) + 7) & ~((size_t) 7))
+
+/*  Control block at the beginning of the shared region. Positions are
+    free-running byte counters; 'head' is only ever written by the producer,
+    'tail' by the consumer. Each lives on its own cache line so that
+    the two sides don't fight over it. */
+struct nn_shmring_ctl {
+    uint32_t magic;
+    uint32_t size;
+    uint8_t pad0 [56];
+    volatile uint32_t head;
+    uint8_t pad1 [60];
+    volatile uint32_t tail;
+    uint8_t pad2 [60];
+
+    /*  Set by the consumer when it goes to sleep because the ring is empty. */
+    volatile uint32_t rsleep;
+    uint8_t pad3 [60];
+
+    /*  Set by the producer when it goes to sleep because the ring is full. */
+    volatile uint32_t wsleep;
+    uint8_t pad4 [60];
+};
+
+struct nn_shmring_rec {
+    uint32_t len;
+    uint32_t flags;
+
+    /*  Size of the whole message. Valid only in BEGIN records. */
+    uint64_t total;
+};
+
+/*  Private functions. */
+static int nn_shmring_mkfd (void);
+static void nn_shmring_copyin (uint8_t *dst, struct nn_msg *msg,
+    size_t pos, size_t len);
+
+void nn_shmring_init (struct nn_shmring *self)
+{
+    self->ctl = NULL;
+    self->data = NULL;
+    self->size = 0;
+    self->mapsz = 0;
+    self->pos = 0;
+    self->busy = 0;
+}
+
+void nn_shmring_term (struct nn_shmring *self)
+{
+    nn_shmring_detach (self);
+}
+
+int nn_shmring_create (struct nn_shmring *self, size_t size)
+{
+    int rc;
+    int fd;
+    uint32_t capacity;
+    void *map;
+
+    nn_assert (self->ctl == NULL);
+
+    capacity = NN_SHMRING_MINSIZE;
+    while (capacity < size && capacity < NN_SHMRING_MAXSIZE)
+        capacity <<= 1;
+
+    fd = nn_shmring_mkfd ();
+    if (nn_slow (fd < 0))
+        return fd;
+    self->mapsz = sizeof (struct nn_shmring_ctl) + capacity;
+    rc = ftruncate (fd, (off_t) self->mapsz);
+    if (nn_slow (rc < 0)) {
+        rc = -errno;
+        nn_closefd (fd);
+        return rc;
+    }
+#if defined NN_HAVE_MEMFD
+    rc = fcntl (fd, F_ADD_SEALS, NN_SHMRING_SEALS);
+    if (nn_slow (rc < 0)) {
+        rc = -errno;
+        nn_closefd (fd);
+        return rc;
+    }
+#endif
+    map = mmap (NULL, self->mapsz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (nn_slow (map == MAP_FAILED)) {
+        rc = -errno;
+        nn_closefd (fd);
+        return rc;
+    }
+
+    self->ctl = map;
+    self->data = ((uint8_t*) map) + sizeof (struct nn_shmring_ctl);
+    self->size = capacity;
+    self->pos = 0;
+    self->busy = 0;
+    memset (self->ctl, 0, sizeof (struct nn_shmring_ctl));
+    self->ctl->magic = NN_SHMRING_MAGIC;
+    self->ctl->size = capacity;
+
+    return fd;
+}
+
+int nn_shmring_attach (struct nn_shmring *self, int fd)
+{
+    int rc;
+    struct stat st;
+    size_t capacity;
+    void *map;
+
+    nn_assert (self->ctl == NULL);
+
+    /*  Refuse regions the peer could still resize under our hands. */
+#if defined NN_HAVE_MEMFD
+    rc = fcntl (fd, F_GET_SEALS);
+    if (nn_slow (rc < 0 || (rc & NN_SHMRING_SEALS) != NN_SHMRING_SEALS))
+        return -EPROTO;
+#endif
+
+    rc = fstat (fd, &st);
+    if (nn_slow (rc < 0))
+        return -errno;
+    if (nn_slow (st.st_size < (off_t) (sizeof (struct nn_shmring_ctl) +
+          NN_SHMRING_MINSIZE) || st.st_size > (off_t)
+          (sizeof (struct nn_shmring_ctl) + NN_SHMRING_MAXSIZE)))
+        return -EPROTO;
+    capacity = (size_t) st.st_size - sizeof (struct nn_shmring_ctl);
+    if (nn_slow (capacity & (capacity - 1)))
+        return -EPROTO;
+
+    map = mmap (NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED, fd, 0);
+    if (nn_slow (map == MAP_FAILED))
+        return -errno;
+    self->ctl = map;
+    self->data = ((uint8_t*) map) + sizeof (struct nn_shmring_ctl);
+    self->size = (uint32_t) capacity;
+    self->mapsz = (size_t) st.st_size;
+    self->pos = 0;
+    self->busy = 0;
+
+    if (nn_slow (self->ctl->magic != NN_SHMRING_MAGIC ||
+          self->ctl->size != self->size)) {
+        nn_shmring_detach (self);
+        return -EPROTO;
+    }
+
+    return 0;
+}
+
+void nn_shmring_detach (struct nn_shmring *self)
+{
+    int rc;
+
+    if (!self->ctl)
+        return;
+    rc = munmap (self->ctl, self->mapsz);
+    errno_assert (rc == 0);
+    nn_shmring_init (self);
+}
+
+int nn_shmring_write (struct nn_shmring *self, struct nn_msg *msg)
+{
+    struct nn_shmring_ctl *ctl;
+    struct nn_shmring_rec rec;
+    size_t total;
+    size_t len;
+    size_t need;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t used;
+    uint32_t avail;
+    uint32_t off;
+    uint32_t contig;
+
+    ctl = self->ctl;
+    total = nn_chunkref_size (&msg->sphdr) + nn_chunkref_size (&msg->body);
+
+    while (1) {
+        head = ctl->head;
+        tail = ctl->tail;
+        __sync_synchronize ();
+        used = head - tail;
+        if (nn_slow (used > self->size))
+            return -EPROTO;
+        avail = self->size - used;
+        off = head & (self->size - 1);
+        contig = self->size - off;
+
+        /*  Write the rest of the message as a single record if possible.
+            If it would fit after wrapping around, pad till the end of
+            the data area first. Otherwise, write as much as fits. */
+        len = total - self->pos;
+        need = sizeof (rec) + NN_SHMRING_ALIGN (len);
+        if (need > contig || need > avail) {
+            if (contig < avail && need <= avail - contig)
+                goto pad;
+            need = avail < contig ? avail : contig;
+            if (need < sizeof (rec) + 8) {
+                if (contig < avail)
+                    goto pad;
+                goto full;
+            }
+            len = (need - sizeof (rec)) & ~((size_t) 7);
+            need = sizeof (rec) + len;
+        }
+
+        rec.len = (uint32_t) len;
+        rec.flags = 0;
+        if (self->pos == 0)
+            rec.flags |= NN_SHMRING_REC_BEGIN;
+        if (self->pos + len == total)
+            rec.flags |= NN_SHMRING_REC_END;
+        rec.total = total;
+        memcpy (self->data + off, &rec, sizeof (rec));
+        nn_shmring_copyin (self->data + off + sizeof (rec), msg,
+            self->pos, len);
+
+        /*  Publish the record. */
+        __sync_synchronize ();
+        ctl->head = head + (uint32_t) need;
+        self->pos += len;
+        if (self->pos == total) {
+            self->pos = 0;
+            return 1;
+        }
+        continue;
+
+pad:
+        if (contig >= sizeof (rec)) {
+            rec.len = 0;
+            rec.flags = NN_SHMRING_REC_PAD;
+            rec.total = 0;
+            memcpy (self->data + off, &rec, sizeof (rec));
+        }
+        __sync_synchronize ();
+        ctl->head = head + contig;
+        continue;
+
+full:
+        /*  Ask the consumer to wake us up. Re-check afterwards to make sure
+            that the consumer haven't freed some space in the meantime. */
+        ctl->wsleep = 1;
+        __sync_synchronize ();
+        if (ctl->tail == tail)
+            return 0;
+        __sync_bool_compare_and_swap (&ctl->wsleep, 1, 0);
+    }
+}
+
+int nn_shmring_read (struct nn_shmring *self, struct nn_msg *msg, int maxsz)
+{
+    struct nn_shmring_ctl *ctl;
+    struct nn_shmring_rec rec;
+    size_t recsz;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t used;
+    uint32_t off;
+    uint32_t contig;
+
+    ctl = self->ctl;
+
+    while (1) {
+        tail = ctl->tail;
+        head = ctl->head;
+        __sync_synchronize ();
+        used = head - tail;
+        if (nn_slow (used > self->size))
+            return -EPROTO;
+
+        /*  The ring is empty. Ask the producer to wake us up. Re-check
+            afterwards to make sure that nothing was written meanwhile. */
+        if (used == 0) {
+            ctl->rsleep = 1;
+            __sync_synchronize ();
+            if (ctl->head == head)
+                return 0;
+            __sync_bool_compare_and_swap (&ctl->rsleep, 1, 0);
+            continue;
+        }
+
+        off = tail & (self->size - 1);
+        contig = self->size - off;
+
+        /*  Skip the padding at the end of the data area. */
+        if (contig < sizeof (rec)) {
+            if (nn_slow (used < contig))
+                return -EPROTO;
+            __sync_synchronize ();
+            ctl->tail = tail + contig;
+            continue;
+        }
+        if (nn_slow (used < sizeof (rec)))
+            return -EPROTO;
+        memcpy (&rec, self->data + off, sizeof (rec));
+        if (rec.flags & NN_SHMRING_REC_PAD) {
+            if (nn_slow (used < contig))
+                return -EPROTO;
+            __sync_synchronize ();
+            ctl->tail = tail + contig;
+            continue;
+        }
+
+        recsz = sizeof (rec) + NN_SHMRING_ALIGN ((size_t) rec.len);
+        if (nn_slow (recsz > contig || recsz > used))
+            return -EPROTO;
+
+        if (rec.flags & NN_SHMRING_REC_BEGIN) {
+            if (nn_slow (self->busy))
+                return -EPROTO;
+            if (maxsz >= 0 && rec.total > (uint64_t) maxsz)
+                return -EMSGSIZE;
+            if (nn_slow (rec.total > SIZE_MAX))
+                return -EPROTO;
+            nn_msg_term (msg);
+            nn_msg_init (msg, (size_t) rec.total);
+            self->pos = 0;
+            self->busy = 1;
+        }
+        else if (nn_slow (!self->busy))
+            return -EPROTO;
+        if (nn_slow (rec.len > nn_chunkref_size (&msg->body) - self->pos))
+            return -EPROTO;
+
+        memcpy (((uint8_t*) nn_chunkref_data (&msg->body)) + self->pos,
+            self->data + off + sizeof (rec), rec.len);
+        self->pos += rec.len;
+
+        /*  Release the space to the producer. */
+        __sync_synchronize ();
+        ctl->tail = tail + (uint32_t) recsz;
+
+        if (rec.flags & NN_SHMRING_REC_END) {
+            if (nn_slow (self->pos != nn_chunkref_size (&msg->body)))
+                return -EPROTO;
+            self->pos = 0;
+            self->busy = 0;
+            return 1;
+        }
+    }
+}
+
+int nn_shmring_wake_reader (struct nn_shmring *self)
+{
+    __sync_synchronize ();
+    return self->ctl->rsleep &&
+        __sync_bool_compare_and_swap (&self->ctl->rsleep, 1, 0) ? 1 : 0;
+}
+
+int nn_shmring_wake_writer (struct nn_shmring *self)
+{
+    __sync_synchronize ();
+    return self->ctl->wsleep &&
+        __sync_bool_compare_and_swap (&self->ctl->wsleep, 1, 0) ? 1 : 0;
+}
+
+static int nn_shmring_mkfd (void)
+{
+    int fd;
+#if defined NN_HAVE_MEMFD
+    fd = memfd_create ("nanomsg-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (nn_slow (fd < 0))
+        return -errno;
+    return fd;
+#else
+    int rc;
+    int i;
+    uint32_t rnd;
+    char name [64];
+
+    /*  Without memfd, create a named object and unlink it straight away.
+        Only the descriptor passed to the peer keeps it alive. Such object
+        can't be sealed, so the peers have to trust each other not to
+        resize it. */
+    for (i = 0; i != 16; ++i) {
+        nn_random_generate (&rnd, sizeof (rnd));
+        snprintf (name, sizeof (name), "/nanomsg-%d-%08x",
+            (int) getpid (), (unsigned) rnd);
+        fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0) {
+            rc = shm_unlink (name);
+            errno_assert (rc == 0);
+            rc = fcntl (fd, F_SETFD, FD_CLOEXEC);
+            errno_assert (rc == 0);
+            return fd;
+        }
+        if (errno != EEXIST)
+            return -errno;
+    }
+    return -EEXIST;
+#endif
+}
+
+/*  Copies 'len' bytes starting at offset 'pos' of the message as if
+    the header and the body were a single buffer. */
+static void nn_shmring_copyin (uint8_t *dst, struct nn_msg *msg,
+    size_t pos, size_t len)
+{
+    size_t hdrsz;
+    size_t sz;
+
+    hdrsz = nn_chunkref_size (&msg->sphdr);
+    if (pos < hdrsz) {
+        sz = hdrsz - pos < len ? hdrsz - pos : len;
+        memcpy (dst, ((uint8_t*) nn_chunkref_data (&msg->sphdr)) + pos, sz);
+        dst += sz;
+        pos += sz;
+        len -= sz;
+    }
+    if (len)
+        memcpy (dst, ((uint8_t*) nn_chunkref_data (&msg->body)) +
+            (pos - hdrsz), len);
+}
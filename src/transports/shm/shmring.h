@@ -0,0 +1,101 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#ifndef NN_SHMRING_INCLUDED
+#define NN_SHMRING_INCLUDED
+
+#include "../../utils/msg.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Single-producer single-consumer ring buffer living in a shared memory
+    region. Each side of a shm connection creates the ring it writes to and
+    maps the ring its peer writes to. Messages are copied into the ring
+    directly; messages that don't fit are split into several records.
+
+    The control block is shared by both processes. Neither side trusts
+    the values written by the other one: all positions and lengths read from
+    the shared memory are validated before use. */
+
+struct nn_shmring_ctl;
+
+struct nn_shmring {
+
+    /*  Shared control block and the data area that follows it. NULL if
+        the ring is not mapped. */
+    struct nn_shmring_ctl *ctl;
+    uint8_t *data;
+
+    /*  Capacity of the data area in bytes. Always a power of two. */
+    uint32_t size;
+
+    /*  Size of the whole mapping. */
+    size_t mapsz;
+
+    /*  Local state of the message being transferred at the moment: number of
+        bytes already written/read and whether a message is in progress. */
+    size_t pos;
+    int busy;
+};
+
+void nn_shmring_init (struct nn_shmring *self);
+void nn_shmring_term (struct nn_shmring *self);
+
+/*  Creates a new ring with at least 'size' bytes of capacity, maps it and
+    returns the file descriptor of the shared region so that it can be passed
+    to the peer. Returns negative errno in case of failure. */
+int nn_shmring_create (struct nn_shmring *self, size_t size);
+
+/*  Maps the ring created by the peer. The caller retains ownership of 'fd'.
+    Returns -EPROTO if the region doesn't look like a ring. */
+int nn_shmring_attach (struct nn_shmring *self, int fd);
+
+/*  Unmaps the ring. It's OK to call this function on a ring that is not
+    mapped. */
+void nn_shmring_detach (struct nn_shmring *self);
+
+/*  Producer side. Writes as much of the message as there's space for.
+    Returns 1 if the message was fully written, in which case the caller
+    still owns the message. Returns 0 if the ring is full; the consumer has
+    been asked to wake the producer up then and the function should be called
+    again with the same message once that happens. Returns -EPROTO if
+    the ring was corrupted by the peer. */
+int nn_shmring_write (struct nn_shmring *self, struct nn_msg *msg);
+
+/*  Consumer side. Returns 1 if a complete message was read into 'msg'.
+    Returns 0 if the ring is empty; the producer has been asked to wake
+    the consumer up then. Messages larger than 'maxsz' bytes are refused
+    with -EMSGSIZE unless 'maxsz' is negative. Returns -EPROTO if the ring
+    was corrupted by the peer. */
+int nn_shmring_read (struct nn_shmring *self, struct nn_msg *msg, int maxsz);
+
+/*  To be called by the producer after writing some data. Returns 1 if
+    the consumer is sleeping and has to be notified. */
+int nn_shmring_wake_reader (struct nn_shmring *self);
+
+/*  To be called by the consumer after reading some data. Returns 1 if
+    the producer is waiting for space and has to be notified. */
+int nn_shmring_wake_writer (struct nn_shmring *self);
+
+#endif
@@ -0,0 +1,743 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "sshm.h"
+
+#include "../../utils/err.h"
+#include "../../utils/cont.h"
+#include "../../utils/fast.h"
+#include "../../utils/closefd.h"
+#include "../../utils/attr.h"
+
+/*  Single-byte messages used to exchange the ring descriptors. The acceptor
+    announces it's ready to receive the connector's ring first so that
+    the descriptor is never read ahead together with the protocol header. */
+#define NN_SSHM_HS_READY 0x52
+#define NN_SSHM_HS_RING 0x48
+
+/*  Progress of the ring exchange. */
+#define NN_SSHM_HS_SENT 1
+#define NN_SSHM_HS_RECEIVED 2
+
+/*  Wake-up notifications. */
+#define NN_SSHM_KICK_DATA 1
+#define NN_SSHM_KICK_SPACE 2
+
+/*  States of the object as a whole. */
+#define NN_SSHM_STATE_IDLE 1
+#define NN_SSHM_STATE_PROTOHDR 2
+#define NN_SSHM_STATE_STOPPING_STREAMHDR 3
+#define NN_SSHM_STATE_READY 4
+#define NN_SSHM_STATE_RINGS 5
+#define NN_SSHM_STATE_ACTIVE 6
+#define NN_SSHM_STATE_SHUTTING_DOWN 7
+#define NN_SSHM_STATE_DONE 8
+#define NN_SSHM_STATE_STOPPING 9
+
+/*  Subordinated srcptr objects. */
+#define NN_SSHM_SRC_USOCK 1
+#define NN_SSHM_SRC_STREAMHDR 2
+#define NN_SSHM_SRC_SELF 3
+
+/*  Events raised by the object to itself. */
+#define NN_SSHM_BROKEN 1
+
+/*  Possible states of the inbound part of the object. */
+#define NN_SSHM_INSTATE_WAITING 1
+#define NN_SSHM_INSTATE_HASMSG 2
+#define NN_SSHM_INSTATE_BROKEN 3
+
+/*  Possible states of the outbound part of the object. */
+#define NN_SSHM_OUTSTATE_IDLE 1
+#define NN_SSHM_OUTSTATE_SENDING 2
+#define NN_SSHM_OUTSTATE_BROKEN 3
+
+/*  Stream is a special type of pipe. Implementation of the virtual pipe API. */
+static int nn_sshm_send (struct nn_pipebase *self, struct nn_msg *msg);
+static int nn_sshm_recv (struct nn_pipebase *self, struct nn_msg *msg);
+const struct nn_pipebase_vfptr nn_sshm_pipebase_vfptr = {
+    nn_sshm_send,
+    nn_sshm_recv
+};
+
+/*  Private functions. */
+static void nn_sshm_handler (struct nn_fsm *self, int src, int type,
+    void *srcptr);
+static void nn_sshm_shutdown (struct nn_fsm *self, int src, int type,
+    void *srcptr);
+static int nn_sshm_mkring (struct nn_sshm *self);
+static void nn_sshm_sendring (struct nn_sshm *self);
+static int nn_sshm_attach (struct nn_sshm *self);
+static int nn_sshm_flush (struct nn_sshm *self);
+static int nn_sshm_fill (struct nn_sshm *self);
+static void nn_sshm_kick (struct nn_sshm *self, int kick);
+static void nn_sshm_break (struct nn_sshm *self);
+static void nn_sshm_fail (struct nn_sshm *self);
+
+void nn_sshm_init (struct nn_sshm *self, int src,
+    struct nn_ep *ep, struct nn_fsm *owner)
+{
+    nn_fsm_init (&self->fsm, nn_sshm_handler, nn_sshm_shutdown,
+        src, self, owner);
+    self->state = NN_SSHM_STATE_IDLE;
+    nn_streamhdr_init (&self->streamhdr, NN_SSHM_SRC_STREAMHDR, &self->fsm);
+    self->usock = NULL;
+    self->usock_owner.src = -1;
+    self->usock_owner.fsm = NULL;
+    nn_pipebase_init (&self->pipebase, &nn_sshm_pipebase_vfptr, ep);
+    self->connector = 0;
+    self->hsflags = 0;
+    self->outfd = -1;
+    self->infd = -1;
+    nn_shmring_init (&self->outring);
+    nn_shmring_init (&self->inring);
+    self->instate = -1;
+    nn_msg_init (&self->inmsg, 0);
+    self->outstate = -1;
+    nn_msg_init (&self->outmsg, 0);
+    self->kickpending = 0;
+    self->kicking = 0;
+    nn_fsm_event_init (&self->broken);
+    nn_fsm_event_init (&self->done);
+}
+
+void nn_sshm_term (struct nn_sshm *self)
+{
+    nn_assert_state (self, NN_SSHM_STATE_IDLE);
+
+    nn_fsm_event_term (&self->done);
+    nn_fsm_event_term (&self->broken);
+    nn_msg_term (&self->outmsg);
+    nn_msg_term (&self->inmsg);
+    nn_shmring_term (&self->inring);
+    nn_shmring_term (&self->outring);
+    nn_pipebase_term (&self->pipebase);
+    nn_streamhdr_term (&self->streamhdr);
+    nn_fsm_term (&self->fsm);
+}
+
+int nn_sshm_isidle (struct nn_sshm *self)
+{
+    return nn_fsm_isidle (&self->fsm);
+}
+
+void nn_sshm_start (struct nn_sshm *self, struct nn_usock *usock,
+    int connector)
+{
+    /*  Take ownership of the underlying socket. */
+    nn_assert (self->usock == NULL && self->usock_owner.fsm == NULL);
+    self->usock_owner.src = NN_SSHM_SRC_USOCK;
+    self->usock_owner.fsm = &self->fsm;
+    nn_usock_swap_owner (usock, &self->usock_owner);
+    self->usock = usock;
+    self->connector = connector;
+
+    /*  Launch the state machine. */
+    nn_fsm_start (&self->fsm);
+}
+
+void nn_sshm_stop (struct nn_sshm *self)
+{
+    nn_fsm_stop (&self->fsm);
+}
+
+static int nn_sshm_send (struct nn_pipebase *self, struct nn_msg *msg)
+{
+    int rc;
+    struct nn_sshm *sshm;
+
+    sshm = nn_cont (self, struct nn_sshm, pipebase);
+
+    nn_assert_state (sshm, NN_SSHM_STATE_ACTIVE);
+    nn_assert (sshm->outstate == NN_SSHM_OUTSTATE_IDLE);
+
+    /*  Move the message to the local storage. */
+    nn_msg_term (&sshm->outmsg);
+    nn_msg_mv (&sshm->outmsg, msg);
+
+    /*  Copy it into the ring. If it fits, the pipe can be used for sending
+        straight away. Otherwise wait till the peer frees some space. */
+    rc = nn_sshm_flush (sshm);
+    if (nn_fast (rc == 1)) {
+        nn_pipebase_sent (&sshm->pipebase);
+        return 0;
+    }
+    if (nn_slow (rc < 0))
+        nn_sshm_break (sshm);
+
+    return 0;
+}
+
+static int nn_sshm_recv (struct nn_pipebase *self, struct nn_msg *msg)
+{
+    int rc;
+    struct nn_sshm *sshm;
+
+    sshm = nn_cont (self, struct nn_sshm, pipebase);
+
+    nn_assert_state (sshm, NN_SSHM_STATE_ACTIVE);
+    nn_assert (sshm->instate == NN_SSHM_INSTATE_HASMSG);
+
+    /*  Move received message to the user. */
+    nn_msg_mv (msg, &sshm->inmsg);
+    nn_msg_init (&sshm->inmsg, 0);
+
+    /*  If there's another message in the ring already, make it available
+        immediately. */
+    rc = nn_sshm_fill (sshm);
+    if (nn_fast (rc == 1))
+        nn_pipebase_received (&sshm->pipebase);
+    else if (nn_slow (rc < 0))
+        nn_sshm_break (sshm);
+
+    return 0;
+}
+
+static void nn_sshm_shutdown (struct nn_fsm *self, int src, int type,
+    NN_UNUSED void *srcptr)
+{
+    struct nn_sshm *sshm;
+
+    sshm = nn_cont (self, struct nn_sshm, fsm);
+
+    if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
+        nn_pipebase_stop (&sshm->pipebase);
+        nn_streamhdr_stop (&sshm->streamhdr);
+        sshm->state = NN_SSHM_STATE_STOPPING;
+    }
+    if (nn_slow (sshm->state == NN_SSHM_STATE_STOPPING)) {
+        if (nn_streamhdr_isidle (&sshm->streamhdr)) {
+            nn_usock_swap_owner (sshm->usock, &sshm->usock_owner);
+            sshm->usock = NULL;
+            sshm->usock_owner.src = -1;
+            sshm->usock_owner.fsm = NULL;
+            if (sshm->outfd >= 0) {
+                nn_closefd (sshm->outfd);
+                sshm->outfd = -1;
+            }
+            if (sshm->infd >= 0) {
+                nn_closefd (sshm->infd);
+                sshm->infd = -1;
+            }
+            nn_shmring_detach (&sshm->outring);
+            nn_shmring_detach (&sshm->inring);
+            sshm->state = NN_SSHM_STATE_IDLE;
+            nn_fsm_stopped (&sshm->fsm, NN_SSHM_STOPPED);
+            return;
+        }
+        return;
+    }
+
+    nn_fsm_bad_state(sshm->state, src, type);
+}
+
+static void nn_sshm_handler (struct nn_fsm *self, int src, int type,
+    NN_UNUSED void *srcptr)
+{
+    int rc;
+    int kick;
+    struct nn_sshm *sshm;
+    struct nn_iovec iov;
+
+    sshm = nn_cont (self, struct nn_sshm, fsm);
+
+    /*  Notification about the broken ring may be delivered after
+        the connection was already closed for a different reason. */
+    if (nn_slow (src == NN_SSHM_SRC_SELF &&
+          sshm->state != NN_SSHM_STATE_ACTIVE))
+        return;
+
+    switch (sshm->state) {
+
+/******************************************************************************/
+/*  IDLE state.                                                               */
+/******************************************************************************/
+    case NN_SSHM_STATE_IDLE:
+        switch (src) {
+
+        case NN_FSM_ACTION:
+            switch (type) {
+            case NN_FSM_START:
+                nn_streamhdr_start (&sshm->streamhdr, sshm->usock,
+                    &sshm->pipebase);
+                sshm->state = NN_SSHM_STATE_PROTOHDR;
+                return;
+            default:
+                nn_fsm_bad_action (sshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (sshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  PROTOHDR state.                                                           */
+/******************************************************************************/
+    case NN_SSHM_STATE_PROTOHDR:
+        switch (src) {
+
+        case NN_SSHM_SRC_STREAMHDR:
+            switch (type) {
+            case NN_STREAMHDR_OK:
+
+                /*  Before exchanging the rings stop the streamhdr
+                    state machine. */
+                nn_streamhdr_stop (&sshm->streamhdr);
+                sshm->state = NN_SSHM_STATE_STOPPING_STREAMHDR;
+                return;
+
+            case NN_STREAMHDR_ERROR:
+
+                /* Raise the error and move directly to the DONE state.
+                   streamhdr object will be stopped later on. */
+                sshm->state = NN_SSHM_STATE_DONE;
+                nn_fsm_raise (&sshm->fsm, &sshm->done, NN_SSHM_ERROR);
+                return;
+
+            default:
+                nn_fsm_bad_action (sshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (sshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  STOPPING_STREAMHDR state.                                                 */
+/******************************************************************************/
+    case NN_SSHM_STATE_STOPPING_STREAMHDR:
+        switch (src) {
+
+        case NN_SSHM_SRC_STREAMHDR:
+            switch (type) {
+            case NN_STREAMHDR_STOPPED:
+
+                /*  The connector waits till the acceptor is ready to receive
+                    the ring. The acceptor says it's ready and waits for
+                    the connector's ring. */
+                sshm->hsflags = 0;
+                sshm->state = NN_SSHM_STATE_READY;
+                if (sshm->connector) {
+                    nn_usock_recv (sshm->usock, &sshm->hsin, 1, NULL);
+                    return;
+                }
+                sshm->hsout = NN_SSHM_HS_READY;
+                iov.iov_base = &sshm->hsout;
+                iov.iov_len = 1;
+                nn_usock_send (sshm->usock, &iov, 1);
+                nn_usock_recv (sshm->usock, &sshm->hsin, 1, &sshm->infd);
+                return;
+
+            default:
+                nn_fsm_bad_action (sshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (sshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  READY state.                                                              */
+/*  Connector is waiting for the acceptor to get ready. Acceptor is waiting   */
+/*  for the connector's ring.                                                 */
+/******************************************************************************/
+    case NN_SSHM_STATE_READY:
+        switch (src) {
+
+        case NN_SSHM_SRC_USOCK:
+            switch (type) {
+            case NN_USOCK_SENT:
+                nn_assert (!sshm->connector);
+                sshm->hsflags |= NN_SSHM_HS_SENT;
+                break;
+
+            case NN_USOCK_RECEIVED:
+                if (sshm->connector) {
+                    if (nn_slow (sshm->hsin != NN_SSHM_HS_READY)) {
+                        nn_sshm_fail (sshm);
+                        return;
+                    }
+                    rc = nn_sshm_mkring (sshm);
+                    if (nn_slow (rc < 0)) {
+                        nn_sshm_fail (sshm);
+                        return;
+                    }
+                    nn_sshm_sendring (sshm);
+                    nn_usock_recv (sshm->usock, &sshm->hsin, 1, &sshm->infd);
+                    sshm->hsflags = 0;
+                    sshm->state = NN_SSHM_STATE_RINGS;
+                    return;
+                }
+                sshm->hsflags |= NN_SSHM_HS_RECEIVED;
+                break;
+
+            case NN_USOCK_SHUTDOWN:
+                sshm->state = NN_SSHM_STATE_SHUTTING_DOWN;
+                return;
+
+            case NN_USOCK_ERROR:
+                sshm->state = NN_SSHM_STATE_DONE;
+                nn_fsm_raise (&sshm->fsm, &sshm->done, NN_SSHM_ERROR);
+                return;
+
+            default:
+                nn_fsm_bad_action (sshm->state, src, type);
+            }
+
+            /*  Acceptor has got the connector's ring. Map it and send
+                its own ring in return. */
+            if (sshm->hsflags != (NN_SSHM_HS_SENT | NN_SSHM_HS_RECEIVED))
+                return;
+            rc = nn_sshm_attach (sshm);
+            if (nn_fast (rc == 0))
+                rc = nn_sshm_mkring (sshm);
+            if (nn_slow (rc < 0)) {
+                nn_sshm_fail (sshm);
+                return;
+            }
+            nn_sshm_sendring (sshm);
+            sshm->hsflags = NN_SSHM_HS_RECEIVED;
+            sshm->state = NN_SSHM_STATE_RINGS;
+            return;
+
+        default:
+            nn_fsm_bad_source (sshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  RINGS state.                                                              */
+/*  The local ring is being sent to the peer. Connector is also waiting for   */
+/*  the acceptor's ring.                                                      */
+/******************************************************************************/
+    case NN_SSHM_STATE_RINGS:
+        switch (src) {
+
+        case NN_SSHM_SRC_USOCK:
+            switch (type) {
+            case NN_USOCK_SENT:
+
+                /*  The peer has its own reference to the region now. */
+                nn_closefd (sshm->outfd);
+                sshm->outfd = -1;
+                sshm->hsflags |= NN_SSHM_HS_SENT;
+                break;
+
+            case NN_USOCK_RECEIVED:
+                nn_assert (sshm->connector);
+                rc = nn_sshm_attach (sshm);
+                if (nn_slow (rc < 0)) {
+                    nn_sshm_fail (sshm);
+                    return;
+                }
+                sshm->hsflags |= NN_SSHM_HS_RECEIVED;
+                break;
+
+            case NN_USOCK_SHUTDOWN:
+                sshm->state = NN_SSHM_STATE_SHUTTING_DOWN;
+                return;
+
+            case NN_USOCK_ERROR:
+                sshm->state = NN_SSHM_STATE_DONE;
+                nn_fsm_raise (&sshm->fsm, &sshm->done, NN_SSHM_ERROR);
+                return;
+
+            default:
+                nn_fsm_bad_action (sshm->state, src, type);
+            }
+
+            if (sshm->hsflags != (NN_SSHM_HS_SENT | NN_SSHM_HS_RECEIVED))
+                return;
+
+            /*  Both rings are mapped now. Start the pipe. */
+            rc = nn_pipebase_start (&sshm->pipebase);
+            if (nn_slow (rc < 0)) {
+                sshm->state = NN_SSHM_STATE_DONE;
+                nn_fsm_raise (&sshm->fsm, &sshm->done, NN_SSHM_ERROR);
+                return;
+            }
+            sshm->state = NN_SSHM_STATE_ACTIVE;
+
+            /*  Mark the pipe as available for sending. */
+            sshm->outstate = NN_SSHM_OUTSTATE_IDLE;
+
+            /*  From now on the socket carries only wake-up notifications. */
+            sshm->kicking = 0;
+            sshm->kickpending = 0;
+            nn_usock_recv (sshm->usock, &sshm->kickin, 1, NULL);
+
+            /*  The peer may have written some messages already. */
+            sshm->instate = NN_SSHM_INSTATE_WAITING;
+            rc = nn_sshm_fill (sshm);
+            if (rc == 1)
+                nn_pipebase_received (&sshm->pipebase);
+            else if (nn_slow (rc < 0))
+                nn_sshm_fail (sshm);
+            return;
+
+        default:
+            nn_fsm_bad_source (sshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  ACTIVE state.                                                             */
+/******************************************************************************/
+    case NN_SSHM_STATE_ACTIVE:
+        switch (src) {
+
+        case NN_SSHM_SRC_USOCK:
+            switch (type) {
+            case NN_USOCK_SENT:
+
+                /*  Notification was sent. Send the ones raised in
+                    the meantime, if any. */
+                nn_assert (sshm->kicking);
+                sshm->kicking = 0;
+                if (sshm->kickpending) {
+                    kick = sshm->kickpending;
+                    sshm->kickpending = 0;
+                    nn_sshm_kick (sshm, kick);
+                }
+                return;
+
+            case NN_USOCK_RECEIVED:
+
+                /*  The peer has freed some space in the ring or written
+                    new data into it. Resume whatever was waiting. */
+                kick = sshm->kickin;
+                if ((kick & NN_SSHM_KICK_SPACE) &&
+                      sshm->outstate == NN_SSHM_OUTSTATE_SENDING) {
+                    rc = nn_sshm_flush (sshm);
+                    if (nn_slow (rc < 0)) {
+                        nn_sshm_fail (sshm);
+                        return;
+                    }
+                    if (rc == 1)
+                        nn_pipebase_sent (&sshm->pipebase);
+                }
+                if ((kick & NN_SSHM_KICK_DATA) &&
+                      sshm->instate == NN_SSHM_INSTATE_WAITING) {
+                    rc = nn_sshm_fill (sshm);
+                    if (nn_slow (rc < 0)) {
+                        nn_sshm_fail (sshm);
+                        return;
+                    }
+                    if (rc == 1)
+                        nn_pipebase_received (&sshm->pipebase);
+                }
+                nn_usock_recv (sshm->usock, &sshm->kickin, 1, NULL);
+                return;
+
+            case NN_USOCK_SHUTDOWN:
+                nn_pipebase_stop (&sshm->pipebase);
+                sshm->state = NN_SSHM_STATE_SHUTTING_DOWN;
+                return;
+
+            case NN_USOCK_ERROR:
+                nn_pipebase_stop (&sshm->pipebase);
+                sshm->state = NN_SSHM_STATE_DONE;
+                nn_fsm_raise (&sshm->fsm, &sshm->done, NN_SSHM_ERROR);
+                return;
+
+            default:
+                nn_fsm_bad_action (sshm->state, src, type);
+            }
+
+        case NN_SSHM_SRC_SELF:
+            switch (type) {
+            case NN_SSHM_BROKEN:
+                nn_sshm_fail (sshm);
+                return;
+            default:
+                nn_fsm_bad_action (sshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (sshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  SHUTTING_DOWN state.                                                      */
+/*  The underlying connection is closed. We are just waiting that underlying  */
+/*  usock being closed                                                        */
+/******************************************************************************/
+    case NN_SSHM_STATE_SHUTTING_DOWN:
+        switch (src) {
+
+        case NN_SSHM_SRC_USOCK:
+            switch (type) {
+            case NN_USOCK_SENT:
+            case NN_USOCK_RECEIVED:
+                return;
+            case NN_USOCK_ERROR:
+                sshm->state = NN_SSHM_STATE_DONE;
+                nn_fsm_raise (&sshm->fsm, &sshm->done, NN_SSHM_ERROR);
+                return;
+            default:
+                nn_fsm_bad_action (sshm->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (sshm->state, src, type);
+        }
+
+/******************************************************************************/
+/*  DONE state.                                                               */
+/*  The connection is closed or the peer has misbehaved. There's nothing     */
+/*  that can be done in this state except stopping the object. Completions   */
+/*  of operations that were in progress on the socket are ignored.            */
+/******************************************************************************/
+    case NN_SSHM_STATE_DONE:
+        if (src == NN_SSHM_SRC_USOCK)
+            return;
+        nn_fsm_bad_source (sshm->state, src, type);
+
+/******************************************************************************/
+/*  Invalid state.                                                            */
+/******************************************************************************/
+    default:
+        nn_fsm_bad_state (sshm->state, src, type);
+    }
+}
+
+/*  Creates the ring this side writes to. Its size is derived from
+    the NN_SNDBUF option. */
+static int nn_sshm_mkring (struct nn_sshm *self)
+{
+    int rc;
+    int sndbuf;
+    size_t sz;
+
+    sz = sizeof (sndbuf);
+    nn_pipebase_getopt (&self->pipebase, NN_SOL_SOCKET, NN_SNDBUF,
+        &sndbuf, &sz);
+    nn_assert (sz == sizeof (sndbuf));
+    rc = nn_shmring_create (&self->outring, (size_t) sndbuf);
+    if (nn_slow (rc < 0))
+        return rc;
+    self->outfd = rc;
+    return 0;
+}
+
+static void nn_sshm_sendring (struct nn_sshm *self)
+{
+    struct nn_iovec iov;
+
+    self->hsout = NN_SSHM_HS_RING;
+    iov.iov_base = &self->hsout;
+    iov.iov_len = 1;
+    nn_usock_send_fd (self->usock, &iov, 1, self->outfd);
+}
+
+/*  Maps the ring received from the peer. */
+static int nn_sshm_attach (struct nn_sshm *self)
+{
+    int rc;
+
+    if (nn_slow (self->hsin != NN_SSHM_HS_RING || self->infd < 0))
+        return -EPROTO;
+    rc = nn_shmring_attach (&self->inring, self->infd);
+    nn_closefd (self->infd);
+    self->infd = -1;
+    return rc;
+}
+
+/*  Writes the pending outbound message into the ring. Returns 1 if it was
+    written fully, 0 if the ring is full, negative number on error. */
+static int nn_sshm_flush (struct nn_sshm *self)
+{
+    int rc;
+
+    rc = nn_shmring_write (&self->outring, &self->outmsg);
+    if (nn_slow (rc < 0)) {
+        self->outstate = NN_SSHM_OUTSTATE_BROKEN;
+        return rc;
+    }
+    if (nn_shmring_wake_reader (&self->outring))
+        nn_sshm_kick (self, NN_SSHM_KICK_DATA);
+    if (rc == 0) {
+        self->outstate = NN_SSHM_OUTSTATE_SENDING;
+        return 0;
+    }
+    nn_msg_term (&self->outmsg);
+    nn_msg_init (&self->outmsg, 0);
+    self->outstate = NN_SSHM_OUTSTATE_IDLE;
+    return 1;
+}
+
+/*  Reads next message from the ring into 'inmsg'. Returns 1 if there's one,
+    0 if the ring is empty, negative number on error. */
+static int nn_sshm_fill (struct nn_sshm *self)
+{
+    int rc;
+    int maxsz;
+    size_t sz;
+
+    sz = sizeof (maxsz);
+    nn_pipebase_getopt (&self->pipebase, NN_SOL_SOCKET, NN_RCVMAXSIZE,
+        &maxsz, &sz);
+    nn_assert (sz == sizeof (maxsz));
+
+    /*  Oversized messages cause the connection to be dropped, same as with
+        the other transports. */
+    rc = nn_shmring_read (&self->inring, &self->inmsg, maxsz);
+    if (nn_slow (rc < 0)) {
+        self->instate = NN_SSHM_INSTATE_BROKEN;
+        return rc;
+    }
+    if (nn_shmring_wake_writer (&self->inring))
+        nn_sshm_kick (self, NN_SSHM_KICK_SPACE);
+    self->instate = rc == 1 ? NN_SSHM_INSTATE_HASMSG :
+        NN_SSHM_INSTATE_WAITING;
+    return rc;
+}
+
+static void nn_sshm_kick (struct nn_sshm *self, int kick)
+{
+    struct nn_iovec iov;
+
+    if (self->kicking) {
+        self->kickpending |= kick;
+        return;
+    }
+    self->kicking = 1;
+    self->kickout = (uint8_t) kick;
+    iov.iov_base = &self->kickout;
+    iov.iov_len = 1;
+    nn_usock_send (self->usock, &iov, 1);
+}
+
+/*  The peer has corrupted the ring. This is called from within the pipe
+    API, so the state machine can't be moved directly. */
+static void nn_sshm_break (struct nn_sshm *self)
+{
+    if (!nn_fsm_event_active (&self->broken))
+        nn_fsm_raiseto (&self->fsm, &self->fsm, &self->broken,
+            NN_SSHM_SRC_SELF, NN_SSHM_BROKEN, self);
+}
+
+static void nn_sshm_fail (struct nn_sshm *self)
+{
+    nn_pipebase_stop (&self->pipebase);
+    self->state = NN_SSHM_STATE_DONE;
+    nn_fsm_raise (&self->fsm, &self->done, NN_SSHM_ERROR);
+}
@@ -0,0 +1,118 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#ifndef NN_SSHM_INCLUDED
+#define NN_SSHM_INCLUDED
+
+#include "../../transport.h"
+
+#include "../../aio/fsm.h"
+#include "../../aio/usock.h"
+
+#include "../utils/streamhdr.h"
+
+#include "../../utils/msg.h"
+
+#include "shmring.h"
+
+/*  This state machine handles shm connection from the point where the Unix
+    domain socket is established to the point when it is broken. The socket
+    is used to exchange the protocol header and the descriptors of
+    the shared memory rings. Afterwards it only carries single-byte wake-up
+    notifications, which are sent only if the peer is actually sleeping. */
+
+#define NN_SSHM_ERROR 1
+#define NN_SSHM_STOPPED 2
+
+struct nn_sshm {
+
+    /*  The state machine. */
+    struct nn_fsm fsm;
+    int state;
+
+    /*  The underlying socket. */
+    struct nn_usock *usock;
+
+    /*  Child state machine to do protocol header exchange. */
+    struct nn_streamhdr streamhdr;
+
+    /*  The original owner of the underlying socket. */
+    struct nn_fsm_owner usock_owner;
+
+    /*  Pipe connecting this shm connection to the nanomsg core. */
+    struct nn_pipebase pipebase;
+
+    /*  1 if this side has initiated the connection, 0 if it has accepted it.
+        The two sides exchange the ring descriptors in a fixed order. */
+    int connector;
+
+    /*  Progress of the ring exchange. */
+    int hsflags;
+    uint8_t hsin;
+    uint8_t hsout;
+
+    /*  Descriptor of the local ring, kept open until it's passed to the peer,
+        and descriptor of the peer's ring as received. */
+    int outfd;
+    int infd;
+
+    /*  The ring this side writes to and the ring the peer writes to. */
+    struct nn_shmring outring;
+    struct nn_shmring inring;
+
+    /*  State of inbound state machine. */
+    int instate;
+
+    /*  Message being received at the moment. */
+    struct nn_msg inmsg;
+
+    /*  State of the outbound state machine. */
+    int outstate;
+
+    /*  Message being sent at the moment. */
+    struct nn_msg outmsg;
+
+    /*  Wake-up notifications. Only one can be in flight at a time; those
+        raised in the meantime are merged into 'kickpending'. */
+    uint8_t kickin;
+    uint8_t kickout;
+    int kickpending;
+    int kicking;
+
+    /*  Raised to itself when the peer corrupts the ring. */
+    struct nn_fsm_event broken;
+
+    /*  Event raised when the state machine ends. */
+    struct nn_fsm_event done;
+};
+
+void nn_sshm_init (struct nn_sshm *self, int src,
+    struct nn_ep *ep, struct nn_fsm *owner);
+void nn_sshm_term (struct nn_sshm *self);
+
+int nn_sshm_isidle (struct nn_sshm *self);
+void nn_sshm_start (struct nn_sshm *self, struct nn_usock *usock,
+    int connector);
+void nn_sshm_stop (struct nn_sshm *self);
+
+#endif
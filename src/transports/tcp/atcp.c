@@ -206,6 +206,15 @@ static void nn_atcp_handler (struct nn_fsm *self, int src, int type,
                 nn_assert (sz == sizeof (val));
                 nn_usock_setsockopt (&atcp->usock, IPPROTO_TCP, TCP_NODELAY,
                     &val, sizeof (val));
+#if defined TCP_USER_TIMEOUT
+                sz = sizeof (val);
+                nn_ep_getopt (atcp->ep, NN_TCP, NN_TCP_USER_TIMEOUT,
+                    &val, &sz);
+                nn_assert (sz == sizeof (val));
+                if (val > 0)
+                    nn_usock_setsockopt (&atcp->usock, IPPROTO_TCP,
+                        TCP_USER_TIMEOUT, &val, sizeof (val));
+#endif
 
                 /*  Return ownership of the listening socket to the parent. */
                 nn_usock_swap_owner (atcp->listener, &atcp->listener_owner);
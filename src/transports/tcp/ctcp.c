@@ -34,6 +34,7 @@
 
 #include "../../aio/fsm.h"
 #include "../../aio/usock.h"
+#include "../../aio/timer.h"
 
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
@@ -62,11 +63,13 @@
 #define NN_CTCP_STATE_STOPPING_BACKOFF 9
 #define NN_CTCP_STATE_STOPPING_STCP_FINAL 10
 #define NN_CTCP_STATE_STOPPING 11
+#define NN_CTCP_STATE_STOPPING_ATTEMPTS 12
 
 #define NN_CTCP_SRC_USOCK 1
 #define NN_CTCP_SRC_RECONNECT_TIMER 2
 #define NN_CTCP_SRC_DNS 3
 #define NN_CTCP_SRC_STCP 4
+#define NN_CTCP_SRC_DELAY_TIMER 5
 
 struct nn_ctcp {
 
@@ -76,8 +79,28 @@ struct nn_ctcp {
 
     struct nn_ep *ep;
 
-    /*  The underlying TCP socket. */
-    struct nn_usock usock;
+    /*  The underlying TCP sockets. If the name resolves to several
+        addresses, connection attempts to them are made in parallel, staggered
+        by 'delay' milliseconds, as described in RFC 8305. Socket N is used
+        to connect to address N. The first one to connect wins, the others
+        are closed. */
+    struct nn_usock usocks [NN_DNS_MAXADDRS];
+    int winner;
+
+    /*  Index of the next address to try. */
+    int next;
+
+    /*  Bitmask of sockets with connection attempt in progress. */
+    int inflight;
+
+    /*  Used to wait before starting the next connection attempt. */
+    struct nn_timer delay_timer;
+    int delay;
+
+    /*  Local address to bind the sockets to, if any. */
+    struct sockaddr_storage local;
+    size_t locallen;
+    int haslocal;
 
     /*  Used to wait before retrying to connect. */
     struct nn_backoff retry;
@@ -106,8 +129,13 @@ static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
 static void nn_ctcp_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_ctcp_start_resolving (struct nn_ctcp *self);
-static void nn_ctcp_start_connecting (struct nn_ctcp *self,
-    struct sockaddr_storage *ss, size_t sslen);
+static void nn_ctcp_start_connecting (struct nn_ctcp *self);
+static void nn_ctcp_start_attempt (struct nn_ctcp *self);
+static int nn_ctcp_connect (struct nn_ctcp *self, int i);
+static void nn_ctcp_next_attempt (struct nn_ctcp *self);
+static void nn_ctcp_check_attempts (struct nn_ctcp *self);
+static int nn_ctcp_index (struct nn_ctcp *self, void *srcptr);
+static int nn_ctcp_count (int mask);
 
 int nn_ctcp_create (struct nn_ep *ep)
 {
@@ -126,6 +154,7 @@ int nn_ctcp_create (struct nn_ep *ep)
     int reconnect_ivl;
     int reconnect_ivl_max;
     size_t sz;
+    int i;
 
     /*  Allocate the new endpoint object. */
     self = nn_alloc (sizeof (struct nn_ctcp), "ctcp");
@@ -161,9 +190,7 @@ int nn_ctcp_create (struct nn_ep *ep)
 
     /*  Check whether the host portion of the address is either a literal
         or a valid hostname. */
-    if (nn_dns_check_hostname (hostname, colon - hostname) < 0 &&
-          nn_literal_resolve (hostname, colon - hostname, ipv4only,
-          &ss, &sslen) < 0) {
+    if (nn_dns_check_hostlist (hostname, colon - hostname, ipv4only) < 0) {
         nn_free (self);
         return -EINVAL;
     }
@@ -181,7 +208,15 @@ int nn_ctcp_create (struct nn_ep *ep)
     nn_fsm_init_root (&self->fsm, nn_ctcp_handler, nn_ctcp_shutdown,
         nn_ep_getctx (ep));
     self->state = NN_CTCP_STATE_IDLE;
-    nn_usock_init (&self->usock, NN_CTCP_SRC_USOCK, &self->fsm);
+    for (i = 0; i != NN_DNS_MAXADDRS; ++i)
+        nn_usock_init (&self->usocks [i], NN_CTCP_SRC_USOCK, &self->fsm);
+    self->winner = -1;
+    self->next = 0;
+    self->inflight = 0;
+    nn_timer_init (&self->delay_timer, NN_CTCP_SRC_DELAY_TIMER, &self->fsm);
+    sz = sizeof (self->delay);
+    nn_ep_getopt (ep, NN_TCP, NN_TCP_CONNECT_DELAY, &self->delay, &sz);
+    nn_assert (sz == sizeof (self->delay));
     sz = sizeof (reconnect_ivl);
     nn_ep_getopt (ep, NN_SOL_SOCKET, NN_RECONNECT_IVL, &reconnect_ivl, &sz);
     nn_assert (sz == sizeof (reconnect_ivl));
@@ -212,11 +247,14 @@ static void nn_ctcp_stop (void *self)
 static void nn_ctcp_destroy (void *self)
 {
     struct nn_ctcp *ctcp = self;
+    int i;
 
     nn_dns_term (&ctcp->dns);
     nn_stcp_term (&ctcp->stcp);
     nn_backoff_term (&ctcp->retry);
-    nn_usock_term (&ctcp->usock);
+    nn_timer_term (&ctcp->delay_timer);
+    for (i = 0; i != NN_DNS_MAXADDRS; ++i)
+        nn_usock_term (&ctcp->usocks [i]);
     nn_fsm_term (&ctcp->fsm);
 
     nn_free (ctcp);
@@ -226,6 +264,7 @@ static void nn_ctcp_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
     struct nn_ctcp *ctcp;
+    int i;
 
     ctcp = nn_cont (self, struct nn_ctcp, fsm);
 
@@ -240,15 +279,23 @@ static void nn_ctcp_shutdown (struct nn_fsm *self, int src, int type,
         if (!nn_stcp_isidle (&ctcp->stcp))
             return;
         nn_backoff_stop (&ctcp->retry);
-        nn_usock_stop (&ctcp->usock);
+        nn_timer_stop (&ctcp->delay_timer);
+        for (i = 0; i != NN_DNS_MAXADDRS; ++i)
+            nn_usock_stop (&ctcp->usocks [i]);
+        nn_ep_stat_increment (ctcp->ep, NN_STAT_INPROGRESS_CONNECTIONS,
+            -nn_ctcp_count (ctcp->inflight));
+        ctcp->inflight = 0;
         nn_dns_stop (&ctcp->dns);
         ctcp->state = NN_CTCP_STATE_STOPPING;
     }
     if (nn_slow (ctcp->state == NN_CTCP_STATE_STOPPING)) {
         if (!nn_backoff_isidle (&ctcp->retry) ||
-              !nn_usock_isidle (&ctcp->usock) ||
+              !nn_timer_isidle (&ctcp->delay_timer) ||
               !nn_dns_isidle (&ctcp->dns))
             return;
+        for (i = 0; i != NN_DNS_MAXADDRS; ++i)
+            if (!nn_usock_isidle (&ctcp->usocks [i]))
+                return;
         ctcp->state = NN_CTCP_STATE_IDLE;
         nn_fsm_stopped_noevent (&ctcp->fsm);
         nn_ep_stopped (ctcp->ep);
@@ -259,9 +306,10 @@ static void nn_ctcp_shutdown (struct nn_fsm *self, int src, int type,
 }
 
 static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
-    NN_UNUSED void *srcptr)
+    void *srcptr)
 {
     struct nn_ctcp *ctcp;
+    int i;
 
     ctcp = nn_cont (self, struct nn_ctcp, fsm);
 
@@ -319,8 +367,7 @@ static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_DNS_STOPPED:
                 if (ctcp->dns_result.error == 0) {
-                    nn_ctcp_start_connecting (ctcp, &ctcp->dns_result.addr,
-                        ctcp->dns_result.addrlen);
+                    nn_ctcp_start_connecting (ctcp);
                     return;
                 }
                 nn_backoff_start (&ctcp->retry);
@@ -336,30 +383,101 @@ static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
 
 /******************************************************************************/
 /*  CONNECTING state.                                                         */
-/*  Non-blocking connect is under way.                                        */
+/*  Non-blocking connects are under way.                                      */
 /******************************************************************************/
     case NN_CTCP_STATE_CONNECTING:
         switch (src) {
 
         case NN_CTCP_SRC_USOCK:
+            i = nn_ctcp_index (ctcp, srcptr);
             switch (type) {
             case NN_USOCK_CONNECTED:
-                nn_stcp_start (&ctcp->stcp, &ctcp->usock);
-                ctcp->state = NN_CTCP_STATE_ACTIVE;
-                nn_ep_stat_increment (ctcp->ep,
-                    NN_STAT_INPROGRESS_CONNECTIONS, -1);
+
+                /*  We have a winner. Close all the other sockets. */
+                ctcp->inflight &= ~(1 << i);
                 nn_ep_stat_increment (ctcp->ep,
-                    NN_STAT_ESTABLISHED_CONNECTIONS, 1);
-                nn_ep_clear_error (ctcp->ep);
+                    NN_STAT_INPROGRESS_CONNECTIONS,
+                    -1 - nn_ctcp_count (ctcp->inflight));
+                ctcp->inflight = 0;
+                ctcp->winner = i;
+                nn_timer_stop (&ctcp->delay_timer);
+                for (i = 0; i != NN_DNS_MAXADDRS; ++i)
+                    if (i != ctcp->winner)
+                        nn_usock_stop (&ctcp->usocks [i]);
+                ctcp->state = NN_CTCP_STATE_STOPPING_ATTEMPTS;
+                nn_ctcp_check_attempts (ctcp);
                 return;
             case NN_USOCK_ERROR:
-                nn_ep_set_error (ctcp->ep, nn_usock_geterrno (&ctcp->usock));
-                nn_usock_stop (&ctcp->usock);
-                ctcp->state = NN_CTCP_STATE_STOPPING_USOCK;
+                nn_ep_set_error (ctcp->ep,
+                    nn_usock_geterrno (&ctcp->usocks [i]));
+                nn_usock_stop (&ctcp->usocks [i]);
+                ctcp->inflight &= ~(1 << i);
                 nn_ep_stat_increment (ctcp->ep,
                     NN_STAT_INPROGRESS_CONNECTIONS, -1);
                 nn_ep_stat_increment (ctcp->ep, NN_STAT_CONNECT_ERRORS, 1);
                 return;
+            case NN_USOCK_SHUTDOWN:
+                return;
+            case NN_USOCK_STOPPED:
+
+                /*  The attempt failed. Don't wait for the delay to expire
+                    before trying the next address. */
+                if (ctcp->next < ctcp->dns_result.naddrs) {
+                    if (nn_timer_isidle (&ctcp->delay_timer))
+                        nn_ctcp_start_attempt (ctcp);
+                    else
+                        nn_timer_stop (&ctcp->delay_timer);
+                    return;
+                }
+                nn_ctcp_next_attempt (ctcp);
+                return;
+            default:
+                nn_fsm_bad_action (ctcp->state, src, type);
+            }
+
+        case NN_CTCP_SRC_DELAY_TIMER:
+            switch (type) {
+            case NN_TIMER_TIMEOUT:
+                nn_timer_stop (&ctcp->delay_timer);
+                return;
+            case NN_TIMER_STOPPED:
+                nn_ctcp_next_attempt (ctcp);
+                return;
+            default:
+                nn_fsm_bad_action (ctcp->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (ctcp->state, src, type);
+        }
+
+/******************************************************************************/
+/*  STOPPING_ATTEMPTS state.                                                  */
+/*  One of the sockets has connected. Waiting for the others to close.        */
+/******************************************************************************/
+    case NN_CTCP_STATE_STOPPING_ATTEMPTS:
+        switch (src) {
+
+        case NN_CTCP_SRC_USOCK:
+            switch (type) {
+            case NN_USOCK_STOPPED:
+                nn_ctcp_check_attempts (ctcp);
+                return;
+            default:
+
+                /*  Events that were already on the way from the sockets
+                    being closed are of no interest. */
+                nn_assert (srcptr != &ctcp->usocks [ctcp->winner]);
+                return;
+            }
+
+        case NN_CTCP_SRC_DELAY_TIMER:
+            switch (type) {
+            case NN_TIMER_TIMEOUT:
+                return;
+            case NN_TIMER_STOPPED:
+                nn_ctcp_check_attempts (ctcp);
+                return;
             default:
                 nn_fsm_bad_action (ctcp->state, src, type);
             }
@@ -402,7 +520,7 @@ static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
             case NN_USOCK_SHUTDOWN:
                 return;
             case NN_STCP_STOPPED:
-                nn_usock_stop (&ctcp->usock);
+                nn_usock_stop (&ctcp->usocks [ctcp->winner]);
                 ctcp->state = NN_CTCP_STATE_STOPPING_USOCK;
                 return;
             default:
@@ -520,10 +638,74 @@ static void nn_ctcp_start_resolving (struct nn_ctcp *self)
     self->state = NN_CTCP_STATE_RESOLVING;
 }
 
-static void nn_ctcp_start_connecting (struct nn_ctcp *self,
-    struct sockaddr_storage *ss, size_t sslen)
+static void nn_ctcp_start_connecting (struct nn_ctcp *self)
+{
+    int rc;
+    const char *addr;
+    const char *semicolon;
+    int ipv4only;
+    size_t ipv4onlylen;
+
+    addr = nn_ep_getaddr (self->ep);
+
+    /*  Check whether IPv6 is to be used. */
+    ipv4onlylen = sizeof (ipv4only);
+    nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_IPV4ONLY,
+        &ipv4only, &ipv4onlylen);
+    nn_assert (ipv4onlylen == sizeof (ipv4only));
+
+    /*  Parse the local address, if any. If there's none, each socket will be
+        bound to the wildcard address of the family it's connecting to. */
+    semicolon = strchr (addr, ';');
+    self->haslocal = 0;
+    if (semicolon) {
+        memset (&self->local, 0, sizeof (self->local));
+        rc = nn_iface_resolve (addr, semicolon - addr, ipv4only,
+            &self->local, &self->locallen);
+        if (nn_slow (rc < 0)) {
+            nn_backoff_start (&self->retry);
+            self->state = NN_CTCP_STATE_WAITING;
+            return;
+        }
+        self->haslocal = 1;
+    }
+
+    self->next = 0;
+    self->winner = -1;
+    self->state = NN_CTCP_STATE_CONNECTING;
+    nn_ctcp_start_attempt (self);
+}
+
+static void nn_ctcp_start_attempt (struct nn_ctcp *self)
+{
+    int rc;
+
+    while (self->next < self->dns_result.naddrs) {
+        rc = nn_ctcp_connect (self, self->next++);
+
+        /*  The socket failed before it was able to connect and is being
+            closed. The next attempt will be made once it's stopped. */
+        if (rc > 0)
+            return;
+
+        if (rc == 0) {
+            if (self->next < self->dns_result.naddrs)
+                nn_timer_start (&self->delay_timer, self->delay);
+            return;
+        }
+    }
+
+    /*  No more addresses to try. */
+    nn_ctcp_next_attempt (self);
+}
+
+/*  Starts connecting socket 'i' to address 'i'. Returns 0 if connecting is
+    under way, 1 if the socket failed and is being stopped and negative error
+    code if the socket couldn't be created at all. */
+static int nn_ctcp_connect (struct nn_ctcp *self, int i)
 {
     int rc;
+    struct nn_usock *usock;
     struct sockaddr_storage remote;
     size_t remotelen;
     struct sockaddr_storage local;
@@ -531,47 +713,23 @@ static void nn_ctcp_start_connecting (struct nn_ctcp *self,
     const char *addr;
     const char *end;
     const char *colon;
-    const char *semicolon;
     uint16_t port;
-    int ipv4only;
-    size_t ipv4onlylen;
     int val;
     size_t sz;
 
-    /*  Create IP address from the address string. */
-    addr = nn_ep_getaddr (self->ep);
-    memset (&remote, 0, sizeof (remote));
+    usock = &self->usocks [i];
 
     /*  Parse the port. */
+    addr = nn_ep_getaddr (self->ep);
     end = addr + strlen (addr);
     colon = strrchr (addr, ':');
     rc = nn_port_resolve (colon + 1, end - colon - 1);
     errnum_assert (rc > 0, -rc);
     port = rc;
 
-    /*  Check whether IPv6 is to be used. */
-    ipv4onlylen = sizeof (ipv4only);
-    nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_IPV4ONLY,
-        &ipv4only, &ipv4onlylen);
-    nn_assert (ipv4onlylen == sizeof (ipv4only));
-
-    /*  Parse the local address, if any. */
-    semicolon = strchr (addr, ';');
-    memset (&local, 0, sizeof (local));
-    if (semicolon)
-        rc = nn_iface_resolve (addr, semicolon - addr, ipv4only,
-            &local, &locallen);
-    else
-        rc = nn_iface_resolve ("*", 1, ipv4only, &local, &locallen);
-    if (nn_slow (rc < 0)) {
-        nn_backoff_start (&self->retry);
-        self->state = NN_CTCP_STATE_WAITING;
-        return;
-    }
-
     /*  Combine the remote address and the port. */
-    remote = *ss;
-    remotelen = sslen;
+    remote = self->dns_result.addrs [i];
+    remotelen = self->dns_result.addrlens [i];
     if (remote.ss_family == AF_INET)
         ((struct sockaddr_in*) &remote)->sin_port = htons (port);
     else if (remote.ss_family == AF_INET6)
@@ -579,41 +737,117 @@ static void nn_ctcp_start_connecting (struct nn_ctcp *self,
     else
         nn_assert (0);
 
-    /*  Try to start the underlying socket. */
-    rc = nn_usock_start (&self->usock, remote.ss_family, SOCK_STREAM, 0);
-    if (nn_slow (rc < 0)) {
-        nn_backoff_start (&self->retry);
-        self->state = NN_CTCP_STATE_WAITING;
-        return;
+    /*  Get the local address to bind to. */
+    if (self->haslocal) {
+        local = self->local;
+        locallen = self->locallen;
+    }
+    else {
+        memset (&local, 0, sizeof (local));
+        rc = nn_iface_resolve ("*", 1, remote.ss_family == AF_INET,
+            &local, &locallen);
+        errnum_assert (rc == 0, -rc);
     }
 
+    /*  Try to start the underlying socket. */
+    rc = nn_usock_start (usock, remote.ss_family, SOCK_STREAM, 0);
+    if (nn_slow (rc < 0))
+        return rc;
+
     /*  Set the relevant socket options. */
     sz = sizeof (val);
     nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_SNDBUF, &val, &sz);
     nn_assert (sz == sizeof (val));
-    nn_usock_setsockopt (&self->usock, SOL_SOCKET, SO_SNDBUF,
+    nn_usock_setsockopt (usock, SOL_SOCKET, SO_SNDBUF,
         &val, sizeof (val));
     sz = sizeof (val);
     nn_ep_getopt (self->ep, NN_SOL_SOCKET, NN_RCVBUF, &val, &sz);
     nn_assert (sz == sizeof (val));
-    nn_usock_setsockopt (&self->usock, SOL_SOCKET, SO_RCVBUF,
+    nn_usock_setsockopt (usock, SOL_SOCKET, SO_RCVBUF,
         &val, sizeof (val));
     sz = sizeof (val);
     nn_ep_getopt (self->ep, NN_TCP, NN_TCP_NODELAY, &val, &sz);
     nn_assert (sz == sizeof (val));
-    nn_usock_setsockopt (&self->usock, IPPROTO_TCP, TCP_NODELAY,
+    nn_usock_setsockopt (usock, IPPROTO_TCP, TCP_NODELAY,
         &val, sizeof (val));
+#if defined TCP_USER_TIMEOUT
+    sz = sizeof (val);
+    nn_ep_getopt (self->ep, NN_TCP, NN_TCP_USER_TIMEOUT, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    if (val > 0)
+        nn_usock_setsockopt (usock, IPPROTO_TCP, TCP_USER_TIMEOUT,
+            &val, sizeof (val));
+#endif
 
     /*  Bind the socket to the local network interface. */
-    rc = nn_usock_bind (&self->usock, (struct sockaddr*) &local, locallen);
+    rc = nn_usock_bind (usock, (struct sockaddr*) &local, locallen);
     if (nn_slow (rc != 0)) {
-        nn_backoff_start (&self->retry);
-        self->state = NN_CTCP_STATE_WAITING;
-        return;
+        nn_usock_stop (usock);
+        return 1;
     }
 
     /*  Start connecting. */
-    nn_usock_connect (&self->usock, (struct sockaddr*) &remote, remotelen);
-    self->state = NN_CTCP_STATE_CONNECTING;
+    nn_usock_connect (usock, (struct sockaddr*) &remote, remotelen);
+    self->inflight |= 1 << i;
     nn_ep_stat_increment (self->ep, NN_STAT_INPROGRESS_CONNECTIONS, 1);
+    return 0;
+}
+
+static void nn_ctcp_next_attempt (struct nn_ctcp *self)
+{
+    int i;
+
+    if (self->next < self->dns_result.naddrs) {
+        nn_ctcp_start_attempt (self);
+        return;
+    }
+
+    /*  If all the attempts have failed, wait before re-connecting. */
+    if (!nn_timer_isidle (&self->delay_timer))
+        return;
+    for (i = 0; i != NN_DNS_MAXADDRS; ++i)
+        if (!nn_usock_isidle (&self->usocks [i]))
+            return;
+    nn_backoff_start (&self->retry);
+    self->state = NN_CTCP_STATE_WAITING;
+}
+
+static void nn_ctcp_check_attempts (struct nn_ctcp *self)
+{
+    int i;
+
+    /*  Wait till all the losing sockets and the timer are stopped. */
+    if (!nn_timer_isidle (&self->delay_timer))
+        return;
+    for (i = 0; i != NN_DNS_MAXADDRS; ++i)
+        if (i != self->winner && !nn_usock_isidle (&self->usocks [i]))
+            return;
+
+    nn_stcp_start (&self->stcp, &self->usocks [self->winner]);
+    self->state = NN_CTCP_STATE_ACTIVE;
+    nn_ep_stat_increment (self->ep, NN_STAT_ESTABLISHED_CONNECTIONS, 1);
+    nn_ep_clear_error (self->ep);
+}
+
+static int nn_ctcp_index (struct nn_ctcp *self, void *srcptr)
+{
+    int i;
+
+    for (i = 0; i != NN_DNS_MAXADDRS; ++i)
+        if (srcptr == &self->usocks [i])
+            return i;
+    nn_assert (0);
+    return -1;
+}
+
+static int nn_ctcp_count (int mask)
+{
+    int count;
+
+    count = 0;
+    while (mask) {
+        mask &= mask - 1;
+        ++count;
+    }
+    return count;
 }
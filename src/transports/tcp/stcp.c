@@ -23,6 +23,8 @@
 
 #include "stcp.h"
 
+#include "../../tcp.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 #include "../../utils/fast.h"
@@ -43,13 +45,24 @@
 #define NN_STCP_INSTATE_BODY 2
 #define NN_STCP_INSTATE_HASMSG 3
 
-/*  Possible states of the outbound part of the object. */
+/*  Possible states of the outbound part of the object. HEARTBEAT means that
+    a heartbeat is being sent, PENDING that there's also a message waiting to
+    be sent once it's done. */
 #define NN_STCP_OUTSTATE_IDLE 1
 #define NN_STCP_OUTSTATE_SENDING 2
+#define NN_STCP_OUTSTATE_HEARTBEAT 3
+#define NN_STCP_OUTSTATE_PENDING 4
 
 /*  Subordinate srcptr objects. */
 #define NN_STCP_SRC_USOCK 1
 #define NN_STCP_SRC_STREAMHDR 2
+#define NN_STCP_SRC_HBTIMER 3
+
+/*  Heartbeat is sent as a message header with the size field set to all
+    ones. Such size can't occur in a real message. It's only sent to peers
+    that have announced they understand heartbeats. */
+static const uint8_t nn_stcp_heartbeat [8] =
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
 
 /*  Stream is a special type of pipe. Implementation of the virtual pipe API. */
 static int nn_stcp_send (struct nn_pipebase *self, struct nn_msg *msg);
@@ -64,10 +77,18 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_stcp_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
+static void nn_stcp_send_parts (struct nn_stcp *self, struct nn_iovec *iov,
+    int iovcnt);
+static void nn_stcp_recv_fragment (struct nn_stcp *self);
+static void nn_stcp_send_outmsg (struct nn_stcp *stcp);
+static void nn_stcp_start_heartbeats (struct nn_stcp *self);
+static int nn_stcp_heartbeat_tick (struct nn_stcp *self);
 
 void nn_stcp_init (struct nn_stcp *self, int src,
     struct nn_ep *ep, struct nn_fsm *owner)
 {
+    size_t sz;
+
     nn_fsm_init (&self->fsm, nn_stcp_handler, nn_stcp_shutdown,
         src, self, owner);
     self->state = NN_STCP_STATE_IDLE;
@@ -76,10 +97,30 @@ void nn_stcp_init (struct nn_stcp *self, int src,
     self->usock_owner.src = -1;
     self->usock_owner.fsm = NULL;
     nn_pipebase_init (&self->pipebase, &nn_stcp_pipebase_vfptr, ep);
+    nn_pipebase_setgather (&self->pipebase);
+#if defined NN_HAVE_SENDFILE
+    nn_pipebase_setsendfile (&self->pipebase);
+#endif
     self->instate = -1;
     nn_msg_init (&self->inmsg, 0);
+    self->infragsz = 0;
+    self->inleft = 0;
     self->outstate = -1;
     nn_msg_init (&self->outmsg, 0);
+    self->outpart = 0;
+    sz = sizeof (self->hbivl);
+    nn_ep_getopt (ep, NN_TCP, NN_TCP_HEARTBEAT_IVL, &self->hbivl, &sz);
+    nn_assert (sz == sizeof (self->hbivl));
+    sz = sizeof (self->hbmisses);
+    nn_ep_getopt (ep, NN_TCP, NN_TCP_HEARTBEAT_MISSES, &self->hbmisses, &sz);
+    nn_assert (sz == sizeof (self->hbmisses));
+    nn_timer_init (&self->hbtimer, NN_STCP_SRC_HBTIMER, &self->fsm);
+    self->sendivl = 0;
+    self->recvivl = 0;
+    self->tick = 0;
+    self->sendelapsed = 0;
+    self->recvelapsed = 0;
+    self->received = 0;
     nn_fsm_event_init (&self->done);
 }
 
@@ -88,6 +129,7 @@ void nn_stcp_term (struct nn_stcp *self)
     nn_assert_state (self, NN_STCP_STATE_IDLE);
 
     nn_fsm_event_term (&self->done);
+    nn_timer_term (&self->hbtimer);
     nn_msg_term (&self->outmsg);
     nn_msg_term (&self->inmsg);
     nn_pipebase_term (&self->pipebase);
@@ -109,6 +151,9 @@ void nn_stcp_start (struct nn_stcp *self, struct nn_usock *usock)
     nn_usock_swap_owner (usock, &self->usock_owner);
     self->usock = usock;
 
+    /*  Offer heartbeats to the peer and ask for them if so configured. */
+    nn_streamhdr_setheartbeat (&self->streamhdr, self->hbivl);
+
     /*  Launch the state machine. */
     nn_fsm_start (&self->fsm);
 }
@@ -121,33 +166,102 @@ void nn_stcp_stop (struct nn_stcp *self)
 static int nn_stcp_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
     struct nn_stcp *stcp;
-    struct nn_iovec iov [3];
 
     stcp = nn_cont (self, struct nn_stcp, pipebase);
 
     nn_assert_state (stcp, NN_STCP_STATE_ACTIVE);
-    nn_assert (stcp->outstate == NN_STCP_OUTSTATE_IDLE);
+    nn_assert (stcp->outstate == NN_STCP_OUTSTATE_IDLE ||
+        stcp->outstate == NN_STCP_OUTSTATE_HEARTBEAT);
 
     /*  Move the message to the local storage. */
     nn_msg_term (&stcp->outmsg);
     nn_msg_mv (&stcp->outmsg, msg);
 
-    /*  Serialise the message header. */
-    nn_putll (stcp->outhdr, nn_chunkref_size (&stcp->outmsg.sphdr) +
-        nn_chunkref_size (&stcp->outmsg.body));
+    /*  If a heartbeat is being sent, the message has to wait for it. */
+    if (nn_slow (stcp->outstate == NN_STCP_OUTSTATE_HEARTBEAT)) {
+        stcp->outstate = NN_STCP_OUTSTATE_PENDING;
+        return 0;
+    }
 
-    /*  Start async sending. */
-    iov [0].iov_base = stcp->outhdr;
-    iov [0].iov_len = sizeof (stcp->outhdr);
-    iov [1].iov_base = nn_chunkref_data (&stcp->outmsg.sphdr);
-    iov [1].iov_len = nn_chunkref_size (&stcp->outmsg.sphdr);
-    iov [2].iov_base = nn_chunkref_data (&stcp->outmsg.body);
-    iov [2].iov_len = nn_chunkref_size (&stcp->outmsg.body);
-    nn_usock_send (stcp->usock, iov, 3);
+    nn_stcp_send_outmsg (stcp);
+    return 0;
+}
+
+/*  Starts sending the message stored in 'outmsg'. */
+static void nn_stcp_send_outmsg (struct nn_stcp *stcp)
+{
+    struct nn_iovec iov [3 + NN_MSG_MAXPARTS];
+    int iovcnt;
+    uint64_t sz;
+    void *hdr;
+
+    sz = nn_chunkref_size (&stcp->outmsg.sphdr) +
+        nn_msg_bodysize (&stcp->outmsg);
+
+    /*  If possible, put the headers in front of the body and send it all
+        as a single buffer. */
+    hdr = nn_msg_prepend (&stcp->outmsg, sizeof (stcp->outhdr));
+    if (nn_fast (hdr != NULL)) {
+        nn_putll (hdr, sz);
+        iov [0].iov_base = nn_chunkref_data (&stcp->outmsg.body);
+        iov [0].iov_len = nn_chunkref_size (&stcp->outmsg.body);
+        iovcnt = 1;
+    }
+    else {
+
+        /*  Serialise the message header. */
+        nn_putll (stcp->outhdr, sz);
+
+        iov [0].iov_base = stcp->outhdr;
+        iov [0].iov_len = sizeof (stcp->outhdr);
+        iov [1].iov_base = nn_chunkref_data (&stcp->outmsg.sphdr);
+        iov [1].iov_len = nn_chunkref_size (&stcp->outmsg.sphdr);
+        iov [2].iov_base = nn_chunkref_data (&stcp->outmsg.body);
+        iov [2].iov_len = nn_chunkref_size (&stcp->outmsg.body);
+        iovcnt = 3;
+    }
+
+    /*  Append the remaining parts of the body, if any, and start async
+        sending. */
+    stcp->outpart = 0;
+    nn_stcp_send_parts (stcp, iov, iovcnt);
 
     stcp->outstate = NN_STCP_OUTSTATE_SENDING;
+}
 
-    return 0;
+/*  Appends body parts of 'outmsg', starting with 'outpart', to the buffers
+    in 'iov' and sends them. A part referring to a file is sent on its own,
+    straight from the file, once the buffers preceding it are sent. */
+static void nn_stcp_send_parts (struct nn_stcp *self, struct nn_iovec *iov,
+    int iovcnt)
+{
+    void *chunk;
+#if defined NN_HAVE_SENDFILE
+    int fd;
+    uint64_t offset;
+#endif
+
+    if (self->outmsg.parts) {
+        while (self->outpart != self->outmsg.parts->nchunks) {
+            chunk = self->outmsg.parts->chunks [self->outpart];
+#if defined NN_HAVE_SENDFILE
+            if (nn_slow (nn_chunk_file (chunk, &fd, &offset))) {
+                if (iovcnt)
+                    break;
+                ++self->outpart;
+                nn_usock_sendfile (self->usock, fd, offset,
+                    nn_chunk_size (chunk));
+                return;
+            }
+#endif
+            iov [iovcnt].iov_base = chunk;
+            iov [iovcnt].iov_len = nn_chunk_size (chunk);
+            ++iovcnt;
+            ++self->outpart;
+        }
+    }
+
+    nn_usock_send (self->usock, iov, iovcnt);
 }
 
 static int nn_stcp_recv (struct nn_pipebase *self, struct nn_msg *msg)
@@ -163,6 +277,12 @@ static int nn_stcp_recv (struct nn_pipebase *self, struct nn_msg *msg)
     nn_msg_mv (msg, &stcp->inmsg);
     nn_msg_init (&stcp->inmsg, 0);
 
+    /*  Continue with the next fragment of a large message. */
+    if (stcp->inleft > 0) {
+        nn_stcp_recv_fragment (stcp);
+        return 0;
+    }
+
     /*  Start receiving new message. */
     stcp->instate = NN_STCP_INSTATE_HDR;
     nn_usock_recv (stcp->usock, stcp->inhdr, sizeof (stcp->inhdr), NULL);
@@ -180,10 +300,12 @@ static void nn_stcp_shutdown (struct nn_fsm *self, int src, int type,
     if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
         nn_pipebase_stop (&stcp->pipebase);
         nn_streamhdr_stop (&stcp->streamhdr);
+        nn_timer_stop (&stcp->hbtimer);
         stcp->state = NN_STCP_STATE_STOPPING;
     }
     if (nn_slow (stcp->state == NN_STCP_STATE_STOPPING)) {
-        if (nn_streamhdr_isidle (&stcp->streamhdr)) {
+        if (nn_streamhdr_isidle (&stcp->streamhdr) &&
+              nn_timer_isidle (&stcp->hbtimer)) {
             nn_usock_swap_owner (stcp->usock, &stcp->usock_owner);
             stcp->usock = NULL;
             stcp->usock_owner.src = -1;
@@ -206,6 +328,7 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
     uint64_t size;
     int opt;
     size_t opt_sz = sizeof (opt);
+    struct nn_iovec iov [NN_MSG_MAXPARTS];
 
     stcp = nn_cont (self, struct nn_stcp, fsm);
 
@@ -290,6 +413,8 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                  /*  Mark the pipe as available for sending. */
                  stcp->outstate = NN_STCP_OUTSTATE_IDLE;
 
+                 nn_stcp_start_heartbeats (stcp);
+
                  stcp->state = NN_STCP_STATE_ACTIVE;
                  return;
 
@@ -311,8 +436,26 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_USOCK_SENT:
 
-                /*  The message is now fully sent. */
+                /*  Heartbeat was sent. If there's a message waiting, send
+                    it now. */
+                if (nn_slow (stcp->outstate == NN_STCP_OUTSTATE_HEARTBEAT)) {
+                    stcp->outstate = NN_STCP_OUTSTATE_IDLE;
+                    return;
+                }
+                if (nn_slow (stcp->outstate == NN_STCP_OUTSTATE_PENDING)) {
+                    nn_stcp_send_outmsg (stcp);
+                    return;
+                }
+
+                /*  Continue with the rest of the message, if any. */
                 nn_assert (stcp->outstate == NN_STCP_OUTSTATE_SENDING);
+                if (nn_slow (stcp->outmsg.parts &&
+                      stcp->outpart != stcp->outmsg.parts->nchunks)) {
+                    nn_stcp_send_parts (stcp, iov, 0);
+                    return;
+                }
+
+                /*  The message is now fully sent. */
                 stcp->outstate = NN_STCP_OUTSTATE_IDLE;
                 nn_msg_term (&stcp->outmsg);
                 nn_msg_init (&stcp->outmsg, 0);
@@ -324,20 +467,41 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                 switch (stcp->instate) {
                 case NN_STCP_INSTATE_HDR:
 
-                    /*  Message header was received. Check that message size
-                        is acceptable by comparing with NN_RCVMAXSIZE;
-                        if it's too large, drop the connection. */
+                    /*  Message header was received. If it's a heartbeat,
+                        there's no body to follow. */
+                    stcp->received = 1;
                     size = nn_getll (stcp->inhdr);
+                    if (nn_slow (size == nn_getll (nn_stcp_heartbeat))) {
+                        nn_usock_recv (stcp->usock, stcp->inhdr,
+                            sizeof (stcp->inhdr), NULL);
+                        return;
+                    }
+
+                    /*  Check that message size is acceptable by comparing
+                        with NN_RCVMAXSIZE; if it's too large, drop the
+                        connection. */
 
                     nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET,
                         NN_RCVMAXSIZE, &opt, &opt_sz);
 
                     if (opt >= 0 && size > (unsigned)opt) {
+                        nn_timer_stop (&stcp->hbtimer);
                         stcp->state = NN_STCP_STATE_DONE;
                         nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
                         return;
                     }
 
+                    /*  If requested, receive large messages in fragments
+                        rather than allocating memory for the whole message. */
+                    nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET,
+                        NN_RCVFRAGSIZE, &opt, &opt_sz);
+                    if (opt > 0 && size > (unsigned)opt) {
+                        stcp->infragsz = (size_t) opt;
+                        stcp->inleft = size;
+                        nn_stcp_recv_fragment (stcp);
+                        return;
+                    }
+
                     /*  Allocate memory for the message. */
                     nn_msg_term (&stcp->inmsg);
                     nn_msg_init (&stcp->inmsg, (size_t) size);
@@ -361,6 +525,7 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
 
                     /*  Message body was received. Notify the owner that it
                         can receive it. */
+                    stcp->received = 1;
                     stcp->instate = NN_STCP_INSTATE_HASMSG;
                     nn_pipebase_received (&stcp->pipebase);
 
@@ -373,11 +538,13 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
 
             case NN_USOCK_SHUTDOWN:
                 nn_pipebase_stop (&stcp->pipebase);
+                nn_timer_stop (&stcp->hbtimer);
                 stcp->state = NN_STCP_STATE_SHUTTING_DOWN;
                 return;
 
             case NN_USOCK_ERROR:
                 nn_pipebase_stop (&stcp->pipebase);
+                nn_timer_stop (&stcp->hbtimer);
                 stcp->state = NN_STCP_STATE_DONE;
                 nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
                 return;
@@ -386,6 +553,26 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                 nn_fsm_bad_action (stcp->state, src, type);
             }
 
+        case NN_STCP_SRC_HBTIMER:
+            switch (type) {
+            case NN_TIMER_TIMEOUT:
+                nn_timer_stop (&stcp->hbtimer);
+                return;
+            case NN_TIMER_STOPPED:
+
+                /*  If the peer has gone silent, consider it dead. */
+                if (nn_slow (nn_stcp_heartbeat_tick (stcp) != 0)) {
+                    nn_pipebase_stop (&stcp->pipebase);
+                    stcp->state = NN_STCP_STATE_DONE;
+                    nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+                    return;
+                }
+                nn_timer_start (&stcp->hbtimer, stcp->tick);
+                return;
+            default:
+                nn_fsm_bad_action (stcp->state, src, type);
+            }
+
         default:
             nn_fsm_bad_source (stcp->state, src, type);
         }
@@ -408,6 +595,11 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                 nn_fsm_bad_action (stcp->state, src, type);
             }
 
+        case NN_STCP_SRC_HBTIMER:
+
+            /*  Heartbeat timer is being stopped. */
+            return;
+
         default:
             nn_fsm_bad_source (stcp->state, src, type);
         }
@@ -419,6 +611,12 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
 /*  this state except stopping the object.                                    */
 /******************************************************************************/
     case NN_STCP_STATE_DONE:
+
+        /*  If the peer was found dead by the heartbeat timer, the underlying
+            socket is still active and may report on the pending operations
+            till it's stopped. */
+        if (src == NN_STCP_SRC_HBTIMER || src == NN_STCP_SRC_USOCK)
+            return;
         nn_fsm_bad_source (stcp->state, src, type);
 
 /******************************************************************************/
@@ -429,3 +627,87 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
     }
 }
 
+/*  Starts receiving next fragment of a large message. All the fragments except
+    for the last one are marked by NN_RCVMORE. */
+static void nn_stcp_recv_fragment (struct nn_stcp *self)
+{
+    size_t sz;
+
+    sz = self->inleft < self->infragsz ? (size_t) self->inleft :
+        self->infragsz;
+    self->inleft -= sz;
+    nn_msg_term (&self->inmsg);
+    nn_msg_init (&self->inmsg, sz);
+    if (self->inleft > 0)
+        nn_msg_setmore (&self->inmsg);
+
+    self->instate = NN_STCP_INSTATE_BODY;
+    nn_usock_recv (self->usock, nn_chunkref_data (&self->inmsg.body), sz,
+        NULL);
+}
+
+/*  Works out the heartbeat intervals negotiated with the peer and starts
+    the heartbeat timer if needed. */
+static void nn_stcp_start_heartbeats (struct nn_stcp *self)
+{
+    /*  Heartbeats are used only if both sides announced them. A peer that
+        announced nothing may not understand them at all. */
+    if (self->hbivl > 0 && self->streamhdr.peerhbivl > 0) {
+        self->sendivl = self->streamhdr.peerhbivl;
+        self->recvivl = self->hbivl;
+    }
+    else {
+        self->sendivl = 0;
+        self->recvivl = 0;
+    }
+
+    self->tick = self->sendivl;
+    if (self->recvivl > 0 && (self->tick == 0 || self->recvivl < self->tick))
+        self->tick = self->recvivl;
+    self->sendelapsed = 0;
+    self->recvelapsed = 0;
+    self->received = 0;
+    if (self->tick > 0)
+        nn_timer_start (&self->hbtimer, self->tick);
+}
+
+/*  Checks whether the peer is still alive and sends a heartbeat if it's
+    due. Returns -ETIMEDOUT if the peer missed too many heartbeats, zero
+    otherwise. */
+static int nn_stcp_heartbeat_tick (struct nn_stcp *self)
+{
+    struct nn_iovec iov;
+
+    if (self->recvivl > 0) {
+
+        /*  While a message body is being received, or while the user is yet
+            to pick up a message, the peer has no chance to get a heartbeat
+            through, so the beats are not counted as missed. */
+        if (self->received || self->instate != NN_STCP_INSTATE_HDR) {
+            self->received = 0;
+            self->recvelapsed = 0;
+        }
+        else {
+            self->recvelapsed += self->tick;
+            if (self->recvelapsed >= self->recvivl * self->hbmisses)
+                return -ETIMEDOUT;
+        }
+    }
+
+    if (self->sendivl > 0) {
+        self->sendelapsed += self->tick;
+
+        /*  If a message is being sent, the peer will know we are alive
+            once it arrives. */
+        if (self->sendelapsed >= self->sendivl &&
+              self->outstate == NN_STCP_OUTSTATE_IDLE) {
+            iov.iov_base = (void*) nn_stcp_heartbeat;
+            iov.iov_len = sizeof (nn_stcp_heartbeat);
+            nn_usock_send (self->usock, &iov, 1);
+            self->outstate = NN_STCP_OUTSTATE_HEARTBEAT;
+            self->sendelapsed = 0;
+        }
+    }
+
+    return 0;
+}
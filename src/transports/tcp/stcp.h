@@ -28,6 +28,7 @@
 
 #include "../../aio/fsm.h"
 #include "../../aio/usock.h"
+#include "../../aio/timer.h"
 
 #include "../utils/streamhdr.h"
 
@@ -66,6 +67,11 @@ struct nn_stcp {
     /*  Message being received at the moment. */
     struct nn_msg inmsg;
 
+    /*  If a large message is being received in fragments, the size of
+        a fragment and the number of bytes yet to be received. */
+    size_t infragsz;
+    uint64_t inleft;
+
     /*  State of the outbound state machine. */
     int outstate;
 
@@ -75,6 +81,31 @@ struct nn_stcp {
     /*  Message being sent at the moment. */
     struct nn_msg outmsg;
 
+    /*  Index of the first body part of 'outmsg' that wasn't passed to
+        the socket yet. Parts referring to files are sent separately. */
+    int outpart;
+
+    /*  Heartbeat settings as set by NN_TCP_HEARTBEAT_IVL and
+        NN_TCP_HEARTBEAT_MISSES options. */
+    int hbivl;
+    int hbmisses;
+
+    /*  Once the connection is established, intervals to send heartbeats at
+        and to expect them at, in milliseconds. Zero if there are none.
+        The timer ticks at the shorter of the two. */
+    struct nn_timer hbtimer;
+    int sendivl;
+    int recvivl;
+    int tick;
+
+    /*  Time elapsed since the last heartbeat was sent and since anything
+        was last received from the peer, in milliseconds. */
+    int sendelapsed;
+    int recvelapsed;
+
+    /*  Set when anything is received from the peer. */
+    int received;
+
     /*  Event raised when the state machine ends. */
     struct nn_fsm_event done;
 };
@@ -29,6 +29,7 @@
 
 #include "../utils/port.h"
 #include "../utils/iface.h"
+#include "../utils/streamhdr.h"
 
 #include "../../utils/err.h"
 #include "../../utils/alloc.h"
@@ -48,6 +49,10 @@
 struct nn_tcp_optset {
     struct nn_optset base;
     int nodelay;
+    int hbivl;
+    int hbmisses;
+    int usertimeout;
+    int connectdelay;
 };
 
 static void nn_tcp_optset_destroy (struct nn_optset *self);
@@ -96,6 +101,10 @@ static struct nn_optset *nn_tcp_optset ()
 
     /*  Default values for TCP socket options. */
     optset->nodelay = 0;
+    optset->hbivl = 0;
+    optset->hbmisses = 3;
+    optset->usertimeout = 0;
+    optset->connectdelay = 250;
 
     return &optset->base;   
 }
@@ -127,6 +136,26 @@ static int nn_tcp_optset_setopt (struct nn_optset *self, int option,
             return -EINVAL;
         optset->nodelay = val;
         return 0;
+    case NN_TCP_HEARTBEAT_IVL:
+        if (nn_slow (val < 0 || val > NN_STREAMHDR_MAXHBIVL))
+            return -EINVAL;
+        optset->hbivl = val;
+        return 0;
+    case NN_TCP_HEARTBEAT_MISSES:
+        if (nn_slow (val < 1))
+            return -EINVAL;
+        optset->hbmisses = val;
+        return 0;
+    case NN_TCP_USER_TIMEOUT:
+        if (nn_slow (val < 0))
+            return -EINVAL;
+        optset->usertimeout = val;
+        return 0;
+    case NN_TCP_CONNECT_DELAY:
+        if (nn_slow (val < 0))
+            return -EINVAL;
+        optset->connectdelay = val;
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
@@ -144,6 +173,18 @@ static int nn_tcp_optset_getopt (struct nn_optset *self, int option,
     case NN_TCP_NODELAY:
         intval = optset->nodelay;
         break;
+    case NN_TCP_HEARTBEAT_IVL:
+        intval = optset->hbivl;
+        break;
+    case NN_TCP_HEARTBEAT_MISSES:
+        intval = optset->hbmisses;
+        break;
+    case NN_TCP_USER_TIMEOUT:
+        intval = optset->usertimeout;
+        break;
+    case NN_TCP_CONNECT_DELAY:
+        intval = optset->connectdelay;
+        break;
     default:
         return -ENOPROTOOPT;
     }
@@ -0,0 +1,905 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "sudp.h"
+
+#include "../../udp.h"
+
+#include "../utils/port.h"
+#include "../utils/iface.h"
+#include "../utils/literal.h"
+
+#include "../../aio/fsm.h"
+#include "../../aio/worker.h"
+
+#include "../../utils/err.h"
+#include "../../utils/cont.h"
+#include "../../utils/alloc.h"
+#include "../../utils/fast.h"
+#include "../../utils/wire.h"
+#include "../../utils/closefd.h"
+#include "../../utils/attr.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/*  Maximum number of datagrams passed to the kernel in one system call. */
+#define NN_SUDP_BATCH 32
+
+/*  Each datagram starts with the same header that the stream transports
+    exchange when the connection is established: "\0SP\0", protocol of
+    the sending socket and two reserved bytes. */
+#define NN_SUDP_HDRSZ 8
+
+/*  Size of the UDP header. */
+#define NN_SUDP_UDPHDRSZ 8
+
+#define NN_SUDP_STATE_IDLE 1
+#define NN_SUDP_STATE_ACTIVE 2
+#define NN_SUDP_STATE_STOPPING 3
+
+#define NN_SUDP_SRC_FD 1
+#define NN_SUDP_SRC_TASK_START 2
+#define NN_SUDP_SRC_TASK_SEND 3
+#define NN_SUDP_SRC_TASK_RECV 4
+#define NN_SUDP_SRC_TASK_STOP 5
+
+/*  Possible states of the inbound part of the object. */
+#define NN_SUDP_INSTATE_WAITING 1
+#define NN_SUDP_INSTATE_HASMSG 2
+
+struct nn_sudp {
+
+    /*  The state machine. */
+    struct nn_fsm fsm;
+    int state;
+
+    struct nn_ep *ep;
+
+    /*  The datagram socket and the worker thread it is registered with. */
+    int s;
+    struct nn_worker *worker;
+    struct nn_worker_fd wfd;
+    int registered;
+
+    /*  Poller can be manipulated only from the worker thread. These tasks
+        are used to get there from the application threads. */
+    struct nn_worker_task task_start;
+    struct nn_worker_task task_send;
+    struct nn_worker_task task_recv;
+    struct nn_worker_task task_stop;
+
+    /*  1 if the endpoint was bound, i.e. it receives datagrams, 0 if it was
+        connected, i.e. it sends them. */
+    int bound;
+
+    /*  The only pipe of the endpoint. */
+    struct nn_pipebase pipebase;
+
+    /*  The largest message that fits into a datagram. */
+    size_t maxsz;
+
+    /*  Header prepended to all outgoing datagrams. */
+    uint8_t outhdr [NN_SUDP_HDRSZ];
+
+    /*  Messages waiting to be sent. Those between 'outpos' and 'outcount'
+        are valid. Once the batch fills up, the pipe is released until it's
+        flushed completely. */
+    struct nn_msg outmsgs [NN_SUDP_BATCH];
+    int outpos;
+    int outcount;
+    int outfull;
+
+    /*  1 if the batch is being flushed, i.e. either the flush task is
+        scheduled or the socket is polled for OUT. */
+    int flushing;
+    int pollout;
+
+    /*  Datagrams received by the last system call, each in a slot of
+        'slotsz' bytes. Those before 'inpos' were already processed. */
+    uint8_t *inbuf;
+    size_t slotsz;
+    size_t inlens [NN_SUDP_BATCH];
+    int intrunc [NN_SUDP_BATCH];
+    int inpos;
+    int incount;
+
+    /*  1 if the socket is polled for IN or is about to be. */
+    int pollin;
+
+    int instate;
+    struct nn_msg inmsg;
+};
+
+/*  nn_ep virtual interface implementation. */
+static void nn_sudp_stop (void *);
+static void nn_sudp_destroy (void *);
+const struct nn_ep_ops nn_sudp_ep_ops = {
+    nn_sudp_stop,
+    nn_sudp_destroy
+};
+
+/*  Implementation of the virtual pipe API. */
+static int nn_sudp_send (struct nn_pipebase *self, struct nn_msg *msg);
+static int nn_sudp_recv (struct nn_pipebase *self, struct nn_msg *msg);
+const struct nn_pipebase_vfptr nn_sudp_pipebase_vfptr = {
+    nn_sudp_send,
+    nn_sudp_recv
+};
+
+/*  Private functions. */
+static void nn_sudp_handler (struct nn_fsm *self, int src, int type,
+    void *srcptr);
+static void nn_sudp_shutdown (struct nn_fsm *self, int src, int type,
+    void *srcptr);
+static int nn_sudp_open (struct nn_ep *ep, int bound, size_t *maxsz);
+static int nn_sudp_setopt (int s, int level, int option, int val);
+static void nn_sudp_flush (struct nn_sudp *self);
+static int nn_sudp_sendall (struct nn_sudp *self);
+static int nn_sudp_sendbatch (struct nn_sudp *self);
+static int nn_sudp_fill (struct nn_sudp *self);
+static int nn_sudp_recvbatch (struct nn_sudp *self);
+
+int nn_sudp_create (struct nn_ep *ep, int bind)
+{
+    int s;
+    int i;
+    int protocol;
+    size_t sz;
+    size_t maxsz;
+    struct nn_sudp *self;
+
+    /*  Open the socket straight away so that errors such as address being
+        in use can be reported to the user. */
+    s = nn_sudp_open (ep, bind, &maxsz);
+    if (nn_slow (s < 0))
+        return s;
+
+    self = nn_alloc (sizeof (struct nn_sudp), "sudp");
+    alloc_assert (self);
+    self->ep = ep;
+    nn_ep_tran_setup (ep, &nn_sudp_ep_ops, self);
+
+    nn_fsm_init_root (&self->fsm, nn_sudp_handler, nn_sudp_shutdown,
+        nn_ep_getctx (ep));
+    self->state = NN_SUDP_STATE_IDLE;
+    self->s = s;
+    self->worker = nn_fsm_choose_worker (&self->fsm);
+    nn_worker_fd_init (&self->wfd, NN_SUDP_SRC_FD, &self->fsm);
+    self->registered = 0;
+    nn_worker_task_init (&self->task_start, NN_SUDP_SRC_TASK_START,
+        &self->fsm);
+    nn_worker_task_init (&self->task_send, NN_SUDP_SRC_TASK_SEND, &self->fsm);
+    nn_worker_task_init (&self->task_recv, NN_SUDP_SRC_TASK_RECV, &self->fsm);
+    nn_worker_task_init (&self->task_stop, NN_SUDP_SRC_TASK_STOP, &self->fsm);
+    self->bound = bind;
+    nn_pipebase_init (&self->pipebase, &nn_sudp_pipebase_vfptr, ep);
+    self->maxsz = maxsz;
+
+    sz = sizeof (protocol);
+    nn_ep_getopt (ep, NN_SOL_SOCKET, NN_PROTOCOL, &protocol, &sz);
+    nn_assert (sz == sizeof (protocol));
+    memcpy (self->outhdr, "\0SP\0\0\0\0\0", NN_SUDP_HDRSZ);
+    nn_puts (self->outhdr + 4, (uint16_t) protocol);
+
+    for (i = 0; i != NN_SUDP_BATCH; ++i)
+        nn_msg_init (&self->outmsgs [i], 0);
+    self->outpos = 0;
+    self->outcount = 0;
+    self->outfull = 0;
+    self->flushing = 0;
+    self->pollout = 0;
+
+    /*  Only the bound endpoint needs the space for incoming datagrams. */
+    self->slotsz = NN_SUDP_HDRSZ + maxsz;
+    self->inbuf = NULL;
+    if (bind) {
+        self->inbuf = nn_alloc (self->slotsz * NN_SUDP_BATCH, "udp batch");
+        alloc_assert (self->inbuf);
+    }
+    self->inpos = 0;
+    self->incount = 0;
+    self->pollin = bind;
+    self->instate = NN_SUDP_INSTATE_WAITING;
+    nn_msg_init (&self->inmsg, 0);
+
+    /*  There's no handshake. The pipe can be used immediately. */
+    nn_fsm_start (&self->fsm);
+
+    return 0;
+}
+
+static void nn_sudp_stop (void *self)
+{
+    struct nn_sudp *sudp = self;
+
+    nn_fsm_stop (&sudp->fsm);
+}
+
+static void nn_sudp_destroy (void *self)
+{
+    int i;
+    struct nn_sudp *sudp = self;
+
+    nn_assert_state (sudp, NN_SUDP_STATE_IDLE);
+
+    nn_msg_term (&sudp->inmsg);
+    if (sudp->inbuf)
+        nn_free (sudp->inbuf);
+    for (i = 0; i != NN_SUDP_BATCH; ++i)
+        if (i >= sudp->outpos && i < sudp->outcount)
+            nn_msg_term (&sudp->outmsgs [i]);
+    nn_pipebase_term (&sudp->pipebase);
+
+    nn_worker_cancel (sudp->worker, &sudp->task_stop);
+    nn_worker_cancel (sudp->worker, &sudp->task_recv);
+    nn_worker_cancel (sudp->worker, &sudp->task_send);
+    nn_worker_cancel (sudp->worker, &sudp->task_start);
+    nn_worker_task_term (&sudp->task_stop);
+    nn_worker_task_term (&sudp->task_recv);
+    nn_worker_task_term (&sudp->task_send);
+    nn_worker_task_term (&sudp->task_start);
+    nn_worker_fd_term (&sudp->wfd);
+    nn_fsm_term (&sudp->fsm);
+
+    nn_free (sudp);
+}
+
+static int nn_sudp_send (struct nn_pipebase *self, struct nn_msg *msg)
+{
+    struct nn_sudp *sudp;
+
+    sudp = nn_cont (self, struct nn_sudp, pipebase);
+
+    nn_assert_state (sudp, NN_SUDP_STATE_ACTIVE);
+    nn_assert (sudp->outcount < NN_SUDP_BATCH);
+
+    /*  The bound endpoint has nowhere to send the message to. Oversized
+        messages were already refused by the socket, unless the protocol
+        has added its own header since then. */
+    if (nn_slow (sudp->bound || nn_chunkref_size (&msg->sphdr) +
+          nn_chunkref_size (&msg->body) > sudp->maxsz)) {
+        nn_msg_term (msg);
+        nn_ep_stat_increment (sudp->ep, NN_STAT_DROPPED_MESSAGES, 1);
+        nn_pipebase_sent (&sudp->pipebase);
+        return 0;
+    }
+
+    /*  Add the message to the batch. The batch is sent by the worker thread
+        so that the messages sent in the meantime can join it. */
+    nn_msg_mv (&sudp->outmsgs [sudp->outcount], msg);
+    ++sudp->outcount;
+    if (!sudp->flushing) {
+        sudp->flushing = 1;
+        nn_worker_execute (sudp->worker, &sudp->task_send);
+    }
+
+    /*  If the batch is full, try to send it straight away. Only if
+        the kernel can't accept it, wait for the worker thread. */
+    if (nn_slow (sudp->outcount == NN_SUDP_BATCH) &&
+          nn_sudp_sendall (sudp) < 0) {
+        sudp->outfull = 1;
+        return 0;
+    }
+    nn_pipebase_sent (&sudp->pipebase);
+
+    return 0;
+}
+
+static int nn_sudp_recv (struct nn_pipebase *self, struct nn_msg *msg)
+{
+    struct nn_sudp *sudp;
+
+    sudp = nn_cont (self, struct nn_sudp, pipebase);
+
+    nn_assert_state (sudp, NN_SUDP_STATE_ACTIVE);
+    nn_assert (sudp->instate == NN_SUDP_INSTATE_HASMSG);
+
+    /*  Move received message to the user. */
+    nn_msg_mv (msg, &sudp->inmsg);
+    nn_msg_init (&sudp->inmsg, 0);
+
+    /*  Try to get next datagram without going through the worker thread. */
+    if (nn_sudp_fill (sudp)) {
+        nn_pipebase_received (&sudp->pipebase);
+        return 0;
+    }
+
+    /*  There's nothing to receive at the moment. Ask the worker thread to
+        wait for more datagrams. */
+    sudp->instate = NN_SUDP_INSTATE_WAITING;
+    if (!sudp->pollin) {
+        sudp->pollin = 1;
+        nn_worker_execute (sudp->worker, &sudp->task_recv);
+    }
+
+    return 0;
+}
+
+static void nn_sudp_shutdown (struct nn_fsm *self, int src, int type,
+    NN_UNUSED void *srcptr)
+{
+    struct nn_sudp *sudp;
+
+    sudp = nn_cont (self, struct nn_sudp, fsm);
+
+    if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
+        nn_pipebase_stop (&sudp->pipebase);
+        nn_worker_execute (sudp->worker, &sudp->task_stop);
+        sudp->state = NN_SUDP_STATE_STOPPING;
+        return;
+    }
+    if (nn_slow (sudp->state == NN_SUDP_STATE_STOPPING)) {
+
+        /*  Pending tasks and I/O events are of no interest any more. */
+        if (src != NN_SUDP_SRC_TASK_STOP)
+            return;
+        if (sudp->registered)
+            nn_worker_rm_fd (sudp->worker, &sudp->wfd);
+        sudp->registered = 0;
+        nn_closefd (sudp->s);
+        sudp->s = -1;
+        sudp->state = NN_SUDP_STATE_IDLE;
+        nn_fsm_stopped_noevent (&sudp->fsm);
+        nn_ep_stopped (sudp->ep);
+        return;
+    }
+
+    nn_fsm_bad_state (sudp->state, src, type);
+}
+
+static void nn_sudp_handler (struct nn_fsm *self, int src, int type,
+    NN_UNUSED void *srcptr)
+{
+    int rc;
+    int err;
+    socklen_t errsz;
+    struct nn_sudp *sudp;
+
+    sudp = nn_cont (self, struct nn_sudp, fsm);
+
+    switch (sudp->state) {
+
+/******************************************************************************/
+/*  IDLE state.                                                               */
+/******************************************************************************/
+    case NN_SUDP_STATE_IDLE:
+        switch (src) {
+
+        case NN_FSM_ACTION:
+            switch (type) {
+            case NN_FSM_START:
+
+                /*  Register the socket with the worker thread and start
+                    the pipe. If the protocol refuses the pipe, the socket
+                    is still kept open till the endpoint is closed. */
+                nn_worker_execute (sudp->worker, &sudp->task_start);
+                nn_pipebase_setmaxsz (&sudp->pipebase, sudp->maxsz);
+                rc = nn_pipebase_start (&sudp->pipebase);
+                if (nn_slow (rc < 0)) {
+                    nn_ep_set_error (sudp->ep, -rc);
+                    sudp->pollin = 0;
+                }
+                sudp->state = NN_SUDP_STATE_ACTIVE;
+                return;
+            default:
+                nn_fsm_bad_action (sudp->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (sudp->state, src, type);
+        }
+
+/******************************************************************************/
+/*  ACTIVE state.                                                             */
+/******************************************************************************/
+    case NN_SUDP_STATE_ACTIVE:
+        switch (src) {
+
+        case NN_SUDP_SRC_TASK_START:
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            nn_worker_add_fd (sudp->worker, sudp->s, &sudp->wfd);
+            sudp->registered = 1;
+            if (sudp->pollin)
+                nn_worker_set_in (sudp->worker, &sudp->wfd);
+            return;
+
+        case NN_SUDP_SRC_TASK_SEND:
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            nn_sudp_flush (sudp);
+            return;
+
+        case NN_SUDP_SRC_TASK_RECV:
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            nn_worker_set_in (sudp->worker, &sudp->wfd);
+            return;
+
+        case NN_SUDP_SRC_FD:
+            switch (type) {
+            case NN_WORKER_FD_IN:
+                if (sudp->instate != NN_SUDP_INSTATE_WAITING ||
+                      !nn_sudp_fill (sudp))
+                    return;
+
+                /*  Stop polling till the user gets to the datagrams that
+                    have been received already. */
+                nn_worker_reset_in (sudp->worker, &sudp->wfd);
+                sudp->pollin = 0;
+                sudp->instate = NN_SUDP_INSTATE_HASMSG;
+                nn_pipebase_received (&sudp->pipebase);
+                return;
+
+            case NN_WORKER_FD_OUT:
+                nn_sudp_flush (sudp);
+                return;
+
+            case NN_WORKER_FD_ERR:
+
+                /*  Connected datagram sockets report ICMP errors caused by
+                    earlier datagrams, typically when there's no one to
+                    receive them. Clear the error and carry on. */
+                errsz = sizeof (err);
+                rc = getsockopt (sudp->s, SOL_SOCKET, SO_ERROR, &err, &errsz);
+                errno_assert (rc == 0);
+                return;
+
+            default:
+                nn_fsm_bad_action (sudp->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (sudp->state, src, type);
+        }
+
+/******************************************************************************/
+/*  Invalid state.                                                            */
+/******************************************************************************/
+    default:
+        nn_fsm_bad_state (sudp->state, src, type);
+    }
+}
+
+/*  Sends as much of the outbound batch as possible. Invoked in the worker
+    thread. */
+static void nn_sudp_flush (struct nn_sudp *self)
+{
+    /*  Kernel buffer is full. Wait till there's some space in it. */
+    if (nn_sudp_sendall (self) < 0) {
+        if (!self->pollout) {
+            nn_worker_set_out (self->worker, &self->wfd);
+            self->pollout = 1;
+        }
+        return;
+    }
+
+    /*  The whole batch was sent. */
+    self->flushing = 0;
+    if (self->pollout) {
+        nn_worker_reset_out (self->worker, &self->wfd);
+        self->pollout = 0;
+    }
+    if (self->outfull) {
+        self->outfull = 0;
+        nn_pipebase_sent (&self->pipebase);
+    }
+}
+
+/*  Sends all the messages in the outbound batch. Returns 0 if done or
+    -EAGAIN if the kernel buffer is full. */
+static int nn_sudp_sendall (struct nn_sudp *self)
+{
+    int rc;
+    int i;
+
+    while (self->outpos < self->outcount) {
+        rc = nn_sudp_sendbatch (self);
+        if (rc == -EAGAIN)
+            return -EAGAIN;
+
+        /*  Error reported for an earlier datagram. Just try again. */
+        if (rc == -ECONNREFUSED || rc == -EINTR)
+            continue;
+
+        /*  The first datagram can't be sent. Drop it. */
+        if (nn_slow (rc < 0)) {
+            nn_msg_term (&self->outmsgs [self->outpos]);
+            ++self->outpos;
+            nn_ep_stat_increment (self->ep, NN_STAT_DROPPED_MESSAGES, 1);
+            continue;
+        }
+
+        for (i = 0; i != rc; ++i)
+            nn_msg_term (&self->outmsgs [self->outpos + i]);
+        self->outpos += rc;
+    }
+    self->outpos = 0;
+    self->outcount = 0;
+    return 0;
+}
+
+/*  Passes the pending messages to the kernel. Returns the number of messages
+    sent or negative errno. */
+static int nn_sudp_sendbatch (struct nn_sudp *self)
+{
+    int i;
+    int n;
+    int rc;
+    struct nn_msg *msg;
+    struct iovec iov [NN_SUDP_BATCH][3];
+#if defined NN_HAVE_SENDMMSG
+    struct mmsghdr hdrs [NN_SUDP_BATCH];
+#else
+    struct msghdr hdr;
+#endif
+
+    n = self->outcount - self->outpos;
+#if defined NN_HAVE_SENDMMSG
+    memset (hdrs, 0, sizeof (struct mmsghdr) * n);
+#endif
+    for (i = 0; i != n; ++i) {
+        msg = &self->outmsgs [self->outpos + i];
+        iov [i][0].iov_base = self->outhdr;
+        iov [i][0].iov_len = NN_SUDP_HDRSZ;
+        iov [i][1].iov_base = nn_chunkref_data (&msg->sphdr);
+        iov [i][1].iov_len = nn_chunkref_size (&msg->sphdr);
+        iov [i][2].iov_base = nn_chunkref_data (&msg->body);
+        iov [i][2].iov_len = nn_chunkref_size (&msg->body);
+#if defined NN_HAVE_SENDMMSG
+        hdrs [i].msg_hdr.msg_iov = iov [i];
+        hdrs [i].msg_hdr.msg_iovlen = 3;
+    }
+    rc = sendmmsg (self->s, hdrs, (unsigned int) n, 0);
+    if (nn_slow (rc < 0))
+        return errno == EWOULDBLOCK ? -EAGAIN : -errno;
+    return rc;
+#else
+    }
+
+    /*  Without sendmmsg, send the datagrams one by one. */
+    for (i = 0; i != n; ++i) {
+        memset (&hdr, 0, sizeof (hdr));
+        hdr.msg_iov = iov [i];
+        hdr.msg_iovlen = 3;
+        rc = sendmsg (self->s, &hdr, 0);
+        if (nn_slow (rc < 0)) {
+            if (i > 0)
+                return i;
+            return errno == EWOULDBLOCK ? -EAGAIN : -errno;
+        }
+    }
+    return n;
+#endif
+}
+
+/*  Moves next valid datagram into 'inmsg', receiving new batch of datagrams
+    if needed. Returns 1 if there is a message, 0 if there are no datagrams
+    available at the moment. */
+static int nn_sudp_fill (struct nn_sudp *self)
+{
+    int rc;
+    int maxsz;
+    size_t sz;
+    uint8_t *dgram;
+    size_t len;
+
+    sz = sizeof (maxsz);
+    nn_pipebase_getopt (&self->pipebase, NN_SOL_SOCKET, NN_RCVMAXSIZE,
+        &maxsz, &sz);
+    nn_assert (sz == sizeof (maxsz));
+
+    while (1) {
+        if (self->inpos == self->incount) {
+            rc = nn_sudp_recvbatch (self);
+            if (rc == -EAGAIN)
+                return 0;
+            if (rc == -EINTR || rc == -ECONNREFUSED)
+                continue;
+            errnum_assert (rc > 0, -rc);
+            self->inpos = 0;
+            self->incount = rc;
+        }
+
+        dgram = self->inbuf + self->inpos * self->slotsz;
+        len = self->inlens [self->inpos];
+        rc = self->intrunc [self->inpos];
+        ++self->inpos;
+
+        /*  Silently drop the datagrams that don't fit into the MTU, aren't
+            SP datagrams or were sent by an incompatible socket. */
+        if (nn_slow (rc || len < NN_SUDP_HDRSZ ||
+              memcmp (dgram, "\0SP\0", 4) != 0 ||
+              !nn_pipebase_ispeer (&self->pipebase, nn_gets (dgram + 4)) ||
+              (maxsz >= 0 && len - NN_SUDP_HDRSZ > (size_t) maxsz))) {
+            nn_ep_stat_increment (self->ep, NN_STAT_DROPPED_MESSAGES, 1);
+            continue;
+        }
+
+        nn_msg_term (&self->inmsg);
+        nn_msg_init (&self->inmsg, len - NN_SUDP_HDRSZ);
+        memcpy (nn_chunkref_data (&self->inmsg.body), dgram + NN_SUDP_HDRSZ,
+            len - NN_SUDP_HDRSZ);
+        return 1;
+    }
+}
+
+/*  Receives a batch of datagrams. Returns the number of datagrams received
+    or negative errno. */
+static int nn_sudp_recvbatch (struct nn_sudp *self)
+{
+    int i;
+    int rc;
+    struct iovec iov [NN_SUDP_BATCH];
+#if defined NN_HAVE_RECVMMSG
+    struct mmsghdr hdrs [NN_SUDP_BATCH];
+#else
+    struct msghdr hdr;
+#endif
+
+#if defined NN_HAVE_RECVMMSG
+    memset (hdrs, 0, sizeof (hdrs));
+    for (i = 0; i != NN_SUDP_BATCH; ++i) {
+        iov [i].iov_base = self->inbuf + i * self->slotsz;
+        iov [i].iov_len = self->slotsz;
+        hdrs [i].msg_hdr.msg_iov = &iov [i];
+        hdrs [i].msg_hdr.msg_iovlen = 1;
+    }
+    rc = recvmmsg (self->s, hdrs, NN_SUDP_BATCH, MSG_DONTWAIT, NULL);
+    if (nn_slow (rc < 0))
+        return errno == EWOULDBLOCK ? -EAGAIN : -errno;
+    for (i = 0; i != rc; ++i) {
+        self->inlens [i] = hdrs [i].msg_len;
+        self->intrunc [i] = hdrs [i].msg_hdr.msg_flags & MSG_TRUNC ? 1 : 0;
+    }
+    return rc;
+#else
+
+    /*  Without recvmmsg, receive the datagrams one by one. */
+    for (i = 0; i != NN_SUDP_BATCH; ++i) {
+        iov [i].iov_base = self->inbuf + i * self->slotsz;
+        iov [i].iov_len = self->slotsz;
+        memset (&hdr, 0, sizeof (hdr));
+        hdr.msg_iov = &iov [i];
+        hdr.msg_iovlen = 1;
+        rc = recvmsg (self->s, &hdr, MSG_DONTWAIT);
+        if (nn_slow (rc < 0)) {
+            if (i > 0)
+                return i;
+            return errno == EWOULDBLOCK ? -EAGAIN : -errno;
+        }
+        self->inlens [i] = (size_t) rc;
+        self->intrunc [i] = hdr.msg_flags & MSG_TRUNC ? 1 : 0;
+    }
+    return NN_SUDP_BATCH;
+#endif
+}
+
+/*  Creates the socket and sets it up according to the endpoint address and
+    options. Address has the form [interface;]address:port. For the bound
+    endpoint, address is either a local interface or a multicast group to
+    join, in which case the interface is used to join the group. For
+    the connected endpoint, address must be a literal IP address and
+    the interface specifies where the datagrams are sent from. Returns
+    the socket or negative errno. */
+static int nn_sudp_open (struct nn_ep *ep, int bound, size_t *maxsz)
+{
+    int rc;
+    int s;
+    int port;
+    int val;
+    int ipv4only;
+    int mcast;
+    size_t sz;
+    const char *addr;
+    const char *end;
+    const char *colon;
+    const char *semicolon;
+    const char *host;
+    struct sockaddr_storage ss;
+    size_t sslen;
+    struct sockaddr_storage iface;
+    size_t ifacelen;
+    struct ip_mreq mreq;
+    struct ipv6_mreq mreq6;
+
+    addr = nn_ep_getaddr (ep);
+    end = addr + strlen (addr);
+
+    /*  Parse the port. */
+    colon = strrchr (addr, ':');
+    if (nn_slow (colon == NULL))
+        return -EINVAL;
+    port = nn_port_resolve (colon + 1, end - colon - 1);
+    if (nn_slow (port < 0))
+        return -EINVAL;
+
+    /*  Parse the optional interface. */
+    sz = sizeof (ipv4only);
+    nn_ep_getopt (ep, NN_SOL_SOCKET, NN_IPV4ONLY, &ipv4only, &sz);
+    nn_assert (sz == sizeof (ipv4only));
+    semicolon = strchr (addr, ';');
+    if (semicolon && semicolon > colon)
+        return -EINVAL;
+    host = semicolon ? semicolon + 1 : addr;
+    memset (&iface, 0, sizeof (iface));
+    ifacelen = 0;
+    if (semicolon) {
+        rc = nn_iface_resolve (addr, semicolon - addr, ipv4only,
+            &iface, &ifacelen);
+        if (nn_slow (rc < 0))
+            return -ENODEV;
+    }
+
+    /*  Parse the address. */
+    memset (&ss, 0, sizeof (ss));
+    rc = nn_literal_resolve (host, colon - host, ipv4only, &ss, &sslen);
+    if (rc < 0) {
+        if (!bound || semicolon)
+            return -EINVAL;
+        rc = nn_iface_resolve (host, colon - host, ipv4only, &ss, &sslen);
+        if (nn_slow (rc < 0))
+            return -ENODEV;
+    }
+    if (ss.ss_family == AF_INET) {
+        ((struct sockaddr_in*) &ss)->sin_port = htons ((uint16_t) port);
+        mcast = IN_MULTICAST (ntohl (((struct sockaddr_in*)
+            &ss)->sin_addr.s_addr));
+        sslen = sizeof (struct sockaddr_in);
+    }
+    else {
+        nn_assert (ss.ss_family == AF_INET6);
+        ((struct sockaddr_in6*) &ss)->sin6_port = htons ((uint16_t) port);
+        mcast = IN6_IS_ADDR_MULTICAST (&((struct sockaddr_in6*)
+            &ss)->sin6_addr);
+        sslen = sizeof (struct sockaddr_in6);
+    }
+    if (nn_slow (semicolon && iface.ss_family != ss.ss_family))
+        return -EINVAL;
+
+    /*  Compute the size limit. */
+    sz = sizeof (val);
+    nn_ep_getopt (ep, NN_UDP, NN_UDP_MTU, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    *maxsz = (size_t) val - NN_SUDP_UDPHDRSZ - NN_SUDP_HDRSZ -
+        (ss.ss_family == AF_INET ? 20 : 40);
+
+    /*  Open the socket. */
+#ifdef SOCK_CLOEXEC
+    s = socket (ss.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+#else
+    s = socket (ss.ss_family, SOCK_DGRAM, 0);
+#endif
+    if (nn_slow (s < 0))
+        return -errno;
+#ifndef SOCK_CLOEXEC
+    rc = fcntl (s, F_SETFD, FD_CLOEXEC);
+    errno_assert (rc != -1);
+#endif
+    rc = fcntl (s, F_SETFL, fcntl (s, F_GETFL, 0) | O_NONBLOCK);
+    errno_assert (rc != -1);
+
+    sz = sizeof (val);
+    nn_ep_getopt (ep, NN_SOL_SOCKET, bound ? NN_RCVBUF : NN_SNDBUF, &val, &sz);
+    nn_assert (sz == sizeof (val));
+    rc = nn_sudp_setopt (s, SOL_SOCKET, bound ? SO_RCVBUF : SO_SNDBUF, val);
+    if (nn_slow (rc < 0))
+        goto fail;
+
+    if (bound) {
+
+        /*  Bind to the group's port on all interfaces and join the group.
+            Several processes are allowed to join the same group. */
+        if (mcast) {
+            rc = nn_sudp_setopt (s, SOL_SOCKET, SO_REUSEADDR, 1);
+            if (nn_slow (rc < 0))
+                goto fail;
+            if (ss.ss_family == AF_INET) {
+                mreq.imr_multiaddr = ((struct sockaddr_in*) &ss)->sin_addr;
+                mreq.imr_interface.s_addr = semicolon ?
+                    ((struct sockaddr_in*) &iface)->sin_addr.s_addr :
+                    htonl (INADDR_ANY);
+                ((struct sockaddr_in*) &ss)->sin_addr.s_addr =
+                    htonl (INADDR_ANY);
+                rc = setsockopt (s, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                    &mreq, sizeof (mreq));
+            }
+            else {
+                mreq6.ipv6mr_multiaddr =
+                    ((struct sockaddr_in6*) &ss)->sin6_addr;
+                mreq6.ipv6mr_interface = 0;
+                ((struct sockaddr_in6*) &ss)->sin6_addr = in6addr_any;
+                rc = setsockopt (s, IPPROTO_IPV6, IPV6_JOIN_GROUP,
+                    &mreq6, sizeof (mreq6));
+            }
+            if (nn_slow (rc < 0)) {
+                rc = -errno;
+                goto fail;
+            }
+        }
+        rc = bind (s, (struct sockaddr*) &ss, (socklen_t) sslen);
+        if (nn_slow (rc < 0)) {
+            rc = -errno;
+            goto fail;
+        }
+        return s;
+    }
+
+    /*  Send from the specified interface. */
+    if (semicolon) {
+        rc = bind (s, (struct sockaddr*) &iface, (socklen_t) ifacelen);
+        if (nn_slow (rc < 0)) {
+            rc = -errno;
+            goto fail;
+        }
+    }
+
+    if (mcast) {
+        sz = sizeof (val);
+        nn_ep_getopt (ep, NN_UDP, NN_UDP_MULTICAST_TTL, &val, &sz);
+        nn_assert (sz == sizeof (val));
+        rc = ss.ss_family == AF_INET ?
+            nn_sudp_setopt (s, IPPROTO_IP, IP_MULTICAST_TTL, val) :
+            nn_sudp_setopt (s, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, val);
+        if (nn_slow (rc < 0))
+            goto fail;
+        sz = sizeof (val);
+        nn_ep_getopt (ep, NN_UDP, NN_UDP_MULTICAST_LOOP, &val, &sz);
+        nn_assert (sz == sizeof (val));
+        rc = ss.ss_family == AF_INET ?
+            nn_sudp_setopt (s, IPPROTO_IP, IP_MULTICAST_LOOP, val) :
+            nn_sudp_setopt (s, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, val);
+        if (nn_slow (rc < 0))
+            goto fail;
+        if (semicolon && ss.ss_family == AF_INET) {
+            rc = setsockopt (s, IPPROTO_IP, IP_MULTICAST_IF,
+                &((struct sockaddr_in*) &iface)->sin_addr,
+                sizeof (struct in_addr));
+            if (nn_slow (rc < 0)) {
+                rc = -errno;
+                goto fail;
+            }
+        }
+    }
+
+    rc = connect (s, (struct sockaddr*) &ss, (socklen_t) sslen);
+    if (nn_slow (rc < 0)) {
+        rc = -errno;
+        goto fail;
+    }
+    return s;
+
+fail:
+    nn_closefd (s);
+    return rc;
+}
+
+static int nn_sudp_setopt (int s, int level, int option, int val)
+{
+    int rc;
+
+    rc = setsockopt (s, level, option, &val, sizeof (val));
+    return rc < 0 ? -errno : 0;
+}
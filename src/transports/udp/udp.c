@@ -0,0 +1,164 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "sudp.h"
+
+#include "../../udp.h"
+
+#include "../../utils/err.h"
+#include "../../utils/alloc.h"
+#include "../../utils/fast.h"
+#include "../../utils/cont.h"
+
+#include <string.h>
+
+/*  UDP-specific socket options. */
+
+struct nn_udp_optset {
+    struct nn_optset base;
+    int mtu;
+    int multicast_ttl;
+    int multicast_loop;
+};
+
+static void nn_udp_optset_destroy (struct nn_optset *self);
+static int nn_udp_optset_setopt (struct nn_optset *self, int option,
+    const void *optval, size_t optvallen);
+static int nn_udp_optset_getopt (struct nn_optset *self, int option,
+    void *optval, size_t *optvallen);
+static const struct nn_optset_vfptr nn_udp_optset_vfptr = {
+    nn_udp_optset_destroy,
+    nn_udp_optset_setopt,
+    nn_udp_optset_getopt
+};
+
+/*  nn_transport interface. */
+static int nn_udp_bind (struct nn_ep *ep);
+static int nn_udp_connect (struct nn_ep *ep);
+static struct nn_optset *nn_udp_optset (void);
+
+struct nn_transport nn_udp = {
+    "udp",
+    NN_UDP,
+    NULL,
+    NULL,
+    nn_udp_bind,
+    nn_udp_connect,
+    nn_udp_optset,
+};
+
+static int nn_udp_bind (struct nn_ep *ep)
+{
+    return nn_sudp_create (ep, 1);
+}
+
+static int nn_udp_connect (struct nn_ep *ep)
+{
+    return nn_sudp_create (ep, 0);
+}
+
+static struct nn_optset *nn_udp_optset ()
+{
+    struct nn_udp_optset *optset;
+
+    optset = nn_alloc (sizeof (struct nn_udp_optset), "optset (udp)");
+    alloc_assert (optset);
+    optset->base.vfptr = &nn_udp_optset_vfptr;
+
+    /*  Default values for UDP socket options. Default MTU is that of
+        the Ethernet so that the datagrams are never fragmented. */
+    optset->mtu = 1500;
+    optset->multicast_ttl = 1;
+    optset->multicast_loop = 1;
+
+    return &optset->base;
+}
+
+static void nn_udp_optset_destroy (struct nn_optset *self)
+{
+    struct nn_udp_optset *optset;
+
+    optset = nn_cont (self, struct nn_udp_optset, base);
+    nn_free (optset);
+}
+
+static int nn_udp_optset_setopt (struct nn_optset *self, int option,
+    const void *optval, size_t optvallen)
+{
+    struct nn_udp_optset *optset;
+    int val;
+
+    optset = nn_cont (self, struct nn_udp_optset, base);
+
+    /*  At this point we assume that all options are of type int. */
+    if (optvallen != sizeof (int))
+        return -EINVAL;
+    val = *(int*) optval;
+
+    switch (option) {
+    case NN_UDP_MTU:
+        if (nn_slow (val < 576 || val > 65535))
+            return -EINVAL;
+        optset->mtu = val;
+        return 0;
+    case NN_UDP_MULTICAST_TTL:
+        if (nn_slow (val < 0 || val > 255))
+            return -EINVAL;
+        optset->multicast_ttl = val;
+        return 0;
+    case NN_UDP_MULTICAST_LOOP:
+        if (nn_slow (val != 0 && val != 1))
+            return -EINVAL;
+        optset->multicast_loop = val;
+        return 0;
+    default:
+        return -ENOPROTOOPT;
+    }
+}
+
+static int nn_udp_optset_getopt (struct nn_optset *self, int option,
+    void *optval, size_t *optvallen)
+{
+    struct nn_udp_optset *optset;
+    int intval;
+
+    optset = nn_cont (self, struct nn_udp_optset, base);
+
+    switch (option) {
+    case NN_UDP_MTU:
+        intval = optset->mtu;
+        break;
+    case NN_UDP_MULTICAST_TTL:
+        intval = optset->multicast_ttl;
+        break;
+    case NN_UDP_MULTICAST_LOOP:
+        intval = optset->multicast_loop;
+        break;
+    default:
+        return -ENOPROTOOPT;
+    }
+    memcpy (optval, &intval,
+        *optvallen < sizeof (int) ? *optvallen : sizeof (int));
+    *optvallen = sizeof (int);
+    return 0;
+}
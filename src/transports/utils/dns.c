@@ -21,11 +21,25 @@
 */
 
 #include "dns.h"
+#include "literal.h"
 
 #include "../../utils/err.h"
 
 #include <string.h>
 
+#ifndef NN_HAVE_WINDOWS
+#include <netinet/in.h>
+#include <netdb.h>
+#endif
+
+/*  Private functions. */
+static size_t nn_dns_namelen (const char *names, size_t nameslen);
+static void nn_dns_add (struct nn_dns_result *result,
+    const struct sockaddr *addr, size_t addrlen);
+static void nn_dns_add_list (struct nn_dns_result *result,
+    const struct addrinfo *ai);
+static void nn_dns_interleave (struct nn_dns_result *result);
+
 int nn_dns_check_hostname (const char *name, size_t namelen)
 {
     int labelsz;
@@ -83,6 +97,92 @@ int nn_dns_check_hostname (const char *name, size_t namelen)
     }
 }
 
+int nn_dns_check_hostlist (const char *names, size_t nameslen, int ipv4only)
+{
+    size_t len;
+    struct sockaddr_storage ss;
+    size_t sslen;
+
+    while (1) {
+        len = nn_dns_namelen (names, nameslen);
+        if (nn_dns_check_hostname (names, len) < 0 &&
+              nn_literal_resolve (names, len, ipv4only, &ss, &sslen) < 0)
+            return -EINVAL;
+        if (len == nameslen)
+            return 0;
+        names += len + 1;
+        nameslen -= len + 1;
+    }
+}
+
+/*  Returns length of the first name in a comma-separated list. */
+static size_t nn_dns_namelen (const char *names, size_t nameslen)
+{
+    const char *comma;
+
+    comma = memchr (names, ',', nameslen);
+    return comma ? (size_t) (comma - names) : nameslen;
+}
+
+static void nn_dns_add (struct nn_dns_result *result,
+    const struct sockaddr *addr, size_t addrlen)
+{
+    if (result->naddrs == NN_DNS_MAXADDRS)
+        return;
+    nn_assert (addrlen <= sizeof (struct sockaddr_storage));
+    memcpy (&result->addrs [result->naddrs], addr, addrlen);
+    result->addrlens [result->naddrs] = addrlen;
+    ++result->naddrs;
+}
+
+static void nn_dns_add_list (struct nn_dns_result *result,
+    const struct addrinfo *ai)
+{
+    for (; ai; ai = ai->ai_next)
+        nn_dns_add (result, ai->ai_addr, ai->ai_addrlen);
+}
+
+/*  Returns 1 for native IPv6 addresses, 0 for IPv4 and IPv4-mapped ones. */
+static int nn_dns_isipv6 (const struct sockaddr_storage *ss)
+{
+    if (ss->ss_family != AF_INET6)
+        return 0;
+    return IN6_IS_ADDR_V4MAPPED (
+        &((const struct sockaddr_in6*) ss)->sin6_addr) ? 0 : 1;
+}
+
+/*  Reorders the addresses so that the families alternate, starting with
+    the family of the first one. The order within each family is kept. */
+static void nn_dns_interleave (struct nn_dns_result *result)
+{
+    int i;
+    int j;
+    int family;
+    struct sockaddr_storage ss;
+    size_t sslen;
+
+    for (i = 1; i < result->naddrs; ++i) {
+        family = !nn_dns_isipv6 (&result->addrs [i - 1]);
+        if (nn_dns_isipv6 (&result->addrs [i]) == family)
+            continue;
+
+        /*  Find the next address of the other family and move it here. */
+        for (j = i + 1; j != result->naddrs; ++j)
+            if (nn_dns_isipv6 (&result->addrs [j]) == family)
+                break;
+        if (j == result->naddrs)
+            return;
+        ss = result->addrs [j];
+        sslen = result->addrlens [j];
+        memmove (&result->addrs [i + 1], &result->addrs [i],
+            (j - i) * sizeof (result->addrs [0]));
+        memmove (&result->addrlens [i + 1], &result->addrlens [i],
+            (j - i) * sizeof (result->addrlens [0]));
+        result->addrs [i] = ss;
+        result->addrlens [i] = sslen;
+    }
+}
+
 #if defined NN_HAVE_GETADDRINFO_A && !defined NN_DISABLE_GETADDRINFO_A
 #include "dns_getaddrinfo_a.inc"
 #else
@@ -31,6 +31,13 @@
     Returns 0 in case the it is valid. */
 int nn_dns_check_hostname (const char *name, size_t namelen);
 
+/*  Checks a comma-separated list of hostnames and literal addresses, as
+    accepted by nn_dns_start. Returns 0 in case all of them are valid. */
+int nn_dns_check_hostlist (const char *names, size_t nameslen, int ipv4only);
+
+/*  Maximum number of addresses reported by the resolver. */
+#define NN_DNS_MAXADDRS 8
+
 /*  Events generated by the DNS state machine. */
 #define NN_DNS_DONE 1
 #define NN_DNS_STOPPED 2
@@ -43,14 +50,20 @@ int nn_dns_check_hostname (const char *name, size_t namelen);
 
 struct nn_dns_result {
     int error;
-    struct sockaddr_storage addr;
-    size_t addrlen;
+
+    /*  The addresses the names resolved to. They are ordered so that IPv6
+        and IPv4 addresses alternate, as recommended by RFC 8305. */
+    int naddrs;
+    struct sockaddr_storage addrs [NN_DNS_MAXADDRS];
+    size_t addrlens [NN_DNS_MAXADDRS];
 };
 
 void nn_dns_init (struct nn_dns *self, int src, struct nn_fsm *owner);
 void nn_dns_term (struct nn_dns *self);
 
 int nn_dns_isidle (struct nn_dns *self);
+/*  'addr' is a comma-separated list of hostnames and literal addresses.
+    All of them are resolved and the results are merged. */
 void nn_dns_start (struct nn_dns *self, const char *addr, size_t addrlen,
     int ipv4only, struct nn_dns_result *result);
 void nn_dns_stop (struct nn_dns *self);
@@ -34,6 +34,14 @@ struct nn_dns {
     struct nn_fsm fsm;
     int state;
     int error;
+
+    /*  The list of names being resolved and the position of the next name
+        to resolve in it. Names are resolved one at a time. */
+    char names [NN_SOCKADDR_MAX];
+    size_t nameslen;
+    size_t pos;
+    int ipv4only;
+
     char hostname [NN_SOCKADDR_MAX];
     struct addrinfo request;
     struct gaicb gcb;
@@ -30,6 +30,7 @@
 #include "../../utils/fast.h"
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
+#include "../../utils/probe.h"
 
 #include <stddef.h>
 #include <string.h>
@@ -45,6 +46,11 @@
 #define NN_STREAMHDR_SRC_USOCK 1
 #define NN_STREAMHDR_SRC_TIMER 2
 
+/*  Flag in the reserved part of the protocol header saying that the sender
+    understands heartbeats. The rest of the bits hold the heartbeat interval
+    the sender asks for. */
+#define NN_STREAMHDR_HEARTBEAT 0x8000
+
 /*  Private functions. */
 static void nn_streamhdr_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
@@ -64,6 +70,8 @@ void nn_streamhdr_init (struct nn_streamhdr *self, int src,
     self->usock_owner.src = -1;
     self->usock_owner.fsm = NULL;
     self->pipebase = NULL;
+    self->hbivl = -1;
+    self->peerhbivl = -1;
 }
 
 void nn_streamhdr_term (struct nn_streamhdr *self)
@@ -99,9 +107,16 @@ void nn_streamhdr_start (struct nn_streamhdr *self, struct nn_usock *usock,
     nn_pipebase_getopt (pipebase, NN_SOL_SOCKET, NN_PROTOCOL, &protocol, &sz);
     nn_assert (sz == sizeof (protocol));
 
-    /*  Compose the protocol header. */
+    /*  Compose the protocol header. The last two bytes, reserved in the
+        original protocol, announce the heartbeat interval, but only if
+        heartbeats were asked for. Otherwise the header is left exactly as
+        in the original protocol so that strict peers accept it. */
     memcpy (self->protohdr, "\0SP\0\0\0\0\0", 8);
     nn_puts (self->protohdr + 4, (uint16_t) protocol);
+    if (self->hbivl > 0)
+        nn_puts (self->protohdr + 6,
+            (uint16_t) (NN_STREAMHDR_HEARTBEAT | self->hbivl));
+    self->peerhbivl = -1;
 
     /*  Launch the state machine. */
     nn_fsm_start (&self->fsm);
@@ -112,6 +127,12 @@ void nn_streamhdr_stop (struct nn_streamhdr *self)
     nn_fsm_stop (&self->fsm);
 }
 
+void nn_streamhdr_setheartbeat (struct nn_streamhdr *self, int ivl)
+{
+    nn_assert (ivl <= NN_STREAMHDR_MAXHBIVL);
+    self->hbivl = ivl;
+}
+
 static void nn_streamhdr_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
@@ -140,6 +161,7 @@ static void nn_streamhdr_handler (struct nn_fsm *self, int src, int type,
     struct nn_streamhdr *streamhdr;
     struct nn_iovec iovec;
     int protocol;
+    uint16_t hb;
 
     streamhdr = nn_cont (self, struct nn_streamhdr, fsm);
 
@@ -224,6 +246,9 @@ static void nn_streamhdr_handler (struct nn_fsm *self, int src, int type,
                 protocol = nn_gets (streamhdr->protohdr + 4);
                 if (!nn_pipebase_ispeer (streamhdr->pipebase, protocol))
                     goto invalidhdr;
+                hb = nn_gets (streamhdr->protohdr + 6);
+                streamhdr->peerhbivl = hb & NN_STREAMHDR_HEARTBEAT ?
+                    hb & NN_STREAMHDR_MAXHBIVL : -1;
                 nn_timer_stop (&streamhdr->timer);
                 streamhdr->state = NN_STREAMHDR_STATE_STOPPING_TIMER_DONE;
                 return;
@@ -273,6 +298,7 @@ invalidhdr:
                 streamhdr->usock_owner.src = -1;
                 streamhdr->usock_owner.fsm = NULL;
                 streamhdr->state = NN_STREAMHDR_STATE_DONE;
+                NN_PROBE2 (handshake__done, streamhdr->pipebase, 0);
                 nn_fsm_raise (&streamhdr->fsm, &streamhdr->done,
                     NN_STREAMHDR_ERROR);
                 return;
@@ -302,6 +328,7 @@ invalidhdr:
                 streamhdr->usock_owner.src = -1;
                 streamhdr->usock_owner.fsm = NULL;
                 streamhdr->state = NN_STREAMHDR_STATE_DONE;
+                NN_PROBE2 (handshake__done, streamhdr->pipebase, 1);
                 nn_fsm_raise (&streamhdr->fsm, &streamhdr->done,
                     NN_STREAMHDR_OK);
                 return;
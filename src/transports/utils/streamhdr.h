@@ -36,6 +36,9 @@
 #define NN_STREAMHDR_ERROR 2
 #define NN_STREAMHDR_STOPPED 3
 
+/*  Maximum heartbeat interval that can be negotiated, in milliseconds. */
+#define NN_STREAMHDR_MAXHBIVL 0x7fff
+
 struct nn_streamhdr {
 
     /*  The state machine. */
@@ -57,6 +60,14 @@ struct nn_streamhdr {
     /*  Protocol header. */
     uint8_t protohdr [8];
 
+    /*  Interval, in milliseconds, the peer is asked to send heartbeats at.
+        Heartbeats are announced in the header only if it's positive. */
+    int hbivl;
+
+    /*  The same value as announced by the peer, -1 if the peer announced
+        nothing. Valid once the header exchange is done successfully. */
+    int peerhbivl;
+
     /*  Event fired when the state machine ends. */
     struct nn_fsm_event done;
 };
@@ -70,4 +81,8 @@ void nn_streamhdr_start (struct nn_streamhdr *self, struct nn_usock *usock,
     struct nn_pipebase *pipebase);
 void nn_streamhdr_stop (struct nn_streamhdr *self);
 
+/*  Sets the heartbeat interval to ask the peer for. Has to be called before
+    nn_streamhdr_start. */
+void nn_streamhdr_setheartbeat (struct nn_streamhdr *self, int ivl);
+
 #endif
@@ -384,8 +384,8 @@ static void nn_cws_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_DNS_STOPPED:
                 if (cws->dns_result.error == 0) {
-                    nn_cws_start_connecting (cws, &cws->dns_result.addr,
-                        cws->dns_result.addrlen);
+                    nn_cws_start_connecting (cws, &cws->dns_result.addrs [0],
+                        cws->dns_result.addrlens [0]);
                     return;
                 }
                 nn_backoff_start (&cws->retry);
@@ -27,6 +27,7 @@
 #include "../../nn.h"
 
 #include "../../utils/alloc.h"
+#include "../../utils/chunk.h"
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 #include "../../utils/fast.h"
@@ -374,6 +375,7 @@ static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
     struct nn_cmsghdr *cmsg;
     struct nn_msghdr msghdr;
     uint8_t rand_mask [NN_SWS_FRAME_SIZE_MASK];
+    void *hdr;
 
     sws = nn_cont (self, struct nn_sws, pipebase);
 
@@ -391,12 +393,12 @@ static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
     cmsg = NULL;
     msghdr.msg_iov = NULL;
     msghdr.msg_iovlen = 0;
-    msghdr.msg_controllen = nn_chunkref_size (&sws->outmsg.hdrs);
+    msghdr.msg_controllen = nn_msg_hdrssize (&sws->outmsg);
 
     /*  If the outgoing message has specified an opcode and control framing in
         its header, properly frame it as per RFC 6455 5.2. */
     if (msghdr.msg_controllen > 0) {
-        msghdr.msg_control = nn_chunkref_data (&sws->outmsg.hdrs);
+        msghdr.msg_control = sws->outmsg.hdrs;
         cmsg = NN_CMSG_FIRSTHDR (&msghdr);
         while (cmsg) {
             if (cmsg->cmsg_level == NN_WS && cmsg->cmsg_type == NN_WS_MSG_TYPE)
@@ -462,6 +464,18 @@ static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
         nn_assert (0);
     }
 
+    /*  If possible, put the frame header in front of the payload and send
+        it all as a single buffer. */
+    hdr = nn_msg_prepend (&sws->outmsg, hdr_len);
+    if (nn_fast (hdr != NULL)) {
+        memcpy (hdr, sws->outhdr, hdr_len);
+        iov [0].iov_base = nn_chunkref_data (&sws->outmsg.body);
+        iov [0].iov_len = nn_chunkref_size (&sws->outmsg.body);
+        nn_usock_send (sws->usock, iov, 1);
+        sws->outstate = NN_SWS_OUTSTATE_SENDING;
+        return 0;
+    }
+
     /*  Start async sending. */
     iov [0].iov_base = sws->outhdr;
     iov [0].iov_len = hdr_len;
@@ -486,6 +500,8 @@ static int nn_sws_recv (struct nn_pipebase *self, struct nn_msg *msg)
     uint8_t opcode;
     size_t cmsgsz;
     size_t pos;
+    int rc;
+    void *chunk;
 
     sws = nn_cont (self, struct nn_sws, pipebase);
 
@@ -568,8 +584,10 @@ static int nn_sws_recv (struct nn_pipebase *self, struct nn_msg *msg)
 
     /*  Allocate and populate WebSocket-specific control headers. */
     cmsgsz = NN_CMSG_SPACE (sizeof (opcode_hdr));
-    nn_chunkref_init (&msg->hdrs, cmsgsz);
-    cmsg = nn_chunkref_data (&msg->hdrs);
+    rc = nn_chunk_alloc (cmsgsz, 0, &chunk);
+    errnum_assert (rc == 0, -rc);
+    nn_msg_sethdrs (msg, chunk);
+    cmsg = chunk;
     cmsg->cmsg_level = NN_WS;
     cmsg->cmsg_type = NN_WS_MSG_TYPE;
     cmsg->cmsg_len = cmsgsz;
@@ -1,5 +1,6 @@
 /*
     Copyright (c) 2012 Martin Sustrik  All rights reserved.
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
 
     Permission is hereby granted, free of charge, to any person obtaining a copy
     of this software and associated documentation files (the "Software"),
@@ -22,55 +23,191 @@
 
 #include "alloc.h"
 
-#if defined NN_ALLOC_MONITOR
+#if defined NN_ALLOC_STATS
+
+#include "fast.h"
+#include "err.h"
 
-#include "mutex.h"
+#if defined NN_HAVE_WINDOWS
+#include "win.h"
+#endif
 
 #include <stdlib.h>
 #include <stddef.h>
-#include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+#if defined NN_ALLOC_MONITOR
+#include <stdio.h>
+#endif
 
+/*  Every block is prefixed by a header recording its size and the tag it is
+    accounted to. The header keeps the alignment guaranteed by malloc. */
 struct nn_alloc_hdr {
+    struct nn_alloc_tag *tag;
     size_t size;
+};
+
+/*  Memory usage of all the blocks allocated with the same name. */
+struct nn_alloc_tag {
+    const char *name;
+    volatile int64_t bytes;
+    volatile int64_t blocks;
+};
+
+/*  Maps the address of the name string to the tag. Same names at different
+    addresses, such as identical literals in different translation units,
+    share a single tag. */
+struct nn_alloc_key {
     const char *name;
+    struct nn_alloc_tag *tag;
 };
 
-static struct nn_mutex nn_alloc_sync;
-static size_t nn_alloc_bytes;
-static size_t nn_alloc_blocks;
+/*  Maximum number of distinct tags. Any further names are accounted to
+    the 'other' tag. Number of slots must be a power of two. */
+#define NN_ALLOC_MAXTAGS 128
+#define NN_ALLOC_SLOTS 256
+
+/*  The first tag is always 'other'. */
+static struct nn_alloc_tag nn_alloc_tags [NN_ALLOC_MAXTAGS] = {{"other", 0, 0}};
+static int nn_alloc_ntags = 1;
+
+/*  Open-addressed hash table of the keys. A slot is filled in once and never
+    changes afterwards, thus lookups need no locking. */
+static struct nn_alloc_key nn_alloc_keys [NN_ALLOC_SLOTS];
+static struct nn_alloc_key *volatile nn_alloc_slots [NN_ALLOC_SLOTS];
+
+/*  Spinlock guarding creation of new keys and tags. This happens only once
+    per call site. */
+static volatile long nn_alloc_lock;
+
+static int64_t nn_alloc_add (volatile int64_t *counter, int64_t n)
+{
+#if defined NN_HAVE_WINDOWS
+    return InterlockedExchangeAdd64 ((volatile LONGLONG*) counter, n);
+#else
+    return __sync_fetch_and_add (counter, n);
+#endif
+}
+
+static void nn_alloc_lock_acquire (void)
+{
+#if defined NN_HAVE_WINDOWS
+    while (InterlockedExchange (&nn_alloc_lock, 1))
+        continue;
+#else
+    while (__sync_lock_test_and_set (&nn_alloc_lock, 1))
+        continue;
+#endif
+}
+
+static void nn_alloc_lock_release (void)
+{
+#if defined NN_HAVE_WINDOWS
+    InterlockedExchange (&nn_alloc_lock, 0);
+#else
+    __sync_lock_release (&nn_alloc_lock);
+#endif
+}
+
+static struct nn_alloc_tag *nn_alloc_newkey (const char *name, size_t pos)
+{
+    int i;
+    size_t n;
+    struct nn_alloc_key *key;
+    struct nn_alloc_tag *tag;
+
+    nn_alloc_lock_acquire ();
+
+    /*  Other thread may have added the key in the meantime. */
+    for (n = 0; n != NN_ALLOC_SLOTS; ++n) {
+        key = nn_alloc_slots [pos];
+        if (!key)
+            break;
+        if (key->name == name) {
+            nn_alloc_lock_release ();
+            return key->tag;
+        }
+        pos = (pos + 1) & (NN_ALLOC_SLOTS - 1);
+    }
+    if (nn_slow (n == NN_ALLOC_SLOTS)) {
+        nn_alloc_lock_release ();
+        return &nn_alloc_tags [0];
+    }
+
+    /*  Find the tag with the same name or create a new one. */
+    tag = NULL;
+    for (i = 1; i != nn_alloc_ntags; ++i) {
+        if (strcmp (nn_alloc_tags [i].name, name) == 0) {
+            tag = &nn_alloc_tags [i];
+            break;
+        }
+    }
+    if (!tag) {
+        if (nn_alloc_ntags < NN_ALLOC_MAXTAGS) {
+            tag = &nn_alloc_tags [nn_alloc_ntags];
+            tag->name = name;
+            ++nn_alloc_ntags;
+        }
+        else
+            tag = &nn_alloc_tags [0];
+    }
+
+    /*  Publish the key. The lock release acts as a memory barrier. */
+    key = &nn_alloc_keys [pos];
+    key->name = name;
+    key->tag = tag;
+#if defined NN_HAVE_WINDOWS
+    MemoryBarrier ();
+#else
+    __sync_synchronize ();
+#endif
+    nn_alloc_slots [pos] = key;
+
+    nn_alloc_lock_release ();
+    return tag;
+}
+
+static struct nn_alloc_tag *nn_alloc_gettag (const char *name)
+{
+    size_t pos;
+    struct nn_alloc_key *key;
+
+    pos = (size_t) (((uintptr_t) name) >> 3) & (NN_ALLOC_SLOTS - 1);
+    while (1) {
+        key = nn_alloc_slots [pos];
+        if (nn_fast (key && key->name == name))
+            return key->tag;
+        if (!key)
+            return nn_alloc_newkey (name, pos);
+        pos = (pos + 1) & (NN_ALLOC_SLOTS - 1);
+    }
+}
 
 void nn_alloc_init (void)
 {
-    nn_mutex_init (&nn_alloc_sync);
-    nn_alloc_bytes = 0;
-    nn_alloc_blocks = 0;
 }
 
 void nn_alloc_term (void)
 {
-    nn_mutex_term (&nn_alloc_sync);
 }
 
 void *nn_alloc_ (size_t size, const char *name)
 {
-    uint8_t *chunk;
+    struct nn_alloc_hdr *chunk;
 
     chunk = malloc (sizeof (struct nn_alloc_hdr) + size);
     if (!chunk)
         return NULL;
 
-    nn_mutex_lock (&nn_alloc_sync);
-    ((struct nn_alloc_hdr*) chunk)->size = size;
-    ((struct nn_alloc_hdr*) chunk)->name = name;
-    nn_alloc_bytes += size;
-    ++nn_alloc_blocks;
+    chunk->tag = nn_alloc_gettag (name);
+    chunk->size = size;
+    nn_alloc_add (&chunk->tag->bytes, (int64_t) size);
+    nn_alloc_add (&chunk->tag->blocks, 1);
+#if defined NN_ALLOC_MONITOR
     printf ("Allocating %s (%zu bytes)\n", name, size);
-    printf ("Current memory usage: %zu bytes in %zu blocks\n",
-        nn_alloc_bytes, nn_alloc_blocks);
-    nn_mutex_unlock (&nn_alloc_sync);
+#endif
 
-    return chunk + sizeof (struct nn_alloc_hdr);
+    return chunk + 1;
 }
 
 void *nn_realloc (void *ptr, size_t size)
@@ -85,40 +222,55 @@ void *nn_realloc (void *ptr, size_t size)
     if (!newchunk)
         return NULL;
     newchunk->size = size;
-
-    nn_mutex_lock (&nn_alloc_sync);
-    nn_alloc_bytes -= oldsize;
-    nn_alloc_bytes += size;
+    nn_alloc_add (&newchunk->tag->bytes, (int64_t) size - (int64_t) oldsize);
+#if defined NN_ALLOC_MONITOR
     printf ("Reallocating %s (%zu bytes to %zu bytes)\n",
-        newchunk->name, oldsize, size);
-    printf ("Current memory usage: %zu bytes in %zu blocks\n",
-        nn_alloc_bytes, nn_alloc_blocks);
-    nn_mutex_unlock (&nn_alloc_sync);
+        newchunk->tag->name, oldsize, size);
+#endif
 
-    return newchunk + sizeof (struct nn_alloc_hdr);
+    return newchunk + 1;
 }
 
 void nn_free (void *ptr)
 {
     struct nn_alloc_hdr *chunk;
-    
+
     if (!ptr)
         return;
     chunk = ((struct nn_alloc_hdr*) ptr) - 1;
-
-    nn_mutex_lock (&nn_alloc_sync);
-    nn_alloc_bytes -= chunk->size;
-    --nn_alloc_blocks;
-    printf ("Deallocating %s (%zu bytes)\n", chunk->name, chunk->size);
-    printf ("Current memory usage: %zu bytes in %zu blocks\n",
-        nn_alloc_bytes, nn_alloc_blocks);
-    nn_mutex_unlock (&nn_alloc_sync);
+    nn_alloc_add (&chunk->tag->bytes, -(int64_t) chunk->size);
+    nn_alloc_add (&chunk->tag->blocks, -1);
+#if defined NN_ALLOC_MONITOR
+    printf ("Deallocating %s (%zu bytes)\n", chunk->tag->name, chunk->size);
+#endif
 
     free (chunk);
 }
 
+int nn_alloc_stat (int i, const char **name, uint64_t *bytes,
+    uint64_t *blocks)
+{
+    struct nn_alloc_tag *tag;
+
+    nn_alloc_lock_acquire ();
+    if (i < 0 || i >= nn_alloc_ntags) {
+        nn_alloc_lock_release ();
+        return -ENOENT;
+    }
+    tag = &nn_alloc_tags [i];
+    nn_alloc_lock_release ();
+
+    *name = tag->name;
+    *bytes = (uint64_t) nn_alloc_add (&tag->bytes, 0);
+    *blocks = (uint64_t) nn_alloc_add (&tag->blocks, 0);
+    return 0;
+}
+
 #else
 
+#include "err.h"
+#include "attr.h"
+
 #include <stdlib.h>
 
 void nn_alloc_init (void)
@@ -144,5 +296,10 @@ void nn_free (void *ptr)
     free (ptr);
 }
 
-#endif
+int nn_alloc_stat (NN_UNUSED int i, NN_UNUSED const char **name,
+    NN_UNUSED uint64_t *bytes, NN_UNUSED uint64_t *blocks)
+{
+    return -ENOTSUP;
+}
 
+#endif
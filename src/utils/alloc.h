@@ -24,16 +24,29 @@
 #define NN_ALLOC_INCLUDED
 
 #include <stddef.h>
+#include <stdint.h>
 
 /*  These functions allow for interception of memory allocation-related
     functionality. */
 
+/*  With NN_ALLOC_STATS, the memory in use is accounted per allocation name.
+    NN_ALLOC_MONITOR additionally prints every allocation and deallocation. */
+#if defined NN_ALLOC_MONITOR && !defined NN_ALLOC_STATS
+#define NN_ALLOC_STATS
+#endif
+
 void nn_alloc_init (void);
 void nn_alloc_term (void);
 void *nn_realloc (void *ptr, size_t size);
 void nn_free (void *ptr);
 
-#if defined NN_ALLOC_MONITOR
+/*  Retrieves memory usage of i-th allocation name. Returns -ENOENT if the
+    index is out of range and -ENOTSUP if the library was built without
+    NN_ALLOC_STATS. */
+int nn_alloc_stat (int i, const char **name, uint64_t *bytes,
+    uint64_t *blocks);
+
+#if defined NN_ALLOC_STATS
 #define nn_alloc(size, name) nn_alloc_ (size, name)
 void *nn_alloc_ (size_t size, const char *name);
 #else
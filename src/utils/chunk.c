@@ -28,9 +28,16 @@
 #include "fast.h"
 #include "wire.h"
 #include "err.h"
+#include "closefd.h"
+#include "region.h"
 
 #include <string.h>
 
+#if !defined NN_HAVE_WINDOWS
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
 #define NN_CHUNK_TAG 0xdeadcafe
 #define NN_CHUNK_TAG_DEALLOCATED 0xbeadfeed
 
@@ -52,50 +59,117 @@ struct nn_chunk {
         the message data itself. */
 };
 
+/*  In chunks referring to a file the empty space holds the location of
+    the data in the file. There's no data in memory. */
+struct nn_chunk_fileref {
+    int fd;
+    uint64_t offset;
+};
+
 /*  Private functions. */
 static struct nn_chunk *nn_chunk_getptr (void *p);
 static void *nn_chunk_getdata (struct nn_chunk *c);
 static void nn_chunk_default_free (void *p);
+static void nn_chunk_file_free (void *p);
+static struct nn_chunk_fileref *nn_chunk_getfileref (struct nn_chunk *self);
 static size_t nn_chunk_hdrsize ();
+#if !defined NN_HAVE_WINDOWS
+static int nn_chunk_checkrange (int fd, uint64_t offset, size_t size);
+#endif
+
+/*  Keep the message data aligned. */
+CT_ASSERT (NN_CHUNK_HEADROOM % 8 == 0);
 
 int nn_chunk_alloc (size_t size, int type, void **result)
 {
+    int rc;
     size_t sz;
     struct nn_chunk *self;
+    void *block;
+    nn_chunk_free_fn ffn;
     const size_t hdrsz = nn_chunk_hdrsize ();
 
     /*  Compute total size to be allocated. Check for overflow. */
-    sz = hdrsz + size;
-    if (nn_slow (sz < hdrsz))
+    sz = hdrsz + NN_CHUNK_HEADROOM + size;
+    if (nn_slow (sz < hdrsz + NN_CHUNK_HEADROOM))
         return -ENOMEM;
 
     /*  Allocate the actual memory depending on the type. */
     switch (type) {
     case 0:
         self = nn_alloc (sz, "message chunk");
+        if (nn_slow (!self))
+            return -ENOMEM;
+        ffn = nn_chunk_default_free;
         break;
     default:
-        return -EINVAL;
+
+        /*  Memory region registered by the user. */
+        rc = nn_region_alloc (type, sz, &block);
+        if (nn_slow (rc < 0))
+            return rc;
+        self = block;
+        ffn = nn_region_free;
+        break;
     }
-    if (nn_slow (!self))
-        return -ENOMEM;
 
     /*  Fill in the chunk header. */
     nn_atomic_init (&self->refcount, 1);
     self->size = size;
-    self->ffn = nn_chunk_default_free;
+    self->ffn = ffn;
 
     /*  Fill in the size of the empty space between the chunk header
         and the message. */
-    nn_putl ((uint8_t*) ((uint32_t*) (self + 1)), 0);
+    *result = nn_chunk_getdata (self);
+    nn_putl ((uint8_t*) (((uint32_t*) *result) - 2), NN_CHUNK_HEADROOM);
 
     /*  Fill in the tag. */
-    nn_putl ((uint8_t*) ((((uint32_t*) (self + 1))) + 1), NN_CHUNK_TAG);
+    nn_putl ((uint8_t*) (((uint32_t*) *result) - 1), NN_CHUNK_TAG);
 
-    *result = nn_chunk_getdata (self);
     return 0;
 }
 
+int nn_chunk_alloc_file (int fd, uint64_t offset, size_t size, void **result)
+{
+#if defined NN_HAVE_WINDOWS
+    return -ENOTSUP;
+#else
+    int rc;
+    struct nn_chunk *self;
+    struct nn_chunk_fileref *ref;
+    const size_t refsz = sizeof (struct nn_chunk_fileref);
+
+    rc = nn_chunk_checkrange (fd, offset, size);
+    if (nn_slow (rc < 0))
+        return rc;
+
+    self = nn_alloc (nn_chunk_hdrsize () + refsz, "file chunk");
+    if (nn_slow (!self))
+        return -ENOMEM;
+
+    /*  Keep our own descriptor so that the user may close theirs. */
+    ref = (struct nn_chunk_fileref*) (self + 1);
+    ref->fd = dup (fd);
+    if (nn_slow (ref->fd < 0)) {
+        rc = -errno;
+        nn_free (self);
+        return rc;
+    }
+    ref->offset = offset;
+
+    nn_atomic_init (&self->refcount, 1);
+    self->size = size;
+    self->ffn = nn_chunk_file_free;
+
+    /*  The data pointer is just past the end of the allocated block. */
+    *result = ((uint8_t*) (ref + 1)) + 2 * sizeof (uint32_t);
+    nn_putl ((uint8_t*) (((uint32_t*) *result) - 2), (uint32_t) refsz);
+    nn_putl ((uint8_t*) (((uint32_t*) *result) - 1), NN_CHUNK_TAG);
+
+    return 0;
+#endif
+}
+
 int nn_chunk_realloc (size_t size, void **chunk)
 {
     struct nn_chunk *self;
@@ -106,6 +180,10 @@ int nn_chunk_realloc (size_t size, void **chunk)
 
     self = nn_chunk_getptr (p);
 
+    /*  There's no memory to resize in a file chunk. */
+    if (nn_slow (nn_chunk_getfileref (self) != NULL))
+        return -EINVAL;
+
     /*  Check if we only have one reference to this object, in that case we can
         reallocate the memory chunk. */
     if (self->refcount.n == 1) {
@@ -141,7 +219,7 @@ int nn_chunk_realloc (size_t size, void **chunk)
             empty = (uint8_t *)new_ptr - (uint8_t *)self - hdr_size;
             nn_putl ((uint8_t*) (((uint32_t*) new_ptr) - 1), NN_CHUNK_TAG);
             nn_putl ((uint8_t*) (((uint32_t*) new_ptr) - 2), (uint32_t) empty);
-            *chunk = p;
+            *chunk = new_ptr;
             return (0);
         }
     }
@@ -156,7 +234,7 @@ int nn_chunk_realloc (size_t size, void **chunk)
         return rc;
     }
 
-    memcpy (new_ptr, nn_chunk_getdata (self), self->size);
+    memcpy (new_ptr, p, self->size);
     *chunk = new_ptr;
     nn_chunk_free (p);
 
@@ -194,12 +272,89 @@ void nn_chunk_addref (void *p, uint32_t n)
     nn_atomic_inc (&self->refcount, n);
 }
 
+int nn_chunk_check (void *p)
+{
+    if (nn_slow (p == NULL))
+        return 0;
+    return nn_getl ((uint8_t*) p - sizeof (uint32_t)) == NN_CHUNK_TAG ? 1 : 0;
+}
 
 size_t nn_chunk_size (void *p)
 {
     return nn_chunk_getptr (p)->size;
 }
 
+int nn_chunk_file (void *p, int *fd, uint64_t *offset)
+{
+    struct nn_chunk_fileref *ref;
+
+    ref = nn_chunk_getfileref (nn_chunk_getptr (p));
+    if (nn_fast (ref == NULL))
+        return 0;
+    *fd = ref->fd;
+    *offset = ref->offset;
+    return 1;
+}
+
+int nn_chunk_checkfile (void *p)
+{
+#if defined NN_HAVE_WINDOWS
+    return 0;
+#else
+    struct nn_chunk *self;
+    struct nn_chunk_fileref *ref;
+
+    self = nn_chunk_getptr (p);
+    ref = nn_chunk_getfileref (self);
+    if (nn_fast (ref == NULL))
+        return 0;
+    return nn_chunk_checkrange (ref->fd, ref->offset, self->size) < 0 ?
+        -EIO : 0;
+#endif
+}
+
+int nn_chunk_read (void *p, void *buf)
+{
+#if !defined NN_HAVE_WINDOWS
+    struct nn_chunk_fileref *ref;
+    uint8_t *pos;
+    size_t left;
+    uint64_t offset;
+    ssize_t nbytes;
+#endif
+    struct nn_chunk *self;
+
+    self = nn_chunk_getptr (p);
+
+#if !defined NN_HAVE_WINDOWS
+    ref = nn_chunk_getfileref (self);
+    if (nn_slow (ref != NULL)) {
+        pos = buf;
+        left = self->size;
+        offset = ref->offset;
+        while (left) {
+            nbytes = pread (ref->fd, pos, left, (off_t) offset);
+            if (nn_slow (nbytes < 0)) {
+                if (errno == EINTR)
+                    continue;
+                return -errno;
+            }
+
+            /*  The file was truncated since the chunk was created. */
+            if (nn_slow (nbytes == 0))
+                return -EIO;
+            pos += nbytes;
+            left -= nbytes;
+            offset += nbytes;
+        }
+        return 0;
+    }
+#endif
+
+    memcpy (buf, p, self->size);
+    return 0;
+}
+
 void *nn_chunk_trim (void *p, size_t n)
 {
     struct nn_chunk *self;
@@ -210,6 +365,7 @@ void *nn_chunk_trim (void *p, size_t n)
 
     /*  Sanity check. We cannot trim more bytes than there are in the chunk. */
     nn_assert (n <= self->size);
+    nn_assert (!nn_chunk_getfileref (self));
 
     /*  Adjust the chunk header. */
     p = ((uint8_t*) p) + n;
@@ -224,6 +380,33 @@ void *nn_chunk_trim (void *p, size_t n)
     return p;
 }
 
+void *nn_chunk_prepend (void *p, size_t n)
+{
+    struct nn_chunk *self;
+    size_t empty_space;
+
+    self = nn_chunk_getptr (p);
+
+    /*  The data may be modified only if nobody else is referencing it.
+        In file chunks the empty space is taken. */
+    if (nn_slow (self->refcount.n != 1 || nn_chunk_getfileref (self)))
+        return NULL;
+
+    empty_space = (uint8_t*) p - (uint8_t*) self - nn_chunk_hdrsize ();
+    if (nn_slow (n > empty_space))
+        return NULL;
+
+    /*  Adjust the chunk header. */
+    p = ((uint8_t*) p) - n;
+    nn_putl ((uint8_t*) (((uint32_t*) p) - 1), NN_CHUNK_TAG);
+    nn_putl ((uint8_t*) (((uint32_t*) p) - 2), (uint32_t) (empty_space - n));
+
+    /*  Adjust the size of the message. */
+    self->size += n;
+
+    return p;
+}
+
 static struct nn_chunk *nn_chunk_getptr (void *p)
 {
     uint32_t off;
@@ -237,7 +420,7 @@ static struct nn_chunk *nn_chunk_getptr (void *p)
 
 static void *nn_chunk_getdata (struct nn_chunk *self)
 {
-    return ((uint8_t*) (self + 1)) + 2 * sizeof (uint32_t);
+    return ((uint8_t*) (self + 1)) + NN_CHUNK_HEADROOM + 2 * sizeof (uint32_t);
 }
 
 static void nn_chunk_default_free (void *p)
@@ -245,8 +428,40 @@ static void nn_chunk_default_free (void *p)
     nn_free (p);
 }
 
+static void nn_chunk_file_free (void *p)
+{
+#if !defined NN_HAVE_WINDOWS
+    nn_closefd (((struct nn_chunk_fileref*) ((struct nn_chunk*) p + 1))->fd);
+#endif
+    nn_free (p);
+}
+
+static struct nn_chunk_fileref *nn_chunk_getfileref (struct nn_chunk *self)
+{
+    if (nn_fast (self->ffn != nn_chunk_file_free))
+        return NULL;
+    return (struct nn_chunk_fileref*) (self + 1);
+}
+
 static size_t nn_chunk_hdrsize ()
 {
     return sizeof (struct nn_chunk) + 2 * sizeof (uint32_t);
 }
 
+#if !defined NN_HAVE_WINDOWS
+static int nn_chunk_checkrange (int fd, uint64_t offset, size_t size)
+{
+    int rc;
+    struct stat st;
+
+    /*  Only regular files can be sent using sendfile. Also, make sure that
+        the range is within the file. */
+    rc = fstat (fd, &st);
+    if (nn_slow (rc < 0))
+        return -errno;
+    if (nn_slow (!S_ISREG (st.st_mode) || offset > (uint64_t) st.st_size ||
+          size > (uint64_t) st.st_size - offset))
+        return -EINVAL;
+    return 0;
+}
+#endif
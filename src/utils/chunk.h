@@ -26,9 +26,22 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/*  Amount of empty space reserved in front of the data of each chunk. It allows
+    transports to prepend the SP header and their own framing in place. */
+#ifndef NN_CHUNK_HEADROOM
+#define NN_CHUNK_HEADROOM 32
+#endif
+
 /*  Allocates the chunk using the allocation mechanism specified by 'type'. */
 int nn_chunk_alloc (size_t size, int type, void **result);
 
+/*  Creates a chunk that refers to 'size' bytes of the file 'fd' starting at
+    'offset' rather than holding the data in memory. The file must be a regular
+    file and the range must lie within it. The file descriptor is duplicated.
+    The data of such chunk must not be accessed directly; use nn_chunk_file
+    to get the file range or nn_chunk_read to copy it. */
+int nn_chunk_alloc_file (int fd, uint64_t offset, size_t size, void **result);
+
 /*  Resizes a chunk previously allocated with nn_chunk_alloc. */
 int nn_chunk_realloc (size_t size, void **chunk);
 
@@ -39,12 +52,35 @@ void nn_chunk_free (void *p);
 /*  Increases the reference count of the chunk by 'n'. */
 void nn_chunk_addref (void *p, uint32_t n);
 
+/*  Returns 1 if 'p' looks like a live chunk, i.e. it's not NULL and it's
+    preceded by the chunk tag. Returns 0 otherwise. */
+int nn_chunk_check (void *p);
+
 /*  Returns size of the chunk buffer. */
 size_t nn_chunk_size (void *p);
 
+/*  If the chunk was created by nn_chunk_alloc_file, fills in the file
+    descriptor and the offset of the data and returns 1. Returns 0 otherwise. */
+int nn_chunk_file (void *p, int *fd, uint64_t *offset);
+
+/*  If the chunk was created by nn_chunk_alloc_file, checks that the range
+    still lies within the file. Returns -EIO if the file was truncated in
+    the meantime, zero otherwise. */
+int nn_chunk_checkfile (void *p);
+
+/*  Copies the chunk data to 'buf', reading it from the file if necessary.
+    Returns -EIO if the file was truncated in the meantime, other negative
+    error if it can't be read, zero otherwise. */
+int nn_chunk_read (void *p, void *buf);
+
 /*  Trims n bytes from the beginning of the chunk. Returns pointer to the new
     chunk. */
 void *nn_chunk_trim (void *p, size_t n);
 
+/*  Extends the chunk by n bytes at the beginning, using the empty space in
+    front of the data. Returns pointer to the new chunk or NULL if there's not
+    enough empty space or the chunk is referenced from several places. */
+void *nn_chunk_prepend (void *p, size_t n);
+
 #endif
 
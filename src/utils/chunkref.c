@@ -22,6 +22,7 @@
 
 #include "chunkref.h"
 #include "err.h"
+#include "fast.h"
 
 #include <string.h>
 
@@ -95,8 +96,7 @@ void *nn_chunkref_getchunk (struct nn_chunkref *self)
 
 void nn_chunkref_mv (struct nn_chunkref *dst, struct nn_chunkref *src)
 {
-    memcpy (dst, src, src->u.ref [0] == 0xff ?
-        (int)sizeof (struct nn_chunkref_chunk) : src->u.ref [0] + 1);
+    memcpy (dst, src, sizeof (struct nn_chunkref));
 }
 
 void nn_chunkref_cp (struct nn_chunkref *dst, struct nn_chunkref *src)
@@ -139,6 +139,28 @@ void nn_chunkref_trim (struct nn_chunkref *self, size_t n)
     self->u.ref [0] -= (uint8_t) n;
 }
 
+void *nn_chunkref_prepend (struct nn_chunkref *self, size_t n)
+{
+    struct nn_chunkref_chunk *ch;
+    void *chunk;
+
+    if (self->u.ref [0] == 0xff) {
+        ch = (struct nn_chunkref_chunk*) self;
+        chunk = nn_chunk_prepend (ch->chunk, n);
+        if (nn_slow (!chunk))
+            return NULL;
+        ch->chunk = chunk;
+        return chunk;
+    }
+
+    /*  Small messages can be extended within the chunkref itself. */
+    if (nn_slow (self->u.ref [0] + n >= NN_CHUNKREF_MAX))
+        return NULL;
+    memmove (&self->u.ref [1 + n], &self->u.ref [1], self->u.ref [0]);
+    self->u.ref [0] += (uint8_t) n;
+    return &self->u.ref [1];
+}
+
 void nn_chunkref_bulkcopy_start (struct nn_chunkref *self, uint32_t copies)
 {
     struct nn_chunkref_chunk *ch;
@@ -23,7 +23,7 @@
 #ifndef NN_CHUNKREF_INCLUDED
 #define NN_CHUNKREF_INCLUDED
 
-#define NN_CHUNKREF_MAX 32
+#define NN_CHUNKREF_MAX 24
 
 #include "chunk.h"
 
@@ -78,6 +78,11 @@ size_t nn_chunkref_size (struct nn_chunkref *self);
 /*  Trims n bytes from the beginning of the chunk. */
 void nn_chunkref_trim (struct nn_chunkref *self, size_t n);
 
+/*  Extends the chunk by n bytes at the beginning without moving the data
+    to a new buffer. Returns pointer to the beginning of the data or NULL if
+    there's no space for the extension or the data is shared. */
+void *nn_chunkref_prepend (struct nn_chunkref *self, size_t n);
+
 /*  Bulk copying is done by first invoking nn_chunkref_bulkcopy_start on the
     source chunk and specifying how many copies of the chunk will be made.
     Then, nn_chunkref_bulkcopy_cp should be used 'copies' of times to make
@@ -28,5 +28,9 @@
 /*  Returns current time in milliseconds. */
 uint64_t nn_clock_ms (void);
 
+/*  Returns current time in microseconds. On Linux, the time is taken from
+    CLOCK_MONOTONIC, so it can be used with timerfd. */
+uint64_t nn_clock_us (void);
+
 #endif
 
@@ -21,61 +21,366 @@
 */
 
 #include "msg.h"
+#include "../nn.h"
+#include "alloc.h"
+#include "clock.h"
+#include "err.h"
+#include "fast.h"
 
 #include <string.h>
 
+CT_ASSERT (sizeof (struct nn_msg) <= 64);
+
+/*  Private functions. */
+static void nn_msg_freeparts (struct nn_msg *self);
+static void nn_msg_editcmsg (struct nn_msg *self, int level, int type,
+    const void *data, size_t len);
+
 void nn_msg_init (struct nn_msg *self, size_t size)
 {
     nn_chunkref_init (&self->sphdr, 0);
-    nn_chunkref_init (&self->hdrs, 0);
+    self->hdrs = NULL;
+    self->parts = NULL;
     nn_chunkref_init (&self->body, size);
 }
 
 void nn_msg_init_chunk (struct nn_msg *self, void *chunk)
 {
+    int fd;
+    uint64_t offset;
+
     nn_chunkref_init (&self->sphdr, 0);
-    nn_chunkref_init (&self->hdrs, 0);
+    self->hdrs = NULL;
+    self->parts = NULL;
+
+    /*  Data of a file chunk are not in memory, so it can't be used as
+        the body. Keep it among the parts instead. */
+    if (nn_slow (nn_chunk_file (chunk, &fd, &offset))) {
+        nn_chunkref_init (&self->body, 0);
+        nn_msg_addpart (self, chunk);
+        return;
+    }
     nn_chunkref_init_chunk (&self->body, chunk);
 }
 
 void nn_msg_term (struct nn_msg *self)
 {
     nn_chunkref_term (&self->sphdr);
-    nn_chunkref_term (&self->hdrs);
     nn_chunkref_term (&self->body);
+    if (self->hdrs)
+        nn_chunk_free (self->hdrs);
+    if (self->parts)
+        nn_msg_freeparts (self);
 }
 
 void nn_msg_mv (struct nn_msg *dst, struct nn_msg *src)
 {
-    nn_chunkref_mv (&dst->sphdr, &src->sphdr);
-    nn_chunkref_mv (&dst->hdrs, &src->hdrs);
-    nn_chunkref_mv (&dst->body, &src->body);
+    memcpy (dst, src, sizeof (struct nn_msg));
 }
 
 void nn_msg_cp (struct nn_msg *dst, struct nn_msg *src)
 {
     nn_chunkref_cp (&dst->sphdr, &src->sphdr);
-    nn_chunkref_cp (&dst->hdrs, &src->hdrs);
     nn_chunkref_cp (&dst->body, &src->body);
+    dst->hdrs = src->hdrs;
+    if (dst->hdrs)
+        nn_chunk_addref (dst->hdrs, 1);
+    dst->parts = src->parts;
+    if (dst->parts)
+        nn_atomic_inc (&dst->parts->refcount, 1);
 }
 
 void nn_msg_bulkcopy_start (struct nn_msg *self, uint32_t copies)
 {
     nn_chunkref_bulkcopy_start (&self->sphdr, copies);
-    nn_chunkref_bulkcopy_start (&self->hdrs, copies);
     nn_chunkref_bulkcopy_start (&self->body, copies);
+    if (self->hdrs)
+        nn_chunk_addref (self->hdrs, copies);
+    if (self->parts)
+        nn_atomic_inc (&self->parts->refcount, copies);
 }
 
 void nn_msg_bulkcopy_cp (struct nn_msg *dst, struct nn_msg *src)
 {
-    nn_chunkref_bulkcopy_cp (&dst->sphdr, &src->sphdr);
-    nn_chunkref_bulkcopy_cp (&dst->hdrs, &src->hdrs);
-    nn_chunkref_bulkcopy_cp (&dst->body, &src->body);
+    memcpy (dst, src, sizeof (struct nn_msg));
+}
+
+void *nn_msg_prepend (struct nn_msg *self, size_t n)
+{
+    size_t hdrsz;
+    uint8_t *p;
+
+    hdrsz = nn_chunkref_size (&self->sphdr);
+    p = nn_chunkref_prepend (&self->body, n + hdrsz);
+    if (!p)
+        return NULL;
+    memcpy (p + n, nn_chunkref_data (&self->sphdr), hdrsz);
+    nn_chunkref_term (&self->sphdr);
+    nn_chunkref_init (&self->sphdr, 0);
+    return p;
+}
+
+void nn_msg_addpart (struct nn_msg *self, void *chunk)
+{
+    int fd;
+    uint64_t offset;
+
+    if (!self->parts) {
+        self->parts = nn_alloc (sizeof (struct nn_msgparts), "message parts");
+        alloc_assert (self->parts);
+        nn_atomic_init (&self->parts->refcount, 1);
+        self->parts->nchunks = 0;
+        self->parts->files = 0;
+    }
+    nn_assert (self->parts->refcount.n == 1);
+    nn_assert (self->parts->nchunks < NN_MSG_MAXPARTS);
+    self->parts->chunks [self->parts->nchunks++] = chunk;
+    if (nn_slow (nn_chunk_file (chunk, &fd, &offset)))
+        ++self->parts->files;
+}
+
+size_t nn_msg_bodysize (struct nn_msg *self)
+{
+    size_t sz;
+    int i;
+
+    sz = nn_chunkref_size (&self->body);
+    if (nn_fast (!self->parts))
+        return sz;
+    for (i = 0; i != self->parts->nchunks; ++i)
+        sz += nn_chunk_size (self->parts->chunks [i]);
+    return sz;
+}
+
+int nn_msg_flatten (struct nn_msg *self)
+{
+    int rc;
+    struct nn_chunkref body;
+    uint8_t *pos;
+    size_t sz;
+    int i;
+
+    if (nn_fast (!self->parts))
+        return 0;
+
+    nn_chunkref_init (&body, nn_msg_bodysize (self));
+    pos = nn_chunkref_data (&body);
+    sz = nn_chunkref_size (&self->body);
+    memcpy (pos, nn_chunkref_data (&self->body), sz);
+    pos += sz;
+    for (i = 0; i != self->parts->nchunks; ++i) {
+        rc = nn_chunk_read (self->parts->chunks [i], pos);
+        if (nn_slow (rc < 0)) {
+            nn_chunkref_term (&body);
+            return rc;
+        }
+        pos += nn_chunk_size (self->parts->chunks [i]);
+    }
+
+    nn_chunkref_term (&self->body);
+    nn_chunkref_mv (&self->body, &body);
+    nn_msg_freeparts (self);
+
+    return 0;
+}
+
+int nn_msg_checkfiles (struct nn_msg *self)
+{
+    int rc;
+    int i;
+
+    if (nn_fast (!self->parts || !self->parts->files))
+        return 0;
+    for (i = 0; i != self->parts->nchunks; ++i) {
+        rc = nn_chunk_checkfile (self->parts->chunks [i]);
+        if (nn_slow (rc < 0))
+            return rc;
+    }
+    return 0;
+}
+
+void nn_msg_setmore (struct nn_msg *self)
+{
+    int more;
+
+    more = 1;
+    nn_msg_setcmsg (self, NN_SOL_SOCKET, NN_RCVMORE, &more, sizeof (more));
+}
+
+int nn_msg_more (struct nn_msg *self)
+{
+    return nn_msg_getcmsg (self, NN_SOL_SOCKET, NN_RCVMORE,
+        sizeof (int)) ? 1 : 0;
+}
+
+void nn_msg_setcmsg (struct nn_msg *self, int level, int type,
+    const void *data, size_t len)
+{
+    nn_assert (data || len == 0);
+    nn_msg_editcmsg (self, level, type, data ? data : "", len);
+}
+
+void nn_msg_rmcmsg (struct nn_msg *self, int level, int type)
+{
+    if (nn_fast (!self->hdrs))
+        return;
+    nn_msg_editcmsg (self, level, type, NULL, 0);
+}
+
+void *nn_msg_getcmsg (struct nn_msg *self, int level, int type, size_t len)
+{
+    size_t sz;
+    size_t pos;
+    struct nn_cmsghdr *cmsg;
+
+    if (nn_fast (!self->hdrs))
+        return NULL;
+    sz = nn_chunk_size (self->hdrs);
+    pos = 0;
+    while (pos + NN_CMSG_SPACE (0) <= sz) {
+        cmsg = (struct nn_cmsghdr*) (((char*) self->hdrs) + pos);
+        if (cmsg->cmsg_len < NN_CMSG_LEN (0) ||
+              pos + cmsg->cmsg_len > sz)
+            return NULL;
+        if (cmsg->cmsg_level == level && cmsg->cmsg_type == type &&
+              cmsg->cmsg_len >= NN_CMSG_LEN (len))
+            return NN_CMSG_DATA (cmsg);
+        pos += NN_CMSG_ALIGN_ (cmsg->cmsg_len);
+    }
+    return NULL;
+}
+
+void nn_msg_armdeadline (struct nn_msg *self)
+{
+    int *deadline;
+    uint32_t at;
+
+    deadline = nn_msg_getcmsg (self, NN_SOL_SOCKET, NN_DEADLINE,
+        sizeof (int));
+    if (nn_fast (!deadline))
+        return;
+
+    /*  The deadline is kept as the lower 32 bits of the clock. Comparing
+        it to the clock modulo 2^32 works as long as the deadline is less
+        than 2^31 milliseconds away, which any positive int is. */
+    at = (uint32_t) nn_clock_ms ();
+    if (*deadline > 0)
+        at += (uint32_t) *deadline;
+    memcpy (deadline, &at, sizeof (at));
+}
+
+int nn_msg_timeleft (struct nn_msg *self)
+{
+    uint32_t *deadline;
+    int32_t left;
+
+    deadline = nn_msg_getcmsg (self, NN_SOL_SOCKET, NN_DEADLINE,
+        sizeof (int));
+    if (nn_fast (!deadline))
+        return -1;
+    left = (int32_t) (*deadline - (uint32_t) nn_clock_ms ());
+    return left > 0 ? (int) left : 0;
+}
+
+void nn_msg_sethdrs (struct nn_msg *self, void *chunk)
+{
+    if (self->hdrs)
+        nn_chunk_free (self->hdrs);
+    self->hdrs = chunk;
+}
+
+size_t nn_msg_hdrssize (struct nn_msg *self)
+{
+    return self->hdrs ? nn_chunk_size (self->hdrs) : 0;
 }
 
 void nn_msg_replace_body (struct nn_msg *self, struct nn_chunkref new_body) 
 {
     nn_chunkref_term (&self->body);
     self->body = new_body;
+    if (self->parts)
+        nn_msg_freeparts (self);
+}
+
+static void nn_msg_freeparts (struct nn_msg *self)
+{
+    int i;
+
+    /*  Other copies of the message may still use the parts. */
+    if (nn_atomic_dec (&self->parts->refcount, 1) <= 1) {
+        for (i = 0; i != self->parts->nchunks; ++i)
+            nn_chunk_free (self->parts->chunks [i]);
+        nn_atomic_term (&self->parts->refcount);
+        nn_free (self->parts);
+    }
+    self->parts = NULL;
 }
 
+/*  Rebuilds the headers without the properties of the specified level and
+    type. Unless 'data' is NULL, a property with the supplied data is
+    appended at the end. */
+static void nn_msg_editcmsg (struct nn_msg *self, int level, int type,
+    const void *data, size_t len)
+{
+    int rc;
+    size_t sz;
+    size_t pos;
+    size_t keep;
+    size_t cmsgsz;
+    int found;
+    char *hdrs;
+    char *chunk;
+    struct nn_cmsghdr *cmsg;
+
+    /*  Find out how much of the existing headers is to be kept. */
+    hdrs = self->hdrs;
+    sz = hdrs ? nn_chunk_size (hdrs) : 0;
+    keep = 0;
+    found = 0;
+    for (pos = 0; pos + NN_CMSG_SPACE (0) <= sz; pos += cmsgsz) {
+        cmsg = (struct nn_cmsghdr*) (hdrs + pos);
+        if (cmsg->cmsg_len < NN_CMSG_LEN (0) || pos + cmsg->cmsg_len > sz)
+            break;
+        cmsgsz = NN_CMSG_ALIGN_ (cmsg->cmsg_len);
+        if (cmsg->cmsg_level == level && cmsg->cmsg_type == type)
+            found = 1;
+        else
+            keep += cmsgsz;
+    }
+    if (!data && !found)
+        return;
+    if (!data && keep == 0) {
+        nn_msg_sethdrs (self, NULL);
+        return;
+    }
+
+    rc = nn_chunk_alloc (keep + (data ? NN_CMSG_SPACE (len) : 0), 0,
+        (void**) &chunk);
+    errnum_assert (rc == 0, -rc);
+
+    /*  Copy the properties to keep. The last one may lack the trailing
+        padding. */
+    keep = 0;
+    for (pos = 0; pos + NN_CMSG_SPACE (0) <= sz; pos += cmsgsz) {
+        cmsg = (struct nn_cmsghdr*) (hdrs + pos);
+        if (cmsg->cmsg_len < NN_CMSG_LEN (0) || pos + cmsg->cmsg_len > sz)
+            break;
+        cmsgsz = NN_CMSG_ALIGN_ (cmsg->cmsg_len);
+        if (cmsg->cmsg_level == level && cmsg->cmsg_type == type)
+            continue;
+        memset (chunk + keep, 0, cmsgsz);
+        memcpy (chunk + keep, cmsg, cmsg->cmsg_len);
+        keep += cmsgsz;
+    }
+
+    if (data) {
+        cmsg = (struct nn_cmsghdr*) (chunk + keep);
+        memset (cmsg, 0, NN_CMSG_SPACE (len));
+        cmsg->cmsg_len = NN_CMSG_LEN (len);
+        cmsg->cmsg_level = level;
+        cmsg->cmsg_type = type;
+        memcpy (NN_CMSG_DATA (cmsg), data, len);
+    }
+
+    nn_msg_sethdrs (self, chunk);
+}
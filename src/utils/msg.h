@@ -24,9 +24,28 @@
 #define NN_MSG_INCLUDED
 
 #include "chunkref.h"
+#include "atomic.h"
 
 #include <stddef.h>
 
+/*  Maximum number of additional body parts a message can consist of. */
+#define NN_MSG_MAXPARTS 8
+
+/*  Chunks forming the rest of the message body, in order. 'files' is the
+    number of them that refer to file data (see nn_chunk_alloc_file).
+    Copies of a message share the parts; the object holds a single reference
+    to each chunk and it's deallocated when the last copy releases it. It
+    must not be modified once shared. */
+struct nn_msgparts {
+    struct nn_atomic refcount;
+    int nchunks;
+    int files;
+    void *chunks [NN_MSG_MAXPARTS];
+};
+
+/*  The message is kept small enough to fit into a single cache line so that
+    queueing and moving messages around is cheap. */
+
 struct nn_msg {
 
     /*  Contains SP message header. This field directly corresponds
@@ -34,18 +53,26 @@ struct nn_msg {
         cmsghdr or trailing padding. */
     struct nn_chunkref sphdr;
 
-    /*  Contains any additional transport-level message headers. Format of this
-        buffer is a list of cmsgs as defined by POSIX (see "ancillary data"). */
-    struct nn_chunkref hdrs;
-
     /*  Contains application level message payload. */
     struct nn_chunkref body;
+
+    /*  Chunk containing any additional transport-level message headers or NULL
+        if there are none. Format of this buffer is a list of cmsgs as defined
+        by POSIX (see "ancillary data"). As these are rarely used they are
+        always stored out of line. */
+    void *hdrs;
+
+    /*  Additional parts of the message body, if it was passed in as several
+        chunks, or NULL. The parts are never copied into a single buffer unless
+        the transport is unable to send them as they are. */
+    struct nn_msgparts *parts;
 };
 
 /*  Initialises a message with body 'size' bytes long and empty header. */
 void nn_msg_init (struct nn_msg *self, size_t size);
 
-/*  Initialise message with body provided in the form of chunk pointer. */
+/*  Initialise message with body provided in the form of chunk pointer.
+    A chunk referring to a file becomes the first part of an empty body. */
 void nn_msg_init_chunk (struct nn_msg *self, void *chunk);
 
 /*  Frees resources allocate with the message. */
@@ -68,6 +95,64 @@ void nn_msg_cp (struct nn_msg *dst, struct nn_msg *src);
 void nn_msg_bulkcopy_start (struct nn_msg *self, uint32_t copies);
 void nn_msg_bulkcopy_cp (struct nn_msg *dst, struct nn_msg *src);
 
+/*  Merges the SP header into the body and reserves n more bytes in front of
+    it, so that the transport can send the whole message as a single buffer.
+    Returns pointer to the reserved space or NULL if it cannot be done without
+    copying the body. In that case the message is left unchanged. */
+void *nn_msg_prepend (struct nn_msg *self, size_t n);
+
+/*  Appends a chunk to the message body without copying it. The message takes
+    ownership of the chunk. */
+void nn_msg_addpart (struct nn_msg *self, void *chunk);
+
+/*  Returns the size of the message body including all its parts. */
+size_t nn_msg_bodysize (struct nn_msg *self);
+
+/*  Copies all the body parts into a single buffer, reading the parts that
+    refer to files. If a file can't be read, the message is left unchanged
+    and a negative error is returned. */
+int nn_msg_flatten (struct nn_msg *self);
+
+/*  Checks that the files the body parts refer to still hold the data.
+    Returns -EIO if any of them was truncated, zero otherwise. */
+int nn_msg_checkfiles (struct nn_msg *self);
+
+/*  Marks the message as a fragment of a larger message that will be followed
+    by more fragments. This is done by adding NN_RCVMORE header. */
+void nn_msg_setmore (struct nn_msg *self);
+
+/*  Returns 1 if the message is marked by nn_msg_setmore, 0 otherwise. */
+int nn_msg_more (struct nn_msg *self);
+
+/*  Sets the ancillary property with the supplied level and type. Any
+    existing property of the same level and type is replaced, the others
+    are left intact. */
+void nn_msg_setcmsg (struct nn_msg *self, int level, int type,
+    const void *data, size_t len);
+
+/*  Removes all the ancillary properties with the supplied level and type. */
+void nn_msg_rmcmsg (struct nn_msg *self, int level, int type);
+
+/*  Returns the data of the first ancillary property with the supplied level
+    and type that has at least 'len' bytes of data. NULL if there's none. */
+void *nn_msg_getcmsg (struct nn_msg *self, int level, int type, size_t len);
+
+/*  Replaces the time remaining in NN_DEADLINE property, if present, by the
+    point in time it refers to. Used once the user hands the message over to
+    the library. */
+void nn_msg_armdeadline (struct nn_msg *self);
+
+/*  Returns number of milliseconds till the message passes its deadline, zero
+    if it already did, or -1 if the message has no deadline. */
+int nn_msg_timeleft (struct nn_msg *self);
+
+/*  Replaces the transport-level headers by the supplied chunk. The message
+    takes ownership of the chunk. NULL removes the headers. */
+void nn_msg_sethdrs (struct nn_msg *self, void *chunk);
+
+/*  Returns the size of the transport-level headers. */
+size_t nn_msg_hdrssize (struct nn_msg *self);
+
 /** Replaces the message body with entirely new data.  This allows protocols
     that substantially rewrite or preprocess the userland message to be written. */
 void nn_msg_replace_body(struct nn_msg *self, struct nn_chunkref newBody);
@@ -0,0 +1,59 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#ifndef NN_PROBE_INCLUDED
+#define NN_PROBE_INCLUDED
+
+/*  Static tracepoints (USDT) for dynamic tracing tools such as perf, bpftrace
+    or SystemTap. Each probe compiles into a single nop instruction plus an
+    ELF note describing the location of its arguments, so there's no runtime
+    cost unless a tracer is attached. Arguments are not evaluated when the
+    probes are not compiled in. The provider name is 'nanomsg'; the list of
+    probes and their arguments is in nn_probes(7). */
+
+#if defined NN_HAVE_SDT
+
+#include <sys/sdt.h>
+
+#define NN_PROBE0(name)\
+    DTRACE_PROBE (nanomsg, name)
+#define NN_PROBE1(name, a1)\
+    DTRACE_PROBE1 (nanomsg, name, a1)
+#define NN_PROBE2(name, a1, a2)\
+    DTRACE_PROBE2 (nanomsg, name, a1, a2)
+#define NN_PROBE3(name, a1, a2, a3)\
+    DTRACE_PROBE3 (nanomsg, name, a1, a2, a3)
+#define NN_PROBE4(name, a1, a2, a3, a4)\
+    DTRACE_PROBE4 (nanomsg, name, a1, a2, a3, a4)
+
+#else
+
+#define NN_PROBE0(name) ((void) 0)
+#define NN_PROBE1(name, a1) ((void) 0)
+#define NN_PROBE2(name, a1, a2) ((void) 0)
+#define NN_PROBE3(name, a1, a2, a3) ((void) 0)
+#define NN_PROBE4(name, a1, a2, a3, a4) ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,203 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "region.h"
+#include "mutex.h"
+#include "once.h"
+#include "fast.h"
+#include "err.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/*  Every block starts with this header. While the block is free, it links
+    it to the next free block. While it's in use, it points to the region
+    the block belongs to. */
+union nn_region_hdr {
+    union nn_region_hdr *next;
+    struct nn_region *region;
+    uint64_t align;
+};
+
+struct nn_region {
+
+    /*  Guards the list of free blocks. Also held while the region is
+        being registered or unregistered. */
+    nn_mutex_t sync;
+
+    /*  Non-zero if the slot is in use. */
+    int registered;
+
+    /*  The memory itself. */
+    uint8_t *addr;
+    size_t size;
+    size_t blocksize;
+
+    /*  Stack of free blocks. */
+    union nn_region_hdr *free;
+
+    /*  Number of blocks in use. */
+    size_t used;
+};
+
+/*  Slot 0 is never used, as type 0 stands for the default allocator. */
+static struct nn_region nn_regions [NN_REGION_MAX + 1];
+
+/*  Serialises registrations. */
+static nn_mutex_t nn_region_sync;
+
+static nn_once_t nn_region_once = NN_ONCE_INITIALIZER;
+
+static void nn_region_init (void)
+{
+    int i;
+
+    nn_mutex_init (&nn_region_sync);
+    for (i = 0; i != NN_REGION_MAX + 1; ++i) {
+        nn_mutex_init (&nn_regions [i].sync);
+        nn_regions [i].registered = 0;
+    }
+}
+
+int nn_region_register (void *addr, size_t size, size_t blocksize)
+{
+    int i;
+    struct nn_region *self;
+    union nn_region_hdr *hdr;
+    size_t pos;
+
+    /*  The blocks have to be aligned and big enough to hold at least the
+        header. */
+    if (nn_slow (!addr || (uintptr_t) addr % sizeof (union nn_region_hdr) ||
+          blocksize % sizeof (union nn_region_hdr) ||
+          blocksize <= sizeof (union nn_region_hdr) || size < blocksize))
+        return -EINVAL;
+
+    nn_do_once (&nn_region_once, nn_region_init);
+
+    nn_mutex_lock (&nn_region_sync);
+    for (i = 1; i != NN_REGION_MAX + 1; ++i)
+        if (!nn_regions [i].registered)
+            break;
+    if (nn_slow (i == NN_REGION_MAX + 1)) {
+        nn_mutex_unlock (&nn_region_sync);
+        return -ENOMEM;
+    }
+    self = &nn_regions [i];
+
+    nn_mutex_lock (&self->sync);
+    self->registered = 1;
+    self->addr = addr;
+    self->size = size;
+    self->blocksize = blocksize;
+    self->used = 0;
+
+    /*  Put all the blocks on the free list, lowest address on the top. */
+    self->free = NULL;
+    pos = (size / blocksize) * blocksize;
+    while (pos) {
+        pos -= blocksize;
+        hdr = (union nn_region_hdr*) (self->addr + pos);
+        hdr->next = self->free;
+        self->free = hdr;
+    }
+    nn_mutex_unlock (&self->sync);
+
+    nn_mutex_unlock (&nn_region_sync);
+    return i;
+}
+
+int nn_region_unregister (int type)
+{
+    struct nn_region *self;
+
+    if (nn_slow (type < 1 || type > NN_REGION_MAX))
+        return -EINVAL;
+
+    nn_do_once (&nn_region_once, nn_region_init);
+
+    nn_mutex_lock (&nn_region_sync);
+    self = &nn_regions [type];
+    nn_mutex_lock (&self->sync);
+    if (nn_slow (!self->registered)) {
+        nn_mutex_unlock (&self->sync);
+        nn_mutex_unlock (&nn_region_sync);
+        return -EINVAL;
+    }
+    if (nn_slow (self->used)) {
+        nn_mutex_unlock (&self->sync);
+        nn_mutex_unlock (&nn_region_sync);
+        return -EBUSY;
+    }
+    self->registered = 0;
+    nn_mutex_unlock (&self->sync);
+    nn_mutex_unlock (&nn_region_sync);
+
+    return 0;
+}
+
+int nn_region_alloc (int type, size_t size, void **result)
+{
+    struct nn_region *self;
+    union nn_region_hdr *hdr;
+
+    if (nn_slow (type < 1 || type > NN_REGION_MAX))
+        return -EINVAL;
+
+    nn_do_once (&nn_region_once, nn_region_init);
+
+    self = &nn_regions [type];
+    nn_mutex_lock (&self->sync);
+    if (nn_slow (!self->registered ||
+          size > self->blocksize - sizeof (union nn_region_hdr))) {
+        nn_mutex_unlock (&self->sync);
+        return -EINVAL;
+    }
+    hdr = self->free;
+    if (nn_slow (!hdr)) {
+        nn_mutex_unlock (&self->sync);
+        return -ENOMEM;
+    }
+    self->free = hdr->next;
+    ++self->used;
+    nn_mutex_unlock (&self->sync);
+
+    hdr->region = self;
+    *result = hdr + 1;
+    return 0;
+}
+
+void nn_region_free (void *p)
+{
+    struct nn_region *self;
+    union nn_region_hdr *hdr;
+
+    hdr = ((union nn_region_hdr*) p) - 1;
+    self = hdr->region;
+
+    nn_mutex_lock (&self->sync);
+    nn_assert (self->registered && self->used > 0);
+    hdr->next = self->free;
+    self->free = hdr;
+    --self->used;
+    nn_mutex_unlock (&self->sync);
+}
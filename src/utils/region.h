@@ -0,0 +1,49 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_REGION_INCLUDED
+#define NN_REGION_INCLUDED
+
+#include <stddef.h>
+
+/*  Memory regions registered by the user, such as hugepage-backed arenas or
+    shared memory segments. Each region is split into blocks of equal size
+    that messages are allocated from. Allocation type N (as passed to
+    nn_allocmsg) refers to the region registered in slot N. */
+
+/*  Maximum number of regions that can be registered at the same time. */
+#define NN_REGION_MAX 16
+
+/*  Registers the memory region. Returns the allocation type to use or
+    a negative error code. */
+int nn_region_register (void *addr, size_t size, size_t blocksize);
+
+/*  Unregisters the region. Fails with -EBUSY if any of its blocks are in use. */
+int nn_region_unregister (int type);
+
+/*  Allocates a block of at least 'size' bytes from the region. */
+int nn_region_alloc (int type, size_t size, void **result);
+
+/*  Returns a block allocated by nn_region_alloc to its region. */
+void nn_region_free (void *p);
+
+#endif
@@ -0,0 +1,140 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pubsub.h"
+
+#include "testutil.h"
+
+#include <stdio.h>
+
+#define SOCKET_ADDRESS "inproc://conflate"
+
+/*  Number of messages to publish while the subscriber is not reading. */
+#define NUM_MSGS 1000
+
+int main ()
+{
+    int rc;
+    int pub;
+    int sub;
+    int val;
+    int i;
+    int count;
+    int lasta;
+    int lastb;
+    int dropped;
+    uint64_t before;
+    size_t sz;
+    char buf [32];
+
+    pub = test_socket (AF_SP, NN_PUB);
+
+    /*  Check the option defaults and validation. */
+    sz = sizeof (val);
+    rc = nn_getsockopt (pub, NN_PUB, NN_PUB_CONFLATE, &val, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (val) && val == 0);
+    val = -1;
+    rc = nn_setsockopt (pub, NN_PUB, NN_PUB_CONFLATE, &val, sizeof (val));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+
+    val = 16;
+    test_setsockopt (pub, NN_PUB, NN_PUB_CONFLATE, &val, sizeof (val));
+    val = 2;
+    test_setsockopt (pub, NN_PUB, NN_PUB_CONFLATE_KEYLEN, &val, sizeof (val));
+    sz = sizeof (val);
+    rc = nn_getsockopt (pub, NN_PUB, NN_PUB_CONFLATE_KEYLEN, &val, &sz);
+    errno_assert (rc == 0);
+    nn_assert (val == 2);
+    test_bind (pub, SOCKET_ADDRESS);
+
+    /*  A tiny receive buffer makes the subscriber fall behind immediately. */
+    sub = test_socket (AF_SP, NN_SUB);
+    val = 1;
+    test_setsockopt (sub, NN_SOL_SOCKET, NN_RCVBUF, &val, sizeof (val));
+    test_setsockopt (sub, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    val = 200;
+    test_setsockopt (sub, NN_SOL_SOCKET, NN_RCVTIMEO, &val, sizeof (val));
+    test_connect (sub, SOCKET_ADDRESS);
+    nn_sleep (10);
+
+    /*  Publish alternating updates for two topics. */
+    for (i = 0; i != NUM_MSGS; ++i) {
+        sprintf (buf, "%s%d", i % 2 ? "B|" : "A|", i);
+        rc = nn_send (pub, buf, strlen (buf), 0);
+        errno_assert (rc >= 0);
+    }
+    nn_sleep (50);
+
+    /*  Slow consumer must get the most recent value of each topic and
+        the backlog must have been collapsed. */
+    count = 0;
+    lasta = -1;
+    lastb = -1;
+    while (1) {
+        rc = nn_recv (sub, buf, sizeof (buf) - 1, 0);
+        if (rc < 0 && nn_errno () == ETIMEDOUT)
+            break;
+        errno_assert (rc >= 2);
+        buf [rc] = 0;
+        ++count;
+        if (buf [0] == 'A')
+            lasta = atoi (buf + 2);
+        else
+            lastb = atoi (buf + 2);
+    }
+    nn_assert (lasta == NUM_MSGS - 2);
+    nn_assert (lastb == NUM_MSGS - 1);
+    nn_assert (count <= 4);
+
+    /*  Lowering the limit trims the backlogs that are already longer. */
+    before = nn_get_statistic (pub, NN_STAT_DROPPED_MESSAGES);
+    for (i = 0; i != 8; ++i) {
+        sprintf (buf, "%c|%d", 'A' + i, i);
+        rc = nn_send (pub, buf, strlen (buf), 0);
+        errno_assert (rc >= 0);
+    }
+    nn_sleep (50);
+    nn_assert (nn_get_statistic (pub, NN_STAT_DROPPED_MESSAGES) == before);
+    val = 2;
+    test_setsockopt (pub, NN_PUB, NN_PUB_CONFLATE, &val, sizeof (val));
+    dropped = (int) (nn_get_statistic (pub, NN_STAT_DROPPED_MESSAGES) -
+        before);
+    nn_assert (dropped >= 4);
+    count = 0;
+    while (1) {
+        rc = nn_recv (sub, buf, sizeof (buf) - 1, 0);
+        if (rc < 0 && nn_errno () == ETIMEDOUT)
+            break;
+        errno_assert (rc >= 2);
+        buf [rc] = 0;
+        ++count;
+    }
+    nn_assert (count + dropped == 8);
+    nn_assert (strcmp (buf, "H|7") == 0);
+
+    test_close (sub);
+    test_close (pub);
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+
+#include "testutil.h"
+
+/*  Tests credit-based flow control between PUSH and PULL sockets. */
+
+#define SOCKET_ADDRESS_INPROC "inproc://a"
+
+static void test_credit (const char *addr)
+{
+    int rc;
+    int push;
+    int slow;
+    int fast;
+    int opt;
+    int i;
+    char buf [8];
+
+    push = test_socket (AF_SP, NN_PUSH);
+    test_bind (push, (char*) addr);
+    opt = 100;
+    test_setsockopt (push, NN_SOL_SOCKET, NN_SNDTIMEO, &opt, sizeof (opt));
+    slow = test_socket (AF_SP, NN_PULL);
+    fast = test_socket (AF_SP, NN_PULL);
+    opt = 2;
+    test_setsockopt (slow, NN_PULL, NN_PULL_CREDIT, &opt, sizeof (opt));
+    test_setsockopt (fast, NN_PULL, NN_PULL_CREDIT, &opt, sizeof (opt));
+    opt = 1000;
+    test_setsockopt (fast, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_connect (slow, (char*) addr);
+    test_connect (fast, (char*) addr);
+
+    /*  Let the initial grants arrive. */
+    nn_sleep (100);
+
+    /*  Each of the workers can take two messages. */
+    for (i = 0; i != 4; ++i)
+        test_send (push, "T");
+    rc = nn_send (push, "T", 1, 0);
+    nn_assert (rc < 0 && nn_errno () == ETIMEDOUT);
+
+    /*  All the subsequent messages go to the worker that keeps up. */
+    opt = 1000;
+    test_setsockopt (push, NN_SOL_SOCKET, NN_SNDTIMEO, &opt, sizeof (opt));
+    for (i = 0; i != 20; ++i) {
+        test_recv (fast, "T");
+        test_send (push, "T");
+    }
+    test_recv (fast, "T");
+    test_recv (fast, "T");
+
+    /*  The slow worker got no more than its credit. */
+    test_recv (slow, "T");
+    test_recv (slow, "T");
+    rc = nn_recv (slow, buf, sizeof (buf), NN_DONTWAIT);
+    nn_assert (rc < 0 && nn_errno () == EAGAIN);
+
+    test_close (fast);
+    test_close (slow);
+    test_close (push);
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int push;
+    int pull;
+    int opt;
+    size_t sz;
+    int i;
+    char addr [128];
+
+    /*  Option handling. */
+    pull = test_socket (AF_SP, NN_PULL);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (pull, NN_PULL, NN_PULL_CREDIT, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt) && opt == 0);
+    opt = -1;
+    rc = nn_setsockopt (pull, NN_PULL, NN_PULL_CREDIT, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    test_close (pull);
+
+    test_credit (SOCKET_ADDRESS_INPROC);
+    test_addr_from (addr, "tcp", "127.0.0.1", get_test_port (argc, argv));
+    test_credit (addr);
+
+    /*  Peers that don't grant credit are not limited by it. */
+    push = test_socket (AF_SP, NN_PUSH);
+    test_bind (push, SOCKET_ADDRESS_INPROC);
+    pull = test_socket (AF_SP, NN_PULL);
+    test_connect (pull, SOCKET_ADDRESS_INPROC);
+    for (i = 0; i != 20; ++i)
+        test_send (push, "T");
+    for (i = 0; i != 20; ++i)
+        test_recv (pull, "T");
+    test_close (pull);
+    test_close (push);
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+
+#include "testutil.h"
+
+#include <string.h>
+
+/*  Tests dropping of messages that have passed their deadline. */
+
+#define SOCKET_ADDRESS_A "inproc://a"
+#define SOCKET_ADDRESS_B "inproc://b"
+
+/*  Sends a message with NN_DEADLINE property attached. */
+static int send_deadline (int s, const char *data, int deadline)
+{
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    uint64_t ctrl [4];
+
+    cmsg = (struct nn_cmsghdr*) ctrl;
+    cmsg->cmsg_len = NN_CMSG_LEN (sizeof (int));
+    cmsg->cmsg_level = NN_SOL_SOCKET;
+    cmsg->cmsg_type = NN_DEADLINE;
+    memcpy (NN_CMSG_DATA (cmsg), &deadline, sizeof (deadline));
+
+    iov.iov_base = (void*) data;
+    iov.iov_len = strlen (data);
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = ctrl;
+    hdr.msg_controllen = NN_CMSG_SPACE (sizeof (int));
+    return nn_sendmsg (s, &hdr, 0);
+}
+
+int main ()
+{
+    int rc;
+    int push;
+    int pull;
+    int relay;
+    int sink;
+    int opt;
+    int left;
+    int found;
+    char buf [16];
+    void *control;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+
+    push = test_socket (AF_SP, NN_PUSH);
+    test_bind (push, SOCKET_ADDRESS_A);
+    pull = test_socket (AF_SP, NN_PULL);
+    test_connect (pull, SOCKET_ADDRESS_A);
+    opt = 1000;
+    test_setsockopt (pull, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+
+    /*  A message that has expired while waiting in the queue is dropped
+        on the receiving side. */
+    rc = send_deadline (push, "A", 50);
+    errno_assert (rc == 1);
+    test_send (push, "B");
+    nn_sleep (100);
+    test_recv (pull, "B");
+    nn_assert (nn_get_statistic (pull, NN_STAT_EXPIRED_MESSAGES) == 1);
+    rc = nn_recv (pull, buf, sizeof (buf), NN_DONTWAIT);
+    nn_assert (rc < 0 && nn_errno () == EAGAIN);
+
+    /*  A message that has already expired is not sent at all. */
+    rc = send_deadline (push, "C", 0);
+    nn_assert (rc < 0 && nn_errno () == ETIMEDOUT);
+    nn_assert (nn_get_statistic (push, NN_STAT_EXPIRED_MESSAGES) == 1);
+
+    /*  The receiver gets the time remaining and can pass the message on
+        with the deadline intact. */
+    relay = test_socket (AF_SP, NN_PUSH);
+    test_bind (relay, SOCKET_ADDRESS_B);
+    sink = test_socket (AF_SP, NN_PULL);
+    test_connect (sink, SOCKET_ADDRESS_B);
+    rc = send_deadline (push, "D", 10000);
+    errno_assert (rc == 1);
+    iov.iov_base = buf;
+    iov.iov_len = sizeof (buf);
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = &control;
+    hdr.msg_controllen = NN_MSG;
+    rc = nn_recvmsg (pull, &hdr, 0);
+    errno_assert (rc == 1);
+    found = 0;
+    cmsg = NN_CMSG_FIRSTHDR (&hdr);
+    while (cmsg) {
+        if (cmsg->cmsg_level == NN_SOL_SOCKET &&
+              cmsg->cmsg_type == NN_DEADLINE) {
+            memcpy (&left, NN_CMSG_DATA (cmsg), sizeof (left));
+            nn_assert (left > 0 && left <= 10000);
+            found = 1;
+        }
+        cmsg = NN_CMSG_NXTHDR (&hdr, cmsg);
+    }
+    nn_assert (found);
+    iov.iov_len = 1;
+    rc = nn_sendmsg (relay, &hdr, 0);
+    errno_assert (rc == 1);
+    test_recv (sink, "D");
+
+    /*  Blocking send doesn't wait past the deadline of the message. */
+    test_close (pull);
+    rc = send_deadline (push, "E", 50);
+    nn_assert (rc < 0 && nn_errno () == ETIMEDOUT);
+    nn_assert (nn_get_statistic (push, NN_STAT_EXPIRED_MESSAGES) == 2);
+
+    test_close (sink);
+    test_close (relay);
+    test_close (push);
+
+    return 0;
+}
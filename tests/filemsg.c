@@ -0,0 +1,249 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+
+#include "testutil.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*  Tests sending message bodies that refer to files. */
+
+#define FILE_SIZE (3 * 1024 * 1024 + 17)
+
+/*  Sends the header, a range of the file and the trailer as a single message
+    and checks that the peer gets them in one piece. */
+static void check_send (int s1, int s2, int fd, const uint8_t *data,
+    uint64_t offset, size_t size)
+{
+    int rc;
+    void *chunks [3];
+    struct nn_iovec iov [3];
+    struct nn_msghdr hdr;
+    void *buf;
+
+    chunks [0] = nn_allocmsg (3, 0);
+    alloc_assert (chunks [0]);
+    memcpy (chunks [0], "ABC", 3);
+    chunks [1] = nn_filemsg (fd, offset, size);
+    alloc_assert (chunks [1]);
+    chunks [2] = nn_allocmsg (2, 0);
+    alloc_assert (chunks [2]);
+    memcpy (chunks [2], "DE", 2);
+
+    iov [0].iov_base = &chunks [0];
+    iov [0].iov_len = NN_MSG;
+    iov [1].iov_base = &chunks [1];
+    iov [1].iov_len = NN_MSG;
+    iov [2].iov_base = &chunks [2];
+    iov [2].iov_len = NN_MSG;
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = iov;
+    hdr.msg_iovlen = 3;
+    rc = nn_sendmsg (s1, &hdr, 0);
+    errno_assert (rc >= 0);
+    nn_assert (rc == (int) size + 5);
+
+    rc = nn_recv (s2, &buf, NN_MSG, 0);
+    errno_assert (rc >= 0);
+    nn_assert (rc == (int) size + 5);
+    nn_assert (memcmp (buf, "ABC", 3) == 0);
+    nn_assert (memcmp ((uint8_t*) buf + 3, data + offset, size) == 0);
+    nn_assert (memcmp ((uint8_t*) buf + 3 + size, "DE", 2) == 0);
+    nn_freemsg (buf);
+
+    /*  File range on its own. */
+    chunks [0] = nn_filemsg (fd, offset, size);
+    alloc_assert (chunks [0]);
+    rc = nn_send (s1, &chunks [0], NN_MSG, 0);
+    errno_assert (rc >= 0);
+    nn_assert (rc == (int) size);
+    rc = nn_recv (s2, &buf, NN_MSG, 0);
+    errno_assert (rc >= 0);
+    nn_assert (rc == (int) size);
+    nn_assert (memcmp (buf, data + offset, size) == 0);
+    nn_freemsg (buf);
+}
+
+static void check_transport (const char *addr, int fd, const uint8_t *data)
+{
+    int s1;
+    int s2;
+    int opt;
+
+    s1 = test_socket (AF_SP, NN_PAIR);
+    s2 = test_socket (AF_SP, NN_PAIR);
+    opt = -1;
+    test_setsockopt (s2, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, sizeof (opt));
+    opt = 5000;
+    test_setsockopt (s2, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_bind (s2, (char*) addr);
+    test_connect (s1, (char*) addr);
+
+    check_send (s1, s2, fd, data, 0, FILE_SIZE);
+    check_send (s1, s2, fd, data, 12345, 1000);
+    check_send (s1, s2, fd, data, FILE_SIZE, 0);
+
+    test_close (s1);
+    test_close (s2);
+}
+
+/*  A message referring to a file that was truncated in the meantime is
+    dropped rather than sent with missing data. The connection survives. */
+static void check_truncated (const char *addr)
+{
+    int rc;
+    int fd;
+    int s1;
+    int s2;
+    int opt;
+    void *chunk;
+    void *buf;
+    char name [] = "/tmp/nanomsg-filemsg-XXXXXX";
+
+    fd = mkstemp (name);
+    errno_assert (fd >= 0);
+    rc = unlink (name);
+    errno_assert (rc == 0);
+    rc = ftruncate (fd, 1000);
+    errno_assert (rc == 0);
+
+    s1 = test_socket (AF_SP, NN_PAIR);
+    s2 = test_socket (AF_SP, NN_PAIR);
+    opt = 200;
+    test_setsockopt (s2, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_bind (s2, (char*) addr);
+    test_connect (s1, (char*) addr);
+    test_send (s1, "A");
+    test_recv (s2, "A");
+
+    chunk = nn_filemsg (fd, 0, 1000);
+    alloc_assert (chunk);
+    rc = ftruncate (fd, 500);
+    errno_assert (rc == 0);
+    rc = nn_send (s1, &chunk, NN_MSG, 0);
+    errno_assert (rc == 1000);
+    rc = nn_recv (s2, &buf, NN_MSG, 0);
+    nn_assert (rc < 0 && nn_errno () == ETIMEDOUT);
+    nn_assert (nn_get_statistic (s1, NN_STAT_DROPPED_MESSAGES) == 1);
+
+    test_send (s1, "B");
+    test_recv (s2, "B");
+    nn_assert (nn_get_statistic (s1, NN_STAT_BROKEN_CONNECTIONS) == 0);
+
+    test_close (s1);
+    test_close (s2);
+    close (fd);
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int fd;
+    int fds [2];
+    int i;
+    uint8_t *data;
+    void *chunk;
+    char name [] = "/tmp/nanomsg-filemsg-XXXXXX";
+    char addr [128];
+    int port = get_test_port (argc, argv);
+
+    /*  Create a file with some pseudo-random data. */
+    data = malloc (FILE_SIZE);
+    alloc_assert (data);
+    for (i = 0; i != FILE_SIZE; ++i)
+        data [i] = (uint8_t) ((i * 7919) >> 3);
+    fd = mkstemp (name);
+    errno_assert (fd >= 0);
+    rc = unlink (name);
+    errno_assert (rc == 0);
+    rc = (int) write (fd, data, FILE_SIZE);
+    errno_assert (rc == FILE_SIZE);
+
+    /*  Invalid arguments. */
+    chunk = nn_filemsg (-1, 0, 10);
+    nn_assert (chunk == NULL && nn_errno () == EBADF);
+    chunk = nn_filemsg (fd, FILE_SIZE - 10, 11);
+    nn_assert (chunk == NULL && nn_errno () == EINVAL);
+    chunk = nn_filemsg (fd, FILE_SIZE + 1, 0);
+    nn_assert (chunk == NULL && nn_errno () == EINVAL);
+    rc = pipe (fds);
+    errno_assert (rc == 0);
+    chunk = nn_filemsg (fds [0], 0, 0);
+    nn_assert (chunk == NULL && nn_errno () == EINVAL);
+    close (fds [0]);
+    close (fds [1]);
+
+    /*  The data can't be resized. */
+    chunk = nn_filemsg (fd, 0, 10);
+    alloc_assert (chunk);
+    nn_assert (nn_reallocmsg (chunk, 20) == NULL && nn_errno () == EINVAL);
+    nn_freemsg (chunk);
+
+    /*  Transports that can send straight from the file. */
+    test_addr_from (addr, "tcp", "127.0.0.1", port);
+    check_transport (addr, fd, data);
+    check_transport ("ipc://test_filemsg.ipc", fd, data);
+
+    /*  Transports that read the data into memory. */
+    check_transport ("inproc://filemsg", fd, data);
+    test_addr_from (addr, "ws", "127.0.0.1", port + 1);
+    check_transport (addr, fd, data);
+
+    /*  Truncated files are handled the same way by all transports. */
+    test_addr_from (addr, "tcp", "127.0.0.1", port + 2);
+    check_truncated (addr);
+    check_truncated ("ipc://test_filemsg.ipc");
+    check_truncated ("inproc://filemsg");
+    test_addr_from (addr, "ws", "127.0.0.1", port + 3);
+    check_truncated (addr);
+
+    /*  The message keeps the file open even if the user closes it. */
+    {
+        int s1;
+        int s2;
+        void *buf;
+
+        s1 = test_socket (AF_SP, NN_PAIR);
+        s2 = test_socket (AF_SP, NN_PAIR);
+        test_bind (s2, "inproc://filemsg");
+        test_connect (s1, "inproc://filemsg");
+        chunk = nn_filemsg (fd, 100, 100);
+        alloc_assert (chunk);
+        close (fd);
+        rc = nn_send (s1, &chunk, NN_MSG, 0);
+        errno_assert (rc == 100);
+        rc = nn_recv (s2, &buf, NN_MSG, 0);
+        errno_assert (rc == 100);
+        nn_assert (memcmp (buf, data + 100, 100) == 0);
+        nn_freemsg (buf);
+        test_close (s1);
+        test_close (s2);
+    }
+
+    free (data);
+
+    return 0;
+}
@@ -0,0 +1,253 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/pipeline.h"
+#include "../src/pubsub.h"
+
+#include "testutil.h"
+
+#include <string.h>
+
+#if !defined NN_HAVE_WINDOWS
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+/*  Tests delivery of large messages in fragments (NN_RCVFRAGSIZE). */
+
+#define FRAGSIZE 1000
+#define MSGSIZE 2500
+
+static char buf [MSGSIZE];
+
+static int test_rcvmore (int s)
+{
+    int rc;
+    int more;
+    size_t sz;
+
+    sz = sizeof (more);
+    rc = nn_getsockopt (s, NN_SOL_SOCKET, NN_RCVMORE, &more, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (more));
+    return more;
+}
+
+static void test_fragments (const char *addr)
+{
+    int rc;
+    int sb;
+    int sc;
+    int i;
+    int opt;
+    size_t pos;
+    char rbuf [MSGSIZE];
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = FRAGSIZE;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVFRAGSIZE, &opt, sizeof (opt));
+    test_bind (sb, (char*) addr);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, (char*) addr);
+
+    for (i = 0; i != MSGSIZE; ++i)
+        buf [i] = (char) i;
+    rc = nn_send (sc, buf, MSGSIZE, 0);
+    errno_assert (rc == MSGSIZE);
+
+    /*  The message arrives as 1000 + 1000 + 500 bytes. */
+    pos = 0;
+    for (i = 0; i != 3; ++i) {
+        rc = nn_recv (sb, rbuf + pos, sizeof (rbuf) - pos, 0);
+        errno_assert (rc >= 0);
+        nn_assert (rc == (i < 2 ? FRAGSIZE : MSGSIZE - 2 * FRAGSIZE));
+        nn_assert (test_rcvmore (sb) == (i < 2 ? 1 : 0));
+        pos += rc;
+    }
+    nn_assert (pos == MSGSIZE);
+    nn_assert (memcmp (buf, rbuf, MSGSIZE) == 0);
+
+    /*  Messages that fit into a single fragment are not affected. */
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    nn_assert (test_rcvmore (sb) == 0);
+
+    test_close (sc);
+    test_close (sb);
+}
+
+#if !defined NN_HAVE_WINDOWS
+
+/*  A peer dies in the middle of sending a large message. The fragments
+    received so far must not be completed by the next message. */
+static void test_broken (int socktype, int port)
+{
+    int rc;
+    int s;
+    int peer;
+    int raw;
+    int opt;
+    char hdr [8];
+    char rbuf [MSGSIZE];
+    char addr [128];
+    struct sockaddr_in sin;
+
+    test_addr_from (addr, "tcp", "127.0.0.1", port);
+    s = test_socket (AF_SP, socktype);
+    opt = FRAGSIZE;
+    test_setsockopt (s, NN_SOL_SOCKET, NN_RCVFRAGSIZE, &opt, sizeof (opt));
+    opt = 2000;
+    test_setsockopt (s, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_bind (s, addr);
+
+    /*  Announce a message of MSGSIZE bytes but send only a part of it. */
+    raw = socket (AF_INET, SOCK_STREAM, 0);
+    errno_assert (raw >= 0);
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons ((uint16_t) port);
+    sin.sin_addr.s_addr = inet_addr ("127.0.0.1");
+    rc = connect (raw, (struct sockaddr*) &sin, sizeof (sin));
+    errno_assert (rc == 0);
+    memcpy (hdr, "\0SP\0\0\0\0\0", 8);
+    hdr [5] = (char) (socktype == NN_PULL ? NN_PUSH : NN_PAIR);
+    rc = (int) send (raw, hdr, 8, 0);
+    errno_assert (rc == 8);
+    rc = (int) recv (raw, hdr, 8, MSG_WAITALL);
+    errno_assert (rc == 8);
+    memset (hdr, 0, 8);
+    hdr [6] = (char) (MSGSIZE >> 8);
+    hdr [7] = (char) (MSGSIZE & 0xff);
+    rc = (int) send (raw, hdr, 8, 0);
+    errno_assert (rc == 8);
+    memset (buf, 'a', MSGSIZE);
+    rc = (int) send (raw, buf, FRAGSIZE + FRAGSIZE / 2, 0);
+    errno_assert (rc == FRAGSIZE + FRAGSIZE / 2);
+
+    rc = nn_recv (s, rbuf, sizeof (rbuf), 0);
+    errno_assert (rc == FRAGSIZE);
+    nn_assert (test_rcvmore (s) == 1);
+    close (raw);
+
+    /*  The truncation is reported rather than passed over silently. */
+    rc = nn_recv (s, rbuf, sizeof (rbuf), 0);
+    nn_assert (rc < 0 && nn_errno () == ECONNRESET);
+    nn_assert (test_rcvmore (s) == 0);
+
+    /*  Subsequent messages are delivered as usual. */
+    peer = test_socket (AF_SP, socktype == NN_PULL ? NN_PUSH : NN_PAIR);
+    test_connect (peer, addr);
+    test_send (peer, "ABC");
+    test_recv (s, "ABC");
+    nn_assert (test_rcvmore (s) == 0);
+
+    test_close (peer);
+    test_close (s);
+}
+
+#endif
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int s;
+    int pull;
+    int push1;
+    int push2;
+    int opt;
+    int i;
+    int j;
+    int more;
+    char current;
+    char rbuf [MSGSIZE];
+    char addr_tcp [128];
+
+    test_addr_from (addr_tcp, "tcp", "127.0.0.1", get_test_port (argc, argv));
+
+    /*  Option validation. */
+    s = test_socket (AF_SP, NN_PAIR);
+    opt = 0;
+    rc = nn_setsockopt (s, NN_SOL_SOCKET, NN_RCVFRAGSIZE, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = -1;
+    test_setsockopt (s, NN_SOL_SOCKET, NN_RCVFRAGSIZE, &opt, sizeof (opt));
+    nn_assert (test_rcvmore (s) == 0);
+    test_close (s);
+    s = test_socket (AF_SP, NN_PUB);
+    opt = FRAGSIZE;
+    rc = nn_setsockopt (s, NN_SOL_SOCKET, NN_RCVFRAGSIZE, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == ENOTSUP);
+    test_close (s);
+
+    test_fragments (addr_tcp);
+    test_fragments ("ipc://test-fragments.ipc");
+
+    /*  Fragments of messages from different peers are never interleaved. */
+    pull = test_socket (AF_SP, NN_PULL);
+    opt = FRAGSIZE;
+    test_setsockopt (pull, NN_SOL_SOCKET, NN_RCVFRAGSIZE, &opt, sizeof (opt));
+    test_bind (pull, addr_tcp);
+    push1 = test_socket (AF_SP, NN_PUSH);
+    test_connect (push1, addr_tcp);
+    push2 = test_socket (AF_SP, NN_PUSH);
+    test_connect (push2, addr_tcp);
+    nn_sleep (100);
+
+    for (i = 0; i != 10; ++i) {
+        memset (buf, 'a', MSGSIZE);
+        rc = nn_send (push1, buf, MSGSIZE, 0);
+        errno_assert (rc == MSGSIZE);
+        memset (buf, 'b', MSGSIZE);
+        rc = nn_send (push2, buf, MSGSIZE, 0);
+        errno_assert (rc == MSGSIZE);
+    }
+    for (i = 0; i != 20; ++i) {
+        current = 0;
+        for (j = 0; ; ++j) {
+            rc = nn_recv (pull, rbuf, sizeof (rbuf), 0);
+            errno_assert (rc > 0);
+            if (!current)
+                current = rbuf [0];
+            nn_assert (rbuf [0] == current && rbuf [rc - 1] == current);
+            more = test_rcvmore (pull);
+            if (!more)
+                break;
+        }
+        nn_assert (j == 2);
+    }
+
+    test_close (push2);
+    test_close (push1);
+    test_close (pull);
+
+#if !defined NN_HAVE_WINDOWS
+    test_broken (NN_PULL, get_test_port (argc, argv) + 1);
+    test_broken (NN_PAIR, get_test_port (argc, argv) + 2);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/reqrep.h"
+#include "../src/tcp.h"
+
+#include "testutil.h"
+#include "../src/utils/stopwatch.c"
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*  Tests parallel connection attempts to the addresses a host resolves to. */
+
+/*  Creates a TCP socket bound to the specified address. */
+static int raw_socket (const char *ip, int port)
+{
+    int rc;
+    int s;
+    int opt;
+    struct sockaddr_in addr;
+
+    s = socket (AF_INET, SOCK_STREAM, 0);
+    errno_assert (s >= 0);
+    opt = 1;
+    rc = setsockopt (s, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons ((uint16_t) port);
+    addr.sin_addr.s_addr = inet_addr (ip);
+    if (port) {
+        rc = bind (s, (struct sockaddr*) &addr, sizeof (addr));
+        errno_assert (rc == 0);
+    }
+    return s;
+}
+
+/*  Starts a non-blocking connect to the specified address. */
+static int raw_connect (const char *ip, int port)
+{
+    int rc;
+    int s;
+    struct sockaddr_in addr;
+
+    s = raw_socket (ip, 0);
+    rc = fcntl (s, F_SETFL, O_NONBLOCK);
+    errno_assert (rc == 0);
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons ((uint16_t) port);
+    addr.sin_addr.s_addr = inet_addr (ip);
+    rc = connect (s, (struct sockaddr*) &addr, sizeof (addr));
+    errno_assert (rc == 0 || errno == EINPROGRESS);
+    return s;
+}
+
+/*  Connects to 'addr' and checks that the REP socket is reached in less
+    than a second. */
+static void check_connect (int rep, char *addr, int delay)
+{
+    int req;
+    int opt;
+    struct nn_stopwatch stopwatch;
+    uint64_t elapsed;
+
+    req = test_socket (AF_SP, NN_REQ);
+    opt = 5000;
+    test_setsockopt (req, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_setsockopt (req, NN_TCP, NN_TCP_CONNECT_DELAY, &delay,
+        sizeof (delay));
+    nn_stopwatch_init (&stopwatch);
+    test_connect (req, addr);
+    test_send (req, "A");
+    test_recv (rep, "A");
+    elapsed = nn_stopwatch_term (&stopwatch);
+    nn_assert (elapsed < 1000000);
+    test_send (rep, "B");
+    test_recv (req, "B");
+    test_close (req);
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int s;
+    int rep;
+    int blackhole;
+    int fillers [4];
+    int opt;
+    int i;
+    size_t sz;
+    char addr [128];
+    int port = get_test_port (argc, argv);
+
+    /*  Check the option values. */
+    s = test_socket (AF_SP, NN_REQ);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (s, NN_TCP, NN_TCP_CONNECT_DELAY, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt) && opt == 250);
+    opt = -1;
+    rc = nn_setsockopt (s, NN_TCP, NN_TCP_CONNECT_DELAY, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+
+    /*  Check the address lists. */
+    sprintf (addr, "tcp://127.0.0.1,:%d", port);
+    rc = nn_connect (s, addr);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    sprintf (addr, "tcp://,127.0.0.1:%d", port);
+    rc = nn_connect (s, addr);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    sprintf (addr, "tcp://127.0.0.1,-x:%d", port);
+    rc = nn_connect (s, addr);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    sprintf (addr, "tcp://127.0.0.1,localhost:%d", port);
+    test_connect (s, addr);
+    test_close (s);
+
+    rep = test_socket (AF_SP, NN_REP);
+    test_addr_from (addr, "tcp", "127.0.0.1", port);
+    test_bind (rep, addr);
+
+    /*  The first address is a host that drops the connection requests. The
+        listen queue of the socket is full, so incoming SYNs are ignored and
+        the connection attempt would hang for a long time. */
+    blackhole = raw_socket ("127.0.0.2", port);
+    rc = listen (blackhole, 0);
+    errno_assert (rc == 0);
+    for (i = 0; i != 4; ++i)
+        fillers [i] = raw_connect ("127.0.0.2", port);
+    nn_sleep (100);
+    sprintf (addr, "tcp://127.0.0.2,127.0.0.1:%d", port);
+    check_connect (rep, addr, 50);
+
+    /*  If the first attempt fails, the next one starts straight away rather
+        than when the delay expires. Nothing listens on this address. */
+    sprintf (addr, "tcp://127.0.0.3,127.0.0.1:%d", port);
+    check_connect (rep, addr, 10000);
+
+    for (i = 0; i != 4; ++i)
+        close (fillers [i]);
+    close (blackhole);
+    test_close (rep);
+
+    return 0;
+}
@@ -0,0 +1,205 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/reqrep.h"
+#include "../src/tcp.h"
+
+#include "testutil.h"
+#include "../src/utils/stopwatch.c"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*  Tests detection of a dead peer by means of TCP heartbeats. */
+
+/*  Binds a plain TCP socket that will play the role of a REP peer that has
+    silently died. */
+static int dead_listen (int port)
+{
+    int rc;
+    int s;
+    int opt;
+    struct sockaddr_in addr;
+
+    s = socket (AF_INET, SOCK_STREAM, 0);
+    errno_assert (s >= 0);
+    opt = 1;
+    rc = setsockopt (s, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons ((uint16_t) port);
+    addr.sin_addr.s_addr = inet_addr ("127.0.0.1");
+    rc = bind (s, (struct sockaddr*) &addr, sizeof (addr));
+    errno_assert (rc == 0);
+    rc = listen (s, 10);
+    errno_assert (rc == 0);
+    return s;
+}
+
+/*  Does the protocol header exchange, sending the header passed in and
+    storing the one received from the peer. Nothing is sent afterwards. */
+static int dead_accept (int listener, const void *hdr, unsigned char *peerhdr)
+{
+    int rc;
+    int s;
+
+    s = accept (listener, NULL, NULL);
+    errno_assert (s >= 0);
+    rc = (int) send (s, hdr, 8, 0);
+    errno_assert (rc == 8);
+    rc = (int) recv (s, peerhdr, 8, MSG_WAITALL);
+    errno_assert (rc == 8);
+    return s;
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int req;
+    int rep;
+    int listener;
+    int dead;
+    int opt;
+    size_t sz;
+    char buf [64];
+    unsigned char hdr [8];
+    char addr_dead [128];
+    char addr_live [128];
+    struct nn_stopwatch stopwatch;
+    uint64_t elapsed;
+    int port = get_test_port (argc, argv);
+
+    test_addr_from (addr_dead, "tcp", "127.0.0.1", port);
+    test_addr_from (addr_live, "tcp", "127.0.0.1", port + 1);
+
+    req = test_socket (AF_SP, NN_REQ);
+
+    /*  Check the option values. */
+    sz = sizeof (opt);
+    rc = nn_getsockopt (req, NN_TCP, NN_TCP_HEARTBEAT_IVL, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 0);
+    rc = nn_getsockopt (req, NN_TCP, NN_TCP_HEARTBEAT_MISSES, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 3);
+    opt = 0x8000;
+    rc = nn_setsockopt (req, NN_TCP, NN_TCP_HEARTBEAT_IVL, &opt,
+        sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 0;
+    rc = nn_setsockopt (req, NN_TCP, NN_TCP_HEARTBEAT_MISSES, &opt,
+        sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+
+    /*  With heartbeats off, which is the default, the protocol header is
+        the same as in the original protocol. */
+    listener = dead_listen (port);
+    test_connect (req, addr_dead);
+    dead = dead_accept (listener, "\0SP\0\0\x31\0\0", hdr);
+    nn_assert (memcmp (hdr, "\0SP\0\0\x30\0\0", 8) == 0);
+    close (dead);
+    close (listener);
+    test_close (req);
+
+    req = test_socket (AF_SP, NN_REQ);
+    opt = 100;
+    test_setsockopt (req, NN_TCP, NN_TCP_HEARTBEAT_IVL, &opt, sizeof (opt));
+
+    /*  A peer that doesn't announce heartbeats is not expected to send any,
+        so the connection to it survives even though it sends nothing. */
+    listener = dead_listen (port);
+    test_connect (req, addr_dead);
+    dead = dead_accept (listener, "\0SP\0\0\x31\0\0", hdr);
+    nn_assert (memcmp (hdr, "\0SP\0\0\x30", 6) == 0);
+    nn_assert (hdr [6] == 0x80 && hdr [7] == 100);
+    nn_sleep (1000);
+    nn_assert (nn_get_statistic (req, NN_STAT_BROKEN_CONNECTIONS) == 0);
+    close (dead);
+    close (listener);
+    test_close (req);
+
+    req = test_socket (AF_SP, NN_REQ);
+    opt = 100;
+    test_setsockopt (req, NN_TCP, NN_TCP_HEARTBEAT_IVL, &opt, sizeof (opt));
+    opt = 1000;
+    test_setsockopt (req, NN_TCP, NN_TCP_USER_TIMEOUT, &opt, sizeof (opt));
+    opt = 5000;
+    test_setsockopt (req, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+
+    /*  Heartbeats keep an idle connection between two live peers up. */
+    rep = test_socket (AF_SP, NN_REP);
+    opt = 100;
+    test_setsockopt (rep, NN_TCP, NN_TCP_HEARTBEAT_IVL, &opt, sizeof (opt));
+    test_bind (rep, addr_live);
+    test_connect (req, addr_live);
+    test_send (req, "A");
+    test_recv (rep, "A");
+    nn_sleep (1000);
+    test_send (rep, "B");
+    test_recv (req, "B");
+    nn_assert (nn_get_statistic (req, NN_STAT_BROKEN_CONNECTIONS) == 0);
+    nn_assert (nn_get_statistic (rep, NN_STAT_BROKEN_CONNECTIONS) == 0);
+    test_close (req);
+
+    /*  Send a request to a peer that has died without closing the
+        connection. It did announce heartbeats before dying. */
+    req = test_socket (AF_SP, NN_REQ);
+    opt = 100;
+    test_setsockopt (req, NN_TCP, NN_TCP_HEARTBEAT_IVL, &opt, sizeof (opt));
+    opt = 5000;
+    test_setsockopt (req, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    listener = dead_listen (port);
+    test_connect (req, addr_dead);
+    dead = dead_accept (listener, "\0SP\0\0\x31\x80\x64", hdr);
+    nn_assert (memcmp (hdr, "\0SP\0\0\x30", 6) == 0);
+    nn_assert (hdr [6] == 0x80 && hdr [7] == 100);
+    nn_sleep (50);
+    test_send (req, "C");
+    nn_stopwatch_init (&stopwatch);
+
+    /*  Once the dead peer is dropped the request is resent to a live one. */
+    test_connect (req, addr_live);
+    test_recv (rep, "C");
+    elapsed = nn_stopwatch_term (&stopwatch);
+    nn_assert (elapsed < 1000000);
+    test_send (rep, "D");
+    test_recv (req, "D");
+    nn_assert (nn_get_statistic (req, NN_STAT_BROKEN_CONNECTIONS) >= 1);
+
+    /*  The connection to the dead peer was closed. The request may or may not
+        have made it there before. */
+    rc = (int) recv (dead, buf, sizeof (buf), MSG_WAITALL);
+    nn_assert (rc >= 0 && rc < (int) sizeof (buf));
+
+    close (dead);
+    close (listener);
+    test_close (req);
+    test_close (rep);
+
+    return 0;
+}
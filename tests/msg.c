@@ -24,6 +24,8 @@
 
 #include "../src/nn.h"
 #include "../src/pair.h"
+#include "../src/pubsub.h"
+#include "../src/reqrep.h"
 
 #include "testutil.h"
 
@@ -38,9 +40,14 @@ int main (int argc, const char *argv[])
     int rc;
     int sb;
     int sc;
+    int sc2;
+    int subs [3];
     unsigned char *buf1, *buf2;
+    void *parts [3];
     int i;
+    int j;
     struct nn_iovec iov;
+    struct nn_iovec iovs [10];
     struct nn_msghdr hdr;
     char socket_address_tcp[128];
 
@@ -126,6 +133,187 @@ int main (int argc, const char *argv[])
     test_close (sb);
 
 
+    /*  Test that the SP header is correctly merged with the body. */
+    sb = test_socket (AF_SP, NN_REP);
+    test_bind (sb, socket_address_tcp);
+    sc = test_socket (AF_SP, NN_REQ);
+    test_connect (sc, socket_address_tcp);
+
+    buf1 = nn_allocmsg (256, 0);
+    alloc_assert (buf1);
+    for (i = 0; i != 256; ++i)
+        buf1 [i] = (unsigned char) i;
+    rc = nn_send (sc, &buf1, NN_MSG, 0);
+    errno_assert (rc == 256);
+    rc = nn_recv (sb, &buf2, NN_MSG, 0);
+    errno_assert (rc == 256);
+    for (i = 0; i != 256; ++i)
+        nn_assert (buf2 [i] == (unsigned char) i);
+    rc = nn_send (sb, &buf2, NN_MSG, 0);
+    errno_assert (rc == 256);
+    rc = nn_recv (sc, &buf1, NN_MSG, 0);
+    errno_assert (rc == 256);
+    for (i = 0; i != 256; ++i)
+        nn_assert (buf1 [i] == (unsigned char) i);
+    rc = nn_freemsg (buf1);
+    errno_assert (rc == 0);
+
+    test_close (sc);
+    test_close (sb);
+
+    /*  Message shared by several pipes must not be modified in place. */
+    sb = test_socket (AF_SP, NN_PUB);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_SUB);
+    test_setsockopt (sc, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    test_connect (sc, SOCKET_ADDRESS);
+    sc2 = test_socket (AF_SP, NN_SUB);
+    test_setsockopt (sc2, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    test_connect (sc2, SOCKET_ADDRESS);
+
+    buf1 = nn_allocmsg (256, 0);
+    alloc_assert (buf1);
+    for (i = 0; i != 256; ++i)
+        buf1 [i] = (unsigned char) i;
+    rc = nn_send (sb, &buf1, NN_MSG, 0);
+    errno_assert (rc == 256);
+    rc = nn_recv (sc, &buf1, NN_MSG, 0);
+    errno_assert (rc == 256);
+    memset (buf1, 0, 256);
+    rc = nn_recv (sc2, &buf2, NN_MSG, 0);
+    errno_assert (rc == 256);
+    for (i = 0; i != 256; ++i)
+        nn_assert (buf2 [i] == (unsigned char) i);
+    rc = nn_freemsg (buf1);
+    errno_assert (rc == 0);
+    rc = nn_freemsg (buf2);
+    errno_assert (rc == 0);
+
+    test_close (sc2);
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test sending a message consisting of several chunks. The payload chunk
+        is shared by several messages. */
+    for (j = 0; j != 2; ++j) {
+        sb = test_socket (AF_SP, NN_PAIR);
+        test_bind (sb, j == 0 ? socket_address_tcp : SOCKET_ADDRESS);
+        sc = test_socket (AF_SP, NN_PAIR);
+        test_connect (sc, j == 0 ? socket_address_tcp : SOCKET_ADDRESS);
+
+        parts [2] = nn_allocmsg (1000, 0);
+        alloc_assert (parts [2]);
+        memset (parts [2], 'x', 1000);
+        rc = nn_refmsg (NULL);
+        nn_assert (rc == -1 && nn_errno () == EFAULT);
+        rc = nn_refmsg ((char*) parts [2] + 100);
+        nn_assert (rc == -1 && nn_errno () == EFAULT);
+        for (i = 0; i != 3; ++i) {
+            parts [0] = nn_allocmsg (3, 0);
+            alloc_assert (parts [0]);
+            memcpy (parts [0], "ABC", 3);
+            parts [1] = nn_allocmsg (1, 0);
+            alloc_assert (parts [1]);
+            *(char*) parts [1] = '0' + i;
+            rc = nn_refmsg (parts [2]);
+            errno_assert (rc == 0);
+            iovs [0].iov_base = &parts [0];
+            iovs [0].iov_len = NN_MSG;
+            iovs [1].iov_base = &parts [1];
+            iovs [1].iov_len = NN_MSG;
+            iovs [2].iov_base = &parts [2];
+            iovs [2].iov_len = NN_MSG;
+            memset (&hdr, 0, sizeof (hdr));
+            hdr.msg_iov = iovs;
+            hdr.msg_iovlen = 3;
+            rc = nn_sendmsg (sc, &hdr, 0);
+            errno_assert (rc == 1004);
+        }
+        rc = nn_freemsg (parts [2]);
+        errno_assert (rc == 0);
+
+        for (i = 0; i != 3; ++i) {
+            rc = nn_recv (sb, &buf2, NN_MSG, 0);
+            errno_assert (rc == 1004);
+            nn_assert (memcmp (buf2, "ABC", 3) == 0);
+            nn_assert (buf2 [3] == '0' + i);
+            nn_assert (buf2 [4] == 'x' && buf2 [1003] == 'x');
+            rc = nn_freemsg (buf2);
+            errno_assert (rc == 0);
+        }
+
+        /*  Chunks can't be combined with ordinary buffers. */
+        parts [0] = nn_allocmsg (3, 0);
+        alloc_assert (parts [0]);
+        iovs [0].iov_base = &parts [0];
+        iovs [0].iov_len = NN_MSG;
+        iovs [1].iov_base = "ABC";
+        iovs [1].iov_len = 3;
+        memset (&hdr, 0, sizeof (hdr));
+        hdr.msg_iov = iovs;
+        hdr.msg_iovlen = 2;
+        rc = nn_sendmsg (sc, &hdr, 0);
+        nn_assert (rc < 0 && nn_errno () == EINVAL);
+
+        /*  Too many chunks. */
+        for (i = 0; i != 10; ++i) {
+            iovs [i].iov_base = &parts [0];
+            iovs [i].iov_len = NN_MSG;
+        }
+        hdr.msg_iovlen = 10;
+        rc = nn_sendmsg (sc, &hdr, 0);
+        nn_assert (rc < 0 && nn_errno () == EMSGSIZE);
+        rc = nn_freemsg (parts [0]);
+        errno_assert (rc == 0);
+
+        test_close (sc);
+        test_close (sb);
+    }
+
+    /*  A message consisting of several chunks fanned out to subscribers over
+        transports that send the chunks as they are (tcp) and that copy them
+        into a single buffer (inproc). The copies share the chunks. */
+    sb = test_socket (AF_SP, NN_PUB);
+    test_bind (sb, socket_address_tcp);
+    test_bind (sb, SOCKET_ADDRESS);
+    subs [0] = test_socket (AF_SP, NN_SUB);
+    subs [1] = test_socket (AF_SP, NN_SUB);
+    subs [2] = test_socket (AF_SP, NN_SUB);
+    for (i = 0; i != 3; ++i) {
+        test_setsockopt (subs [i], NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+        test_connect (subs [i], i == 2 ? SOCKET_ADDRESS : socket_address_tcp);
+    }
+    nn_sleep (100);
+    for (j = 0; j != 2; ++j) {
+        parts [0] = nn_allocmsg (3, 0);
+        alloc_assert (parts [0]);
+        memcpy (parts [0], "ABC", 3);
+        parts [1] = nn_allocmsg (1000, 0);
+        alloc_assert (parts [1]);
+        memset (parts [1], 'a' + j, 1000);
+        iovs [0].iov_base = &parts [0];
+        iovs [0].iov_len = NN_MSG;
+        iovs [1].iov_base = &parts [1];
+        iovs [1].iov_len = NN_MSG;
+        memset (&hdr, 0, sizeof (hdr));
+        hdr.msg_iov = iovs;
+        hdr.msg_iovlen = 2;
+        rc = nn_sendmsg (sb, &hdr, 0);
+        errno_assert (rc == 1003);
+    }
+    for (i = 0; i != 3; ++i) {
+        for (j = 0; j != 2; ++j) {
+            rc = nn_recv (subs [i], &buf2, NN_MSG, 0);
+            errno_assert (rc == 1003);
+            nn_assert (memcmp (buf2, "ABC", 3) == 0);
+            nn_assert (buf2 [3] == 'a' + j && buf2 [1002] == 'a' + j);
+            rc = nn_freemsg (buf2);
+            errno_assert (rc == 0);
+        }
+        test_close (subs [i]);
+    }
+    test_close (sb);
+
     /*  Test reallocmsg  */
     buf1 = nn_allocmsg (8, 0);
     alloc_assert (buf1);
@@ -140,6 +328,15 @@ int main (int argc, const char *argv[])
 
     nn_freemsg (buf1);
 
+    /*  Growing the message by a few bytes preserves its content. */
+    buf1 = nn_allocmsg (8, 0);
+    alloc_assert (buf1);
+    memcpy (buf1, "01234567", 8);
+    buf2 = nn_reallocmsg (buf1, 16);
+    alloc_assert (buf2);
+    nn_assert (memcmp (buf2, "01234567", 8) == 0);
+    nn_freemsg (buf2);
+
     return 0;
 }
 
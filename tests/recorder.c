@@ -0,0 +1,122 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/pipeline.h"
+
+#include "testutil.h"
+
+#include <string.h>
+
+/*  Tests nn_get_flight_record. */
+
+#define SOCKET_ADDRESS "inproc://recorder"
+
+/*  Returns the number of occurrences of 'str' in the flight record of 's'. */
+static int record_count (int s, const char *str)
+{
+    int rc;
+    char *record;
+    char *pos;
+    int count;
+
+    rc = nn_get_flight_record (s, &record, NN_MSG);
+    errno_assert (rc >= 0);
+    nn_assert ((size_t) rc == strlen (record));
+    count = 0;
+    for (pos = strstr (record, str); pos; pos = strstr (pos + 1, str))
+        ++count;
+    nn_freemsg (record);
+    return count;
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int sb;
+    int sc;
+    int push;
+    int i;
+    int before;
+    char buf [8];
+    char error [64];
+    char socket_address [128];
+
+    test_addr_from (socket_address, "tcp", "127.0.0.1",
+        get_test_port (argc, argv));
+
+    /*  Invalid socket. */
+    rc = nn_get_flight_record (-1, NULL, 0);
+    nn_assert (rc == -1 && nn_errno () == EBADF);
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+
+    /*  Creating endpoints starts state machines. */
+    nn_assert (record_count (sb, "\"kind\":\"event\"") > 0);
+    nn_assert (record_count (sb, "\"src\":-2,\"type\":-2") > 0);
+    nn_assert (record_count (sb, "\"kind\":\"error\"") == 0);
+
+    /*  Traffic is recorded. */
+    before = record_count (sb, "\"kind\":\"event\"");
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    nn_assert (record_count (sb, "\"kind\":\"event\"") > before);
+
+    /*  The ring keeps only the most recent entries. */
+    for (i = 0; i != 1000; ++i) {
+        test_send (sc, "ABC");
+        test_recv (sb, "ABC");
+    }
+    rc = record_count (sb, "\"time\":");
+    nn_assert (rc > 0 && rc <= 128);
+
+    /*  The record is truncated to fit the buffer. */
+    rc = nn_get_flight_record (sb, buf, sizeof (buf));
+    nn_assert (rc > (int) sizeof (buf));
+    nn_assert (strcmp (buf, "{\"fd\":0") == 0);
+
+    /*  Endpoint errors are recorded. */
+    push = test_socket (AF_SP, NN_PUSH);
+    test_connect (push, socket_address);
+    memcpy (error, "\"error\":\"", 9);
+    strcpy (error + 9, nn_strerror (ECONNREFUSED));
+    for (i = 0; i != 100; ++i) {
+        if (record_count (push, error) > 0)
+            break;
+        nn_sleep (10);
+    }
+    nn_assert (i != 100);
+    nn_assert (record_count (push, "\"kind\":\"error\",\"endpoint\":1,") > 0);
+    test_close (push);
+
+    test_close (sc);
+    test_close (sb);
+
+    rc = nn_get_flight_record (sb, NULL, 0);
+    nn_assert (rc == -1 && nn_errno () == EBADF);
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+
+#include "testutil.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*  Tests allocation of messages from user-registered memory regions. */
+
+#define BLOCK_SIZE 4096
+#define BLOCK_COUNT 4
+
+static char *region;
+
+static int inregion (void *p)
+{
+    return (char*) p >= region && (char*) p < region + BLOCK_SIZE * BLOCK_COUNT;
+}
+
+/*  Sends a message allocated from the region and waits till the region
+    gets the block back. */
+static void check_send (int type, int s1, int s2)
+{
+    int rc;
+    int i;
+    void *msg;
+    void *buf;
+
+    msg = nn_allocmsg (3000, type);
+    alloc_assert (msg);
+    nn_assert (inregion (msg));
+    memset (msg, 'x', 3000);
+    rc = nn_send (s1, &msg, NN_MSG, 0);
+    errno_assert (rc == 3000);
+    rc = nn_recv (s2, &buf, NN_MSG, 0);
+    errno_assert (rc == 3000);
+    nn_assert (((char*) buf) [2999] == 'x');
+    nn_freemsg (buf);
+
+    for (i = 0; i != 100; ++i) {
+        rc = nn_unregister_region (type);
+        if (rc == 0)
+            return;
+        nn_assert (nn_errno () == EBUSY);
+        nn_sleep (10);
+    }
+    nn_assert (0);
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int type;
+    int i;
+    int s1;
+    int s2;
+    int types [16];
+    void *msgs [BLOCK_COUNT];
+    void *msg;
+    char addr [128];
+    int port = get_test_port (argc, argv);
+
+    region = malloc (BLOCK_SIZE * BLOCK_COUNT);
+    alloc_assert (region);
+
+    /*  Invalid arguments. */
+    rc = nn_register_region (NULL, BLOCK_SIZE, BLOCK_SIZE);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    rc = nn_register_region (region + 1, BLOCK_SIZE, BLOCK_SIZE);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    rc = nn_register_region (region, BLOCK_SIZE, BLOCK_SIZE * 2);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    rc = nn_register_region (region, BLOCK_SIZE, 8);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    rc = nn_unregister_region (0);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    rc = nn_unregister_region (1);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    msg = nn_allocmsg (10, 1);
+    nn_assert (msg == NULL && nn_errno () == EINVAL);
+
+    /*  Allocate all the blocks. */
+    type = nn_register_region (region, BLOCK_SIZE * BLOCK_COUNT, BLOCK_SIZE);
+    errno_assert (type > 0);
+    msg = nn_allocmsg (BLOCK_SIZE, type);
+    nn_assert (msg == NULL && nn_errno () == EINVAL);
+    for (i = 0; i != BLOCK_COUNT; ++i) {
+        msgs [i] = nn_allocmsg (3000, type);
+        alloc_assert (msgs [i]);
+        nn_assert (inregion (msgs [i]));
+    }
+    msg = nn_allocmsg (10, type);
+    nn_assert (msg == NULL && nn_errno () == ENOMEM);
+    rc = nn_unregister_region (type);
+    nn_assert (rc < 0 && nn_errno () == EBUSY);
+
+    /*  Freed block can be reused. */
+    nn_freemsg (msgs [1]);
+    msgs [1] = nn_allocmsg (10, type);
+    alloc_assert (msgs [1]);
+    nn_assert (inregion (msgs [1]));
+
+    /*  Once the message doesn't fit into the block, it's moved out of
+        the region. */
+    memcpy (msgs [2], "ABC", 3);
+    msgs [2] = nn_reallocmsg (msgs [2], BLOCK_SIZE * 2);
+    alloc_assert (msgs [2]);
+    nn_assert (!inregion (msgs [2]));
+    nn_assert (memcmp (msgs [2], "ABC", 3) == 0);
+    msg = nn_allocmsg (10, type);
+    alloc_assert (msg);
+    nn_assert (inregion (msg));
+    nn_freemsg (msg);
+
+    for (i = 0; i != BLOCK_COUNT; ++i)
+        nn_freemsg (msgs [i]);
+    rc = nn_unregister_region (type);
+    errno_assert (rc == 0);
+    msg = nn_allocmsg (10, type);
+    nn_assert (msg == NULL && nn_errno () == EINVAL);
+
+    /*  Number of regions is limited. */
+    for (i = 0; i != 16; ++i) {
+        types [i] = nn_register_region (region + i * 64, 64, 64);
+        errno_assert (types [i] > 0);
+    }
+    rc = nn_register_region (region, BLOCK_SIZE, BLOCK_SIZE);
+    nn_assert (rc < 0 && nn_errno () == ENOMEM);
+    for (i = 0; i != 16; ++i) {
+        rc = nn_unregister_region (types [i]);
+        errno_assert (rc == 0);
+    }
+
+    /*  Messages from the region can be sent via any transport. Once they are,
+        the blocks are returned to the region. */
+    s1 = test_socket (AF_SP, NN_PAIR);
+    s2 = test_socket (AF_SP, NN_PAIR);
+    test_bind (s2, "inproc://region");
+    test_connect (s1, "inproc://region");
+    type = nn_register_region (region, BLOCK_SIZE * BLOCK_COUNT, BLOCK_SIZE);
+    errno_assert (type > 0);
+    check_send (type, s1, s2);
+    test_close (s1);
+    test_close (s2);
+
+    s1 = test_socket (AF_SP, NN_PAIR);
+    s2 = test_socket (AF_SP, NN_PAIR);
+    test_addr_from (addr, "tcp", "127.0.0.1", port);
+    test_bind (s2, addr);
+    test_connect (s1, addr);
+    type = nn_register_region (region, BLOCK_SIZE * BLOCK_COUNT, BLOCK_SIZE);
+    errno_assert (type > 0);
+    check_send (type, s1, s2);
+    test_close (s1);
+    test_close (s2);
+
+    free (region);
+
+    return 0;
+}
@@ -0,0 +1,284 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/reqrep.h"
+
+#include "testutil.h"
+
+#include <string.h>
+
+/*  Tests REP socket processing several requests at once (NN_REP_CONTEXTS). */
+
+#define SOCKET_ADDRESS "inproc://a"
+
+/*  Size of the ancillary data identifying a request. */
+#define CTRLSZ NN_CMSG_SPACE (sizeof (uint32_t))
+
+/*  Receives a request and stores the ancillary property needed to reply to
+    it in 'ctrl'. Returns the time left till the request's deadline, or -1 if
+    it has none. */
+static int recv_request (int s, void *ctrl, const char *data)
+{
+    int rc;
+    int left;
+    void *control;
+    char buf [16];
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    int found;
+
+    iov.iov_base = buf;
+    iov.iov_len = sizeof (buf);
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = &control;
+    hdr.msg_controllen = NN_MSG;
+    rc = nn_recvmsg (s, &hdr, 0);
+    errno_assert (rc >= 0);
+    nn_assert (rc == (int) strlen (data));
+    nn_assert (memcmp (buf, data, rc) == 0);
+
+    found = 0;
+    left = -1;
+    cmsg = NN_CMSG_FIRSTHDR (&hdr);
+    while (cmsg) {
+        if (cmsg->cmsg_level == NN_REP && cmsg->cmsg_type == NN_REP_CONTEXT) {
+            nn_assert (cmsg->cmsg_len == NN_CMSG_LEN (sizeof (uint32_t)));
+            memcpy (ctrl, cmsg, CTRLSZ);
+            found = 1;
+        }
+        if (cmsg->cmsg_level == NN_SOL_SOCKET &&
+              cmsg->cmsg_type == NN_DEADLINE)
+            memcpy (&left, NN_CMSG_DATA (cmsg), sizeof (left));
+        cmsg = NN_CMSG_NXTHDR (&hdr, cmsg);
+    }
+    nn_assert (found);
+    nn_freemsg (control);
+    return left;
+}
+
+/*  Replies to the request identified by the ancillary property in
+    'ctrl'. */
+static int send_reply (int s, void *ctrl, const char *data)
+{
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+
+    iov.iov_base = (void*) data;
+    iov.iov_len = strlen (data);
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = ctrl;
+    hdr.msg_controllen = CTRLSZ;
+    return nn_sendmsg (s, &hdr, 0);
+}
+
+/*  Appends NN_DEADLINE property to the ancillary data in 'ctrl' that's
+    'sz' bytes long. Returns the new length of the ancillary data. */
+static size_t add_deadline (void *ctrl, size_t sz, int deadline)
+{
+    struct nn_cmsghdr *cmsg;
+
+    cmsg = (struct nn_cmsghdr*) (((char*) ctrl) + sz);
+    cmsg->cmsg_len = NN_CMSG_LEN (sizeof (int));
+    cmsg->cmsg_level = NN_SOL_SOCKET;
+    cmsg->cmsg_type = NN_DEADLINE;
+    memcpy (NN_CMSG_DATA (cmsg), &deadline, sizeof (deadline));
+    return sz + NN_CMSG_SPACE (sizeof (int));
+}
+
+/*  Sends a message with the supplied ancillary data. */
+static int send_ctrl (int s, void *ctrl, size_t sz, const char *data)
+{
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+
+    iov.iov_base = (void*) data;
+    iov.iov_len = strlen (data);
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = ctrl;
+    hdr.msg_controllen = sz;
+    return nn_sendmsg (s, &hdr, 0);
+}
+
+/*  Receives a message and returns the time left till its deadline, or -1
+    if it has none. */
+static int recv_deadline (int s, const char *data)
+{
+    int rc;
+    int left;
+    void *control;
+    char buf [16];
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+
+    iov.iov_base = buf;
+    iov.iov_len = sizeof (buf);
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = &control;
+    hdr.msg_controllen = NN_MSG;
+    rc = nn_recvmsg (s, &hdr, 0);
+    errno_assert (rc >= 0);
+    nn_assert (rc == (int) strlen (data));
+    nn_assert (memcmp (buf, data, rc) == 0);
+
+    left = -1;
+    cmsg = NN_CMSG_FIRSTHDR (&hdr);
+    while (cmsg) {
+        if (cmsg->cmsg_level == NN_SOL_SOCKET &&
+              cmsg->cmsg_type == NN_DEADLINE)
+            memcpy (&left, NN_CMSG_DATA (cmsg), sizeof (left));
+        cmsg = NN_CMSG_NXTHDR (&hdr, cmsg);
+    }
+    nn_freemsg (control);
+    return left;
+}
+
+int main ()
+{
+    int rc;
+    int rep;
+    int req1;
+    int req2;
+    int req3;
+    int opt;
+    size_t sz;
+    char buf [16];
+    uint64_t ctrl1 [4];
+    uint64_t ctrl2 [4];
+    uint64_t ctrl3 [4];
+
+    rep = test_socket (AF_SP, NN_REP);
+
+    /*  Check the option values. */
+    sz = sizeof (opt);
+    rc = nn_getsockopt (rep, NN_REP, NN_REP_CONTEXTS, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 0);
+    opt = -1;
+    rc = nn_setsockopt (rep, NN_REP, NN_REP_CONTEXTS, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 65536;
+    rc = nn_setsockopt (rep, NN_REP, NN_REP_CONTEXTS, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 2;
+    test_setsockopt (rep, NN_REP, NN_REP_CONTEXTS, &opt, sizeof (opt));
+    rc = nn_getsockopt (rep, NN_REP, NN_REP_CONTEXTS, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 2);
+
+    opt = 1000;
+    test_setsockopt (rep, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_bind (rep, SOCKET_ADDRESS);
+    req1 = test_socket (AF_SP, NN_REQ);
+    test_connect (req1, SOCKET_ADDRESS);
+    req2 = test_socket (AF_SP, NN_REQ);
+    test_connect (req2, SOCKET_ADDRESS);
+    req3 = test_socket (AF_SP, NN_REQ);
+    test_connect (req3, SOCKET_ADDRESS);
+
+    /*  Nothing to reply to. */
+    rc = nn_send (rep, "ABC", 3, 0);
+    nn_assert (rc < 0 && nn_errno () == EFSM);
+
+    /*  Receive two requests at once. The third one has to wait till one of
+        them is replied to. */
+    test_send (req1, "A1");
+    recv_request (rep, ctrl1, "A1");
+    test_send (req2, "A2");
+    recv_request (rep, ctrl2, "A2");
+    test_send (req3, "A3");
+    rc = nn_recv (rep, buf, sizeof (buf), NN_DONTWAIT);
+    nn_assert (rc < 0 && nn_errno () == EAGAIN);
+
+    /*  Reply out of order. */
+    rc = send_reply (rep, ctrl2, "B2");
+    errno_assert (rc == 2);
+    test_recv (req2, "B2");
+    recv_request (rep, ctrl3, "A3");
+    rc = send_reply (rep, ctrl1, "B1");
+    errno_assert (rc == 2);
+    test_recv (req1, "B1");
+
+    /*  The same request can't be replied to twice. */
+    rc = send_reply (rep, ctrl1, "C1");
+    nn_assert (rc < 0 && nn_errno () == EFSM);
+    rc = send_reply (rep, ctrl2, "C2");
+    nn_assert (rc < 0 && nn_errno () == EFSM);
+
+    /*  Without ancillary data the reply goes to the request received
+        last. */
+    test_send (rep, "B3");
+    test_recv (req3, "B3");
+    rc = nn_send (rep, "C3", 2, 0);
+    nn_assert (rc < 0 && nn_errno () == EFSM);
+
+    /*  Deadlines are kept alongside the request handle in both
+        directions. */
+    rc = send_ctrl (req1, ctrl1, add_deadline (ctrl1, 0, 10000), "F1");
+    errno_assert (rc == 2);
+    rc = recv_request (rep, ctrl1, "F1");
+    nn_assert (rc > 0 && rc <= 10000);
+    rc = send_ctrl (rep, ctrl1, add_deadline (ctrl1, CTRLSZ, 10000), "G1");
+    errno_assert (rc == 2);
+    rc = recv_deadline (req1, "G1");
+    nn_assert (rc > 0 && rc <= 10000);
+
+    /*  Without a deadline, none is reported. */
+    test_send (req1, "H1");
+    rc = recv_request (rep, ctrl1, "H1");
+    nn_assert (rc == -1);
+    rc = send_reply (rep, ctrl1, "I1");
+    errno_assert (rc == 2);
+    rc = recv_deadline (req1, "I1");
+    nn_assert (rc == -1);
+
+    /*  Switching back to the classic mode cancels the requests being
+        processed. */
+    test_send (req1, "D1");
+    recv_request (rep, ctrl1, "D1");
+    opt = 0;
+    test_setsockopt (rep, NN_REP, NN_REP_CONTEXTS, &opt, sizeof (opt));
+    rc = nn_send (rep, "E1", 2, 0);
+    nn_assert (rc < 0 && nn_errno () == EFSM);
+    test_send (req2, "D2");
+    test_recv (rep, "D2");
+    test_send (rep, "E2");
+    test_recv (req2, "E2");
+
+    test_close (req3);
+    test_close (req2);
+    test_close (req1);
+    test_close (rep);
+
+    return 0;
+}
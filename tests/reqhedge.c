@@ -0,0 +1,211 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/reqrep.h"
+
+#include "testutil.h"
+
+/*  Tests hedged requests in REQ socket. */
+
+#define SOCKET_ADDRESS "inproc://a"
+
+int main ()
+{
+    int rc;
+    int req;
+    int rep1;
+    int rep2;
+    int opt;
+    int i;
+    int rep;
+    int other;
+    size_t sz;
+    char buf [8];
+    struct nn_pollfd pfd [2];
+
+    req = test_socket (AF_SP, NN_REQ);
+
+    /*  Check the option values. */
+    sz = sizeof (opt);
+    rc = nn_getsockopt (req, NN_REQ, NN_REQ_HEDGE_IVL, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 0);
+    rc = nn_getsockopt (req, NN_REQ, NN_REQ_HEDGE_RATIO, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 10);
+    opt = 100;
+    rc = nn_setsockopt (req, NN_REQ, NN_REQ_HEDGE_PERCENTILE, &opt,
+        sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 101;
+    rc = nn_setsockopt (req, NN_REQ, NN_REQ_HEDGE_RATIO, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = -1;
+    rc = nn_setsockopt (req, NN_REQ, NN_REQ_HEDGE_IVL, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    rc = nn_setsockopt (req, NN_REQ, NN_REQ_HEDGE_IVL, buf, 1);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    rc = nn_setsockopt (req, NN_REQ, 1000, buf, 1);
+    nn_assert (rc < 0 && nn_errno () == ENOPROTOOPT);
+
+    opt = 100;
+    test_setsockopt (req, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_bind (req, SOCKET_ADDRESS);
+    rep1 = test_socket (AF_SP, NN_REP);
+    test_setsockopt (rep1, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_connect (rep1, SOCKET_ADDRESS);
+    rep2 = test_socket (AF_SP, NN_REP);
+    test_setsockopt (rep2, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_connect (rep2, SOCKET_ADDRESS);
+    nn_sleep (100);
+
+    /*  Hedging is off by default. Request goes to a single peer. */
+    test_send (req, "ABC");
+    nn_sleep (100);
+    rc = nn_recv (rep1, buf, sizeof (buf), 0);
+    if (rc < 0) {
+        errno_assert (nn_errno () == ETIMEDOUT);
+        test_recv (rep2, "ABC");
+        test_send (rep2, "DEF");
+    }
+    else {
+        nn_assert (rc == 3);
+        test_drop (rep2, ETIMEDOUT);
+        test_send (rep1, "DEF");
+    }
+    test_recv (req, "DEF");
+
+    /*  Late reply makes a hedged copy of the request go to the other peer.
+        The first reply wins, the other one is dropped. */
+    opt = 50;
+    test_setsockopt (req, NN_REQ, NN_REQ_HEDGE_IVL, &opt, sizeof (opt));
+    opt = 100;
+    test_setsockopt (req, NN_REQ, NN_REQ_HEDGE_RATIO, &opt, sizeof (opt));
+    test_send (req, "GHI");
+    nn_sleep (200);
+    test_recv (rep1, "GHI");
+    test_recv (rep2, "GHI");
+    test_send (rep2, "JKL");
+    test_recv (req, "JKL");
+    test_send (rep1, "MNO");
+    nn_sleep (50);
+    rc = nn_recv (req, buf, sizeof (buf), 0);
+    nn_assert (rc < 0 && nn_errno () == EFSM);
+    nn_assert (nn_get_statistic (req, NN_STAT_HEDGED_REQUESTS) == 1);
+
+    /*  Reply arriving in time means no hedged copy. */
+    opt = 1000;
+    test_setsockopt (req, NN_REQ, NN_REQ_HEDGE_IVL, &opt, sizeof (opt));
+    test_send (req, "PQR");
+    rc = nn_recv (rep1, buf, sizeof (buf), 0);
+    if (rc < 0) {
+        errno_assert (nn_errno () == ETIMEDOUT);
+        test_recv (rep2, "PQR");
+        test_send (rep2, "STU");
+    }
+    else {
+        nn_assert (rc == 3);
+        test_send (rep1, "STU");
+    }
+    test_recv (req, "STU");
+    nn_assert (nn_get_statistic (req, NN_STAT_HEDGED_REQUESTS) == 1);
+
+    /*  With zero ratio no request is ever hedged. */
+    opt = 50;
+    test_setsockopt (req, NN_REQ, NN_REQ_HEDGE_IVL, &opt, sizeof (opt));
+    opt = 0;
+    test_setsockopt (req, NN_REQ, NN_REQ_HEDGE_RATIO, &opt, sizeof (opt));
+    test_send (req, "VWX");
+    nn_sleep (200);
+    rc = nn_recv (rep1, buf, sizeof (buf), 0);
+    if (rc < 0) {
+        errno_assert (nn_errno () == ETIMEDOUT);
+        test_recv (rep2, "VWX");
+        test_send (rep2, "VWX");
+    }
+    else {
+        nn_assert (rc == 3);
+        test_drop (rep2, ETIMEDOUT);
+        test_send (rep1, "VWX");
+    }
+    nn_assert (nn_get_statistic (req, NN_STAT_HEDGED_REQUESTS) == 1);
+
+    /*  Hedging delay derived from the recent reply times. Fill in the
+        history with fast replies first, with hedging switched off. */
+    test_recv (req, "VWX");
+    opt = 0;
+    test_setsockopt (req, NN_REQ, NN_REQ_HEDGE_IVL, &opt, sizeof (opt));
+    opt = 90;
+    test_setsockopt (req, NN_REQ, NN_REQ_HEDGE_PERCENTILE, &opt, sizeof (opt));
+    pfd [0].fd = rep1;
+    pfd [0].events = NN_POLLIN;
+    pfd [1].fd = rep2;
+    pfd [1].events = NN_POLLIN;
+    for (i = 0; i != 64; ++i) {
+        test_send (req, "ABC");
+        rc = nn_poll (pfd, 2, 1000);
+        errno_assert (rc >= 1);
+        rep = pfd [0].revents & NN_POLLIN ? rep1 : rep2;
+        test_recv (rep, "ABC");
+        test_send (rep, "DEF");
+        test_recv (req, "DEF");
+    }
+    nn_assert (nn_get_statistic (req, NN_STAT_HEDGED_REQUESTS) == 1);
+    opt = 100;
+    test_setsockopt (req, NN_REQ, NN_REQ_HEDGE_RATIO, &opt, sizeof (opt));
+    test_send (req, "GHI");
+    nn_sleep (100);
+    test_recv (rep1, "GHI");
+    test_recv (rep2, "GHI");
+    test_send (rep1, "JKL");
+    test_recv (req, "JKL");
+    nn_assert (nn_get_statistic (req, NN_STAT_HEDGED_REQUESTS) == 2);
+
+    /*  Losing the peer the request was sent to doesn't cause a re-send while
+        the hedged copy is still in flight. */
+    opt = 0;
+    test_setsockopt (req, NN_REQ, NN_REQ_HEDGE_PERCENTILE, &opt, sizeof (opt));
+    opt = 100;
+    test_setsockopt (req, NN_REQ, NN_REQ_HEDGE_IVL, &opt, sizeof (opt));
+    test_send (req, "PQR");
+    rc = nn_poll (pfd, 2, 50);
+    errno_assert (rc == 1);
+    rep = pfd [0].revents & NN_POLLIN ? rep1 : rep2;
+    other = rep == rep1 ? rep2 : rep1;
+    test_recv (rep, "PQR");
+    nn_sleep (150);
+    test_recv (other, "PQR");
+    nn_assert (nn_get_statistic (req, NN_STAT_HEDGED_REQUESTS) == 3);
+    test_close (rep);
+    pfd [0].fd = other;
+    rc = nn_poll (pfd, 1, 100);
+    errno_assert (rc == 0);
+    test_send (other, "STU");
+    test_recv (req, "STU");
+
+    test_close (other);
+    test_close (req);
+
+    return 0;
+}
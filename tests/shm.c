@@ -0,0 +1,291 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/shm.h"
+
+#include "testutil.h"
+#include "../src/utils/attr.h"
+#include "../src/utils/thread.c"
+
+#if defined NN_HAVE_MEMFD
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+/*  Tests shared memory transport. */
+
+#define SOCKET_ADDRESS "shm://test.shm"
+
+#define MSG_COUNT 5000
+#define MSG_SIZE 1500
+
+int sc;
+int sb;
+
+#if defined NN_HAVE_MEMFD
+
+/*  Creates a ring the way the transport does, optionally without sealing
+    it against resizing. */
+static int raw_ring (int seal)
+{
+    int rc;
+    int fd;
+    uint32_t *ctl;
+
+    fd = memfd_create ("nanomsg-test", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    errno_assert (fd >= 0);
+    rc = ftruncate (fd, 320 + 4096);
+    errno_assert (rc == 0);
+    ctl = mmap (NULL, 320 + 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    nn_assert (ctl != MAP_FAILED);
+    ctl [0] = 0x6e6e5352;
+    ctl [1] = 4096;
+    rc = munmap (ctl, 320 + 4096);
+    errno_assert (rc == 0);
+    if (seal) {
+        rc = fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+        errno_assert (rc == 0);
+    }
+    return fd;
+}
+
+/*  Connects to the socket bound to SOCKET_ADDRESS, plays the connector's
+    part of the handshake and passes it the ring. Returns the acceptor's
+    reply, or -1 if it closed the connection instead. */
+static int raw_handshake (int seal)
+{
+    int rc;
+    int s;
+    int fd;
+    char c;
+    char hdr [8];
+    struct sockaddr_un addr;
+    struct timeval tv;
+    struct iovec iov;
+    struct msghdr hdrmsg;
+    struct cmsghdr *cmsg;
+    char control [CMSG_SPACE (sizeof (int))];
+
+    s = socket (AF_UNIX, SOCK_STREAM, 0);
+    errno_assert (s >= 0);
+    tv.tv_sec = 5;
+    tv.tv_usec = 0;
+    rc = setsockopt (s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+    errno_assert (rc == 0);
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strcpy (addr.sun_path, "test.shm");
+    rc = connect (s, (struct sockaddr*) &addr, sizeof (addr));
+    errno_assert (rc == 0);
+
+    rc = (int) send (s, "\0SP\0\0\x10\0\0", 8, 0);
+    errno_assert (rc == 8);
+    rc = (int) recv (s, hdr, sizeof (hdr), MSG_WAITALL);
+    errno_assert (rc == 8);
+    rc = (int) recv (s, &c, 1, 0);
+    errno_assert (rc == 1);
+    nn_assert (c == 0x52);
+
+    fd = raw_ring (seal);
+    c = 0x48;
+    iov.iov_base = &c;
+    iov.iov_len = 1;
+    memset (&hdrmsg, 0, sizeof (hdrmsg));
+    hdrmsg.msg_iov = &iov;
+    hdrmsg.msg_iovlen = 1;
+    hdrmsg.msg_control = control;
+    hdrmsg.msg_controllen = sizeof (control);
+    cmsg = CMSG_FIRSTHDR (&hdrmsg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+    memcpy (CMSG_DATA (cmsg), &fd, sizeof (int));
+    rc = (int) sendmsg (s, &hdrmsg, 0);
+    errno_assert (rc == 1);
+    close (fd);
+
+    rc = (int) recv (s, &c, 1, 0);
+    errno_assert (rc >= 0);
+    close (s);
+    return rc == 1 ? (unsigned char) c : -1;
+}
+
+#endif
+
+static void fill (char *buf, int size, int seed)
+{
+    int i;
+
+    for (i = 0; i < size; ++i)
+        buf [i] = (char) (48 + (i + seed) % 10);
+}
+
+/*  Pushes more data than the ring can hold so that the sender has to wait
+    for the receiver repeatedly. */
+static void sender (NN_UNUSED void *arg)
+{
+    int i;
+    int rc;
+    char buf [MSG_SIZE];
+
+    for (i = 0; i != MSG_COUNT; ++i) {
+        fill (buf, MSG_SIZE, i);
+        rc = nn_send (sc, buf, MSG_SIZE, 0);
+        errno_assert (rc >= 0);
+        nn_assert (rc == MSG_SIZE);
+    }
+}
+
+int main ()
+{
+    int i;
+    int rc;
+    int opt;
+    int s1;
+    size_t opt_sz = sizeof (opt);
+    void *dummy_buf;
+    char buf [MSG_SIZE];
+    char *large;
+    int size;
+    struct nn_thread thread;
+
+    /*  Try closing a shm socket while it not connected. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+    test_close (sc);
+
+    /*  Open the socket anew. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+
+    /*  Leave enough time for at least one re-connect attempt. */
+    nn_sleep (200);
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+
+    /*  Ping-pong test. */
+    test_send (sc, "0123456789012345678901234567890123456789");
+    test_recv (sb, "0123456789012345678901234567890123456789");
+    test_send (sb, "0123456789012345678901234567890123456789");
+    test_recv (sc, "0123456789012345678901234567890123456789");
+
+    /*  Batch transfer test. */
+    for (i = 0; i != 100; ++i) {
+        test_send (sc, "XYZ");
+    }
+    for (i = 0; i != 100; ++i) {
+        test_recv (sb, "XYZ");
+    }
+
+    /*  Message larger than the ring has to be transferred in pieces. */
+    size = 100000;
+    large = malloc (size);
+    alloc_assert (large);
+    fill (large, size - 1, 0);
+    large [size - 1] = '\0';
+    test_send (sc, large);
+    test_recv (sb, large);
+    free (large);
+
+    test_close (sc);
+    test_close (sb);
+
+    /*  Streaming through the smallest possible ring. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 4096;
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_SNDBUF, &opt, sizeof (opt));
+    test_connect (sc, SOCKET_ADDRESS);
+    nn_thread_init (&thread, sender, NULL);
+    for (i = 0; i != MSG_COUNT; ++i) {
+        rc = nn_recv (sb, buf, sizeof (buf), 0);
+        errno_assert (rc >= 0);
+        nn_assert (rc == MSG_SIZE);
+        nn_assert (buf [0] == (char) (48 + i % 10));
+        nn_assert (buf [MSG_SIZE - 1] == (char) (48 + (MSG_SIZE - 1 + i) % 10));
+    }
+    nn_thread_term (&thread);
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test two sockets binding to the same address. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    s1 = test_socket (AF_SP, NN_PAIR);
+    rc = nn_bind (s1, SOCKET_ADDRESS);
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EADDRINUSE);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+    nn_sleep (100);
+    test_send (sb, "ABC");
+    test_recv (sc, "ABC");
+    test_close (sb);
+    test_close (sc);
+    test_close (s1);
+
+    /*  Test NN_RCVMAXSIZE limit */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    s1 = test_socket (AF_SP, NN_PAIR);
+    test_connect (s1, SOCKET_ADDRESS);
+    opt = 4;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, opt_sz);
+    nn_assert (rc == 0);
+    nn_sleep (100);
+    test_send (s1, "ABCD");
+    test_recv (sb, "ABCD");
+    test_send (s1, "ABCDE");
+    nn_sleep (100);
+    rc = nn_recv (sb, &dummy_buf, NN_MSG, NN_DONTWAIT);
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EAGAIN);
+    test_close (sb);
+    test_close (s1);
+
+#if defined NN_HAVE_MEMFD
+    /*  A ring the peer could still resize is refused, a sealed one is
+        accepted and answered by the acceptor's own ring. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    nn_assert (raw_handshake (0) == -1);
+    nn_assert (raw_handshake (1) == 0x48);
+    test_close (sb);
+#endif
+
+    /*  Test closing a socket that is waiting to connect. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+    nn_sleep (100);
+    test_close (sc);
+
+    return 0;
+}
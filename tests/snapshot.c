@@ -0,0 +1,142 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/pipeline.h"
+
+#include "testutil.h"
+
+#include <string.h>
+
+/*  Tests nn_get_snapshot. */
+
+#define SOCKET_ADDRESS "inproc://snapshot"
+
+/*  Returns the current snapshot; release it with nn_freemsg. */
+static char *snapshot (void)
+{
+    int rc;
+    char *snap;
+
+    rc = nn_get_snapshot (&snap, NN_MSG);
+    errno_assert (rc >= 0);
+    nn_assert ((size_t) rc == strlen (snap));
+    return snap;
+}
+
+static int snapshot_has (const char *str)
+{
+    char *snap;
+    int rc;
+
+    snap = snapshot ();
+    rc = strstr (snap, str) != NULL;
+    nn_freemsg (snap);
+    return rc;
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int sb;
+    int sc;
+    int push;
+    int i;
+    char buf [10];
+    char *snap;
+    char socket_address [128];
+
+    test_addr_from (socket_address, "tcp", "127.0.0.1",
+        get_test_port (argc, argv));
+
+    /*  No sockets, empty document. */
+    rc = nn_get_snapshot (NULL, 0);
+    nn_assert (rc == (int) strlen ("{\"sockets\":[]}"));
+    snap = snapshot ();
+    nn_assert (strcmp (snap, "{\"sockets\":[]}") == 0);
+    nn_freemsg (snap);
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_SOCKET_NAME, "left", 4);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP_RAW, NN_PAIR);
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_SOCKET_NAME, "right", 5);
+    test_connect (sc, SOCKET_ADDRESS);
+
+    /*  Sockets, endpoints and pipes are all present. */
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    snap = snapshot ();
+    nn_assert (strstr (snap, "\"name\":\"left\",\"type\":\"PAIR\","
+        "\"raw\":false"));
+    nn_assert (strstr (snap, "\"name\":\"right\",\"type\":\"PAIR\","
+        "\"raw\":true"));
+    nn_assert (strstr (snap, "\"address\":\"inproc://snapshot\","
+        "\"bind\":true,\"state\":\"active\""));
+    nn_assert (strstr (snap, "\"address\":\"inproc://snapshot\","
+        "\"bind\":false,\"state\":\"active\""));
+    nn_assert (strstr (snap, "\"messages_sent\":1,\"messages_received\":0,"
+        "\"bytes_sent\":3,\"bytes_received\":0,\"messages_dropped\":0}"));
+    nn_assert (strstr (snap, "\"messages_sent\":0,\"messages_received\":1,"
+        "\"bytes_sent\":0,\"bytes_received\":3,\"messages_dropped\":0}"));
+    nn_assert (strstr (snap, "\"in\":\"waiting\",\"out\":\"ready\""));
+    nn_freemsg (snap);
+
+    /*  The document is truncated to fit the buffer. */
+    rc = nn_get_snapshot (buf, sizeof (buf));
+    nn_assert (rc > (int) sizeof (buf));
+    nn_assert (strcmp (buf, "{\"sockets") == 0);
+
+    /*  Names are escaped. */
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_SOCKET_NAME, "a\"b\\c\n", 6);
+    nn_assert (snapshot_has ("\"name\":\"a\\\"b\\\\c\\u000a\""));
+
+    /*  Failing endpoint reports its error. */
+    push = test_socket (AF_SP, NN_PUSH);
+    test_connect (push, socket_address);
+    for (i = 0; i != 100; ++i) {
+        if (snapshot_has ("\"type\":\"PUSH\"") &&
+              !snapshot_has ("\"last_errno\":0,\"last_error\":null}],"
+              "\"pipes\":[]}]"))
+            break;
+        nn_sleep (10);
+    }
+    nn_assert (i != 100);
+    test_close (push);
+
+    /*  Snapshots can be taken while messages flow. */
+    for (i = 0; i != 100; ++i) {
+        test_send (sb, "XYZ");
+        nn_assert (snapshot_has ("\"type\":\"PAIR\""));
+        test_recv (sc, "XYZ");
+    }
+
+    test_close (sc);
+    test_close (sb);
+
+    snap = snapshot ();
+    nn_assert (strcmp (snap, "{\"sockets\":[]}") == 0);
+    nn_freemsg (snap);
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pubsub.h"
+
+#include "testutil.h"
+
+#include <stdio.h>
+
+/*  Number of messages to publish while the subscriber is not reading. */
+#define NUM_MSGS 100
+
+/*  Creates a publisher with the specified send queue and a subscriber that
+    falls behind immediately because of its tiny receive buffer. */
+static void setup (int *pub, int *sub, char *addr, int msgs, int policy)
+{
+    int val;
+
+    *pub = test_socket (AF_SP, NN_PUB);
+    test_setsockopt (*pub, NN_SOL_SOCKET, NN_SNDQUEUE_MSGS,
+        &msgs, sizeof (msgs));
+    test_setsockopt (*pub, NN_SOL_SOCKET, NN_SNDQUEUE_POLICY,
+        &policy, sizeof (policy));
+    test_bind (*pub, addr);
+
+    *sub = test_socket (AF_SP, NN_SUB);
+    val = 1;
+    test_setsockopt (*sub, NN_SOL_SOCKET, NN_RCVBUF, &val, sizeof (val));
+    test_setsockopt (*sub, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    val = 200;
+    test_setsockopt (*sub, NN_SOL_SOCKET, NN_RCVTIMEO, &val, sizeof (val));
+    test_connect (*sub, addr);
+    nn_sleep (10);
+}
+
+/*  Receives everything available. Returns number of messages received and
+    stores the first and the last sequence number received. */
+static int drain (int sub, int *first, int *last)
+{
+    int rc;
+    int count;
+    int seq;
+    char buf [32];
+
+    count = 0;
+    *first = -1;
+    *last = -1;
+    while (1) {
+        rc = nn_recv (sub, buf, sizeof (buf) - 1, 0);
+        if (rc < 0 && nn_errno () == ETIMEDOUT)
+            break;
+        errno_assert (rc > 0);
+        buf [rc] = 0;
+        seq = atoi (buf);
+
+        /*  Whatever the policy, the messages are delivered in order. */
+        nn_assert (seq > *last);
+        if (*first < 0)
+            *first = seq;
+        *last = seq;
+        ++count;
+    }
+    return count;
+}
+
+/*  Checks that the snapshot shows a pipe that has missed 'dropped'
+    messages. */
+static void check_pipe_dropped (int dropped)
+{
+    int rc;
+    char *snap;
+    char expected [64];
+
+    rc = nn_get_snapshot (&snap, NN_MSG);
+    errno_assert (rc >= 0);
+    sprintf (expected, "\"messages_dropped\":%d}", dropped);
+    nn_assert (strstr (snap, expected));
+    nn_freemsg (snap);
+}
+
+static void publish (int pub)
+{
+    int rc;
+    int i;
+    char buf [32];
+
+    for (i = 0; i != NUM_MSGS; ++i) {
+        sprintf (buf, "%d", i);
+        rc = nn_send (pub, buf, strlen (buf), 0);
+        errno_assert (rc >= 0);
+    }
+    nn_sleep (50);
+}
+
+int main ()
+{
+    int rc;
+    int pub;
+    int sub;
+    int val;
+    int count;
+    int first;
+    int last;
+    size_t sz;
+
+    /*  Check the option defaults and validation. */
+    pub = test_socket (AF_SP, NN_PUB);
+    sz = sizeof (val);
+    rc = nn_getsockopt (pub, NN_SOL_SOCKET, NN_SNDQUEUE_MSGS, &val, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (val) && val == 0);
+    sz = sizeof (val);
+    rc = nn_getsockopt (pub, NN_SOL_SOCKET, NN_SNDQUEUE_POLICY, &val, &sz);
+    errno_assert (rc == 0);
+    nn_assert (val == NN_SNDQUEUE_DROP_NEWEST);
+    val = -1;
+    rc = nn_setsockopt (pub, NN_SOL_SOCKET, NN_SNDQUEUE_BYTES,
+        &val, sizeof (val));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    val = 0;
+    rc = nn_setsockopt (pub, NN_SOL_SOCKET, NN_SNDQUEUE_POLICY,
+        &val, sizeof (val));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    test_close (pub);
+
+    /*  Drop-newest keeps the beginning of the stream. */
+    setup (&pub, &sub, "inproc://sndqueue-newest", 4, NN_SNDQUEUE_DROP_NEWEST);
+    publish (pub);
+    count = drain (sub, &first, &last);
+    nn_assert (first == 0);
+    nn_assert (last == count - 1);
+    nn_assert (count < NUM_MSGS);
+    nn_assert (nn_get_statistic (pub, NN_STAT_DROPPED_MESSAGES) ==
+        (uint64_t) (NUM_MSGS - count));
+    check_pipe_dropped (NUM_MSGS - count);
+    test_close (sub);
+    test_close (pub);
+
+    /*  Drop-oldest keeps the most recent messages. */
+    setup (&pub, &sub, "inproc://sndqueue-oldest", 4, NN_SNDQUEUE_DROP_OLDEST);
+    publish (pub);
+    count = drain (sub, &first, &last);
+    nn_assert (last == NUM_MSGS - 1);
+    nn_assert (count < NUM_MSGS);
+    nn_assert (nn_get_statistic (pub, NN_STAT_DROPPED_MESSAGES) ==
+        (uint64_t) (NUM_MSGS - count));
+    check_pipe_dropped (NUM_MSGS - count);
+    test_close (sub);
+    test_close (pub);
+
+    /*  Blocking policy pushes back on the publisher instead of dropping. */
+    setup (&pub, &sub, "inproc://sndqueue-block", 2, NN_SNDQUEUE_BLOCK);
+    count = 0;
+    while (1) {
+        rc = nn_send (pub, "0", 1, NN_DONTWAIT);
+        if (rc < 0) {
+            nn_assert (nn_errno () == EAGAIN);
+            break;
+        }
+        ++count;
+        nn_assert (count < NUM_MSGS);
+    }
+    nn_assert (nn_get_statistic (pub, NN_STAT_QUEUED_BYTES) == 2);
+    test_recv (sub, "0");
+    nn_sleep (10);
+    rc = nn_send (pub, "0", 1, NN_DONTWAIT);
+    errno_assert (rc == 1);
+    ++count;
+    while (--count)
+        test_recv (sub, "0");
+    nn_assert (nn_get_statistic (pub, NN_STAT_DROPPED_MESSAGES) == 0);
+    nn_assert (nn_get_statistic (pub, NN_STAT_QUEUED_BYTES) == 0);
+    test_close (sub);
+    test_close (pub);
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+#include "../src/pubsub.h"
+
+#include "testutil.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*  Tests the spill queue of PUSH and PUB sockets. */
+
+#define MSG_SIZE 1000
+#define NUM_MSGS 1000
+
+/*  Sends a message carrying the sequence number without blocking. */
+static int send_seq (int s, int seq)
+{
+    char buf [MSG_SIZE];
+
+    memset (buf, 'x', sizeof (buf));
+    sprintf (buf, "%d", seq);
+    return nn_send (s, buf, sizeof (buf), NN_DONTWAIT);
+}
+
+static void recv_seq (int s, int seq)
+{
+    int rc;
+    char buf [MSG_SIZE + 1];
+
+    rc = nn_recv (s, buf, sizeof (buf), 0);
+    errno_assert (rc == MSG_SIZE);
+    nn_assert (atoi (buf) == seq);
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int push;
+    int pull;
+    int pub;
+    int sub;
+    int val;
+    int i;
+    int sent;
+    int received;
+    size_t sz;
+    char path [64];
+    char buf [64];
+    char addr [128];
+    int port = get_test_port (argc, argv);
+
+    test_addr_from (addr, "tcp", "127.0.0.1", port);
+    sprintf (path, "/tmp/nanomsg-spill-%d", port);
+
+    /*  Check the option defaults and validation. */
+    push = test_socket (AF_SP, NN_PUSH);
+    sz = sizeof (val);
+    rc = nn_getsockopt (push, NN_PUSH, NN_PUSH_SPILL_SIZE, &val, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (val) && val == 64 * 1024 * 1024);
+    sz = sizeof (buf);
+    rc = nn_getsockopt (push, NN_PUSH, NN_PUSH_SPILL_FILE, buf, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == 0);
+    val = 4095;
+    rc = nn_setsockopt (push, NN_PUSH, NN_PUSH_SPILL_SIZE, &val, sizeof (val));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    rc = nn_setsockopt (push, NN_PUSH, NN_PUSH_SPILL_FILE,
+        "/nonexistent/spill", 18);
+    nn_assert (rc < 0 && nn_errno () == ENOENT);
+
+    /*  Without peers, messages go to the spill until it's full. */
+    val = 4096;
+    test_setsockopt (push, NN_PUSH, NN_PUSH_SPILL_SIZE, &val, sizeof (val));
+    val = 1;
+    test_setsockopt (push, NN_SOL_SOCKET, NN_SNDBUF, &val, sizeof (val));
+    test_setsockopt (push, NN_PUSH, NN_PUSH_SPILL_FILE, path, strlen (path));
+    sz = sizeof (buf);
+    rc = nn_getsockopt (push, NN_PUSH, NN_PUSH_SPILL_FILE, buf, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == strlen (path) && memcmp (buf, path, sz) == 0);
+    nn_assert (access (path, F_OK) == 0);
+    test_bind (push, addr);
+    for (i = 0; i != 4; ++i)
+        errno_assert (send_seq (push, i) == MSG_SIZE);
+    rc = send_seq (push, i);
+    nn_assert (rc < 0 && nn_errno () == EAGAIN);
+
+    /*  The spilled messages are delivered in order once a peer connects
+        and the newer messages follow them. */
+    pull = test_socket (AF_SP, NN_PULL);
+    val = 1000;
+    test_setsockopt (pull, NN_SOL_SOCKET, NN_RCVTIMEO, &val, sizeof (val));
+    val = 1;
+    test_setsockopt (pull, NN_SOL_SOCKET, NN_RCVBUF, &val, sizeof (val));
+    test_connect (pull, addr);
+    for (i = 0; i != 4; ++i)
+        recv_seq (pull, i);
+    nn_sleep (10);
+    errno_assert (send_seq (push, 4) == MSG_SIZE);
+    recv_seq (pull, 4);
+
+    /*  Keep sending faster than the peer reads. With the tiny buffers
+        the pipe blocks quickly, so the spill fills up, drains and wraps
+        around many times. Nothing is lost or reordered. */
+    sent = 5;
+    received = 5;
+    while (sent != NUM_MSGS) {
+        rc = send_seq (push, sent);
+        if (rc < 0) {
+            nn_assert (nn_errno () == EAGAIN);
+            recv_seq (pull, received++);
+            continue;
+        }
+        ++sent;
+    }
+    while (received != NUM_MSGS)
+        recv_seq (pull, received++);
+    test_close (pull);
+
+    /*  Closing the socket removes the spill file. */
+    test_close (push);
+    nn_assert (access (path, F_OK) != 0);
+
+    /*  PUB keeps the messages published while there are no subscribers. */
+    pub = test_socket (AF_SP, NN_PUB);
+    test_setsockopt (pub, NN_PUB, NN_PUB_SPILL_FILE, path, strlen (path));
+    test_bind (pub, addr);
+    for (i = 0; i != 10; ++i)
+        errno_assert (send_seq (pub, i) == MSG_SIZE);
+    sub = test_socket (AF_SP, NN_SUB);
+    test_setsockopt (sub, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    val = 1000;
+    test_setsockopt (sub, NN_SOL_SOCKET, NN_RCVTIMEO, &val, sizeof (val));
+    test_connect (sub, addr);
+    for (i = 0; i != 10; ++i)
+        recv_seq (sub, i);
+
+    /*  Disabling the spill discards what's left in it. */
+    test_close (sub);
+    nn_sleep (50);
+    errno_assert (send_seq (pub, 10) == MSG_SIZE);
+    test_setsockopt (pub, NN_PUB, NN_PUB_SPILL_FILE, "", 0);
+    nn_assert (access (path, F_OK) != 0);
+    nn_assert (nn_get_statistic (pub, NN_STAT_DROPPED_MESSAGES) == 1);
+    test_close (pub);
+
+    return 0;
+}
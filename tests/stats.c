@@ -22,14 +22,36 @@
 */
 
 #include "../src/nn.h"
+#include "../src/pair.h"
 #include "../src/reqrep.h"
 
 #include "testutil.h"
 
+#include <string.h>
+
+/*  Returns bytes allocated under the given name, -1 if there's no such name
+    or the library doesn't account memory. */
+static int64_t memory_stat (const char *name)
+{
+    int i;
+    struct nn_memory_stat stat;
+
+    for (i = 0; nn_get_memory_stat (i, &stat, sizeof (stat)) != 0; ++i) {
+        if (strcmp (stat.name, name) == 0)
+            return (int64_t) stat.bytes;
+    }
+    return -1;
+}
+
 int main (int argc, const char *argv[])
 {
     int rep1;
     int req1;
+    int sb;
+    int sc;
+    void *msg;
+    int64_t after;
+    uint64_t loops;
     char socket_address[128];
 
     test_addr_from(socket_address, "tcp", "127.0.0.1",
@@ -94,6 +116,71 @@ int main (int argc, const char *argv[])
 
     test_close (rep1);
 
+    /*  Messages waiting in the inproc queue are accounted to the receiver. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, "inproc://stats");
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, "inproc://stats");
+    test_send (sc, "ABC");
+    test_send (sc, "DEFG");
+    nn_sleep (100);
+    nn_assert (nn_get_statistic (sb, NN_STAT_QUEUED_BYTES) == 7);
+    nn_assert (nn_get_statistic (sc, NN_STAT_QUEUED_BYTES) == 0);
+    test_recv (sb, "ABC");
+    nn_assert (nn_get_statistic (sb, NN_STAT_QUEUED_BYTES) == 4);
+    test_recv (sb, "DEFG");
+    nn_assert (nn_get_statistic (sb, NN_STAT_QUEUED_BYTES) == 0);
+    test_send (sc, "HIJ");
+    nn_sleep (100);
+    nn_assert (nn_get_statistic (sb, NN_STAT_QUEUED_BYTES) == 3);
+    test_close (sc);
+    test_close (sb);
+
+    /*  Worker thread statistics. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    loops = nn_get_worker_statistic (0, NN_STAT_WORKER_LOOPS);
+    nn_assert (loops != (uint64_t) -1);
+    test_bind (sb, socket_address);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, socket_address);
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    nn_assert (nn_get_worker_statistic (0, NN_STAT_WORKER_LOOPS) > loops);
+    nn_assert (nn_get_worker_statistic (0, NN_STAT_WORKER_EVENTS) > 0);
+    nn_assert (nn_get_worker_statistic (0, NN_STAT_WORKER_TASKS) > 0);
+    nn_assert (nn_get_worker_statistic (0, NN_STAT_WORKER_TIMERS) !=
+        (uint64_t) -1);
+    nn_assert (nn_get_worker_statistic (0, NN_STAT_WORKER_WAIT_TIME) > 0);
+    nn_assert (nn_get_worker_statistic (0, NN_STAT_WORKER_BUSY_TIME) !=
+        (uint64_t) -1);
+    nn_assert (nn_get_worker_statistic (0, NN_STAT_WORKER_MAX_HANDLER_TIME) !=
+        (uint64_t) -1);
+    nn_assert (nn_get_worker_statistic (1, NN_STAT_WORKER_LOOPS) ==
+        (uint64_t) -1 && nn_errno () == EINVAL);
+    nn_assert (nn_get_worker_statistic (0, 0) == (uint64_t) -1 &&
+        nn_errno () == EINVAL);
+    test_close (sc);
+    test_close (sb);
+
+    /*  With no sockets open there are no worker threads. */
+    nn_assert (nn_get_worker_statistic (0, NN_STAT_WORKER_LOOPS) ==
+        (uint64_t) -1 && nn_errno () == EINVAL);
+
+    /*  Memory accounting by allocation name. */
+    nn_assert (nn_get_memory_stat (0, NULL, -1) == -1 &&
+        nn_errno () == EINVAL);
+    msg = nn_allocmsg (100000, 0);
+    alloc_assert (msg);
+    after = memory_stat ("message chunk");
+#if defined NN_ALLOC_STATS
+    nn_assert (after >= 100000);
+    nn_freemsg (msg);
+    nn_assert (memory_stat ("message chunk") <= after - 100000);
+#else
+    nn_assert (after < 0);
+    nn_freemsg (msg);
+#endif
+
     return 0;
 }
 
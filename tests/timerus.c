@@ -0,0 +1,130 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/reqrep.h"
+#include "../src/survey.h"
+
+#include "testutil.h"
+#include "../src/utils/attr.h"
+#include "../src/utils/thread.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stdlib.h>
+
+/*  Tests accuracy of timeouts specified in microseconds while the worker
+    threads are kept busy by traffic on other sockets. */
+
+#define DEADLINE 1500
+#define ROUNDS 50
+
+static char socket_address [128];
+static int stop;
+
+static int compare (const void *a, const void *b)
+{
+    return *(const int*) a - *(const int*) b;
+}
+
+/*  Keeps the worker threads busy passing a message back and forth. */
+static void load (NN_UNUSED void *arg)
+{
+    int rc;
+    int s1;
+    int s2;
+    char buf [64];
+
+    s1 = test_socket (AF_SP, NN_PAIR);
+    test_bind (s1, socket_address);
+    s2 = test_socket (AF_SP, NN_PAIR);
+    test_connect (s2, socket_address);
+    test_send (s1, "ping");
+    while (!stop) {
+        rc = nn_recv (s2, buf, sizeof (buf), 0);
+        errno_assert (rc >= 0);
+        test_send (s1, "ping");
+    }
+    test_close (s2);
+    test_close (s1);
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int s;
+    int opt;
+    size_t sz;
+    int i;
+    char buf [8];
+    int elapsed [ROUNDS];
+    struct nn_stopwatch stopwatch;
+    struct nn_thread thread;
+
+    /*  The options are visible in both units. */
+    s = test_socket (AF_SP, NN_REQ);
+    opt = 2500;
+    test_setsockopt (s, NN_REQ, NN_REQ_RESEND_IVL_US, &opt, sizeof (opt));
+    sz = sizeof (opt);
+    rc = nn_getsockopt (s, NN_REQ, NN_REQ_RESEND_IVL, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 2);
+    opt = -1;
+    rc = nn_setsockopt (s, NN_REQ, NN_REQ_RESEND_IVL_US, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    test_close (s);
+
+    test_addr_from (socket_address, "tcp", "127.0.0.1",
+        get_test_port (argc, argv));
+    stop = 0;
+    nn_thread_init (&thread, load, NULL);
+
+    /*  The survey times out as there's no one to respond. The timeout must
+        never come early, and normally no later than a fraction of
+        a millisecond. */
+    s = test_socket (AF_SP, NN_SURVEYOR);
+    opt = DEADLINE;
+    test_setsockopt (s, NN_SURVEYOR, NN_SURVEYOR_DEADLINE_US, &opt,
+        sizeof (opt));
+    sz = sizeof (opt);
+    rc = nn_getsockopt (s, NN_SURVEYOR, NN_SURVEYOR_DEADLINE_US, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == DEADLINE);
+    for (i = 0; i != ROUNDS; ++i) {
+        nn_stopwatch_init (&stopwatch);
+        test_send (s, "survey");
+        rc = nn_recv (s, buf, sizeof (buf), 0);
+        nn_assert (rc < 0 && nn_errno () == ETIMEDOUT);
+        elapsed [i] = (int) nn_stopwatch_term (&stopwatch);
+    }
+    test_close (s);
+
+    stop = 1;
+    nn_thread_term (&thread);
+
+    qsort (elapsed, ROUNDS, sizeof (int), compare);
+    nn_assert (elapsed [0] >= DEADLINE);
+    nn_assert (elapsed [ROUNDS / 2] < DEADLINE + 1000);
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+    Copyright (c) 2026 nanomsg contributors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pubsub.h"
+#include "../src/pipeline.h"
+#include "../src/udp.h"
+
+#include "testutil.h"
+
+/*  Tests UDP transport. */
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int sb;
+    int sc;
+    int i;
+    int opt;
+    size_t sz;
+    char buf [2000];
+    char addr [128];
+    char socket_address [128];
+
+    int port = get_test_port (argc, argv);
+
+    test_addr_from (socket_address, "udp", "127.0.0.1", port);
+
+    /*  Try closing bound and connected sockets with no traffic. */
+    sb = test_socket (AF_SP, NN_SUB);
+    test_bind (sb, socket_address);
+    test_close (sb);
+    sc = test_socket (AF_SP, NN_PUB);
+    test_connect (sc, socket_address);
+    test_close (sc);
+
+    /*  Check the socket options. */
+    sc = test_socket (AF_SP, NN_PUB);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sc, NN_UDP, NN_UDP_MTU, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 1500);
+    opt = 100;
+    rc = nn_setsockopt (sc, NN_UDP, NN_UDP_MTU, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 2;
+    rc = nn_setsockopt (sc, NN_UDP, NN_UDP_MULTICAST_LOOP, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 256;
+    rc = nn_setsockopt (sc, NN_UDP, NN_UDP_MULTICAST_TTL, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+
+    /*  Connected side needs a literal address. */
+    rc = nn_connect (sc, "udp://localhost:5555");
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    rc = nn_connect (sc, "udp://127.0.0.1");
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    test_close (sc);
+
+    /*  Publish-subscribe. */
+    sb = test_socket (AF_SP, NN_SUB);
+    test_setsockopt (sb, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    opt = 1000;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    sc = test_socket (AF_SP, NN_PUB);
+    test_connect (sc, socket_address);
+    for (i = 0; i != 100; ++i)
+        test_send (sc, "ABC");
+    for (i = 0; i != 100; ++i)
+        test_recv (sb, "ABC");
+
+    /*  The same address can't be bound twice. */
+    sz = (size_t) test_socket (AF_SP, NN_SUB);
+    rc = nn_bind ((int) sz, socket_address);
+    nn_assert (rc < 0 && nn_errno () == EADDRINUSE);
+    test_close ((int) sz);
+
+    /*  Messages that don't fit into the MTU are refused. */
+    memset (buf, 'x', sizeof (buf));
+    rc = nn_send (sc, buf, sizeof (buf), 0);
+    nn_assert (rc < 0 && nn_errno () == EMSGSIZE);
+    rc = nn_send (sc, buf, 1465, 0);
+    nn_assert (rc < 0 && nn_errno () == EMSGSIZE);
+    rc = nn_send (sc, buf, 1464, 0);
+    errno_assert (rc == 1464);
+    rc = nn_recv (sb, buf, sizeof (buf), 0);
+    errno_assert (rc == 1464);
+    test_close (sc);
+
+    /*  Larger MTU allows for larger messages. */
+    sc = test_socket (AF_SP, NN_PUB);
+    opt = 9000;
+    test_setsockopt (sc, NN_UDP, NN_UDP_MTU, &opt, sizeof (opt));
+    test_connect (sc, socket_address);
+    rc = nn_send (sc, buf, sizeof (buf), 0);
+    errno_assert (rc == sizeof (buf));
+    test_close (sc);
+    test_close (sb);
+
+    /*  Pipeline. Datagrams from incompatible sockets are dropped. */
+    sb = test_socket (AF_SP, NN_PULL);
+    opt = 1000;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    sc = test_socket (AF_SP, NN_PUB);
+    test_connect (sc, socket_address);
+    test_send (sc, "WRONG");
+    test_close (sc);
+    sc = test_socket (AF_SP, NN_PUSH);
+    test_connect (sc, socket_address);
+    test_send (sc, "ABC");
+    test_send (sc, "DEF");
+    test_recv (sb, "ABC");
+    test_recv (sb, "DEF");
+    test_close (sc);
+    test_close (sb);
+
+    /*  Multicast. Joining the group on the loopback interface may not be
+        permitted in the test environment, in which case the rest of
+        the test is skipped. */
+    sb = test_socket (AF_SP, NN_SUB);
+    test_setsockopt (sb, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    opt = 1000;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_addr_from (addr, "udp", "127.0.0.1;239.255.77.77", port);
+    rc = nn_bind (sb, addr);
+    if (rc >= 0) {
+        sc = test_socket (AF_SP, NN_PUB);
+        test_connect (sc, addr);
+        test_send (sc, "MULTICAST");
+        rc = nn_recv (sb, buf, sizeof (buf), 0);
+        nn_assert (rc < 0 || (rc == 9 && memcmp (buf, "MULTICAST", 9) == 0));
+        test_close (sc);
+    }
+    test_close (sb);
+
+    return 0;
+}
@@ -32,6 +32,7 @@
 #include "options.h"
 #include "../src/utils/sleep.c"
 #include "../src/utils/clock.c"
+#include "../src/utils/wire.c"
 
 #include <stdio.h>
 #include <string.h>
@@ -39,8 +40,10 @@
 #include <stdlib.h>
 #include <time.h>
 #include <ctype.h>
+#include <stdint.h>
 #if !defined NN_HAVE_WINDOWS
 #include <unistd.h>
+#include <sys/time.h>
 #endif
 
 enum echo_format {
@@ -55,6 +58,7 @@ enum echo_format {
 typedef struct nn_options {
     /* Global options */
     int verbose;
+    int worker_stats;
 
     /* Socket options */
     int socket_type;
@@ -72,6 +76,13 @@ typedef struct nn_options {
 
     /* Input options */
     enum echo_format echo_format;
+
+    /* Load options */
+    float rate;
+    char *size;
+    long count;
+    int latency;
+    float report_interval;
 } nn_options_t;
 
 /*  Constants to get address of in option declaration  */
@@ -126,6 +137,8 @@ struct nn_enum_item echo_formats[] = {
 #define NN_MASK_SOCK_SUB 8
 #define NN_MASK_DATA 16
 #define NN_MASK_ENDPOINT 32
+#define NN_MASK_RATE 64
+#define NN_MASK_LATENCY 128
 #define NN_NO_PROVIDES 0
 #define NN_NO_CONFLICTS 0
 #define NN_NO_REQUIRES 0
@@ -147,6 +160,11 @@ struct nn_option nn_options[] = {
      NN_OPT_HELP, 0, NULL,
      NN_NO_PROVIDES, NN_NO_CONFLICTS, NN_NO_REQUIRES,
      "Generic", NULL, "This help text"},
+    {"worker-stats", 0, NULL,
+     NN_OPT_INCREMENT, offsetof (nn_options_t, worker_stats), NULL,
+     NN_NO_PROVIDES, NN_NO_CONFLICTS, NN_NO_REQUIRES,
+     "Generic", NULL, "Print utilization of the library's worker thread "
+     "when done (and with every --report)"},
 
     /* Socket types */
     {"push", 0, "nn_push",
@@ -293,6 +311,36 @@ struct nn_option nn_options[] = {
      NN_MASK_DATA, NN_MASK_DATA, NN_MASK_WRITEABLE,
      "Output Options", "PATH", "Same as --data but get data from file PATH"},
 
+    /* Load Options */
+    {"rate", 0, NULL,
+     NN_OPT_FLOAT, offsetof (nn_options_t, rate), NULL,
+     NN_MASK_DATA | NN_MASK_RATE, NN_MASK_DATA, NN_MASK_WRITEABLE,
+     "Load Options", "MSGS", "Send MSGS timestamped messages per second "
+     "on a fixed schedule, regardless of how fast the peers are "
+     "(PUSH, PUB, BUS and PAIR sockets only)"},
+    {"size", 0, NULL,
+     NN_OPT_STRING, offsetof (nn_options_t, size), NULL,
+     NN_NO_PROVIDES, NN_NO_CONFLICTS, NN_MASK_RATE,
+     "Load Options", "SIZES", "Size of the messages sent with --rate. "
+     "Either a fixed size (N), a uniform range (MIN-MAX) or a list of "
+     "sizes to pick from at random (N1,N2,...). At least 16 bytes. "
+     "Default is 64."},
+    {"count", 0, NULL,
+     NN_OPT_INT, offsetof (nn_options_t, count), NULL,
+     NN_NO_PROVIDES, NN_NO_CONFLICTS, NN_NO_REQUIRES,
+     "Load Options", "NUM", "Stop after sending (with --rate) or "
+     "receiving (with --latency) NUM messages"},
+    {"latency", 0, NULL,
+     NN_OPT_INCREMENT, offsetof (nn_options_t, latency), NULL,
+     NN_MASK_LATENCY, NN_NO_CONFLICTS, NN_MASK_READABLE,
+     "Load Options", NULL, "Measure the latency of the messages sent "
+     "by --rate and print the histogram when done"},
+    {"report", 0, NULL,
+     NN_OPT_FLOAT, offsetof (nn_options_t, report_interval), NULL,
+     NN_NO_PROVIDES, NN_NO_CONFLICTS, NN_MASK_LATENCY,
+     "Load Options", "SEC", "Print latencies measured in the last SEC "
+     "seconds every SEC seconds"},
+
     /* Sentinel */
     {NULL, 0, NULL,
      0, 0, NULL,
@@ -595,11 +643,500 @@ void nn_resp_loop (nn_options_t *options, int sock)
     }
 }
 
+/*  Every message sent in the load mode starts with this header: the time
+    the message was scheduled to be sent at (microseconds since the epoch),
+    random identifier of the sender and the sequence number of the message.
+    Note that the time is the scheduled one rather than the actual time of
+    the send so that any stall of the sender or backpressure from the
+    network shows up in the latencies instead of silently lowering the
+    rate (the so called coordinated omission). */
+#define NN_LOAD_HDRSIZE 16
+
+/*  Latency histogram with 32 linear sub-buckets per each power of two,
+    i.e. with the resolution of about 3%. */
+#define NN_HIST_SUB 32
+#define NN_HIST_BUCKETS (NN_HIST_SUB * 60)
+
+/*  Maximum number of distinct senders tracked for lost messages. */
+#define NN_LOAD_MAXSENDERS 64
+
+struct nn_hist {
+    uint64_t buckets [NN_HIST_BUCKETS];
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+};
+
+struct nn_load_sender {
+    uint32_t id;
+    uint32_t next;
+};
+
+struct nn_load {
+    /*  Sending side. */
+    size_t *sizes;
+    int nsizes;
+    size_t minsize;
+    size_t maxsize;
+    uint64_t rng;
+    uint32_t id;
+    uint32_t seq;
+    uint64_t sent;
+    uint64_t failed;
+    uint64_t maxlag;
+
+    /*  Receiving side. */
+    struct nn_hist total;
+    struct nn_hist interval;
+    struct nn_load_sender senders [NN_LOAD_MAXSENDERS];
+    int nsenders;
+    uint64_t received;
+    uint64_t lost;
+    uint64_t malformed;
+
+    /*  Offset to convert monotonic time to wall-clock time. */
+    int64_t offset;
+};
+
+uint64_t nn_load_mono_us (void)
+{
+#if defined NN_HAVE_WINDOWS
+    LARGE_INTEGER tps;
+    LARGE_INTEGER time;
+
+    QueryPerformanceFrequency (&tps);
+    QueryPerformanceCounter (&time);
+    return (uint64_t) (time.QuadPart / tps.QuadPart * 1000000 +
+        time.QuadPart % tps.QuadPart * 1000000 / tps.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+uint64_t nn_load_wall_us (void)
+{
+#if defined NN_HAVE_WINDOWS
+    FILETIME ft;
+    ULARGE_INTEGER t;
+
+    /*  FILETIME counts 100ns intervals since 1601-01-01. */
+    GetSystemTimeAsFileTime (&ft);
+    t.LowPart = ft.dwLowDateTime;
+    t.HighPart = ft.dwHighDateTime;
+    return t.QuadPart / 10 - 11644473600000000ULL;
+#else
+    struct timeval tv;
+
+    gettimeofday (&tv, NULL);
+    return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+uint64_t nn_load_random (struct nn_load *load)
+{
+    /*  xorshift64*  */
+    load->rng ^= load->rng >> 12;
+    load->rng ^= load->rng << 25;
+    load->rng ^= load->rng >> 27;
+    return load->rng * 2685821657736338717ULL;
+}
+
+int nn_hist_index (uint64_t val)
+{
+    int e;
+
+    e = 0;
+    while ((val >> e) >= 2 * NN_HIST_SUB)
+        ++e;
+    return e * NN_HIST_SUB + (int) (val >> e);
+}
+
+/*  Returns the highest value that falls into the bucket. */
+uint64_t nn_hist_value (int index)
+{
+    int e;
+
+    if (index < 2 * NN_HIST_SUB)
+        return index;
+    e = index / NN_HIST_SUB - 1;
+    return (((uint64_t) (index - e * NN_HIST_SUB) + 1) << e) - 1;
+}
+
+void nn_hist_reset (struct nn_hist *hist)
+{
+    memset (hist, 0, sizeof (struct nn_hist));
+}
+
+void nn_hist_record (struct nn_hist *hist, uint64_t val)
+{
+    int index;
+
+    index = nn_hist_index (val);
+    if (index >= NN_HIST_BUCKETS)
+        index = NN_HIST_BUCKETS - 1;
+    ++hist->buckets [index];
+    if (hist->count == 0 || val < hist->min)
+        hist->min = val;
+    if (val > hist->max)
+        hist->max = val;
+    ++hist->count;
+}
+
+uint64_t nn_hist_percentile (struct nn_hist *hist, double p)
+{
+    int i;
+    uint64_t rank;
+    uint64_t seen;
+
+    rank = (uint64_t) (p / 100.0 * (double) hist->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    seen = 0;
+    for (i = 0; i != NN_HIST_BUCKETS; ++i) {
+        seen += hist->buckets [i];
+        if (seen >= rank)
+            return nn_hist_value (i) < hist->max ?
+                nn_hist_value (i) : hist->max;
+    }
+    return hist->max;
+}
+
+void nn_hist_print (struct nn_hist *hist, const char *label)
+{
+    if (hist->count == 0) {
+        fprintf (stdout, "%s: no messages\n", label);
+    }
+    else {
+        fprintf (stdout, "%s: count=%llu min=%llu p50=%llu p90=%llu p99=%llu "
+            "p99.9=%llu p99.99=%llu max=%llu (us)\n", label,
+            (unsigned long long) hist->count,
+            (unsigned long long) hist->min,
+            (unsigned long long) nn_hist_percentile (hist, 50.0),
+            (unsigned long long) nn_hist_percentile (hist, 90.0),
+            (unsigned long long) nn_hist_percentile (hist, 99.0),
+            (unsigned long long) nn_hist_percentile (hist, 99.9),
+            (unsigned long long) nn_hist_percentile (hist, 99.99),
+            (unsigned long long) hist->max);
+    }
+    fflush (stdout);
+}
+
+void nn_load_parse_sizes (nn_options_t *options, struct nn_load *load)
+{
+    char *spec;
+    char *end;
+    long val;
+    int i;
+
+    spec = options->size ? options->size : "64";
+    load->sizes = malloc ((strlen (spec) / 2 + 1) * sizeof (size_t));
+    nn_assert_errno (load->sizes != NULL, "Can't allocate sizes");
+    load->nsizes = 0;
+    load->minsize = 0;
+    load->maxsize = 0;
+
+    for (;;) {
+        val = strtol (spec, &end, 10);
+        if (end == spec || val < NN_LOAD_HDRSIZE)
+            goto invalid;
+        load->sizes [load->nsizes++] = (size_t) val;
+        if (*end == '-' && load->nsizes == 1) {
+            spec = end + 1;
+            val = strtol (spec, &end, 10);
+            if (end == spec || *end || (size_t) val < load->sizes [0])
+                goto invalid;
+            load->minsize = load->sizes [0];
+            load->maxsize = (size_t) val;
+            load->nsizes = 0;
+            return;
+        }
+        if (!*end)
+            break;
+        if (*end != ',')
+            goto invalid;
+        spec = end + 1;
+    }
+
+    for (i = 0; i != load->nsizes; ++i)
+        if (load->sizes [i] > load->maxsize)
+            load->maxsize = load->sizes [i];
+    return;
+
+invalid:
+    fprintf (stderr, "Invalid --size: %s (sizes must be at least %d bytes)\n",
+        options->size, NN_LOAD_HDRSIZE);
+    exit (3);
+}
+
+size_t nn_load_size (struct nn_load *load)
+{
+    if (load->nsizes == 0)
+        return load->minsize +
+            (size_t) (nn_load_random (load) %
+            (load->maxsize - load->minsize + 1));
+    if (load->nsizes == 1)
+        return load->sizes [0];
+    return load->sizes [nn_load_random (load) % load->nsizes];
+}
+
+void nn_load_send (struct nn_load *load, int sock, uint64_t scheduled,
+    uint64_t now)
+{
+    int rc;
+    size_t sz;
+    uint8_t *msg;
+
+    if (now - scheduled > load->maxlag)
+        load->maxlag = now - scheduled;
+
+    /*  The message is allocated by nanomsg and handed over to the socket
+        so that it's never copied on the way to the transport. */
+    sz = nn_load_size (load);
+    msg = nn_allocmsg (sz, 0);
+    nn_assert_errno (msg != NULL, "Can't allocate message");
+    nn_putll (msg, scheduled + load->offset);
+    nn_putl (msg + 8, load->id);
+    nn_putl (msg + 12, load->seq++);
+    memset (msg + NN_LOAD_HDRSIZE, 0, sz - NN_LOAD_HDRSIZE);
+
+    rc = nn_send (sock, &msg, NN_MSG, 0);
+    if (rc < 0 && (errno == EAGAIN || errno == ETIMEDOUT)) {
+        nn_freemsg (msg);
+        ++load->failed;
+    } else {
+        nn_assert_errno (rc >= 0, "Can't send");
+        ++load->sent;
+    }
+}
+
+void nn_load_recv (nn_options_t *options, struct nn_load *load,
+    void *buf, int len)
+{
+    int i;
+    uint64_t sent;
+    uint64_t now;
+    uint64_t lat;
+    uint32_t id;
+    uint32_t seq;
+    struct nn_load_sender *sender;
+
+    if (len < NN_LOAD_HDRSIZE) {
+        ++load->malformed;
+        return;
+    }
+    nn_print_message (options, buf, len);
+
+    now = nn_load_wall_us ();
+    sent = nn_getll (buf);
+    id = nn_getl ((uint8_t*) buf + 8);
+    seq = nn_getl ((uint8_t*) buf + 12);
+
+    /*  Clocks of different hosts may be skewed. Don't let the latency go
+        negative. */
+    lat = now > sent ? now - sent : 0;
+    nn_hist_record (&load->total, lat);
+    nn_hist_record (&load->interval, lat);
+    ++load->received;
+
+    /*  Gaps in the sequence numbers are the messages that were lost. */
+    sender = NULL;
+    for (i = 0; i != load->nsenders; ++i) {
+        if (load->senders [i].id == id) {
+            sender = &load->senders [i];
+            break;
+        }
+    }
+    if (!sender) {
+        if (load->nsenders == NN_LOAD_MAXSENDERS)
+            return;
+        sender = &load->senders [load->nsenders++];
+        sender->id = id;
+        sender->next = seq;
+    }
+    if ((int32_t) (seq - sender->next) > 0)
+        load->lost += seq - sender->next;
+    if ((int32_t) (seq - sender->next) >= 0)
+        sender->next = seq + 1;
+}
+
+/*  Prints the counters of the library's worker thread. Utilization is
+    the share of the time the thread spent processing events rather than
+    waiting for them since the previous call. */
+void nn_print_worker_stats (void)
+{
+    static uint64_t prev_busy = 0;
+    static uint64_t prev_wait = 0;
+    uint64_t busy;
+    uint64_t wait;
+
+    busy = nn_get_worker_statistic (0, NN_STAT_WORKER_BUSY_TIME);
+    wait = nn_get_worker_statistic (0, NN_STAT_WORKER_WAIT_TIME);
+    if (busy == (uint64_t) -1 || wait == (uint64_t) -1)
+        return;
+    fprintf (stderr, "worker: loops=%llu events=%llu tasks=%llu timers=%llu "
+        "busy=%llu wait=%llu max-handler=%llu (us) utilization=%.1f%%\n",
+        (unsigned long long) nn_get_worker_statistic (0,
+            NN_STAT_WORKER_LOOPS),
+        (unsigned long long) nn_get_worker_statistic (0,
+            NN_STAT_WORKER_EVENTS),
+        (unsigned long long) nn_get_worker_statistic (0,
+            NN_STAT_WORKER_TASKS),
+        (unsigned long long) nn_get_worker_statistic (0,
+            NN_STAT_WORKER_TIMERS),
+        (unsigned long long) busy, (unsigned long long) wait,
+        (unsigned long long) nn_get_worker_statistic (0,
+            NN_STAT_WORKER_MAX_HANDLER_TIME),
+        busy + wait > prev_busy + prev_wait ?
+            100.0 * (double) (busy - prev_busy) /
+            (double) (busy + wait - prev_busy - prev_wait) : 0.0);
+    prev_busy = busy;
+    prev_wait = wait;
+}
+
+void nn_load_loop (nn_options_t *options, int sock)
+{
+    int rc;
+    void *buf;
+    int sending;
+    int receiving;
+    uint64_t start;
+    uint64_t now;
+    uint64_t next;
+    uint64_t deadline;
+    uint64_t idle;
+    uint64_t period;
+    uint64_t report;
+    uint64_t next_report;
+    uint64_t recv_timeout;
+    struct nn_pollfd pfd;
+    struct nn_load load;
+
+    switch (options->socket_type) {
+    case NN_PUSH:
+    case NN_PUB:
+    case NN_PULL:
+    case NN_SUB:
+    case NN_BUS:
+    case NN_PAIR:
+        break;
+    default:
+        fprintf (stderr, "Load options can be used only with PUSH, PULL, "
+            "PUB, SUB, BUS and PAIR sockets\n");
+        exit (3);
+    }
+
+    memset (&load, 0, sizeof (load));
+    start = nn_load_mono_us ();
+    load.offset = (int64_t) (nn_load_wall_us () - start);
+    load.rng = (start ^ (uint64_t) (size_t) &load) | 1;
+    load.id = (uint32_t) nn_load_random (&load);
+
+    sending = options->rate > 0;
+    receiving = options->latency;
+    period = 0;
+    if (sending) {
+        nn_load_parse_sizes (options, &load);
+        period = (uint64_t) (1000000.0 / options->rate);
+    }
+    report = (uint64_t) (options->report_interval * 1000000);
+    recv_timeout = options->recv_timeout >= 0 ?
+        (uint64_t) (options->recv_timeout * 1000000) : UINT64_MAX;
+    next = start;
+    next_report = start + report;
+    idle = start;
+
+    pfd.fd = sock;
+    pfd.events = NN_POLLIN;
+
+    for (;;) {
+        now = nn_load_mono_us ();
+
+        /*  Send all the messages that are due. If the sender fell behind
+            the schedule, the missed messages are sent back to back. */
+        while (sending && next <= now) {
+            nn_load_send (&load, sock, next, now);
+            next += period;
+            if (options->count > 0 && load.sent + load.failed >=
+                  (uint64_t) options->count)
+                sending = 0;
+            now = nn_load_mono_us ();
+        }
+
+        if (report && now >= next_report) {
+            nn_hist_print (&load.interval, "interval");
+            nn_hist_reset (&load.interval);
+            if (options->worker_stats)
+                nn_print_worker_stats ();
+            next_report += report;
+        }
+
+        if (receiving && (now - idle >= recv_timeout || (options->count > 0 &&
+              load.received >= (uint64_t) options->count)))
+            receiving = 0;
+        if (!sending && !receiving)
+            break;
+
+        /*  Wait till the next thing to do. */
+        deadline = UINT64_MAX;
+        if (sending)
+            deadline = next;
+        if (report && next_report < deadline)
+            deadline = next_report;
+        if (receiving && recv_timeout != UINT64_MAX &&
+              idle + recv_timeout < deadline)
+            deadline = idle + recv_timeout;
+        if (!receiving) {
+            if (deadline - now >= 1000)
+                nn_sleep ((int) ((deadline - now) / 1000));
+            continue;
+        }
+        rc = nn_poll (&pfd, 1, deadline == UINT64_MAX ? -1 :
+            (int) ((deadline - now) / 1000));
+        if (rc < 0 && errno == EINTR)
+            continue;
+        nn_assert_errno (rc >= 0, "Can't poll");
+        if (rc == 0)
+            continue;
+        for (;;) {
+            rc = nn_recv (sock, &buf, NN_MSG, NN_DONTWAIT);
+            if (rc < 0 && errno == EAGAIN)
+                break;
+            nn_assert_errno (rc >= 0, "Can't recv");
+            nn_load_recv (options, &load, buf, rc);
+            nn_freemsg (buf);
+            idle = nn_load_mono_us ();
+            if (options->count > 0 && load.received >= (uint64_t) options->count)
+                break;
+        }
+    }
+
+    now = nn_load_mono_us ();
+    if (options->rate > 0) {
+        fprintf (stdout, "sent: count=%llu failed=%llu rate=%.1f/s "
+            "max-lag=%llu (us)\n", (unsigned long long) load.sent,
+            (unsigned long long) load.failed,
+            now > start ? (double) load.sent * 1e6 / (double) (now - start) :
+            0.0, (unsigned long long) load.maxlag);
+    }
+    if (options->latency) {
+        fprintf (stdout, "received: count=%llu lost=%llu malformed=%llu\n",
+            (unsigned long long) load.received,
+            (unsigned long long) load.lost,
+            (unsigned long long) load.malformed);
+        nn_hist_print (&load.total, "latency");
+    }
+    free (load.sizes);
+}
+
 int main (int argc, char **argv)
 {
     int sock;
     nn_options_t options = {
         /* verbose           */ 0,
+        /* worker_stats      */ 0,
         /* socket_type       */ 0,
         /* bind_addresses    */ {NULL, NULL, 0, 0},
         /* connect_addresses */ {NULL, NULL, 0, 0},
@@ -610,13 +1147,26 @@ int main (int argc, char **argv)
         /* send_delay        */ 0.f,
         /* send_interval     */ -1.f,
         /* data_to_send      */ {NULL, 0, 0},
-        /* echo_format       */ NN_NO_ECHO
+        /* echo_format       */ NN_NO_ECHO,
+        /* rate              */ 0.f,
+        /* size              */ NULL,
+        /* count             */ 0,
+        /* latency           */ 0,
+        /* report_interval   */ 0.f
     };
 
     nn_parse_options (&nn_cli, &options, argc, argv);
     sock = nn_create_socket (&options);
     nn_connect_socket (&options, sock);
     nn_sleep((int)(options.send_delay*1000));
+    if (options.rate > 0 || options.latency) {
+        nn_load_loop (&options, sock);
+        if (options.worker_stats)
+            nn_print_worker_stats ();
+        nn_close (sock);
+        nn_free_options(&nn_cli, &options);
+        return 0;
+    }
     switch (options.socket_type) {
     case NN_PUB:
     case NN_PUSH:
@@ -648,6 +1198,8 @@ int main (int argc, char **argv)
         break;
     }
 
+    if (options.worker_stats)
+        nn_print_worker_stats ();
     nn_close (sock);
     nn_free_options(&nn_cli, &options);
     return 0;